@@ -0,0 +1,615 @@
+#include "AssetBaker.h"
+#include "Archive.h"
+#include "File.h"
+#include "Image.h"
+#include "MeshCodec.h"
+#include "MeshOptimizer.h"
+#include "ObjLoader.h"
+#include "Parallel.h"
+#include "Welder.h"
+
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <mutex>
+#include <unordered_set>
+
+#include <stb/stb_image.h>
+
+#ifdef _WIN32
+  #define WIN32_LEAN_AND_MEAN
+  #define NOMINMAX
+  #include <Windows.h>
+  #include <d3dcompiler.h>
+  #pragma comment (lib, "d3dcompiler.lib")
+#endif // _WIN32
+
+enum class BakeKind : uint8_t
+{
+    Mesh,
+    Image,
+    Shader,
+};
+
+enum class BakeResult : uint8_t
+{
+    Baked,
+    Skipped,
+    Failed,
+};
+
+struct BakeInput
+{
+    std::filesystem::path Source = {};
+    BakeKind              Kind   = BakeKind::Mesh;
+};
+
+// What an output was made from, every hash has to match for it to be up to date
+struct BakeRecord
+{
+    uint64_t                          SourceHash   = 0u;
+    uint64_t                          Recipe       = 0u;
+    List<std::pair<String, uint64_t>> Dependencies = {}; // Relative to the root, with their content hashes
+};
+
+using BakeDatabase = Dictionary<String, BakeRecord>; // By source path relative to the root
+
+static constexpr const char* s_DatabaseHeader = "BAKE 1";
+
+// Bumped whenever a conversion changes its output for the same input
+static constexpr uint32_t s_MeshRecipeVersion   = 1u;
+static constexpr uint32_t s_ShaderRecipeVersion = 1u;
+
+// BAKE INPUTS
+static bool GetKind(const std::filesystem::path& Filepath, BakeKind& Kind) noexcept
+{
+    String Extension = Filepath.extension().string();
+    std::transform(Extension.begin(), Extension.end(), Extension.begin(), [](char c) { return char(tolower(c)); });
+
+    if (Extension == ".obj")
+    {
+        Kind = BakeKind::Mesh;
+        return true;
+    }
+    if (Extension == ".png" || Extension == ".jpg" || Extension == ".jpeg" || Extension == ".tga" || Extension == ".bmp")
+    {
+        Kind = BakeKind::Image;
+        return true;
+    }
+    if (Extension == ".hlsl")
+    {
+        Kind = BakeKind::Shader;
+        return true;
+    }
+    return false;
+}
+
+static const char* GetOutputExtension(BakeKind Kind) noexcept
+{
+    switch (Kind)
+    {
+        case BakeKind::Mesh:   return ".mesh";
+        case BakeKind::Image:  return ".image";
+        case BakeKind::Shader: return ".cso";
+    }
+    return "";
+}
+
+static uint64_t GetRecipe(BakeKind Kind) noexcept
+{
+    uint32_t kRecipe[3] = { uint32_t(Kind), 0u, 0u };
+    switch (Kind)
+    {
+        case BakeKind::Mesh:
+            kRecipe[1] = s_MeshRecipeVersion;
+            kRecipe[2] = MeshCodec::Version;
+            break;
+        case BakeKind::Image:
+            kRecipe[1] = Image::BakedHeader().Version;
+            break;
+        case BakeKind::Shader:
+            kRecipe[1] = s_ShaderRecipeVersion;
+            break;
+    }
+    return HashBytes(kRecipe, sizeof(kRecipe));
+}
+
+// Stage from the file name, as the renderer's shaders are named: "...VS.hlsl" and "...PS.hlsl"
+static const char* GetShaderTarget(const std::filesystem::path& Filepath) noexcept
+{
+    const String Stem = Filepath.stem().string();
+    if (Stem.size() > 2u && Stem.compare(Stem.size() - 2u, 2u, "VS") == 0)
+    {
+        return "vs_5_0";
+    }
+    if (Stem.size() > 2u && Stem.compare(Stem.size() - 2u, 2u, "PS") == 0)
+    {
+        return "ps_5_0";
+    }
+    return nullptr;
+}
+
+static bool HashFile(const std::filesystem::path& Filepath, uint64_t& kHash) noexcept
+{
+    const MappedFile File = MappedFile(Filepath.string().c_str());
+    if (!File.IsOpen())
+    {
+        return false;
+    }
+    kHash = HashBytes(File.GetData(), File.GetSize());
+    return true;
+}
+
+// DEPENDENCIES
+// Quoted file names after a keyword at the start of a line, e.g. '#include "Common.hlsli"' or 'mtllib Sphere.mtl'
+static void FindReferences(const std::filesystem::path& Filepath, const String& Keyword, bool bRecursive, std::unordered_set<String>& Visited, List<std::filesystem::path>& Files) noexcept
+{
+    const MappedFile File = MappedFile(Filepath.string().c_str());
+    if (!File.IsOpen())
+    {
+        return;
+    }
+
+    const char* pText = reinterpret_cast<const char*>(File.GetData());
+    const char* pEnd  = pText + File.GetSize();
+    while (pText < pEnd)
+    {
+        const char* pLineEnd = std::find(pText, pEnd, '\n');
+        while (pText < pLineEnd && (*pText == ' ' || *pText == '\t'))
+        {
+            pText++;
+        }
+
+        if (size_t(pLineEnd - pText) > Keyword.size() && Keyword.compare(0u, Keyword.size(), pText, Keyword.size()) == 0)
+        {
+            const char* pName    = pText + Keyword.size();
+            const char* pNameEnd = pLineEnd;
+            while (pName < pNameEnd && (*pName == ' ' || *pName == '\t' || *pName == '"'))
+            {
+                pName++;
+            }
+            while (pNameEnd > pName && (pNameEnd[-1] == '\r' || pNameEnd[-1] == ' ' || pNameEnd[-1] == '\t' || pNameEnd[-1] == '"'))
+            {
+                pNameEnd--;
+            }
+
+            // Missing files are recorded too, with a zero hash, so the input is baked again once they show up
+            const std::filesystem::path Reference = (Filepath.parent_path() / String(pName, pNameEnd)).lexically_normal();
+            if (pName < pNameEnd && Visited.insert(Reference.generic_string()).second)
+            {
+                Files.push_back(Reference);
+                if (bRecursive)
+                {
+                    FindReferences(Reference, Keyword, bRecursive, Visited, Files);
+                }
+            }
+        }
+        pText = pLineEnd + 1;
+    }
+}
+
+static List<std::filesystem::path> FindDependencies(const BakeInput& Input) noexcept
+{
+    std::unordered_set<String>  Visited = {};
+    List<std::filesystem::path> Files   = {};
+    switch (Input.Kind)
+    {
+        case BakeKind::Mesh:
+            // Materials group the triangles into submeshes, which changes the index order
+            FindReferences(Input.Source, "mtllib", false, Visited, Files);
+            break;
+        case BakeKind::Shader:
+            FindReferences(Input.Source, "#include", true, Visited, Files);
+            break;
+        case BakeKind::Image:
+            break;
+    }
+    return Files;
+}
+
+// DATABASE
+static void ReadDatabase(const std::filesystem::path& Filepath, BakeDatabase& Database) noexcept
+{
+    const MappedFile File = MappedFile(Filepath.string().c_str());
+    if (!File.IsOpen())
+    {
+        return;
+    }
+
+    const char* pText   = reinterpret_cast<const char*>(File.GetData());
+    const char* pEnd    = pText + File.GetSize();
+    BakeRecord* pRecord = nullptr;
+    bool        bHeader = true;
+    while (pText < pEnd)
+    {
+        const char*  pLineEnd = std::find(pText, pEnd, '\n');
+        const String Line     = String(pText, pLineEnd);
+        pText = pLineEnd + 1;
+
+        // A database from another version is thrown away whole, everything is baked again
+        if (bHeader)
+        {
+            if (Line != s_DatabaseHeader)
+            {
+                return;
+            }
+            bHeader = false;
+            continue;
+        }
+
+        // "S <source hash> <recipe> <path>" starts a record, "D <hash> <path>" lines after it are its dependencies
+        char*          pField = nullptr;
+        const uint64_t kHash  = Line.size() > 2u ? strtoull(Line.c_str() + 2u, &pField, 16) : 0u;
+        if (Line.size() > 2u && Line[0] == 'S')
+        {
+            const uint64_t kRecipe = strtoull(pField, &pField, 16);
+            pRecord = &Database[String(pField + 1)];
+            pRecord->SourceHash = kHash;
+            pRecord->Recipe     = kRecipe;
+        }
+        else if (Line.size() > 2u && Line[0] == 'D' && pRecord != nullptr)
+        {
+            pRecord->Dependencies.emplace_back(String(pField + 1), kHash);
+        }
+    }
+}
+
+static bool WriteDatabase(const std::filesystem::path& Filepath, const BakeDatabase& Database) noexcept
+{
+    // Sorted, so the file only changes where the inputs did
+    List<const BakeDatabase::value_type*> Records = {};
+    for (const BakeDatabase::value_type& Record : Database)
+    {
+        Records.push_back(&Record);
+    }
+    std::sort(Records.begin(), Records.end(), [](const auto* a, const auto* b) { return a->first < b->first; });
+
+    String Text = String(s_DatabaseHeader) + "\n";
+    char   lpLine[64] = {};
+    for (const BakeDatabase::value_type* pRecord : Records)
+    {
+        snprintf(lpLine, sizeof(lpLine), "S %016llx %016llx ", (unsigned long long)pRecord->second.SourceHash, (unsigned long long)pRecord->second.Recipe);
+        Text += lpLine + pRecord->first + "\n";
+        for (const auto&[Dependency, kHash] : pRecord->second.Dependencies)
+        {
+            snprintf(lpLine, sizeof(lpLine), "D %016llx ", (unsigned long long)kHash);
+            Text += lpLine + Dependency + "\n";
+        }
+    }
+    return SaveFile(Filepath.string().c_str(), Text.data(), Text.size());
+}
+
+// CONVERSIONS
+// The same steps the renderer takes importing an OBJ file before it writes its own .mesh, the two are interchangeable
+static BakeResult BakeMesh(const std::filesystem::path& Source, const std::filesystem::path& Output, String& Error) noexcept
+{
+    ObjModel Model = {};
+    if (!ObjLoader::LoadFromFile(Source.string().c_str(), Model) || Model.Vertices.empty())
+    {
+        Error = "no geometry could be read";
+        return BakeResult::Failed;
+    }
+
+    List<MeshVertex> Vertices = std::move(Model.Vertices);
+    List<uint32_t>   Indices  = std::move(Model.Indices);
+    VertexWelder::Weld(Vertices, Indices);
+    MeshOptimizer::Optimize(Vertices, Indices);
+
+    if (!MeshCodec::SaveToFile(Output.string().c_str(), Vertices, Indices))
+    {
+        Error = "the output could not be written";
+        return BakeResult::Failed;
+    }
+    return BakeResult::Baked;
+}
+
+static BakeResult BakeImage(const std::filesystem::path& Source, const std::filesystem::path& Output, String& Error) noexcept
+{
+    // Decoded here rather than through Image, which would load the very output being replaced
+    int32_t  kWidth    = 0;
+    int32_t  kHeight   = 0;
+    int32_t  kChannels = 0;
+    stbi_uc* pPixels   = stbi_load(Source.string().c_str(), &kWidth, &kHeight, &kChannels, 4);
+    if (pPixels == nullptr || kWidth < 1 || kHeight < 1)
+    {
+        Error = pPixels == nullptr ? stbi_failure_reason() : "empty image";
+        stbi_image_free(pPixels);
+        return BakeResult::Failed;
+    }
+
+    const bool bSaved = Image::SaveBaked(Output.string().c_str(), reinterpret_cast<const Pixel*>(pPixels), uint32_t(kWidth), uint32_t(kHeight));
+    stbi_image_free(pPixels);
+    if (!bSaved)
+    {
+        Error = "the output could not be written";
+        return BakeResult::Failed;
+    }
+    return BakeResult::Baked;
+}
+
+static BakeResult BakeShader(const std::filesystem::path& Source, const std::filesystem::path& Output, String& Error) noexcept
+{
+    const char* lpTarget = GetShaderTarget(Source);
+    if (lpTarget == nullptr)
+    {
+        Error = "no stage in the file name, expected ...VS.hlsl or ...PS.hlsl";
+        return BakeResult::Skipped;
+    }
+
+#ifdef _WIN32
+    const MappedFile File = MappedFile(Source.string().c_str());
+    if (!File.IsOpen())
+    {
+        Error = "the file could not be read";
+        return BakeResult::Failed;
+    }
+
+    ID3DBlob*     pBlob   = nullptr;
+    ID3DBlob*     pErrors = nullptr;
+    const String  Name    = Source.string();
+    const HRESULT hResult = D3DCompile(File.GetData(), File.GetSize(), Name.c_str(), nullptr, D3D_COMPILE_STANDARD_FILE_INCLUDE,
+                                       "Main", lpTarget, D3DCOMPILE_OPTIMIZATION_LEVEL3, 0u, &pBlob, &pErrors);
+    if (pErrors != nullptr)
+    {
+        Error.assign(static_cast<const char*>(pErrors->GetBufferPointer()), pErrors->GetBufferSize());
+        pErrors->Release();
+    }
+    if (FAILED(hResult) || pBlob == nullptr)
+    {
+        if (pBlob != nullptr)
+        {
+            pBlob->Release();
+        }
+        return BakeResult::Failed;
+    }
+
+    const bool bSaved = SaveFile(Output.string().c_str(), pBlob->GetBufferPointer(), pBlob->GetBufferSize());
+    pBlob->Release();
+    if (!bSaved)
+    {
+        Error = "the output could not be written";
+        return BakeResult::Failed;
+    }
+    return BakeResult::Baked;
+#else
+    (void)Output;
+    Error = "no HLSL compiler on this platform";
+    return BakeResult::Skipped;
+#endif // _WIN32
+}
+
+// ASSET BAKER
+BakeStatistics AssetBaker::Bake(const BakeOptions& Options) noexcept
+{
+    const auto Start = std::chrono::steady_clock::now();
+
+    const std::filesystem::path Root         = Options.Root.lexically_normal();
+    const std::filesystem::path DatabasePath = Options.Database.empty() ? Root / ".bake" : Options.Database;
+
+    BakeStatistics Statistics = {};
+    BakeDatabase   Previous   = {};
+    BakeDatabase   Current    = {};
+    std::mutex     Mutex      = {};
+    if (!Options.bForce)
+    {
+        ReadDatabase(DatabasePath, Previous);
+    }
+
+    // Sorted so the log reads the same from run to run, whatever order the workers finish in
+    List<BakeInput> Inputs = {};
+    std::error_code Error  = {};
+    for (std::filesystem::recursive_directory_iterator it = std::filesystem::recursive_directory_iterator(Root, Error), End = {}; !Error && it != End; it.increment(Error))
+    {
+        BakeInput Input = {};
+        if (it->is_regular_file(Error) && GetKind(it->path(), Input.Kind))
+        {
+            Input.Source = it->path().lexically_normal();
+            Inputs.push_back(Input);
+        }
+    }
+    std::sort(Inputs.begin(), Inputs.end(), [](const BakeInput& a, const BakeInput& b) { return a.Source < b.Source; });
+    Statistics.Inputs = uint32_t(Inputs.size());
+
+    // One input at a time per worker, handed out as they finish since a large mesh can take as long as the rest together
+    std::atomic<size_t> kNext    = 0u;
+    const uint32_t      kWorkers = Options.Workers != 0u ? Options.Workers : Parallel::GetWorkerCount();
+    Parallel::For(std::min<size_t>(kWorkers, Inputs.size()), 1u, [&](size_t, size_t)
+    {
+        for (size_t k = kNext++; k < Inputs.size(); k = kNext++)
+        {
+            const BakeInput&            Input  = Inputs[k];
+            const String                Name   = Input.Source.lexically_relative(Root).generic_string();
+            const std::filesystem::path Output = Input.Source.string() + GetOutputExtension(Input.Kind);
+
+            BakeRecord Record = {};
+            Record.Recipe = GetRecipe(Input.Kind);
+            if (!HashFile(Input.Source, Record.SourceHash))
+            {
+                std::lock_guard<std::mutex> Lock = std::lock_guard<std::mutex>(Mutex);
+                fprintf(stderr, "[Bake] failed %s: the file could not be read\n", Name.c_str());
+                Statistics.Failed++;
+                continue;
+            }
+            for (const std::filesystem::path& Dependency : FindDependencies(Input))
+            {
+                uint64_t kHash = 0u;
+                HashFile(Dependency, kHash);
+                Record.Dependencies.emplace_back(Dependency.lexically_relative(Root).generic_string(), kHash);
+            }
+
+            bool bUpToDate = false;
+            {
+                std::lock_guard<std::mutex> Lock = std::lock_guard<std::mutex>(Mutex);
+                auto it = Previous.find(Name);
+                bUpToDate = it != Previous.end() && it->second.SourceHash == Record.SourceHash && it->second.Recipe == Record.Recipe &&
+                            it->second.Dependencies == Record.Dependencies && std::filesystem::exists(Output, Error);
+            }
+
+            if (bUpToDate)
+            {
+                // The renderer goes by timestamps, an output older than an unchanged source would be passed over
+                std::error_code TimeError = {};
+                if (std::filesystem::last_write_time(Output, TimeError) < std::filesystem::last_write_time(Input.Source, TimeError))
+                {
+                    std::filesystem::last_write_time(Output, std::filesystem::file_time_type::clock::now(), TimeError);
+                }
+
+                std::lock_guard<std::mutex> Lock = std::lock_guard<std::mutex>(Mutex);
+                if (Options.bVerbose)
+                {
+                    printf("[Bake] up to date %s\n", Name.c_str());
+                }
+                Current[Name] = std::move(Record);
+                Statistics.UpToDate++;
+                continue;
+            }
+
+            const auto       BakeStart = std::chrono::steady_clock::now();
+            String           Reason    = {};
+            const BakeResult Result    = Input.Kind == BakeKind::Mesh ? BakeMesh(Input.Source, Output, Reason) :
+                                         Input.Kind == BakeKind::Image ? BakeImage(Input.Source, Output, Reason) : BakeShader(Input.Source, Output, Reason);
+            const double     kMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - BakeStart).count();
+
+            // Failed and skipped inputs stay out of the database, so the next run tries them again
+            std::lock_guard<std::mutex> Lock = std::lock_guard<std::mutex>(Mutex);
+            switch (Result)
+            {
+                case BakeResult::Baked:
+                    printf("[Bake] baked %s (%.1f ms)\n", Name.c_str(), kMilliseconds);
+                    Current[Name] = std::move(Record);
+                    Statistics.Baked++;
+                    break;
+                case BakeResult::Skipped:
+                    if (Options.bVerbose)
+                    {
+                        printf("[Bake] skipped %s: %s\n", Name.c_str(), Reason.c_str());
+                    }
+                    Statistics.Skipped++;
+                    break;
+                case BakeResult::Failed:
+                    fprintf(stderr, "[Bake] failed %s: %s\n", Name.c_str(), Reason.c_str());
+                    Statistics.Failed++;
+                    break;
+            }
+        }
+    });
+
+    // Inputs that are gone drop out here, their outputs are left for whoever deleted the source
+    if (!WriteDatabase(DatabasePath, Current))
+    {
+        fprintf(stderr, "[Bake] the database could not be written to %s\n", DatabasePath.string().c_str());
+    }
+
+    Statistics.Milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - Start).count();
+    return Statistics;
+}
+
+bool AssetBaker::Pack(const std::filesystem::path& Root, const std::filesystem::path& Filepath, PackStatistics& Statistics) noexcept
+{
+    const auto Start = std::chrono::steady_clock::now();
+
+    ArchiveWriter   Writer = {};
+    std::error_code Error  = {};
+    for (std::filesystem::recursive_directory_iterator it = std::filesystem::recursive_directory_iterator(Root, Error), End = {}; !Error && it != End; it.increment(Error))
+    {
+        const std::filesystem::path Source    = it->path().lexically_normal();
+        const String                Name      = Source.lexically_relative(Root).generic_string();
+        std::error_code             FileError = {};
+        if (!it->is_regular_file(FileError) || Name == ".bake" || Source.extension() == ".tmp" || std::filesystem::equivalent(Source, Filepath, FileError))
+        {
+            continue;
+        }
+
+        BakeKind Kind = BakeKind::Mesh;
+        if (GetKind(Source, Kind) && Kind != BakeKind::Shader && GetBakedReadPath(Source.string().c_str(), GetOutputExtension(Kind)) != Source.string())
+        {
+            continue;
+        }
+
+        const MappedFile File = MappedFile(Source.string().c_str());
+        if (!File.IsOpen())
+        {
+            fprintf(stderr, "[Pack] %s could not be read\n", Name.c_str());
+            return false;
+        }
+
+        // Point clouds are streamed from where they are mapped, inflating one would load all of it
+        Writer.Add(Name, List<uint8_t>(File.GetData(), File.GetData() + File.GetSize()), Source.extension() != ".pcot");
+        Statistics.Files++;
+    }
+
+    String Reason = {};
+    if (!Writer.Save(Filepath.string().c_str(), Reason))
+    {
+        fprintf(stderr, "[Pack] %s: %s\n", Filepath.string().c_str(), Reason.c_str());
+        return false;
+    }
+
+    Statistics.RawBytes     = Writer.GetRawSize();
+    Statistics.PackedBytes  = Writer.GetPackedSize();
+    Statistics.Milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - Start).count();
+    return true;
+}
+
+bool AssetBaker::Benchmark(const std::filesystem::path& Root, uint32_t kRuns) noexcept
+{
+    List<std::filesystem::path> Sources = {};
+    std::error_code             Error   = {};
+    for (std::filesystem::recursive_directory_iterator it = std::filesystem::recursive_directory_iterator(Root, Error), End = {}; !Error && it != End; it.increment(Error))
+    {
+        std::error_code FileError = {};
+        if (it->is_regular_file(FileError) && it->path().extension() == ".obj")
+        {
+            Sources.push_back(it->path().lexically_normal());
+        }
+    }
+    std::sort(Sources.begin(), Sources.end());
+
+    // The first load of each file is not timed, it only pulls the file into the page cache
+    const auto Time = [kRuns](const std::filesystem::path& Source, bool bInline, bool& bLoaded)
+    {
+        double kBest = 0.0;
+        for (uint32_t k = 0u; k <= kRuns; k++)
+        {
+            ObjModel   Model = {};
+            const auto Start = std::chrono::steady_clock::now();
+            if (bInline)
+            {
+                Parallel::Inline([&]() { bLoaded = ObjLoader::LoadFromFile(Source.string().c_str(), Model); });
+            }
+            else
+            {
+                bLoaded = ObjLoader::LoadFromFile(Source.string().c_str(), Model);
+            }
+            const double kMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - Start).count();
+            if (!bLoaded)
+            {
+                break;
+            }
+            if (k != 0u)
+            {
+                kBest = k == 1u ? kMilliseconds : std::min(kBest, kMilliseconds);
+            }
+        }
+        return kBest;
+    };
+
+    bool bOk = true;
+    for (const std::filesystem::path& Source : Sources)
+    {
+        const String Name = Source.lexically_relative(Root).generic_string();
+
+        bool bLoaded = false;
+        const double kSerial   = Time(Source, true, bLoaded);
+        const double kParallel = bLoaded ? Time(Source, false, bLoaded) : 0.0;
+        if (!bLoaded)
+        {
+            fprintf(stderr, "[Benchmark] %s could not be loaded\n", Name.c_str());
+            bOk = false;
+            continue;
+        }
+        printf("[Benchmark] %s: %.2f ms on one thread, %.2f ms on %u (%.2fx)\n",
+            Name.c_str(), kSerial, kParallel, Parallel::GetWorkerCount(), kParallel > 0.0 ? kSerial / kParallel : 0.0);
+    }
+    return bOk;
+}
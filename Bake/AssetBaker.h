@@ -0,0 +1,49 @@
+#pragma once
+
+#include "Core.h"
+
+struct BakeOptions
+{
+	std::filesystem::path Root     = "Resources";
+	std::filesystem::path Database = {};    // Root/.bake when empty
+	uint32_t              Workers  = 0u;    // Inputs baked at once, 0 for one per hardware thread
+	bool                  bForce   = false; // Bake everything whether it changed or not
+	bool                  bVerbose = false; // List the inputs that were up to date too
+};
+
+struct BakeStatistics
+{
+	uint32_t Inputs       = 0u;
+	uint32_t Baked        = 0u;
+	uint32_t UpToDate     = 0u;
+	uint32_t Skipped      = 0u; // Nothing on this platform can bake them, the renderer keeps loading the source
+	uint32_t Failed       = 0u;
+	double   Milliseconds = 0.0;
+};
+
+struct PackStatistics
+{
+	uint32_t Files        = 0u;
+	size_t   RawBytes     = 0u;
+	size_t   PackedBytes  = 0u;
+	double   Milliseconds = 0.0;
+};
+
+// Turns everything under a directory into what the renderer loads without importing, decoding or compiling it: a
+// .mesh beside every OBJ file, a .image beside every image and a .cso beside every vertex and pixel shader. The
+// renderer picks these up on its own whenever they are at least as new as their source.
+//
+// A database of content hashes remembers what every output was made from, the source itself, the files it includes
+// and the version of the conversion, so only inputs where one of those changed are baked again. Timestamps are not
+// trusted for this, a checkout or a copy moves them without changing anything.
+//
+// Pack() then puts the directory into one archive the renderer mounts over it. A source is left out when its baked
+// output is current, the renderer would never read it; shaders always go in, other entry points compile from them.
+class AssetBaker
+{
+public:
+	static BakeStatistics Bake(const BakeOptions& Options) noexcept;
+	static bool           Pack(const std::filesystem::path& Root, const std::filesystem::path& Filepath, PackStatistics& Statistics) noexcept;
+	// Times loading every OBJ file under Root on the calling thread alone and on the worker pool, best of kRuns each
+	static bool           Benchmark(const std::filesystem::path& Root, uint32_t kRuns) noexcept;
+};
@@ -0,0 +1,91 @@
+#include "AssetBaker.h"
+
+#include <string.h>
+#include <stdlib.h>
+
+static void PrintUsage() noexcept
+{
+	printf("Usage: Bake [--force] [--verbose] [--jobs N] [--database FILE] [--pack FILE] [--benchmark RUNS] [DIRECTORY]\n");
+	printf("  Bakes every mesh, image and shader under DIRECTORY (Resources by default) that changed since the last run.\n");
+	printf("  --force     Bake everything, whether it changed or not\n");
+	printf("  --verbose   Also list the inputs that were up to date or skipped\n");
+	printf("  --jobs N    Bake at most N inputs at once, one per hardware thread by default\n");
+	printf("  --database  Where the content hashes are kept, DIRECTORY/.bake by default\n");
+	printf("  --pack      Also pack DIRECTORY into an archive for the renderer to mount, e.g. Resources.pak\n");
+	printf("  --benchmark Only time loading the OBJ files under DIRECTORY on one thread and on all of them, best of RUNS\n");
+}
+
+int main(int kArgs, char** ppArgs)
+{
+	BakeOptions           Options = {};
+	std::filesystem::path Archive = {};
+	uint32_t              kRuns   = 0u;
+	for (int k = 1; k < kArgs; k++)
+	{
+		if (strcmp(ppArgs[k], "--force") == 0)
+		{
+			Options.bForce = true;
+		}
+		else if (strcmp(ppArgs[k], "--verbose") == 0)
+		{
+			Options.bVerbose = true;
+		}
+		else if (strcmp(ppArgs[k], "--jobs") == 0 && k + 1 < kArgs)
+		{
+			Options.Workers = uint32_t(strtoul(ppArgs[++k], nullptr, 10));
+		}
+		else if (strcmp(ppArgs[k], "--database") == 0 && k + 1 < kArgs)
+		{
+			Options.Database = ppArgs[++k];
+		}
+		else if (strcmp(ppArgs[k], "--pack") == 0 && k + 1 < kArgs)
+		{
+			Archive = ppArgs[++k];
+		}
+		else if (strcmp(ppArgs[k], "--benchmark") == 0 && k + 1 < kArgs)
+		{
+			kRuns = std::max(uint32_t(strtoul(ppArgs[++k], nullptr, 10)), 1u);
+		}
+		else if (ppArgs[k][0] != '-')
+		{
+			Options.Root = ppArgs[k];
+		}
+		else
+		{
+			PrintUsage();
+			return strcmp(ppArgs[k], "--help") == 0 ? 0 : 2;
+		}
+	}
+
+	if (!std::filesystem::is_directory(Options.Root))
+	{
+		fprintf(stderr, "[Bake] %s is not a directory\n", Options.Root.string().c_str());
+		return 2;
+	}
+
+	if (kRuns != 0u)
+	{
+		return AssetBaker::Benchmark(Options.Root, kRuns) ? 0 : 1;
+	}
+
+	const BakeStatistics Statistics = AssetBaker::Bake(Options);
+	printf("[Bake] %u inputs: %u baked, %u up to date, %u skipped, %u failed (%.1f ms)\n",
+		Statistics.Inputs, Statistics.Baked, Statistics.UpToDate, Statistics.Skipped, Statistics.Failed, Statistics.Milliseconds);
+	if (Statistics.Failed != 0u)
+	{
+		return 1;
+	}
+
+	// Only what baked cleanly is packed, an archive with a stale output in it would be mounted as if it were current
+	if (!Archive.empty())
+	{
+		PackStatistics Packed = {};
+		if (!AssetBaker::Pack(Options.Root.lexically_normal(), Archive, Packed))
+		{
+			return 1;
+		}
+		printf("[Pack] %u files: %.2f MB, %.2f MB packed (%.1f ms)\n",
+			Packed.Files, double(Packed.RawBytes) / 1048576.0, double(Packed.PackedBytes) / 1048576.0, Packed.Milliseconds);
+	}
+	return 0;
+}
@@ -2,7 +2,7 @@
 
 int WINAPI wWinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, LPWSTR lpCmdLine, int nShowCmd)
 {
-	if (!Renderer3D::Initialize(hInstance))
+	if (!Renderer3D::Initialize(hInstance, lpCmdLine))
 		return -1;
 	
 	Renderer3D::Run();
@@ -0,0 +1,605 @@
+#include "Animation.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <emmintrin.h>
+
+static constexpr float s_RotationQuantization = 32767.0f;
+static constexpr float s_RangeQuantization    = 65535.0f;
+
+// Keys bracketing Time, Alpha is the position between them
+static void FindKeys(const List<float>& Times, float Time, size_t& k0, size_t& k1, float& Alpha) noexcept
+{
+    Alpha = 0.0f;
+    if (Times.size() <= 1u || Time <= Times.front())
+    {
+        k0 = k1 = 0u;
+        return;
+    }
+    if (Time >= Times.back())
+    {
+        k0 = k1 = Times.size() - 1u;
+        return;
+    }
+
+    k1 = size_t(std::upper_bound(Times.begin(), Times.end(), Time) - Times.begin());
+    k0 = k1 - 1u;
+    Alpha = (Time - Times[k0]) / std::max(Times[k1] - Times[k0], 1e-6f);
+}
+
+static Float3 SampleVector(const List<float>& Times, const List<Float3>& Values, float Time, const Float3& Default) noexcept
+{
+    if (Values.empty())
+    {
+        return Default;
+    }
+
+    size_t k0 = 0u, k1 = 0u;
+    float  Alpha = 0.0f;
+    FindKeys(Times, Time, k0, k1, Alpha);
+
+    const Float3& a = Values[k0];
+    const Float3& b = Values[k1];
+    return Float3(a.X + (b.X - a.X) * Alpha, a.Y + (b.Y - a.Y) * Alpha, a.Z + (b.Z - a.Z) * Alpha);
+}
+
+static Float4 SampleQuaternion(const List<float>& Times, const List<Float4>& Values, float Time) noexcept
+{
+    if (Values.empty())
+    {
+        return Float4(0.0f, 0.0f, 0.0f, 1.0f);
+    }
+
+    size_t k0 = 0u, k1 = 0u;
+    float  Alpha = 0.0f;
+    FindKeys(Times, Time, k0, k1, Alpha);
+
+    // Normalized lerp along the shorter arc, keys are dense enough after import for the speed difference to not matter
+    const Float4& a = Values[k0];
+    Float4        b = Values[k1];
+    if (a.X * b.X + a.Y * b.Y + a.Z * b.Z + a.W * b.W < 0.0f)
+    {
+        b = Float4(-b.X, -b.Y, -b.Z, -b.W);
+    }
+
+    Float4 q = Float4(a.X + (b.X - a.X) * Alpha, a.Y + (b.Y - a.Y) * Alpha, a.Z + (b.Z - a.Z) * Alpha, a.W + (b.W - a.W) * Alpha);
+    const float Length = sqrtf(q.X * q.X + q.Y * q.Y + q.Z * q.Z + q.W * q.W);
+    if (Length > 0.0f)
+    {
+        q = Float4(q.X / Length, q.Y / Length, q.Z / Length, q.W / Length);
+    }
+    return q;
+}
+
+static float MaxDifference(const Float4& a, const Float4& b) noexcept
+{
+    return std::max(std::max(fabsf(a.X - b.X), fabsf(a.Y - b.Y)), std::max(fabsf(a.Z - b.Z), fabsf(a.W - b.W)));
+}
+
+// Frames bracketing Time in a resampled clip
+static void FindFrames(const AnimationClip& Clip, float Time, bool bLoop, uint32_t& kF0, uint32_t& kF1, float& Alpha) noexcept
+{
+    if (Clip.FrameCount <= 1u)
+    {
+        kF0 = kF1 = 0u;
+        Alpha = 0.0f;
+        return;
+    }
+
+    if (bLoop)
+    {
+        Time = fmodf(Time, Clip.Duration);
+        Time = Time < 0.0f ? Time + Clip.Duration : Time;
+    }
+    else
+    {
+        Time = std::clamp(Time, 0.0f, Clip.Duration);
+    }
+
+    const float Frame = Time * Clip.FrameRate;
+    kF0   = std::min(uint32_t(Frame), Clip.FrameCount - 1u);
+    kF1   = std::min(kF0 + 1u, Clip.FrameCount - 1u);
+    Alpha = Frame - float(kF0);
+}
+
+// SSE
+static inline __m128 Dot4(__m128 a, __m128 b) noexcept
+{
+    const __m128 m = _mm_mul_ps(a, b);
+    const __m128 s = _mm_add_ps(m, _mm_shuffle_ps(m, m, _MM_SHUFFLE(2, 3, 0, 1)));
+    return _mm_add_ps(s, _mm_shuffle_ps(s, s, _MM_SHUFFLE(1, 0, 3, 2)));
+}
+
+static inline __m128 Normalize4(__m128 q) noexcept
+{
+    return _mm_div_ps(q, _mm_sqrt_ps(_mm_max_ps(Dot4(q, q), _mm_set1_ps(1e-12f))));
+}
+
+static inline __m128 LoadInt16x4(const int16_t* p) noexcept
+{
+    const __m128i v = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(p));
+    return _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(v, v), 16));
+}
+
+static inline __m128 LoadUInt16x4(const uint16_t* p) noexcept
+{
+    const __m128i v = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(p));
+    return _mm_cvtepi32_ps(_mm_unpacklo_epi16(v, _mm_setzero_si128()));
+}
+
+static inline __m128 Splat(__m128 v, int kLane) noexcept
+{
+    switch (kLane)
+    {
+        case 0:  return _mm_shuffle_ps(v, v, _MM_SHUFFLE(0, 0, 0, 0));
+        case 1:  return _mm_shuffle_ps(v, v, _MM_SHUFFLE(1, 1, 1, 1));
+        case 2:  return _mm_shuffle_ps(v, v, _MM_SHUFFLE(2, 2, 2, 2));
+        default: return _mm_shuffle_ps(v, v, _MM_SHUFFLE(3, 3, 3, 3));
+    }
+}
+
+// Out = a * b with a given as rows, row vector convention
+static inline void Multiply(const __m128 a[4], const Float4x4& b, Float4x4& Out) noexcept
+{
+    const __m128 b0 = _mm_loadu_ps(b.Matrix[0]);
+    const __m128 b1 = _mm_loadu_ps(b.Matrix[1]);
+    const __m128 b2 = _mm_loadu_ps(b.Matrix[2]);
+    const __m128 b3 = _mm_loadu_ps(b.Matrix[3]);
+
+    for (int k = 0; k < 4; k++)
+    {
+        __m128 Row = _mm_mul_ps(Splat(a[k], 0), b0);
+        Row = _mm_add_ps(Row, _mm_mul_ps(Splat(a[k], 1), b1));
+        Row = _mm_add_ps(Row, _mm_mul_ps(Splat(a[k], 2), b2));
+        Row = _mm_add_ps(Row, _mm_mul_ps(Splat(a[k], 3), b3));
+        _mm_storeu_ps(Out.Matrix[k], Row);
+    }
+}
+
+// Scale, then rotate, then translate
+static inline void PoseToRows(const JointPose& Pose, __m128 Rows[4]) noexcept
+{
+    const float x = Pose.Rotation.X, y = Pose.Rotation.Y, z = Pose.Rotation.Z, w = Pose.Rotation.W;
+    const float xx = x * x, yy = y * y, zz = z * z;
+    const float xy = x * y, xz = x * z, yz = y * z;
+    const float wx = w * x, wy = w * y, wz = w * z;
+
+    Rows[0] = _mm_mul_ps(_mm_setr_ps(1.0f - 2.0f * (yy + zz), 2.0f * (xy + wz), 2.0f * (xz - wy), 0.0f), _mm_set1_ps(Pose.Scale.X));
+    Rows[1] = _mm_mul_ps(_mm_setr_ps(2.0f * (xy - wz), 1.0f - 2.0f * (xx + zz), 2.0f * (yz + wx), 0.0f), _mm_set1_ps(Pose.Scale.Y));
+    Rows[2] = _mm_mul_ps(_mm_setr_ps(2.0f * (xz + wy), 2.0f * (yz - wx), 1.0f - 2.0f * (xx + yy), 0.0f), _mm_set1_ps(Pose.Scale.Z));
+    Rows[3] = _mm_setr_ps(Pose.Translation.X, Pose.Translation.Y, Pose.Translation.Z, 1.0f);
+}
+
+// ANIMATION
+AnimationClip Animation::Compress(const char* lpName, float Duration, const List<AnimationTrack>& Tracks, const List<MorphWeightTrack>& MorphTracks, float FrameRate, float Tolerance) noexcept
+{
+    AnimationClip Clip = {};
+    Clip.Name       = lpName;
+    Clip.Duration   = std::max(Duration, 0.0f);
+    Clip.FrameCount = Clip.Duration > 0.0f ? uint32_t(ceilf(Clip.Duration * FrameRate)) + 1u : 1u;
+    Clip.FrameRate  = Clip.FrameCount > 1u ? float(Clip.FrameCount - 1u) / Clip.Duration : 0.0f;
+
+    const size_t kTrackCount = Tracks.size();
+    const size_t kFrameCount = Clip.FrameCount;
+
+    // Resample every channel, frame major
+    List<JointPose> Frames = List<JointPose>(kFrameCount * kTrackCount);
+    for (size_t t = 0u; t < kTrackCount; t++)
+    {
+        const AnimationTrack& Track = Tracks[t];
+        for (size_t f = 0u; f < kFrameCount; f++)
+        {
+            const float Time = Clip.FrameRate > 0.0f ? float(f) / Clip.FrameRate : 0.0f;
+
+            JointPose& Pose  = Frames[f * kTrackCount + t];
+            Pose.Translation = Float4(SampleVector(Track.PositionTimes, Track.Positions, Time, Float3(0.0f)), 0.0f);
+            Pose.Scale       = Float4(SampleVector(Track.ScaleTimes, Track.Scales, Time, Float3(1.0f)), 0.0f);
+            Pose.Rotation    = SampleQuaternion(Track.RotationTimes, Track.Rotations, Time);
+
+            // Keep consecutive frames in the same hemisphere so sampling can lerp without a sign test
+            if (f > 0u)
+            {
+                const Float4& Previous = Frames[(f - 1u) * kTrackCount + t].Rotation;
+                if (Previous.X * Pose.Rotation.X + Previous.Y * Pose.Rotation.Y + Previous.Z * Pose.Rotation.Z + Previous.W * Pose.Rotation.W < 0.0f)
+                {
+                    Pose.Rotation = Float4(-Pose.Rotation.X, -Pose.Rotation.Y, -Pose.Rotation.Z, -Pose.Rotation.W);
+                }
+            }
+        }
+    }
+
+    // Constant channels
+    Clip.Targets.resize(kTrackCount);
+    Clip.Constants.assign(Frames.begin(), Frames.begin() + kTrackCount);
+    for (size_t t = 0u; t < kTrackCount; t++)
+    {
+        Clip.Targets[t] = Tracks[t].Target;
+
+        bool bRotation = false, bTranslation = false, bScale = false;
+        for (size_t f = 1u; f < kFrameCount; f++)
+        {
+            const JointPose& Pose = Frames[f * kTrackCount + t];
+            bRotation    |= MaxDifference(Pose.Rotation,    Clip.Constants[t].Rotation)    > Tolerance;
+            bTranslation |= MaxDifference(Pose.Translation, Clip.Constants[t].Translation) > Tolerance;
+            bScale       |= MaxDifference(Pose.Scale,       Clip.Constants[t].Scale)       > Tolerance;
+        }
+
+        if (bRotation)
+        {
+            Clip.RotationTracks.emplace_back(uint32_t(t));
+        }
+        if (bTranslation)
+        {
+            Clip.TranslationTracks.emplace_back(uint32_t(t));
+        }
+        if (bScale)
+        {
+            Clip.ScaleTracks.emplace_back(uint32_t(t));
+        }
+    }
+
+    // Rotations, components are within [-1, 1]
+    const size_t kRotationCount = Clip.RotationTracks.size();
+    Clip.Rotations.resize(kFrameCount * kRotationCount * 4u);
+    for (size_t f = 0u; f < kFrameCount; f++)
+    {
+        for (size_t r = 0u; r < kRotationCount; r++)
+        {
+            const Float4& q   = Frames[f * kTrackCount + Clip.RotationTracks[r]].Rotation;
+            int16_t*      pQ  = &Clip.Rotations[(f * kRotationCount + r) * 4u];
+            const float   c[] = { q.X, q.Y, q.Z, q.W };
+            for (size_t k = 0u; k < 4u; k++)
+            {
+                pQ[k] = int16_t(lroundf(std::clamp(c[k], -1.0f, 1.0f) * s_RotationQuantization));
+            }
+        }
+    }
+
+    // Translations and scales, within the range each track covers
+    const auto QuantizeRanges = [&](const List<uint32_t>& Channels, Float4 JointPose::* pMember, List<Float4>& Min, List<Float4>& Step, List<uint16_t>& Values)
+    {
+        const size_t kChannelCount = Channels.size();
+        Min.resize(kChannelCount);
+        Step.resize(kChannelCount);
+        for (size_t c = 0u; c < kChannelCount; c++)
+        {
+            Float3 Low  = Float3(+FLT_MAX);
+            Float3 High = Float3(-FLT_MAX);
+            for (size_t f = 0u; f < kFrameCount; f++)
+            {
+                const Float4& v = Frames[f * kTrackCount + Channels[c]].*pMember;
+                Low  = Float3(std::min(Low.X,  v.X), std::min(Low.Y,  v.Y), std::min(Low.Z,  v.Z));
+                High = Float3(std::max(High.X, v.X), std::max(High.Y, v.Y), std::max(High.Z, v.Z));
+            }
+            Min[c]  = Float4(Low, 0.0f);
+            Step[c] = Float4((High.X - Low.X) / s_RangeQuantization, (High.Y - Low.Y) / s_RangeQuantization, (High.Z - Low.Z) / s_RangeQuantization, 0.0f);
+        }
+
+        // One element of padding so the last value can be read four components at a time
+        Values.resize(kFrameCount * kChannelCount * 3u + 1u);
+        for (size_t f = 0u; f < kFrameCount; f++)
+        {
+            for (size_t c = 0u; c < kChannelCount; c++)
+            {
+                const Float4& v   = Frames[f * kTrackCount + Channels[c]].*pMember;
+                uint16_t*     pV  = &Values[(f * kChannelCount + c) * 3u];
+                const float   x[] = { v.X - Min[c].X, v.Y - Min[c].Y, v.Z - Min[c].Z };
+                const float   s[] = { Step[c].X, Step[c].Y, Step[c].Z };
+                for (size_t k = 0u; k < 3u; k++)
+                {
+                    pV[k] = s[k] > 0.0f ? uint16_t(std::min(lroundf(x[k] / s[k]), 65535l)) : 0u;
+                }
+            }
+        }
+    };
+    QuantizeRanges(Clip.TranslationTracks, &JointPose::Translation, Clip.TranslationMin, Clip.TranslationStep, Clip.Translations);
+    QuantizeRanges(Clip.ScaleTracks,       &JointPose::Scale,       Clip.ScaleMin,       Clip.ScaleStep,       Clip.Scales);
+
+    // Morph weights
+    const size_t kMorphCount = MorphTracks.size();
+    Clip.MorphTargets.resize(kMorphCount);
+    Clip.MorphWeights.resize(kFrameCount * kMorphCount);
+    for (size_t m = 0u; m < kMorphCount; m++)
+    {
+        const MorphWeightTrack& Track = MorphTracks[m];
+        Clip.MorphTargets[m] = Track.Target;
+        for (size_t f = 0u; f < kFrameCount; f++)
+        {
+            size_t k0 = 0u, k1 = 0u;
+            float  Alpha = 0.0f;
+            FindKeys(Track.Times, Clip.FrameRate > 0.0f ? float(f) / Clip.FrameRate : 0.0f, k0, k1, Alpha);
+            Clip.MorphWeights[f * kMorphCount + m] = Track.Weights.empty() ? 0.0f : Track.Weights[k0] + (Track.Weights[k1] - Track.Weights[k0]) * Alpha;
+        }
+    }
+
+    return Clip;
+}
+
+void Animation::Sample(const AnimationClip& Clip, float Time, bool bLoop, JointPose* pPoses) noexcept
+{
+    const size_t kTrackCount = Clip.Targets.size();
+    if (Clip.FrameCount == 0u || kTrackCount == 0u)
+    {
+        return;
+    }
+
+    for (size_t t = 0u; t < kTrackCount; t++)
+    {
+        pPoses[Clip.Targets[t]] = Clip.Constants[t];
+    }
+    if (Clip.FrameCount == 1u)
+    {
+        return;
+    }
+
+    uint32_t kF0 = 0u, kF1 = 0u;
+    float    Fraction = 0.0f;
+    FindFrames(Clip, Time, bLoop, kF0, kF1, Fraction);
+    const __m128 Alpha = _mm_set1_ps(Fraction);
+
+    // Rotations
+    const size_t   kRotationCount = Clip.RotationTracks.size();
+    const int16_t* pR0            = Clip.Rotations.data() + size_t(kF0) * kRotationCount * 4u;
+    const int16_t* pR1            = Clip.Rotations.data() + size_t(kF1) * kRotationCount * 4u;
+    const __m128   RotationScale  = _mm_set1_ps(1.0f / s_RotationQuantization);
+    for (size_t r = 0u; r < kRotationCount; r++)
+    {
+        const __m128 q0 = _mm_mul_ps(LoadInt16x4(pR0 + r * 4u), RotationScale);
+        const __m128 q1 = _mm_mul_ps(LoadInt16x4(pR1 + r * 4u), RotationScale);
+        const __m128 q  = Normalize4(_mm_add_ps(q0, _mm_mul_ps(_mm_sub_ps(q1, q0), Alpha)));
+        _mm_storeu_ps(&pPoses[Clip.Targets[Clip.RotationTracks[r]]].Rotation.X, q);
+    }
+
+    // Translations and scales, lerped while still quantized since dequantizing is linear
+    const auto SampleRanges = [&](const List<uint32_t>& Channels, Float4 JointPose::* pMember, const List<Float4>& Min, const List<Float4>& Step, const List<uint16_t>& Values)
+    {
+        const size_t    kChannelCount = Channels.size();
+        const uint16_t* pV0           = Values.data() + size_t(kF0) * kChannelCount * 3u;
+        const uint16_t* pV1           = Values.data() + size_t(kF1) * kChannelCount * 3u;
+        for (size_t c = 0u; c < kChannelCount; c++)
+        {
+            const __m128 v0 = LoadUInt16x4(pV0 + c * 3u);
+            const __m128 v1 = LoadUInt16x4(pV1 + c * 3u);
+            const __m128 q  = _mm_add_ps(v0, _mm_mul_ps(_mm_sub_ps(v1, v0), Alpha));
+
+            // Step.W is zero, which also clears the padding lane
+            const __m128 v = _mm_add_ps(_mm_loadu_ps(&Min[c].X), _mm_mul_ps(q, _mm_loadu_ps(&Step[c].X)));
+            _mm_storeu_ps(&(pPoses[Clip.Targets[Channels[c]]].*pMember).X, v);
+        }
+    };
+    SampleRanges(Clip.TranslationTracks, &JointPose::Translation, Clip.TranslationMin, Clip.TranslationStep, Clip.Translations);
+    SampleRanges(Clip.ScaleTracks,       &JointPose::Scale,       Clip.ScaleMin,       Clip.ScaleStep,       Clip.Scales);
+}
+
+void Animation::SampleMorphWeights(const AnimationClip& Clip, float Time, bool bLoop, float* pWeights) noexcept
+{
+    const size_t kMorphCount = Clip.MorphTargets.size();
+    if (kMorphCount == 0u)
+    {
+        return;
+    }
+
+    uint32_t kF0 = 0u, kF1 = 0u;
+    float    Alpha = 0.0f;
+    FindFrames(Clip, Time, bLoop, kF0, kF1, Alpha);
+
+    const float* pW0 = Clip.MorphWeights.data() + size_t(kF0) * kMorphCount;
+    const float* pW1 = Clip.MorphWeights.data() + size_t(kF1) * kMorphCount;
+    for (size_t m = 0u; m < kMorphCount; m++)
+    {
+        pWeights[Clip.MorphTargets[m]] = pW0[m] + (pW1[m] - pW0[m]) * Alpha;
+    }
+}
+
+void Animation::Blend(const AnimationLayer* pLayers, size_t kLayerCount, const JointPose* pRestPose, size_t kPoseCount, JointPose* pPoses, List<JointPose>& Scratch) noexcept
+{
+    float  TotalWeight  = 0.0f;
+    size_t kActiveCount = 0u;
+    size_t kLastActive  = 0u;
+    for (size_t k = 0u; k < kLayerCount; k++)
+    {
+        if (pLayers[k].pClip != nullptr && pLayers[k].Weight > 0.0f)
+        {
+            TotalWeight += pLayers[k].Weight;
+            kLastActive  = k;
+            kActiveCount++;
+        }
+    }
+
+    std::copy(pRestPose, pRestPose + kPoseCount, pPoses);
+    if (kActiveCount == 0u)
+    {
+        return;
+    }
+    if (kActiveCount == 1u)
+    {
+        Animation::Sample(*pLayers[kLastActive].pClip, pLayers[kLastActive].Time, pLayers[kLastActive].bLoop, pPoses);
+        return;
+    }
+
+    // Weighted sum of every layer. Quaternions are flipped into the rest pose's hemisphere first so opposite signs of the
+    // same rotation don't cancel out.
+    const __m128 Zero    = _mm_setzero_ps();
+    const __m128 SignBit = _mm_set1_ps(-0.0f);
+    for (size_t k = 0u; k < kPoseCount; k++)
+    {
+        _mm_storeu_ps(&pPoses[k].Rotation.X,    Zero);
+        _mm_storeu_ps(&pPoses[k].Translation.X, Zero);
+        _mm_storeu_ps(&pPoses[k].Scale.X,       Zero);
+    }
+
+    Scratch.resize(kPoseCount);
+    for (size_t k = 0u; k < kLayerCount; k++)
+    {
+        const AnimationLayer& Layer = pLayers[k];
+        if (Layer.pClip == nullptr || Layer.Weight <= 0.0f)
+        {
+            continue;
+        }
+
+        std::copy(pRestPose, pRestPose + kPoseCount, Scratch.begin());
+        Animation::Sample(*Layer.pClip, Layer.Time, Layer.bLoop, Scratch.data());
+
+        const __m128 Weight = _mm_set1_ps(Layer.Weight / TotalWeight);
+        for (size_t j = 0u; j < kPoseCount; j++)
+        {
+            const __m128 q    = _mm_loadu_ps(&Scratch[j].Rotation.X);
+            const __m128 Flip = _mm_and_ps(_mm_cmplt_ps(Dot4(q, _mm_loadu_ps(&pRestPose[j].Rotation.X)), Zero), SignBit);
+
+            JointPose& Pose = pPoses[j];
+            _mm_storeu_ps(&Pose.Rotation.X,    _mm_add_ps(_mm_loadu_ps(&Pose.Rotation.X),    _mm_mul_ps(q, _mm_xor_ps(Weight, Flip))));
+            _mm_storeu_ps(&Pose.Translation.X, _mm_add_ps(_mm_loadu_ps(&Pose.Translation.X), _mm_mul_ps(_mm_loadu_ps(&Scratch[j].Translation.X), Weight)));
+            _mm_storeu_ps(&Pose.Scale.X,       _mm_add_ps(_mm_loadu_ps(&Pose.Scale.X),       _mm_mul_ps(_mm_loadu_ps(&Scratch[j].Scale.X), Weight)));
+        }
+    }
+
+    for (size_t k = 0u; k < kPoseCount; k++)
+    {
+        _mm_storeu_ps(&pPoses[k].Rotation.X, Normalize4(_mm_loadu_ps(&pPoses[k].Rotation.X)));
+    }
+}
+
+void Animation::BlendMorphWeights(const AnimationLayer* pLayers, size_t kLayerCount, const float* pRestWeights, size_t kWeightCount, float* pWeights, List<float>& Scratch) noexcept
+{
+    float TotalWeight = 0.0f;
+    for (size_t k = 0u; k < kLayerCount; k++)
+    {
+        TotalWeight += pLayers[k].pClip != nullptr && pLayers[k].Weight > 0.0f ? pLayers[k].Weight : 0.0f;
+    }
+
+    std::copy(pRestWeights, pRestWeights + kWeightCount, pWeights);
+    if (TotalWeight <= 0.0f)
+    {
+        return;
+    }
+
+    std::fill(pWeights, pWeights + kWeightCount, 0.0f);
+    Scratch.resize(kWeightCount);
+    for (size_t k = 0u; k < kLayerCount; k++)
+    {
+        const AnimationLayer& Layer = pLayers[k];
+        if (Layer.pClip == nullptr || Layer.Weight <= 0.0f)
+        {
+            continue;
+        }
+
+        std::copy(pRestWeights, pRestWeights + kWeightCount, Scratch.begin());
+        Animation::SampleMorphWeights(*Layer.pClip, Layer.Time, Layer.bLoop, Scratch.data());
+
+        const float Weight = Layer.Weight / TotalWeight;
+        for (size_t m = 0u; m < kWeightCount; m++)
+        {
+            pWeights[m] += Scratch[m] * Weight;
+        }
+    }
+}
+
+void Animation::ComputeModelMatrices(const JointPose* pPoses, const int32_t* pParents, size_t kCount, Float4x4* pModel) noexcept
+{
+    __m128 Local[4] = {};
+    for (size_t k = 0u; k < kCount; k++)
+    {
+        PoseToRows(pPoses[k], Local);
+        if (pParents[k] < 0)
+        {
+            for (int r = 0; r < 4; r++)
+            {
+                _mm_storeu_ps(pModel[k].Matrix[r], Local[r]);
+            }
+        }
+        else
+        {
+            assert(size_t(pParents[k]) < k && "Parents must come before their children");
+            Multiply(Local, pModel[pParents[k]], pModel[k]);
+        }
+    }
+}
+
+void Animation::ComputePalette(const Float4x4* pModel, const uint32_t* pJointNodes, const Float4x4* pInverseBind, size_t kJointCount, Float4x4* pPalette) noexcept
+{
+    for (size_t k = 0u; k < kJointCount; k++)
+    {
+        const __m128 InverseBind[4] =
+        {
+            _mm_loadu_ps(pInverseBind[k].Matrix[0]),
+            _mm_loadu_ps(pInverseBind[k].Matrix[1]),
+            _mm_loadu_ps(pInverseBind[k].Matrix[2]),
+            _mm_loadu_ps(pInverseBind[k].Matrix[3]),
+        };
+        Multiply(InverseBind, pModel[pJointNodes[k]], pPalette[k]);
+    }
+}
+
+JointPose Animation::Decompose(const Float4x4& m) noexcept
+{
+    JointPose Pose = {};
+    Pose.Translation = Float4(m[3][0], m[3][1], m[3][2], 0.0f);
+
+    float Scale[3] = {};
+    float r[3][3]  = {};
+    for (size_t k = 0u; k < 3u; k++)
+    {
+        Scale[k] = sqrtf(m[k][0] * m[k][0] + m[k][1] * m[k][1] + m[k][2] * m[k][2]);
+        for (size_t c = 0u; c < 3u; c++)
+        {
+            r[k][c] = Scale[k] > 0.0f ? m[k][c] / Scale[k] : 0.0f;
+        }
+    }
+
+    // Mirrored, put the reflection into the X scale
+    const float Determinant = r[0][0] * (r[1][1] * r[2][2] - r[1][2] * r[2][1]) - r[0][1] * (r[1][0] * r[2][2] - r[1][2] * r[2][0]) + r[0][2] * (r[1][0] * r[2][1] - r[1][1] * r[2][0]);
+    if (Determinant < 0.0f)
+    {
+        Scale[0] = -Scale[0];
+        r[0][0] = -r[0][0], r[0][1] = -r[0][1], r[0][2] = -r[0][2];
+    }
+    Pose.Scale = Float4(Scale[0], Scale[1], Scale[2], 0.0f);
+
+    // Inverse of the rows PoseToRows() builds
+    float x = 0.0f, y = 0.0f, z = 0.0f, w = 1.0f;
+    const float Trace = r[0][0] + r[1][1] + r[2][2];
+    if (Trace > 0.0f)
+    {
+        const float s = sqrtf(Trace + 1.0f) * 2.0f;
+        w = 0.25f * s, x = (r[1][2] - r[2][1]) / s, y = (r[2][0] - r[0][2]) / s, z = (r[0][1] - r[1][0]) / s;
+    }
+    else if (r[0][0] > r[1][1] && r[0][0] > r[2][2])
+    {
+        const float s = sqrtf(1.0f + r[0][0] - r[1][1] - r[2][2]) * 2.0f;
+        x = 0.25f * s, y = (r[0][1] + r[1][0]) / s, z = (r[0][2] + r[2][0]) / s, w = (r[1][2] - r[2][1]) / s;
+    }
+    else if (r[1][1] > r[2][2])
+    {
+        const float s = sqrtf(1.0f + r[1][1] - r[0][0] - r[2][2]) * 2.0f;
+        y = 0.25f * s, x = (r[0][1] + r[1][0]) / s, z = (r[1][2] + r[2][1]) / s, w = (r[2][0] - r[0][2]) / s;
+    }
+    else
+    {
+        const float s = sqrtf(1.0f + r[2][2] - r[0][0] - r[1][1]) * 2.0f;
+        z = 0.25f * s, x = (r[0][2] + r[2][0]) / s, y = (r[1][2] + r[2][1]) / s, w = (r[0][1] - r[1][0]) / s;
+    }
+    const float Length = sqrtf(x * x + y * y + z * z + w * w);
+    Pose.Rotation = Float4(x / Length, y / Length, z / Length, w / Length);
+
+    return Pose;
+}
+
+size_t Animation::GetByteSize(const AnimationClip& Clip) noexcept
+{
+    size_t kBytes = Clip.Name.capacity();
+    kBytes += Clip.Targets.capacity()           * sizeof(uint32_t);
+    kBytes += Clip.Constants.capacity()         * sizeof(JointPose);
+    kBytes += Clip.RotationTracks.capacity()    * sizeof(uint32_t);
+    kBytes += Clip.TranslationTracks.capacity() * sizeof(uint32_t);
+    kBytes += Clip.ScaleTracks.capacity()       * sizeof(uint32_t);
+    kBytes += Clip.TranslationMin.capacity()    * sizeof(Float4);
+    kBytes += Clip.TranslationStep.capacity()   * sizeof(Float4);
+    kBytes += Clip.ScaleMin.capacity()          * sizeof(Float4);
+    kBytes += Clip.ScaleStep.capacity()         * sizeof(Float4);
+    kBytes += Clip.Rotations.capacity()         * sizeof(int16_t);
+    kBytes += Clip.Translations.capacity()      * sizeof(uint16_t);
+    kBytes += Clip.Scales.capacity()            * sizeof(uint16_t);
+    kBytes += Clip.MorphTargets.capacity()      * sizeof(uint32_t);
+    kBytes += Clip.MorphWeights.capacity()      * sizeof(float);
+    return kBytes;
+}
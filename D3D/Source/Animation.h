@@ -0,0 +1,103 @@
+#pragma once
+
+#include "Core.h"
+
+// Local transform of one node. Translation and scale are padded to four floats so poses load straight into SSE registers.
+struct JointPose
+{
+	Float4 Rotation    = Float4(0.0f, 0.0f, 0.0f, 1.0f); // Quaternion x, y, z, w
+	Float4 Translation = Float4(0.0f, 0.0f, 0.0f, 0.0f); // W unused
+	Float4 Scale       = Float4(1.0f, 1.0f, 1.0f, 0.0f); // W unused
+};
+
+// Keys of one node as imported, times in seconds. Every channel needs at least one key.
+struct AnimationTrack
+{
+	uint32_t     Target        = 0u; // Scene node
+	List<float>  PositionTimes = {};
+	List<Float3> Positions     = {};
+	List<float>  RotationTimes = {};
+	List<Float4> Rotations     = {};
+	List<float>  ScaleTimes    = {};
+	List<Float3> Scales        = {};
+};
+
+// Weight keys of one morph target
+struct MorphWeightTrack
+{
+	uint32_t    Target  = 0u; // Scene morph target
+	List<float> Times   = {};
+	List<float> Weights = {};
+};
+
+// A clip resampled at a fixed rate, so sampling is two frame lookups instead of a key search per channel. Channels that
+// never move are stored once in Constants. Rotations are quantized to 16 bits per component, translations and scales to
+// 16 bits within their track's range. Frames are stored one after another so a sample reads two contiguous blocks.
+struct AnimationClip
+{
+	String   Name       = {};
+	float    Duration   = 0.0f; // Seconds
+	float    FrameRate  = 0.0f; // Frames per second after resampling
+	uint32_t FrameCount = 0u;
+
+	List<uint32_t>  Targets   = {}; // Scene node of every track
+	List<JointPose> Constants = {}; // Per track, animated channels are overwritten when sampling
+
+	List<uint32_t> RotationTracks    = {}; // Tracks with an animated rotation, in frame order
+	List<uint32_t> TranslationTracks = {};
+	List<uint32_t> ScaleTracks       = {};
+
+	List<Float4> TranslationMin  = {}; // Dequantized value is Min + q * Step
+	List<Float4> TranslationStep = {};
+	List<Float4> ScaleMin        = {};
+	List<Float4> ScaleStep       = {};
+
+	List<int16_t>  Rotations    = {}; // FrameCount * RotationTracks * 4
+	List<uint16_t> Translations = {}; // FrameCount * TranslationTracks * 3, plus one element of padding
+	List<uint16_t> Scales       = {}; // FrameCount * ScaleTracks * 3, plus one element of padding
+
+	List<uint32_t> MorphTargets = {}; // Scene morph target of every weight channel
+	List<float>    MorphWeights = {}; // FrameCount * MorphTargets, few enough to keep at full precision
+};
+
+struct AnimationLayer
+{
+	const AnimationClip* pClip  = nullptr;
+	float                Time   = 0.0f; // Seconds
+	float                Weight = 1.0f;
+	bool                 bLoop  = true;
+};
+
+class Animation
+{
+public:
+	static constexpr float DefaultFrameRate = 30.0f;
+
+	// Resamples the tracks at kFrameRate and quantizes them. A channel that stays within Tolerance of its first frame
+	// everywhere becomes a constant.
+	static AnimationClip Compress(const char* lpName, float Duration, const List<AnimationTrack>& Tracks, const List<MorphWeightTrack>& MorphTracks = {}, float FrameRate = DefaultFrameRate, float Tolerance = 1e-4f) noexcept;
+
+	// Writes the clip's pose at Time into pPoses[Targets[k]], nodes the clip does not animate are left alone
+	static void      Sample(const AnimationClip& Clip, float Time, bool bLoop, JointPose* pPoses) noexcept;
+
+	// Writes the clip's morph weights at Time into pWeights[MorphTargets[k]]
+	static void      SampleMorphWeights(const AnimationClip& Clip, float Time, bool bLoop, float* pWeights) noexcept;
+
+	// Weighted blend of every layer over the rest pose, a node a layer does not animate counts as its rest pose.
+	// Scratch is reused between calls to avoid allocating per frame.
+	static void      Blend(const AnimationLayer* pLayers, size_t kLayerCount, const JointPose* pRestPose, size_t kPoseCount, JointPose* pPoses, List<JointPose>& Scratch) noexcept;
+
+	// Same for morph weights, a target a layer does not animate counts as its rest weight
+	static void      BlendMorphWeights(const AnimationLayer* pLayers, size_t kLayerCount, const float* pRestWeights, size_t kWeightCount, float* pWeights, List<float>& Scratch) noexcept;
+
+	// Local poses to model space, row vector convention. Parents must come before their children.
+	static void      ComputeModelMatrices(const JointPose* pPoses, const int32_t* pParents, size_t kCount, Float4x4* pModel) noexcept;
+
+	// pPalette[k] = pInverseBind[k] * pModel[pJointNodes[k]], the matrices skinning blends
+	static void      ComputePalette(const Float4x4* pModel, const uint32_t* pJointNodes, const Float4x4* pInverseBind, size_t kJointCount, Float4x4* pPalette) noexcept;
+
+	// Splits an affine matrix without shear into a pose
+	static JointPose Decompose(const Float4x4& m) noexcept;
+
+	static size_t    GetByteSize(const AnimationClip& Clip) noexcept;
+};
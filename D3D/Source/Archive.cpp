@@ -0,0 +1,588 @@
+#include "Archive.h"
+#include "Parallel.h"
+
+#include <algorithm>
+#include <memory>
+
+#include <string.h>
+
+// Table of contents and every entry start on a cache line
+static constexpr size_t s_Alignment = 64u;
+
+// Paths per bucket of the perfect hash, more makes the seed table smaller and the build slower
+static constexpr uint32_t s_BucketSize = 4u;
+static constexpr uint32_t s_MaxSeed    = 1u << 24u;
+
+// LZ4 block format: matches are at least 4 bytes, the last 5 bytes are always literals and the last match starts at
+// least 12 bytes before the end, which lets a decoder copy in words without checking every byte
+static constexpr size_t   s_MinMatch     = 4u;
+static constexpr size_t   s_LastLiterals = 5u;
+static constexpr size_t   s_MatchLimit   = 12u;
+static constexpr size_t   s_MaxOffset    = 65535u;
+static constexpr uint32_t s_HashBits     = 12u;
+
+static std::unique_ptr<Archive> s_pMounted = nullptr;
+
+static size_t   AlignUp(size_t kValue, size_t kAlignment) noexcept;
+static uint32_t Read32(const uint8_t* p) noexcept;
+static bool     WriteLength(size_t kLength, uint8_t*& pOutput, const uint8_t* pOutputEnd) noexcept;
+static bool     WriteSequence(const uint8_t* pLiterals, size_t kLiterals, size_t kOffset, size_t kMatch, uint8_t*& pOutput, const uint8_t* pOutputEnd) noexcept;
+static bool     ReadLength(size_t& kLength, const uint8_t*& pInput, const uint8_t* pInputEnd) noexcept;
+
+// ARCHIVE
+Archive::Archive(const char* lpFilepath)
+{
+    // Entries are read in whatever order the loaders ask for them, pages stay mapped after they were read
+    m_File.Map(lpFilepath, false);
+    const uint8_t* pData = m_File.GetData();
+    const size_t   kSize = m_File.GetSize();
+    if (pData == nullptr || kSize < sizeof(ArchiveHeader))
+    {
+        m_File.Close();
+        return;
+    }
+
+    const ArchiveHeader* pHeader = reinterpret_cast<const ArchiveHeader*>(pData);
+    const ArchiveHeader  Expected = {};
+    const bool bValid = pHeader->Magic == Expected.Magic && pHeader->Version == Expected.Version &&
+                        (pHeader->EntryCount == 0u || pHeader->BucketCount > 0u) &&
+                        pHeader->SeedOffset % alignof(uint32_t) == 0u && pHeader->EntryOffset % alignof(ArchiveEntry) == 0u &&
+                        pHeader->SeedOffset <= kSize && uint64_t(pHeader->BucketCount) * sizeof(uint32_t) <= kSize - pHeader->SeedOffset &&
+                        pHeader->EntryOffset <= kSize && uint64_t(pHeader->EntryCount) * sizeof(ArchiveEntry) <= kSize - pHeader->EntryOffset &&
+                        pHeader->NameOffset <= kSize && pHeader->NameSize <= kSize - pHeader->NameOffset;
+    if (!bValid)
+    {
+        m_File.Close();
+        return;
+    }
+
+    m_pHeader  = pHeader;
+    m_pSeeds   = reinterpret_cast<const uint32_t*>(pData + pHeader->SeedOffset);
+    m_pEntries = reinterpret_cast<const ArchiveEntry*>(pData + pHeader->EntryOffset);
+    m_lpNames  = reinterpret_cast<const char*>(pData + pHeader->NameOffset);
+}
+
+bool Archive::IsOpen() const noexcept
+{
+    return m_pHeader != nullptr;
+}
+
+uint32_t Archive::GetEntryCount() const noexcept
+{
+    return m_pHeader != nullptr ? m_pHeader->EntryCount : 0u;
+}
+
+const ArchiveEntry& Archive::GetEntry(uint32_t kIndex) const noexcept
+{
+    assert(kIndex < GetEntryCount());
+    return m_pEntries[kIndex];
+}
+
+std::string_view Archive::GetName(const ArchiveEntry& Entry) const noexcept
+{
+    if (uint64_t(Entry.NameOffset) + Entry.NameLength > m_pHeader->NameSize)
+    {
+        return {};
+    }
+    return std::string_view(m_lpNames + Entry.NameOffset, Entry.NameLength);
+}
+
+const ArchiveEntry* Archive::Find(std::string_view Name) const noexcept
+{
+    if (GetEntryCount() == 0u)
+    {
+        return nullptr;
+    }
+
+    // The perfect hash only places the paths it was built from, anything else lands on some entry and is told apart
+    // by its hash and then its name
+    const uint64_t      kHash  = HashName(Name);
+    const uint32_t      kSeed  = m_pSeeds[kHash % m_pHeader->BucketCount];
+    const ArchiveEntry& Entry  = m_pEntries[GetSlot(kHash, kSeed, m_pHeader->EntryCount)];
+    return Entry.Hash == kHash && GetName(Entry) == Name ? &Entry : nullptr;
+}
+
+const ArchiveEntry* Archive::FindFile(const char* lpFilepath) const noexcept
+{
+    const String Filepath = std::filesystem::path(lpFilepath).lexically_normal().generic_string();
+    if (Filepath.compare(0u, m_Directory.size(), m_Directory) != 0)
+    {
+        return nullptr;
+    }
+    return Find(std::string_view(Filepath).substr(m_Directory.size()));
+}
+
+bool Archive::Read(const ArchiveEntry& Entry, MappedFile& File) const noexcept
+{
+    File.Close();
+    if (Entry.Offset > m_File.GetSize() || Entry.Size > m_File.GetSize() - Entry.Offset)
+    {
+        return false;
+    }
+
+    const uint8_t* pData = m_File.GetData() + Entry.Offset;
+    switch (Entry.Compression)
+    {
+        case ArchiveCompression::None:
+            if (Entry.RawSize != Entry.Size)
+            {
+                return false;
+            }
+            File.m_Data = pData;
+            File.m_Size = size_t(Entry.Size);
+            break;
+        case ArchiveCompression::LZ4:
+            File.m_Buffer.resize(size_t(Entry.RawSize));
+            if (!Decompress(pData, size_t(Entry.Size), File.m_Buffer.data(), File.m_Buffer.size()))
+            {
+                File.Close();
+                return false;
+            }
+            File.m_Data = File.m_Buffer.data();
+            File.m_Size = File.m_Buffer.size();
+            break;
+        default:
+            return false;
+    }
+
+    File.m_bInMemory = true;
+    return true;
+}
+
+bool Archive::Mount(const char* lpFilepath, const char* lpDirectory) noexcept
+{
+    Unmount();
+
+    std::unique_ptr<Archive> pArchive = std::make_unique<Archive>(lpFilepath);
+    if (!pArchive->IsOpen())
+    {
+        return false;
+    }
+
+    // Normalized as FindFile() normalizes the paths it is given, "." mounts over the working directory
+    const String Directory = std::filesystem::path(lpDirectory).lexically_normal().generic_string();
+    if (Directory != "." && !Directory.empty())
+    {
+        pArchive->m_Directory = Directory.back() == '/' ? Directory : Directory + '/';
+    }
+    s_pMounted = std::move(pArchive);
+    return true;
+}
+
+void Archive::Unmount() noexcept
+{
+    s_pMounted.reset();
+}
+
+const Archive* Archive::GetMounted() noexcept
+{
+    return s_pMounted.get();
+}
+
+uint64_t Archive::HashName(std::string_view Name) noexcept
+{
+    return HashBytes(Name.data(), Name.size());
+}
+
+uint32_t Archive::GetSlot(uint64_t kHash, uint32_t kSeed, uint32_t kSlotCount) noexcept
+{
+    // Every seed is a different hash function of the same path, mixed so nearby seeds scatter it unrelatedly
+    uint64_t x = kHash ^ (uint64_t(kSeed) * 0x9E3779B97F4A7C15ull);
+    x ^= x >> 33u;
+    x *= 0xFF51AFD7ED558CCDull;
+    x ^= x >> 33u;
+    x *= 0xC4CEB9FE1A85EC53ull;
+    x ^= x >> 33u;
+    return uint32_t(x % kSlotCount);
+}
+
+// COMPRESSION
+size_t Archive::GetCompressBound(size_t kSize) noexcept
+{
+    return kSize + kSize / 255u + 16u;
+}
+
+size_t Archive::Compress(const uint8_t* pInput, size_t kSize, uint8_t* pOutput, size_t kCapacity) noexcept
+{
+    uint8_t*       pOut    = pOutput;
+    const uint8_t* pOutEnd = pOutput + kCapacity;
+    size_t         kAnchor = 0u;
+
+    // Greedy, one candidate per hash of the next four bytes, which is what LZ4's fast mode does too
+    if (kSize > s_MatchLimit)
+    {
+        List<uint32_t> Table  = List<uint32_t>(size_t(1u) << s_HashBits, 0u);
+        const size_t   kLimit = kSize - s_MatchLimit;
+        size_t         k      = 0u;
+        while (k < kLimit)
+        {
+            const uint32_t kSequence = Read32(pInput + k);
+            const uint32_t kSlot     = (kSequence * 2654435761u) >> (32u - s_HashBits);
+            const size_t   kCandidate = Table[kSlot];
+            Table[kSlot] = uint32_t(k);
+
+            if (kCandidate >= k || k - kCandidate > s_MaxOffset || Read32(pInput + kCandidate) != kSequence)
+            {
+                // Steps lengthen the longer nothing matched, incompressible data is passed over quickly
+                k += 1u + ((k - kAnchor) >> 6u);
+                continue;
+            }
+
+            size_t kMatch = s_MinMatch;
+            while (k + kMatch < kSize - s_LastLiterals && pInput[kCandidate + kMatch] == pInput[k + kMatch])
+            {
+                kMatch++;
+            }
+            if (!WriteSequence(pInput + kAnchor, k - kAnchor, k - kCandidate, kMatch, pOut, pOutEnd))
+            {
+                return 0u;
+            }
+            k      += kMatch;
+            kAnchor = k;
+        }
+    }
+
+    // The last literals are a sequence without a match
+    if (!WriteSequence(pInput + kAnchor, kSize - kAnchor, 0u, 0u, pOut, pOutEnd))
+    {
+        return 0u;
+    }
+    return size_t(pOut - pOutput);
+}
+
+bool Archive::Decompress(const uint8_t* pInput, size_t kSize, uint8_t* pOutput, size_t kOutputSize) noexcept
+{
+    const uint8_t* pIn     = pInput;
+    const uint8_t* pInEnd  = pInput + kSize;
+    uint8_t*       pOut    = pOutput;
+    uint8_t*       pOutEnd = pOutput + kOutputSize;
+    while (pIn < pInEnd)
+    {
+        const uint8_t kToken    = *pIn++;
+        size_t        kLiterals = kToken >> 4u;
+        if (!ReadLength(kLiterals, pIn, pInEnd) || kLiterals > size_t(pInEnd - pIn) || kLiterals > size_t(pOutEnd - pOut))
+        {
+            return false;
+        }
+        if (kLiterals != 0u)
+        {
+            memcpy(pOut, pIn, kLiterals);
+        }
+        pIn  += kLiterals;
+        pOut += kLiterals;
+
+        if (pIn == pInEnd)
+        {
+            break;
+        }
+        if (pInEnd - pIn < 2)
+        {
+            return false;
+        }
+
+        const size_t kOffset = size_t(pIn[0]) | (size_t(pIn[1]) << 8u);
+        size_t       kMatch  = kToken & 15u;
+        pIn += 2;
+        if (kOffset == 0u || kOffset > size_t(pOut - pOutput) || !ReadLength(kMatch, pIn, pInEnd))
+        {
+            return false;
+        }
+        kMatch += s_MinMatch;
+        if (kMatch > size_t(pOutEnd - pOut))
+        {
+            return false;
+        }
+
+        // Matches may overlap what they copy, a run of one byte is an offset of one
+        const uint8_t* pMatch = pOut - kOffset;
+        if (kOffset >= kMatch)
+        {
+            memcpy(pOut, pMatch, kMatch);
+            pOut += kMatch;
+        }
+        else
+        {
+            for (size_t k = 0u; k < kMatch; k++)
+            {
+                *pOut++ = *pMatch++;
+            }
+        }
+    }
+    return pOut == pOutEnd;
+}
+
+// ARCHIVE WRITER
+void ArchiveWriter::Add(const String& Name, List<uint8_t>&& Bytes, bool bCompress) noexcept
+{
+    Pending Entry = {};
+    Entry.Name      = Name;
+    Entry.Bytes     = std::move(Bytes);
+    Entry.bCompress = bCompress;
+    m_Entries.push_back(std::move(Entry));
+}
+
+bool ArchiveWriter::Save(const char* lpFilepath, String& Error) noexcept
+{
+    // Name order keeps the files of a directory next to each other and the archive the same from build to build
+    std::sort(m_Entries.begin(), m_Entries.end(), [](const Pending& a, const Pending& b) { return a.Name < b.Name; });
+    for (size_t k = 1u; k < m_Entries.size(); k++)
+    {
+        if (m_Entries[k].Name == m_Entries[k - 1u].Name)
+        {
+            Error = "'" + m_Entries[k].Name + "' was added twice";
+            return false;
+        }
+    }
+
+    Parallel::For(m_Entries.size(), 1u, [this](size_t kBegin, size_t kEnd)
+    {
+        for (size_t k = kBegin; k < kEnd; k++)
+        {
+            Pending& Entry = m_Entries[k];
+            if (!Entry.bCompress || Entry.Bytes.size() < s_Alignment)
+            {
+                continue;
+            }
+            Entry.Packed.resize(Archive::GetCompressBound(Entry.Bytes.size()));
+            const size_t kPacked = Archive::Compress(Entry.Bytes.data(), Entry.Bytes.size(), Entry.Packed.data(), Entry.Packed.size());
+            if (kPacked == 0u || kPacked > Entry.Bytes.size() - Entry.Bytes.size() / 8u)
+            {
+                Entry.Packed = {};
+            }
+            else
+            {
+                Entry.Packed.resize(kPacked);
+            }
+        }
+    });
+
+    // Perfect hash: every bucket of paths gets the first seed that puts all of them in slots still free. The fullest
+    // buckets go first, while most slots are free, which keeps the seeds small.
+    const uint32_t kCount   = uint32_t(m_Entries.size());
+    const uint32_t kBuckets = std::max(1u, (kCount + s_BucketSize - 1u) / s_BucketSize);
+    List<uint64_t>       Hashes  = List<uint64_t>(kCount);
+    List<List<uint32_t>> Buckets = List<List<uint32_t>>(kBuckets);
+    for (uint32_t k = 0u; k < kCount; k++)
+    {
+        Hashes[k] = Archive::HashName(m_Entries[k].Name);
+        Buckets[Hashes[k] % kBuckets].push_back(k);
+    }
+
+    List<uint32_t> Order = List<uint32_t>(kBuckets);
+    for (uint32_t k = 0u; k < kBuckets; k++)
+    {
+        Order[k] = k;
+    }
+    std::stable_sort(Order.begin(), Order.end(), [&Buckets](uint32_t a, uint32_t b) { return Buckets[a].size() > Buckets[b].size(); });
+
+    static constexpr uint32_t kFree = UINT32_MAX;
+    List<uint32_t> Seeds = List<uint32_t>(kBuckets, 0u);
+    List<uint32_t> Slots = List<uint32_t>(kCount, kFree); // Entry per slot
+    List<uint32_t> Taken = {};
+    for (const uint32_t kBucket : Order)
+    {
+        const List<uint32_t>& Bucket = Buckets[kBucket];
+        if (Bucket.empty())
+        {
+            break;
+        }
+
+        uint32_t kSeed = 0u;
+        for (; kSeed < s_MaxSeed; kSeed++)
+        {
+            Taken.clear();
+            for (const uint32_t kEntry : Bucket)
+            {
+                const uint32_t kSlot = Archive::GetSlot(Hashes[kEntry], kSeed, kCount);
+                if (Slots[kSlot] != kFree || std::find(Taken.begin(), Taken.end(), kSlot) != Taken.end())
+                {
+                    break;
+                }
+                Taken.push_back(kSlot);
+            }
+            if (Taken.size() == Bucket.size())
+            {
+                break;
+            }
+        }
+
+        // Only two paths with the same hash never separate
+        if (kSeed == s_MaxSeed)
+        {
+            Error = "no perfect hash separates '" + m_Entries[Bucket[0]].Name + "' from the paths it shares a bucket with";
+            return false;
+        }
+        Seeds[kBucket] = kSeed;
+        for (size_t k = 0u; k < Bucket.size(); k++)
+        {
+            Slots[Taken[k]] = Bucket[k];
+        }
+    }
+
+    // Header, seeds, table of contents and names up front, the data after them in name order
+    ArchiveHeader Header = {};
+    Header.EntryCount  = kCount;
+    Header.BucketCount = kBuckets;
+    Header.SeedOffset  = AlignUp(sizeof(ArchiveHeader), s_Alignment);
+    Header.EntryOffset = AlignUp(Header.SeedOffset + kBuckets * sizeof(uint32_t), s_Alignment);
+    Header.NameOffset  = Header.EntryOffset + uint64_t(kCount) * sizeof(ArchiveEntry);
+
+    List<ArchiveEntry> Entries = List<ArchiveEntry>(kCount);
+    String             Names   = {};
+    for (uint32_t k = 0u; k < kCount; k++)
+    {
+        Entries[k].NameOffset = uint32_t(Names.size());
+        Entries[k].NameLength = uint32_t(m_Entries[k].Name.size());
+        Names += m_Entries[k].Name;
+    }
+    Header.NameSize   = Names.size();
+    Header.DataOffset = AlignUp(Header.NameOffset + Header.NameSize, s_Alignment);
+
+    uint64_t kOffset = Header.DataOffset;
+    m_RawSize    = 0u;
+    m_PackedSize = 0u;
+    for (uint32_t k = 0u; k < kCount; k++)
+    {
+        const Pending& Source = m_Entries[k];
+        const bool     bPacked = !Source.Packed.empty();
+
+        ArchiveEntry& Entry = Entries[k];
+        Entry.Hash        = Hashes[k];
+        Entry.Offset      = kOffset;
+        Entry.Size        = bPacked ? Source.Packed.size() : Source.Bytes.size();
+        Entry.RawSize     = Source.Bytes.size();
+        Entry.Compression = bPacked ? ArchiveCompression::LZ4 : ArchiveCompression::None;
+
+        kOffset       = AlignUp(kOffset + Entry.Size, s_Alignment);
+        m_RawSize    += size_t(Entry.RawSize);
+        m_PackedSize += size_t(Entry.Size);
+    }
+    Header.DataSize = kOffset - Header.DataOffset;
+
+    List<uint8_t> Bytes  = List<uint8_t>(size_t(kOffset), 0u);
+    uint8_t*      pBytes = Bytes.data();
+    memcpy(pBytes, &Header, sizeof(Header));
+    for (uint32_t kBucket = 0u; kBucket < kBuckets; kBucket++)
+    {
+        memcpy(pBytes + Header.SeedOffset + kBucket * sizeof(uint32_t), &Seeds[kBucket], sizeof(uint32_t));
+    }
+    for (uint32_t kSlot = 0u; kSlot < kCount; kSlot++)
+    {
+        memcpy(pBytes + Header.EntryOffset + kSlot * sizeof(ArchiveEntry), &Entries[Slots[kSlot]], sizeof(ArchiveEntry));
+    }
+    if (!Names.empty())
+    {
+        memcpy(pBytes + Header.NameOffset, Names.data(), Names.size());
+    }
+    for (uint32_t k = 0u; k < kCount; k++)
+    {
+        const List<uint8_t>& Data = m_Entries[k].Packed.empty() ? m_Entries[k].Bytes : m_Entries[k].Packed;
+        if (!Data.empty())
+        {
+            memcpy(pBytes + Entries[k].Offset, Data.data(), Data.size());
+        }
+    }
+
+    if (!SaveFile(lpFilepath, Bytes.data(), Bytes.size()))
+    {
+        Error = "the archive could not be written";
+        return false;
+    }
+    return true;
+}
+
+size_t ArchiveWriter::GetRawSize() const noexcept
+{
+    return m_RawSize;
+}
+
+size_t ArchiveWriter::GetPackedSize() const noexcept
+{
+    return m_PackedSize;
+}
+
+// HELPERS
+size_t AlignUp(size_t kValue, size_t kAlignment) noexcept
+{
+    return (kValue + kAlignment - 1u) / kAlignment * kAlignment;
+}
+
+uint32_t Read32(const uint8_t* p) noexcept
+{
+    uint32_t kValue = 0u;
+    memcpy(&kValue, p, sizeof(kValue));
+    return kValue;
+}
+
+// Lengths past what fits the token's four bits follow it as bytes of 255 and a last one below that
+bool WriteLength(size_t kLength, uint8_t*& pOutput, const uint8_t* pOutputEnd) noexcept
+{
+    if (kLength < 15u)
+    {
+        return true;
+    }
+    for (kLength -= 15u; ; kLength -= 255u)
+    {
+        if (pOutput == pOutputEnd)
+        {
+            return false;
+        }
+        if (kLength < 255u)
+        {
+            *pOutput++ = uint8_t(kLength);
+            return true;
+        }
+        *pOutput++ = 255u;
+    }
+}
+
+bool WriteSequence(const uint8_t* pLiterals, size_t kLiterals, size_t kOffset, size_t kMatch, uint8_t*& pOutput, const uint8_t* pOutputEnd) noexcept
+{
+    if (pOutput == pOutputEnd)
+    {
+        return false;
+    }
+
+    const size_t kMatchCode = kMatch != 0u ? kMatch - s_MinMatch : 0u;
+    *pOutput++ = uint8_t((std::min<size_t>(kLiterals, 15u) << 4u) | std::min<size_t>(kMatchCode, 15u));
+    if (!WriteLength(kLiterals, pOutput, pOutputEnd) || kLiterals > size_t(pOutputEnd - pOutput))
+    {
+        return false;
+    }
+    if (kLiterals != 0u)
+    {
+        memcpy(pOutput, pLiterals, kLiterals);
+    }
+    pOutput += kLiterals;
+
+    if (kMatch == 0u)
+    {
+        return true;
+    }
+    if (pOutputEnd - pOutput < 2)
+    {
+        return false;
+    }
+    *pOutput++ = uint8_t(kOffset);
+    *pOutput++ = uint8_t(kOffset >> 8u);
+    return WriteLength(kMatchCode, pOutput, pOutputEnd);
+}
+
+bool ReadLength(size_t& kLength, const uint8_t*& pInput, const uint8_t* pInputEnd) noexcept
+{
+    if (kLength != 15u)
+    {
+        return true;
+    }
+    uint8_t kByte = 255u;
+    while (kByte == 255u)
+    {
+        if (pInput == pInputEnd)
+        {
+            return false;
+        }
+        kByte    = *pInput++;
+        kLength += kByte;
+    }
+    return true;
+}
@@ -0,0 +1,118 @@
+#pragma once
+
+#include "Core.h"
+#include "File.h"
+
+#include <string_view>
+
+enum class ArchiveCompression : uint32_t
+{
+	None,
+	LZ4, // LZ4 block format, without the frame around it
+};
+
+struct ArchiveHeader
+{
+	uint32_t Magic       = 0x4B434150u; // "PACK"
+	uint32_t Version     = 1u;
+	uint32_t EntryCount  = 0u;
+	uint32_t BucketCount = 0u;
+	uint64_t SeedOffset  = 0u; // One uint32_t per bucket of the perfect hash
+	uint64_t EntryOffset = 0u; // One ArchiveEntry per slot of the perfect hash
+	uint64_t NameOffset  = 0u; // Every path back to back, not terminated
+	uint64_t NameSize    = 0u;
+	uint64_t DataOffset  = 0u;
+	uint64_t DataSize    = 0u;
+};
+
+struct ArchiveEntry
+{
+	uint64_t           Hash        = 0u; // Of the path
+	uint64_t           Offset      = 0u; // From the start of the archive
+	uint64_t           Size        = 0u; // In the archive
+	uint64_t           RawSize     = 0u; // Once decompressed
+	uint32_t           NameOffset  = 0u;
+	uint32_t           NameLength  = 0u;
+	ArchiveCompression Compression = ArchiveCompression::None;
+	uint32_t           Reserved    = 0u;
+};
+
+// A directory of resources packed into one file that is mapped once, so loading a file from it is a lookup instead of
+// an open, a read and a close. The table of contents is indexed by a minimal perfect hash of the paths, any path is
+// found with one probe. Entries are stored raw, where the loaders read them in place, or compressed when that saves
+// enough to be worth decompressing them.
+//
+// Mount() puts one over the directory it was packed from: every MappedFile below it is then read from the archive,
+// and only what the archive does not have from the disk.
+class Archive
+{
+public:
+	Archive() = default;
+	explicit Archive(const char* lpFilepath);
+
+	bool                IsOpen() const noexcept;
+	uint32_t            GetEntryCount() const noexcept;
+	const ArchiveEntry& GetEntry(uint32_t kIndex) const noexcept;
+	std::string_view    GetName(const ArchiveEntry& Entry) const noexcept;
+
+	// Path relative to the packed directory with '/' separators, nullptr when the archive does not have it
+	const ArchiveEntry* Find(std::string_view Name) const noexcept;
+	// Path as the loaders name it, e.g. "Resources/Models/Sphere.obj" when mounted over "Resources"
+	const ArchiveEntry* FindFile(const char* lpFilepath) const noexcept;
+
+	// Points File at the entry's bytes, in place for raw entries and decompressed into a buffer it owns otherwise
+	bool                Read(const ArchiveEntry& Entry, MappedFile& File) const noexcept;
+
+	// Mounted before any loads start and unmounted after they are done, lookups take no lock
+	static bool           Mount(const char* lpFilepath, const char* lpDirectory) noexcept;
+	static void           Unmount() noexcept;
+	static const Archive* GetMounted() noexcept;
+
+	static uint64_t HashName(std::string_view Name) noexcept;
+	static uint32_t GetSlot(uint64_t kHash, uint32_t kSeed, uint32_t kSlotCount) noexcept;
+
+	static size_t   GetCompressBound(size_t kSize) noexcept;
+	// Returns the compressed size, 0 when the output did not fit
+	static size_t   Compress(const uint8_t* pInput, size_t kSize, uint8_t* pOutput, size_t kCapacity) noexcept;
+	// Fails unless the input decompresses to exactly kOutputSize bytes
+	static bool     Decompress(const uint8_t* pInput, size_t kSize, uint8_t* pOutput, size_t kOutputSize) noexcept;
+
+private:
+	Archive(const Archive&) = delete;
+	Archive& operator=(const Archive&) = delete;
+
+private:
+	MappedFile           m_File      = {};
+	String               m_Directory = {}; // Mount point, with a trailing '/'
+	const ArchiveHeader* m_pHeader   = nullptr;
+	const uint32_t*      m_pSeeds    = nullptr;
+	const ArchiveEntry*  m_pEntries  = nullptr;
+	const char*          m_lpNames   = nullptr;
+};
+
+// Builds an archive from files added in any order. Save() compresses the entries on all hardware threads and keeps
+// whatever did not shrink by at least an eighth raw, already compressed formats gain nothing and cost a copy.
+class ArchiveWriter
+{
+public:
+	// Name is the path the loaders will look it up by, relative to the packed directory
+	void Add(const String& Name, List<uint8_t>&& Bytes, bool bCompress = true) noexcept;
+
+	bool Save(const char* lpFilepath, String& Error) noexcept;
+
+	size_t GetRawSize() const noexcept;
+	size_t GetPackedSize() const noexcept;
+
+private:
+	struct Pending
+	{
+		String        Name      = {};
+		List<uint8_t> Bytes     = {};
+		List<uint8_t> Packed    = {};
+		bool          bCompress = true;
+	};
+
+	List<Pending> m_Entries    = {};
+	size_t        m_RawSize    = 0u;
+	size_t        m_PackedSize = 0u;
+};
@@ -0,0 +1,112 @@
+#pragma once
+
+#include "Core.h"
+#include "MeshOptimizer.h"
+
+#include <list>
+#include <memory>
+
+struct ImportStatistics
+{
+	size_t   PeakBytes       = 0u; // Largest importer + converted + cached footprint seen during an import
+	size_t   ResidentBytes   = 0u; // Converted data still cached between imports
+	size_t   LastImportBytes = 0u; // Importer's own footprint for the most recent file
+	uint32_t Imports         = 0u;
+	uint32_t Evictions       = 0u;
+
+	MeshOptimizationReport LastOptimization = {}; // Vertex cache statistics of the most recently imported mesh
+};
+
+// Least recently used cache of converted import data with a byte budget. Entries are shared, so evicting one only
+// drops the cache's reference and anything still using it keeps it alive.
+template<typename T>
+class AssetCache
+{
+public:
+	explicit AssetCache(size_t kBudget) noexcept
+		: m_Budget(kBudget)
+	{ }
+
+	std::shared_ptr<T> Find(uint64_t kKey) noexcept;
+	// The new entry is never evicted by its own insertion, even when it alone exceeds the budget
+	std::shared_ptr<T> Insert(uint64_t kKey, std::shared_ptr<T> pAsset, size_t kBytes) noexcept;
+	// For entries whose file changed, the next Find() misses and the file is imported again
+	void               Erase(uint64_t kKey) noexcept;
+	void               Clear() noexcept;
+
+	size_t   GetResidentBytes() const noexcept { return m_ResidentBytes; }
+	uint32_t GetEvictions()     const noexcept { return m_Evictions; }
+
+private:
+	struct Entry
+	{
+		uint64_t           Key   = 0u;
+		std::shared_ptr<T> Asset = nullptr;
+		size_t             Bytes = 0u;
+	};
+
+private:
+	std::list<Entry>                                         m_Entries = {}; // Most recently used first
+	Dictionary<uint64_t, typename std::list<Entry>::iterator> m_Lookup  = {};
+	size_t   m_Budget        = 0u;
+	size_t   m_ResidentBytes = 0u;
+	uint32_t m_Evictions     = 0u;
+};
+
+
+template<typename T>
+inline std::shared_ptr<T> AssetCache<T>::Find(uint64_t kKey) noexcept
+{
+	auto it = m_Lookup.find(kKey);
+	if (it == m_Lookup.end())
+	{
+		return nullptr;
+	}
+
+	m_Entries.splice(m_Entries.begin(), m_Entries, it->second);
+	return it->second->Asset;
+}
+
+template<typename T>
+inline std::shared_ptr<T> AssetCache<T>::Insert(uint64_t kKey, std::shared_ptr<T> pAsset, size_t kBytes) noexcept
+{
+	if (auto it = m_Lookup.find(kKey); it != m_Lookup.end())
+	{
+		m_ResidentBytes -= it->second->Bytes;
+		m_Entries.erase(it->second);
+		m_Lookup.erase(it);
+	}
+
+	while (!m_Entries.empty() && m_ResidentBytes + kBytes > m_Budget)
+	{
+		const Entry& Oldest = m_Entries.back();
+		m_ResidentBytes -= Oldest.Bytes;
+		m_Lookup.erase(Oldest.Key);
+		m_Entries.pop_back();
+		m_Evictions++;
+	}
+
+	m_Entries.push_front({ kKey, pAsset, kBytes });
+	m_Lookup[kKey] = m_Entries.begin();
+	m_ResidentBytes += kBytes;
+	return pAsset;
+}
+
+template<typename T>
+inline void AssetCache<T>::Erase(uint64_t kKey) noexcept
+{
+	if (auto it = m_Lookup.find(kKey); it != m_Lookup.end())
+	{
+		m_ResidentBytes -= it->second->Bytes;
+		m_Entries.erase(it->second);
+		m_Lookup.erase(it);
+	}
+}
+
+template<typename T>
+inline void AssetCache<T>::Clear() noexcept
+{
+	m_Entries.clear();
+	m_Lookup.clear();
+	m_ResidentBytes = 0u;
+}
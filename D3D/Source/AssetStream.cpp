@@ -0,0 +1,297 @@
+#include "AssetStream.h"
+#include "Archive.h"
+#include "AsyncReader.h"
+#include "Parallel.h"
+
+// Smallest page size of the platforms we run on, touching one byte each faults the whole file in
+static constexpr size_t s_PageSize = 4096u;
+
+AssetStream::AssetStream(const AssetStreamOptions& Options)
+    : m_Options(Options)
+{
+    m_Options.MaxPendingReads   = std::max(m_Options.MaxPendingReads, 1u);
+    m_Options.ReadQueueDepth    = std::max(m_Options.ReadQueueDepth, 1u);
+    m_Options.MaxPendingUploads = std::max(m_Options.MaxPendingUploads, 1u);
+
+    // The reader and the main thread take the remaining hardware threads
+    const uint32_t kWorkers = m_Options.Workers != 0u ? m_Options.Workers : std::max(Parallel::GetWorkerCount(), 2u) - 1u;
+    m_Reader = std::thread(&AssetStream::ReaderMain, this);
+    for (uint32_t k = 0u; k < kWorkers; k++)
+    {
+        m_Workers.emplace_back(&AssetStream::WorkerMain, this);
+    }
+}
+
+AssetStream::~AssetStream() noexcept
+{
+    {
+        std::lock_guard<std::mutex> Lock = std::lock_guard<std::mutex>(m_Mutex);
+        m_bStopping = true;
+    }
+    m_ReadWake.notify_all();
+    m_DecodeWake.notify_all();
+
+    m_Reader.join();
+    for (std::thread& Worker : m_Workers)
+    {
+        Worker.join();
+    }
+}
+
+void AssetStream::Submit(const std::shared_ptr<IAssetLoad>& pLoad) noexcept
+{
+    {
+        std::lock_guard<std::mutex> Lock = std::lock_guard<std::mutex>(m_Mutex);
+        pLoad->m_State.store(AssetState::Queued, std::memory_order_release);
+        m_ReadQueue.push_back(pLoad);
+    }
+    m_ReadWake.notify_one();
+}
+
+uint32_t AssetStream::Pump() noexcept
+{
+    uint32_t kUploads = 0u;
+    size_t   kBytes   = 0u;
+    while (kUploads < m_Options.UploadsPerFrame && (kUploads == 0u || kBytes < m_Options.UploadBytesPerFrame))
+    {
+        std::shared_ptr<IAssetLoad> pLoad = nullptr;
+        {
+            std::lock_guard<std::mutex> Lock = std::lock_guard<std::mutex>(m_Mutex);
+            if (m_UploadQueue.empty())
+            {
+                break;
+            }
+            pLoad = std::move(m_UploadQueue.front());
+            m_UploadQueue.pop_front();
+        }
+        m_DecodeWake.notify_one();
+
+        kBytes += pLoad->GetUploadBytes();
+        pLoad->Upload();
+        pLoad->m_State.store(AssetState::Ready, std::memory_order_release);
+        kUploads++;
+    }
+
+    std::lock_guard<std::mutex> Lock = std::lock_guard<std::mutex>(m_Mutex);
+    m_Statistics.Uploads     = kUploads;
+    m_Statistics.UploadBytes = kBytes;
+    m_Statistics.Completed  += kUploads;
+    return kUploads;
+}
+
+AssetStreamStatistics AssetStream::GetStatistics() const noexcept
+{
+    std::lock_guard<std::mutex> Lock = std::lock_guard<std::mutex>(m_Mutex);
+    AssetStreamStatistics Statistics = m_Statistics;
+    Statistics.Reading   = uint32_t(m_ReadQueue.size()) + m_Reading;
+    Statistics.Decoding  = uint32_t(m_DecodeQueue.size()) + m_Decoding;
+    Statistics.Uploading = uint32_t(m_UploadQueue.size());
+    return Statistics;
+}
+
+void AssetStream::ReaderMain() noexcept
+{
+    // A file read whole into memory, indexed by its request's UserData
+    struct FileRead
+    {
+        std::shared_ptr<IAssetLoad> pLoad = nullptr;
+        intptr_t                    File  = -1;
+        List<uint8_t>               Bytes = {};
+    };
+
+    List<FileRead>                                     Reads     = {};
+    List<uint32_t>                                     FreeReads = {};
+    List<std::shared_ptr<IAssetLoad>>                  Taken     = {};
+    List<ReadRequest>                                  Requests  = {};
+    List<ReadCompletion>                               Completed = {};
+    List<std::pair<std::shared_ptr<IAssetLoad>, bool>> Finished  = {}; // And whether it was read
+    uint32_t                                           kInFlight = 0u;
+
+    AsyncReaderOptions ReaderOptions = {};
+    ReaderOptions.QueueDepth = m_Options.ReadQueueDepth;
+    AsyncReader Reader = AsyncReader(ReaderOptions);
+
+    std::unique_lock<std::mutex> Lock = std::unique_lock<std::mutex>(m_Mutex);
+    while (true)
+    {
+        // With reads in flight the thread waits on those instead and takes what was queued meanwhile once one is done
+        const auto CanRead = [this]() { return !m_ReadQueue.empty() && m_DecodeQueue.size() + m_Reading < m_Options.MaxPendingReads; };
+        if (kInFlight == 0u)
+        {
+            m_ReadWake.wait(Lock, [this, &CanRead]() { return m_bStopping || CanRead(); });
+        }
+        if (m_bStopping)
+        {
+            break;
+        }
+
+        while (CanRead())
+        {
+            Taken.push_back(std::move(m_ReadQueue.front()));
+            m_ReadQueue.pop_front();
+            m_Reading++;
+        }
+        Lock.unlock();
+
+        const Archive* pArchive = Archive::GetMounted();
+        for (std::shared_ptr<IAssetLoad>& pLoad : Taken)
+        {
+            const String Filepath = pLoad->m_Filepath.string();
+
+            // Entries of the mounted archive are found without a system call and faulted in here, so the workers
+            // decode from memory instead of waiting on the disk. Compressed ones are inflated here as well.
+            if (pArchive != nullptr && pArchive->FindFile(Filepath.c_str()) != nullptr)
+            {
+                pLoad->m_File = MappedFile(Filepath.c_str());
+                const bool bRead = pLoad->m_File.IsOpen();
+                if (bRead)
+                {
+                    const uint8_t* pData = pLoad->m_File.GetData();
+                    volatile uint8_t kTouched = 0u;
+                    for (size_t k = 0u; k < pLoad->m_File.GetSize(); k += s_PageSize)
+                    {
+                        kTouched = kTouched + pData[k];
+                    }
+                }
+                Finished.emplace_back(std::move(pLoad), bRead);
+                continue;
+            }
+
+            uint64_t kSize = 0u;
+            const intptr_t File = AsyncReader::Open(Filepath.c_str());
+            if (File == -1 || !AsyncReader::GetFileSize(File, kSize))
+            {
+                AsyncReader::Close(File);
+                Finished.emplace_back(std::move(pLoad), false);
+                continue;
+            }
+
+            uint32_t kRead = uint32_t(Reads.size());
+            if (!FreeReads.empty())
+            {
+                kRead = FreeReads.back();
+                FreeReads.pop_back();
+            }
+            else
+            {
+                Reads.emplace_back();
+            }
+
+            FileRead& Read = Reads[kRead];
+            Read.pLoad = std::move(pLoad);
+            Read.File  = File;
+            Read.Bytes.resize(size_t(kSize));
+
+            ReadRequest Request = {};
+            Request.File     = File;
+            Request.pBuffer  = Read.Bytes.data();
+            Request.Size     = Read.Bytes.size();
+            Request.UserData = kRead;
+            Requests.push_back(Request);
+        }
+        Taken.clear();
+
+        Reader.Submit(Requests.data(), Requests.size());
+        kInFlight += uint32_t(Requests.size());
+        Requests.clear();
+
+        // Blocks only when nothing is ready to hand on otherwise
+        if (Finished.empty())
+        {
+            Reader.Wait(Completed);
+        }
+        else
+        {
+            Reader.Poll(Completed);
+        }
+        for (const ReadCompletion& Completion : Completed)
+        {
+            FileRead& Read = Reads[uint32_t(Completion.UserData)];
+            AsyncReader::Close(Read.File);
+
+            bool bRead = Completion.Error == 0 && Completion.Bytes == Read.Bytes.size();
+            if (bRead)
+            {
+                Read.pLoad->m_File = MappedFile(std::move(Read.Bytes));
+            }
+            else if (Completion.Error != 0)
+            {
+                // The reader may have failed rather than the file, which is then mapped and read here instead
+                Read.pLoad->m_File = MappedFile(Read.pLoad->m_Filepath.string().c_str());
+                bRead = Read.pLoad->m_File.IsOpen();
+            }
+            Finished.emplace_back(std::move(Read.pLoad), bRead);
+
+            Read = {};
+            FreeReads.push_back(uint32_t(Completion.UserData));
+            kInFlight--;
+        }
+        Completed.clear();
+
+        Lock.lock();
+        for (auto& [pLoad, bRead] : Finished)
+        {
+            m_Reading--;
+            if (bRead)
+            {
+                pLoad->m_State.store(AssetState::Decoding, std::memory_order_release);
+                m_DecodeQueue.push_back(std::move(pLoad));
+                m_DecodeWake.notify_one();
+            }
+            else
+            {
+                pLoad->m_Error = "Failed to read '" + pLoad->m_Filepath.string() + "'";
+                pLoad->m_State.store(AssetState::Failed, std::memory_order_release);
+                m_Statistics.Failed++;
+            }
+        }
+        Finished.clear();
+    }
+    Lock.unlock();
+
+    // The loads still being read are dropped, but not before the reads into their buffers are done
+    Reader.Wait(Completed, kInFlight);
+    for (const FileRead& Read : Reads)
+    {
+        AsyncReader::Close(Read.File);
+    }
+}
+
+void AssetStream::WorkerMain() noexcept
+{
+    std::unique_lock<std::mutex> Lock = std::unique_lock<std::mutex>(m_Mutex);
+    while (true)
+    {
+        // Nothing new is decoded while the main thread is behind on uploads
+        m_DecodeWake.wait(Lock, [this]()
+        {
+            return m_bStopping || (!m_DecodeQueue.empty() && m_UploadQueue.size() + m_Decoding < m_Options.MaxPendingUploads);
+        });
+        if (m_bStopping)
+        {
+            break;
+        }
+
+        std::shared_ptr<IAssetLoad> pLoad = std::move(m_DecodeQueue.front());
+        m_DecodeQueue.pop_front();
+        m_Decoding++;
+        Lock.unlock();
+        m_ReadWake.notify_one();
+
+        const bool bDecoded = pLoad->Decode(pLoad->m_File);
+        pLoad->m_File.Close();
+
+        Lock.lock();
+        m_Decoding--;
+        if (bDecoded)
+        {
+            pLoad->m_State.store(AssetState::Uploading, std::memory_order_release);
+            m_UploadQueue.push_back(std::move(pLoad));
+        }
+        else
+        {
+            pLoad->m_State.store(AssetState::Failed, std::memory_order_release);
+            m_Statistics.Failed++;
+        }
+    }
+}
@@ -0,0 +1,128 @@
+#pragma once
+
+#include "Core.h"
+#include "File.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+enum class AssetState : uint8_t
+{
+	Queued,    // Waiting for the I/O thread
+	Decoding,  // Read, waiting for a worker or on one
+	Uploading, // Decoded, waiting for the main thread
+	Ready,
+	Failed,
+};
+
+// One asset's way through an AssetStream. The file is read into memory on the I/O thread, Decode() turns it into
+// whatever the asset is made of on a worker and Upload() creates its GPU resources on the main thread. The stream
+// holds a reference until the load is done, whoever submitted it keeps one as the handle to poll.
+class IAssetLoad
+{
+public:
+	explicit IAssetLoad(const std::filesystem::path& Filepath)
+		: m_Filepath(Filepath)
+	{ }
+	virtual ~IAssetLoad() = default;
+
+	AssetState                   GetState() const noexcept    { return m_State.load(std::memory_order_acquire); }
+	bool                         IsReady() const noexcept     { return GetState() == AssetState::Ready; }
+	bool                         IsDone() const noexcept      { return GetState() >= AssetState::Ready; }
+	const std::filesystem::path& GetFilepath() const noexcept { return m_Filepath; }
+	// Why the load failed, for the main thread to report. Worker threads must not raise errors themselves.
+	const String&                GetError() const noexcept    { return m_Error; }
+
+protected:
+	// Worker thread, File is the whole of GetFilepath(). Returning false fails the load and skips Upload(), SetError()
+	// says why.
+	virtual bool   Decode(const MappedFile& File) noexcept = 0;
+	// Main thread
+	virtual void   Upload() noexcept = 0;
+	// Bytes Upload() sends to the GPU, counted against the stream's per frame budget. Valid once decoded.
+	virtual size_t GetUploadBytes() const noexcept = 0;
+
+	void SetError(String&& Error) noexcept { m_Error = std::move(Error); }
+
+private:
+	IAssetLoad(const IAssetLoad&) = delete;
+	IAssetLoad& operator=(const IAssetLoad&) = delete;
+
+private:
+	friend class AssetStream;
+
+	std::filesystem::path   m_Filepath = {};
+	MappedFile              m_File     = {};
+	String                  m_Error    = {};
+	std::atomic<AssetState> m_State    = AssetState::Queued;
+};
+
+struct AssetStreamOptions
+{
+	uint32_t Workers             = 0u;                 // Decode threads, 0 for one less than the hardware threads
+	uint32_t MaxPendingReads     = 64u;                // Files read ahead of the workers, in flight or waiting for one
+	uint32_t ReadQueueDepth      = 256u;               // Reads the I/O thread keeps in flight, a large file takes several
+	uint32_t MaxPendingUploads   = 32u;                // Decoded loads waiting for Pump(), workers stall beyond this
+	size_t   UploadBytesPerFrame = size_t(16u) << 20u;
+	uint32_t UploadsPerFrame     = 16u;
+};
+
+struct AssetStreamStatistics
+{
+	uint32_t Reading          = 0u; // Queued or being read
+	uint32_t Decoding         = 0u; // Read, waiting for a worker or on one
+	uint32_t Uploading        = 0u; // Waiting for Pump()
+	uint32_t Uploads          = 0u; // In the last Pump()
+	size_t   UploadBytes      = 0u; // In the last Pump()
+	uint64_t Completed        = 0u;
+	uint64_t Failed           = 0u;
+};
+
+// Loads assets in three stages so the frame loop never waits on one: a thread reading files, a pool of workers
+// decoding them and a bounded queue of uploads the main thread drains under a budget every frame. Each stage only
+// runs ahead of the next by a bounded number of loads, which keeps memory flat when a large scene is queued at once.
+//
+// The reader has every file it may read ahead in flight at once through an AsyncReader, enough to keep an NVMe drive
+// busy, and hands each on as soon as it completes. Entries of the mounted archive are already in memory and skip it.
+class AssetStream
+{
+public:
+	explicit AssetStream(const AssetStreamOptions& Options = {});
+	// Loads that are not done by now are dropped where they are, decodes running on a worker are finished first
+	~AssetStream() noexcept;
+
+	void Submit(const std::shared_ptr<IAssetLoad>& pLoad) noexcept;
+
+	// Main thread, once a frame. Uploads decoded loads in submission order until either budget is spent, at least
+	// one when any are waiting, so a load larger than the budget still goes through. Returns how many were uploaded.
+	uint32_t Pump() noexcept;
+
+	AssetStreamStatistics GetStatistics() const noexcept;
+
+private:
+	AssetStream(const AssetStream&) = delete;
+	AssetStream& operator=(const AssetStream&) = delete;
+
+	void ReaderMain() noexcept;
+	void WorkerMain() noexcept;
+
+private:
+	AssetStreamOptions m_Options = {};
+	std::thread        m_Reader  = {};
+	List<std::thread>  m_Workers = {};
+
+	mutable std::mutex                      m_Mutex       = {};
+	std::condition_variable                 m_ReadWake    = {};
+	std::condition_variable                 m_DecodeWake  = {};
+	std::deque<std::shared_ptr<IAssetLoad>> m_ReadQueue   = {};
+	std::deque<std::shared_ptr<IAssetLoad>> m_DecodeQueue = {};
+	std::deque<std::shared_ptr<IAssetLoad>> m_UploadQueue = {};
+	uint32_t                                m_Reading     = 0u;
+	uint32_t                                m_Decoding    = 0u;
+	AssetStreamStatistics                   m_Statistics  = {};
+	bool                                    m_bStopping   = false;
+};
@@ -0,0 +1,596 @@
+#include "AsyncReader.h"
+
+#include <algorithm>
+
+#include <errno.h>
+#include <string.h>
+
+#ifdef _WIN32
+  #define WIN32_LEAN_AND_MEAN
+  #define NOMINMAX
+  #include <Windows.h>
+#else
+  #include <fcntl.h>
+  #include <sys/stat.h>
+  #include <unistd.h>
+#endif // _WIN32
+
+#ifdef __linux__
+  #include <linux/io_uring.h>
+  #include <sys/mman.h>
+  #include <sys/syscall.h>
+#endif // __linux__
+
+// Direct reads need offsets, sizes and buffers aligned to the drive's sectors, a page covers every drive we run on
+static constexpr size_t s_DirectAlignment = 4096u;
+static constexpr size_t s_MaxReadSize     = size_t(1u) << 30u; // What one read of either backend can take
+
+#ifdef __linux__
+// The submission and completion rings share one mapping, kernels without IORING_FEAT_SINGLE_MMAP are not used
+struct Ring
+{
+    int32_t       Descriptor  = -1;
+    uint8_t*      pRings      = nullptr;
+    size_t        RingsSize   = 0u;
+    io_uring_sqe* pEntries    = nullptr;
+    size_t        EntriesSize = 0u;
+
+    uint32_t*     pSqHead     = nullptr;
+    uint32_t*     pSqTail     = nullptr;
+    uint32_t*     pSqArray    = nullptr;
+    uint32_t      kSqMask     = 0u;
+    uint32_t*     pCqHead     = nullptr;
+    uint32_t*     pCqTail     = nullptr;
+    io_uring_cqe* pCqEntries  = nullptr;
+    uint32_t      kCqMask     = 0u;
+};
+
+static int32_t  EnterRing(Ring& r, uint32_t kMinComplete) noexcept;
+static uint16_t GetIoPriority(ReadPriority Priority) noexcept;
+#endif // __linux__
+
+static int64_t ReadAt(intptr_t File, uint64_t Offset, uint8_t* pBuffer, size_t Size) noexcept;
+
+// ASYNC READER
+AsyncReader::AsyncReader(const AsyncReaderOptions& Options)
+    : m_Options(Options)
+{
+    // Parts of a split read stay aligned for direct reads
+    m_Options.QueueDepth  = std::clamp(m_Options.QueueDepth, 1u, 4096u);
+    m_Options.MaxReadSize = std::clamp(m_Options.MaxReadSize / s_DirectAlignment * s_DirectAlignment, s_DirectAlignment, s_MaxReadSize);
+    if (m_Options.bForceThreadPool || !OpenRing())
+    {
+        StartWorkers();
+    }
+}
+
+AsyncReader::~AsyncReader() noexcept
+{
+    // Queued parts are dropped, the ones in flight still write into their callers' buffers until they are reaped
+    for (std::deque<uint32_t>& Queued : m_Queued)
+    {
+        Queued.clear();
+    }
+    while (m_InFlight > 0u)
+    {
+        ReapParts(true);
+    }
+
+    CloseRing();
+    {
+        std::lock_guard<std::mutex> Lock = std::lock_guard<std::mutex>(m_Mutex);
+        m_bStopping = true;
+    }
+    m_WorkWake.notify_all();
+    for (std::thread& Worker : m_Workers)
+    {
+        Worker.join();
+    }
+}
+
+intptr_t AsyncReader::Open(const char* lpFilepath, bool bDirect) noexcept
+{
+#ifdef _WIN32
+    HANDLE hFile = CreateFileA(lpFilepath, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, bDirect ? FILE_FLAG_NO_BUFFERING : 0u, NULL);
+    return hFile != INVALID_HANDLE_VALUE ? reinterpret_cast<intptr_t>(hFile) : -1;
+#else
+    int32_t kFlags = O_RDONLY | O_CLOEXEC;
+  #ifdef O_DIRECT
+    kFlags |= bDirect ? O_DIRECT : 0;
+  #endif // O_DIRECT
+    return intptr_t(open(lpFilepath, kFlags));
+#endif // _WIN32
+}
+
+void AsyncReader::Close(intptr_t File) noexcept
+{
+    if (File == -1)
+    {
+        return;
+    }
+#ifdef _WIN32
+    CloseHandle(reinterpret_cast<HANDLE>(File));
+#else
+    close(int32_t(File));
+#endif // _WIN32
+}
+
+bool AsyncReader::GetFileSize(intptr_t File, uint64_t& kSize) noexcept
+{
+#ifdef _WIN32
+    LARGE_INTEGER kFileSize = {};
+    if (!GetFileSizeEx(reinterpret_cast<HANDLE>(File), &kFileSize))
+    {
+        return false;
+    }
+    kSize = uint64_t(kFileSize.QuadPart);
+#else
+    struct stat Stat = {};
+    if (fstat(int32_t(File), &Stat) != 0)
+    {
+        return false;
+    }
+    kSize = uint64_t(Stat.st_size);
+#endif // _WIN32
+    return true;
+}
+
+size_t AsyncReader::GetDirectAlignment() noexcept
+{
+    return s_DirectAlignment;
+}
+
+void AsyncReader::Submit(const ReadRequest* pRequests, size_t kCount) noexcept
+{
+    for (size_t k = 0u; k < kCount; k++)
+    {
+        const ReadRequest& Request = pRequests[k];
+
+        uint32_t kRead = uint32_t(m_Reads.size());
+        if (!m_FreeReads.empty())
+        {
+            kRead = m_FreeReads.back();
+            m_FreeReads.pop_back();
+        }
+        else
+        {
+            m_Reads.emplace_back();
+        }
+        m_Reads[kRead] = {};
+        m_Reads[kRead].UserData = Request.UserData;
+        m_Pending++;
+
+        // Empty reads still go through the backend once, so they complete like any other
+        size_t kOffset = 0u;
+        do
+        {
+            uint32_t kPart = uint32_t(m_Parts.size());
+            if (!m_FreeParts.empty())
+            {
+                kPart = m_FreeParts.back();
+                m_FreeParts.pop_back();
+            }
+            else
+            {
+                m_Parts.emplace_back();
+            }
+
+            ReadPart& Part = m_Parts[kPart];
+            Part.Request  = kRead;
+            Part.File     = Request.File;
+            Part.Offset   = Request.Offset + kOffset;
+            Part.pBuffer  = static_cast<uint8_t*>(Request.pBuffer) + kOffset;
+            Part.Size     = std::min(m_Options.MaxReadSize, Request.Size - kOffset);
+            Part.Priority = Request.Priority;
+            QueuePart(kPart);
+
+            m_Reads[kRead].Parts++;
+            kOffset += Part.Size;
+        } while (kOffset < Request.Size);
+    }
+    Dispatch();
+}
+
+size_t AsyncReader::Poll(List<ReadCompletion>& Completed) noexcept
+{
+    ReapParts(false);
+    const size_t kCompleted = Complete(Completed);
+    Dispatch();
+    return kCompleted;
+}
+
+size_t AsyncReader::Wait(List<ReadCompletion>& Completed, size_t kMinimum) noexcept
+{
+    // Results are left over when the ring was given up on while dispatching, and completed without waiting
+    size_t kCompleted = Poll(Completed);
+    while (kCompleted < kMinimum && (m_InFlight > 0u || !m_Results.empty()))
+    {
+        ReapParts(m_Results.empty());
+        kCompleted += Complete(Completed);
+        Dispatch();
+    }
+    return kCompleted;
+}
+
+uint32_t AsyncReader::GetPendingCount() const noexcept
+{
+    return m_Pending;
+}
+
+const char* AsyncReader::GetBackendName() const noexcept
+{
+    return m_pRing != nullptr ? "io_uring" : "thread pool";
+}
+
+void AsyncReader::QueuePart(uint32_t kPart) noexcept
+{
+    m_Queued[size_t(m_Parts[kPart].Priority)].push_back(kPart);
+}
+
+void AsyncReader::Dispatch() noexcept
+{
+    m_Batch.clear();
+    for (std::deque<uint32_t>& Queued : m_Queued)
+    {
+        while (!Queued.empty() && m_InFlight + m_Batch.size() < m_Options.QueueDepth)
+        {
+            m_Batch.push_back(Queued.front());
+            Queued.pop_front();
+        }
+    }
+    if (!m_Batch.empty())
+    {
+        m_InFlight += uint32_t(m_Batch.size());
+        SubmitParts(m_Batch);
+    }
+}
+
+size_t AsyncReader::Complete(List<ReadCompletion>& Completed) noexcept
+{
+    size_t kCompleted = 0u;
+    for (const auto& [kPart, kResult] : m_Results)
+    {
+        ReadPart&    Part = m_Parts[kPart];
+        PendingRead& Read = m_Reads[Part.Request];
+
+        // Interrupted, or short of what was asked for and not at the end of the file: the rest is read again. The
+        // thread pool retries on its own and reports Win32 codes, which these would be mistaken for.
+        if (m_pRing != nullptr && (kResult == -EINTR || kResult == -EAGAIN))
+        {
+            QueuePart(kPart);
+            continue;
+        }
+        if (kResult > 0 && size_t(kResult) < Part.Size)
+        {
+            Read.Bytes   += size_t(kResult);
+            Part.Offset  += uint64_t(kResult);
+            Part.pBuffer += kResult;
+            Part.Size    -= size_t(kResult);
+            QueuePart(kPart);
+            continue;
+        }
+
+        if (kResult < 0)
+        {
+            Read.Error = int32_t(-kResult);
+        }
+        else
+        {
+            Read.Bytes += size_t(kResult);
+        }
+        m_FreeParts.push_back(kPart);
+
+        if (--Read.Parts == 0u)
+        {
+            ReadCompletion Completion = {};
+            Completion.UserData = Read.UserData;
+            Completion.Bytes    = Read.Bytes;
+            Completion.Error    = Read.Error;
+            Completed.push_back(Completion);
+
+            m_FreeReads.push_back(Part.Request);
+            m_Pending--;
+            kCompleted++;
+        }
+    }
+    m_Results.clear();
+    return kCompleted;
+}
+
+void AsyncReader::SubmitParts(const List<uint32_t>& Parts) noexcept
+{
+#ifdef __linux__
+    if (m_pRing != nullptr)
+    {
+        Ring&    r     = *static_cast<Ring*>(m_pRing);
+        uint32_t kTail = *r.pSqTail;
+        for (const uint32_t kPart : Parts)
+        {
+            const ReadPart& Part   = m_Parts[kPart];
+            const uint32_t  kIndex = kTail & r.kSqMask;
+
+            io_uring_sqe& Entry = r.pEntries[kIndex];
+            memset(&Entry, 0, sizeof(Entry));
+            Entry.opcode    = IORING_OP_READ;
+            Entry.fd        = int32_t(Part.File);
+            Entry.off       = Part.Offset;
+            Entry.addr      = uint64_t(reinterpret_cast<uintptr_t>(Part.pBuffer));
+            Entry.len       = uint32_t(Part.Size);
+            Entry.ioprio    = GetIoPriority(Part.Priority);
+            Entry.user_data = kPart;
+            r.pSqArray[kIndex] = kIndex;
+            kTail++;
+        }
+
+        // The whole batch in one system call
+        __atomic_store_n(r.pSqTail, kTail, __ATOMIC_RELEASE);
+        if (EnterRing(r, 0u) < 0)
+        {
+            const int32_t kError = errno;
+            ReapParts(false);
+            AbandonRing(kError);
+        }
+        return;
+    }
+#endif // __linux__
+
+    {
+        std::lock_guard<std::mutex> Lock = std::lock_guard<std::mutex>(m_Mutex);
+        for (const uint32_t kPart : Parts)
+        {
+            m_Work.emplace_back(kPart, m_Parts[kPart]);
+        }
+    }
+    if (Parts.size() == 1u)
+    {
+        m_WorkWake.notify_one();
+    }
+    else
+    {
+        m_WorkWake.notify_all();
+    }
+}
+
+void AsyncReader::ReapParts(bool bWait) noexcept
+{
+    const size_t kReaped = m_Results.size();
+#ifdef __linux__
+    if (m_pRing != nullptr)
+    {
+        Ring&    r      = *static_cast<Ring*>(m_pRing);
+        uint32_t kHead  = *r.pCqHead;
+        int32_t  kError = 0;
+        if (bWait && kHead == __atomic_load_n(r.pCqTail, __ATOMIC_ACQUIRE) && EnterRing(r, 1u) < 0)
+        {
+            kError = errno;
+        }
+
+        const uint32_t kTail = __atomic_load_n(r.pCqTail, __ATOMIC_ACQUIRE);
+        for (; kHead != kTail; kHead++)
+        {
+            const io_uring_cqe& Entry = r.pCqEntries[kHead & r.kCqMask];
+            m_Results.emplace_back(uint32_t(Entry.user_data), int64_t(Entry.res));
+        }
+        __atomic_store_n(r.pCqHead, kHead, __ATOMIC_RELEASE);
+        m_InFlight -= uint32_t(m_Results.size() - kReaped);
+        if (kError != 0)
+        {
+            AbandonRing(kError);
+        }
+        return;
+    }
+#endif // __linux__
+
+    std::unique_lock<std::mutex> Lock = std::unique_lock<std::mutex>(m_Mutex);
+    if (bWait)
+    {
+        m_DoneWake.wait(Lock, [this]() { return !m_Done.empty(); });
+    }
+    m_Results.insert(m_Results.end(), m_Done.begin(), m_Done.end());
+    m_Done.clear();
+    m_InFlight -= uint32_t(m_Results.size() - kReaped);
+}
+
+bool AsyncReader::OpenRing() noexcept
+{
+#ifdef __linux__
+    // Refused outright by kernels built without it and by sandboxes that filter the system call
+    io_uring_params Params = {};
+    const int32_t   kRing  = int32_t(syscall(__NR_io_uring_setup, m_Options.QueueDepth, &Params));
+    if (kRing < 0)
+    {
+        return false;
+    }
+
+    // IORING_OP_READ came with 5.6, 5.7 added the first feature flag that tells those kernels apart
+    if ((Params.features & IORING_FEAT_SINGLE_MMAP) == 0u || (Params.features & IORING_FEAT_FAST_POLL) == 0u)
+    {
+        close(kRing);
+        return false;
+    }
+
+    Ring* pRing = new Ring();
+    pRing->Descriptor  = kRing;
+    pRing->RingsSize   = std::max(Params.sq_off.array + Params.sq_entries * sizeof(uint32_t), Params.cq_off.cqes + Params.cq_entries * sizeof(io_uring_cqe));
+    pRing->EntriesSize = Params.sq_entries * sizeof(io_uring_sqe);
+
+    void* pRings   = mmap(nullptr, pRing->RingsSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, kRing, IORING_OFF_SQ_RING);
+    void* pEntries = mmap(nullptr, pRing->EntriesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, kRing, IORING_OFF_SQES);
+    if (pRings == MAP_FAILED || pEntries == MAP_FAILED)
+    {
+        if (pRings != MAP_FAILED)
+        {
+            munmap(pRings, pRing->RingsSize);
+        }
+        if (pEntries != MAP_FAILED)
+        {
+            munmap(pEntries, pRing->EntriesSize);
+        }
+        close(kRing);
+        delete pRing;
+        return false;
+    }
+
+    uint8_t* p = static_cast<uint8_t*>(pRings);
+    pRing->pRings     = p;
+    pRing->pEntries   = static_cast<io_uring_sqe*>(pEntries);
+    pRing->pSqHead    = reinterpret_cast<uint32_t*>(p + Params.sq_off.head);
+    pRing->pSqTail    = reinterpret_cast<uint32_t*>(p + Params.sq_off.tail);
+    pRing->pSqArray   = reinterpret_cast<uint32_t*>(p + Params.sq_off.array);
+    pRing->kSqMask    = *reinterpret_cast<const uint32_t*>(p + Params.sq_off.ring_mask);
+    pRing->pCqHead    = reinterpret_cast<uint32_t*>(p + Params.cq_off.head);
+    pRing->pCqTail    = reinterpret_cast<uint32_t*>(p + Params.cq_off.tail);
+    pRing->pCqEntries = reinterpret_cast<io_uring_cqe*>(p + Params.cq_off.cqes);
+    pRing->kCqMask    = *reinterpret_cast<const uint32_t*>(p + Params.cq_off.ring_mask);
+    m_pRing = pRing;
+    return true;
+#else
+    return false;
+#endif // __linux__
+}
+
+// The ring failed in a way retrying would not fix, so nothing it holds could be waited for. Those parts fail with
+// its error, closing the ring cancels the ones the kernel took, and the thread pool takes every read after them.
+void AsyncReader::AbandonRing(int32_t kError) noexcept
+{
+    List<bool> Held = List<bool>(m_Parts.size(), true);
+    for (const uint32_t kPart : m_FreeParts)
+    {
+        Held[kPart] = false;
+    }
+    for (const std::deque<uint32_t>& Queued : m_Queued)
+    {
+        for (const uint32_t kPart : Queued)
+        {
+            Held[kPart] = false;
+        }
+    }
+    for (const PartResult& Result : m_Results)
+    {
+        Held[Result.first] = false;
+    }
+
+    for (uint32_t kPart = 0u; kPart < uint32_t(m_Parts.size()); kPart++)
+    {
+        if (Held[kPart])
+        {
+            m_Results.emplace_back(kPart, -int64_t(kError));
+        }
+    }
+    m_InFlight = 0u;
+
+    CloseRing();
+    StartWorkers();
+}
+
+void AsyncReader::CloseRing() noexcept
+{
+#ifdef __linux__
+    if (m_pRing == nullptr)
+    {
+        return;
+    }
+
+    Ring* pRing = static_cast<Ring*>(m_pRing);
+    munmap(pRing->pEntries, pRing->EntriesSize);
+    munmap(pRing->pRings, pRing->RingsSize);
+    close(pRing->Descriptor);
+    delete pRing;
+    m_pRing = nullptr;
+#endif // __linux__
+}
+
+void AsyncReader::StartWorkers() noexcept
+{
+    for (uint32_t k = 0u; k < std::max(m_Options.Workers, 1u); k++)
+    {
+        m_Workers.emplace_back(&AsyncReader::WorkerMain, this);
+    }
+}
+
+void AsyncReader::WorkerMain() noexcept
+{
+    std::unique_lock<std::mutex> Lock = std::unique_lock<std::mutex>(m_Mutex);
+    while (true)
+    {
+        m_WorkWake.wait(Lock, [this]() { return m_bStopping || !m_Work.empty(); });
+        if (m_Work.empty())
+        {
+            break;
+        }
+
+        const std::pair<uint32_t, ReadPart> Work = m_Work.front();
+        m_Work.pop_front();
+        Lock.unlock();
+
+        const int64_t kResult = ReadAt(Work.second.File, Work.second.Offset, Work.second.pBuffer, Work.second.Size);
+
+        Lock.lock();
+        m_Done.emplace_back(Work.first, kResult);
+        m_DoneWake.notify_one();
+    }
+}
+
+// HELPERS
+#ifdef __linux__
+// Submits whatever the kernel has not taken from the submission ring yet, and waits for completions if asked to.
+// Only interruptions are retried, any other error is returned with errno set.
+int32_t EnterRing(Ring& r, uint32_t kMinComplete) noexcept
+{
+    while (true)
+    {
+        const uint32_t kUnsubmitted = *r.pSqTail - __atomic_load_n(r.pSqHead, __ATOMIC_ACQUIRE);
+        const uint32_t kFlags       = kMinComplete > 0u ? IORING_ENTER_GETEVENTS : 0u;
+        const int32_t  kResult      = int32_t(syscall(__NR_io_uring_enter, r.Descriptor, kUnsubmitted, kMinComplete, kFlags, nullptr, 0));
+        if (kResult >= 0 || errno != EINTR)
+        {
+            return kResult;
+        }
+    }
+}
+
+// Best effort class, its highest level for what the frame waits on and its lowest for prefetching
+uint16_t GetIoPriority(ReadPriority Priority) noexcept
+{
+    static constexpr uint16_t kClassBestEffort = 2u;
+    static constexpr uint16_t kLevels[]        = { 0u, 4u, 7u };
+    return uint16_t((kClassBestEffort << 13u) | kLevels[size_t(Priority)]);
+}
+#endif // __linux__
+
+// Blocking read of the fallback, whole unless the file ends first. Returns the bytes read or the error negated.
+int64_t ReadAt(intptr_t File, uint64_t Offset, uint8_t* pBuffer, size_t Size) noexcept
+{
+    size_t kRead = 0u;
+    while (kRead < Size)
+    {
+#ifdef _WIN32
+        OVERLAPPED Overlapped = {};
+        Overlapped.Offset     = DWORD(Offset + kRead);
+        Overlapped.OffsetHigh = DWORD((Offset + kRead) >> 32u);
+
+        DWORD kBytes = 0u;
+        if (!ReadFile(reinterpret_cast<HANDLE>(File), pBuffer + kRead, DWORD(Size - kRead), &kBytes, &Overlapped))
+        {
+            const DWORD kError = GetLastError();
+            return kError == ERROR_HANDLE_EOF ? int64_t(kRead) : -int64_t(kError);
+        }
+#else
+        const ssize_t kBytes = pread(int32_t(File), pBuffer + kRead, Size - kRead, off_t(Offset + kRead));
+        if (kBytes < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            return -int64_t(errno);
+        }
+#endif // _WIN32
+        if (kBytes == 0)
+        {
+            break;
+        }
+        kRead += size_t(kBytes);
+    }
+    return int64_t(kRead);
+}
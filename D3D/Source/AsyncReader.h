@@ -0,0 +1,134 @@
+#pragma once
+
+#include "Core.h"
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+enum class ReadPriority : uint8_t
+{
+	High,   // Needed for the current frame
+	Normal,
+	Low,    // Prefetch
+	Count,
+};
+
+// Reads Size bytes at Offset into the caller's buffer, which must stay valid until the read completes. Files opened
+// for direct reads bypass the page cache and need Offset, Size and pBuffer aligned to GetDirectAlignment().
+struct ReadRequest
+{
+	intptr_t     File     = -1;
+	uint64_t     Offset   = 0u;
+	void*        pBuffer  = nullptr;
+	size_t       Size     = 0u;
+	ReadPriority Priority = ReadPriority::Normal;
+	uint64_t     UserData = 0u;
+};
+
+struct ReadCompletion
+{
+	uint64_t UserData = 0u;
+	size_t   Bytes    = 0u; // Less than asked for only past the end of the file
+	int32_t  Error    = 0;  // errno, or the Win32 error code
+};
+
+struct AsyncReaderOptions
+{
+	uint32_t QueueDepth       = 256u;                // Reads in flight at once, the rest wait in priority order
+	size_t   MaxReadSize      = size_t(1u) << 20u;   // Larger reads are split, so one large file keeps many in flight
+	uint32_t Workers          = 32u;                 // Blocking readers of the fallback, enough to keep a fast drive busy
+	bool     bForceThreadPool = false;
+};
+
+// Asynchronous file reads with batched submission. On Linux they go through an io_uring: a batch is one system call
+// to submit and completions are reaped from shared memory without any. Where there is no io_uring (other platforms,
+// older kernels, sandboxes that forbid it) a pool of threads makes blocking positional reads instead, behind the same
+// interface. Should the io_uring fail later on, the reads it holds fail with its error and the thread pool takes over.
+//
+// Reads past the queue depth wait in the reader and are submitted as earlier ones complete, highest priority first,
+// and on an io_uring carry their priority to the kernel's I/O scheduler. Not thread safe: one thread submits and
+// reaps, as the asset stream's reader does.
+class AsyncReader
+{
+public:
+	explicit AsyncReader(const AsyncReaderOptions& Options = {});
+	// Waits for the reads in flight, the caller's buffers may be freed once it returns
+	~AsyncReader() noexcept;
+
+	static intptr_t Open(const char* lpFilepath, bool bDirect = false) noexcept;
+	static void     Close(intptr_t File) noexcept;
+	static bool     GetFileSize(intptr_t File, uint64_t& kSize) noexcept;
+	static size_t   GetDirectAlignment() noexcept;
+
+	void     Submit(const ReadRequest* pRequests, size_t kCount) noexcept;
+	// Appends the reads that completed, Wait() blocks until at least kMinimum did or none are left. Both return how
+	// many they appended.
+	size_t   Poll(List<ReadCompletion>& Completed) noexcept;
+	size_t   Wait(List<ReadCompletion>& Completed, size_t kMinimum = 1u) noexcept;
+
+	uint32_t    GetPendingCount() const noexcept;
+	const char* GetBackendName() const noexcept;
+
+private:
+	AsyncReader(const AsyncReader&) = delete;
+	AsyncReader& operator=(const AsyncReader&) = delete;
+
+	// A request, or its share of one, as one read of the backend
+	struct ReadPart
+	{
+		uint32_t     Request  = 0u;
+		intptr_t     File     = -1;
+		uint64_t     Offset   = 0u;
+		uint8_t*     pBuffer  = nullptr;
+		size_t       Size     = 0u;
+		ReadPriority Priority = ReadPriority::Normal;
+	};
+
+	struct PendingRead
+	{
+		uint64_t UserData = 0u;
+		size_t   Bytes    = 0u;
+		uint32_t Parts    = 0u; // Not completed yet
+		int32_t  Error    = 0;
+	};
+
+	// Part and the bytes it read, or its error negated
+	using PartResult = std::pair<uint32_t, int64_t>;
+
+	void   QueuePart(uint32_t kPart) noexcept;
+	void   Dispatch() noexcept;
+	size_t Complete(List<ReadCompletion>& Completed) noexcept;
+
+	void   SubmitParts(const List<uint32_t>& Parts) noexcept;
+	void   ReapParts(bool bWait) noexcept;
+
+	bool   OpenRing() noexcept;
+	void   AbandonRing(int32_t kError) noexcept;
+	void   CloseRing() noexcept;
+	void   StartWorkers() noexcept;
+	void   WorkerMain() noexcept;
+
+private:
+	AsyncReaderOptions   m_Options   = {};
+	List<PendingRead>    m_Reads     = {};
+	List<uint32_t>       m_FreeReads = {};
+	List<ReadPart>       m_Parts     = {};
+	List<uint32_t>       m_FreeParts = {};
+	std::deque<uint32_t> m_Queued[size_t(ReadPriority::Count)] = {}; // Parts not submitted yet
+	List<uint32_t>       m_Batch     = {};
+	List<PartResult>     m_Results   = {};
+	uint32_t             m_InFlight  = 0u; // Parts submitted and not reaped
+	uint32_t             m_Pending   = 0u; // Requests not completed
+	void*                m_pRing     = nullptr; // nullptr when the thread pool reads instead
+
+	// Thread pool
+	std::mutex                                m_Mutex     = {};
+	std::condition_variable                   m_WorkWake  = {};
+	std::condition_variable                   m_DoneWake  = {};
+	List<std::thread>                         m_Workers   = {};
+	std::deque<std::pair<uint32_t, ReadPart>> m_Work      = {}; // Copies, the workers never touch m_Parts
+	List<PartResult>                          m_Done      = {};
+	bool                                      m_bStopping = false;
+};
@@ -2,10 +2,16 @@
 
 #pragma warning (disable: 4267)
 
+#include "Archive.h"
 #include "Bindable.h"
 #include "Drawable.h"
 #include "Camera.h"
 #include "Light.h"
+#include "FileWatcher.h"
+
+#include <algorithm>
+#include <chrono>
+#include <sstream>
 
 #include <imgui/imgui.h>
 #include <imgui/backends/imgui_impl_dx11.h>
@@ -99,18 +105,36 @@ struct RendererContext
 
     Dictionary<String, VertexShader*>   VertexShaders   = {};
     Dictionary<String, PixelShader*>    PixelShaders    = {};
-    Dictionary<uint32_t, VertexBuffer*> VertexBuffers    = {};
-    Dictionary<uint32_t, IndexBuffer*>  IndexBuffers     = {};
+    Dictionary<uint64_t, VertexBuffer*> VertexBuffers    = {};
+    Dictionary<uint64_t, IndexBuffer*>  IndexBuffers     = {};
+    // Asset streaming
+    std::unique_ptr<AssetStream>                      Streaming         = nullptr;
+    Dictionary<String, std::shared_ptr<IAssetLoad>> VertexShaderLoads = {}; // Every prefetch, by shader name
+    Dictionary<String, std::shared_ptr<IAssetLoad>> PixelShaderLoads  = {};
+    std::unique_ptr<FileWatcher>                      Watcher           = nullptr; // Resources saved while running
 
     // User Runtime Renderer Data
     Matrix4x4                           Projection      = DirectX::XMMatrixIdentity();
     SceneCamera                         Camera          = {};
     float                               Frametime       = 0.0f;
+    uint32_t                            kTriangles      = 0u; // Submitted this frame
+    uint32_t                            kPoints         = 0u; // Point list vertices submitted this frame
     List<IDrawable*>                    Drawables       = {};
     PointLight*                         Light           = nullptr;
+    // Ray queries
+    InstanceBvh                         SceneBvh         = {};
+    List<IDrawable*>                    Pickables        = {}; // Instance order of SceneBvh
+    size_t                              kPickableSource  = 0u; // Drawable count SceneBvh was built from
+    uint32_t                            kGeometryVersion = 0u; // Mesh::GetGeometryVersion() SceneBvh was built from
 
     bool                                bMouse[7]       = {};
     bool                                bKeys[256]      = {};
+    Float2                              Cursor          = {};
+
+    // Demos added next to the test meshes, each only when its switch is on the command line
+    bool                                bVolumeDemo     = false; // --volume
+    bool                                bPointCloudDemo = false; // --point-cloud
+    bool                                bTerrainDemo    = false; // --terrain
 };
 
 static constexpr const wchar_t* s_ClassName = L"D3D";
@@ -119,19 +143,66 @@ static RendererContext s_Context = {};
 
 
 static float            Clock() noexcept;
+static String           GetShaderName(const std::filesystem::path& Filepath) noexcept;
 static bool             InitializeD3D();
 static void             ShutdownD3D();
 static void             BeginFrame(const Float4& ClearColor = Float4(1.0f));
 static void             RenderFrame(float dt);
 static void             EndFrame();
+static void             ParseCommandLine(const wchar_t* lpCommandLine) noexcept;
 static void             DrawTestTriangle() noexcept;
+static void             AddVolumeDemo() noexcept;
+static void             AddPointCloudDemo() noexcept;
+static void             AddTerrainDemo() noexcept;
+static void             UpdateSceneBvh() noexcept;
 static LRESULT CALLBACK WindowProcedure(HWND hWnd, UINT kMsg, WPARAM wParam, LPARAM lParam);
 
+// Keeps the instance tree in step with the drawables: rebuilt when drawables come, go, finish loading or are
+// reloaded, refit as they move
+void UpdateSceneBvh() noexcept
+{
+    const size_t kPickable = std::count_if(s_Context.Drawables.begin(), s_Context.Drawables.end(), [](IDrawable* pDrawable)
+    {
+        const TriangleBvh* pBvh = pDrawable->GetBvh();
+        return pBvh && !pBvh->IsEmpty();
+    });
+
+    if (s_Context.kPickableSource != s_Context.Drawables.size() || kPickable != s_Context.Pickables.size() || s_Context.kGeometryVersion != Mesh::GetGeometryVersion())
+    {
+        s_Context.kPickableSource  = s_Context.Drawables.size();
+        s_Context.kGeometryVersion = Mesh::GetGeometryVersion();
+        s_Context.Pickables.clear();
+
+        List<BvhInstance> Instances = {};
+        for (IDrawable* const& pDrawable : s_Context.Drawables)
+        {
+            if (const TriangleBvh* pBvh = pDrawable->GetBvh(); pBvh && !pBvh->IsEmpty())
+            {
+                BvhInstance& Instance = Instances.emplace_back();
+                Instance.pBvh = pBvh;
+                DirectX::XMStoreFloat4x4(reinterpret_cast<DirectX::XMFLOAT4X4*>(&Instance.Transform), pDrawable->GetTransform());
+                s_Context.Pickables.push_back(pDrawable);
+            }
+        }
+        s_Context.SceneBvh.Build(Instances.data(), Instances.size());
+        return;
+    }
+
+    Float4x4 Transform = {};
+    for (size_t k = 0u; k < s_Context.Pickables.size(); k++)
+    {
+        DirectX::XMStoreFloat4x4(reinterpret_cast<DirectX::XMFLOAT4X4*>(&Transform), s_Context.Pickables[k]->GetTransform());
+        s_Context.SceneBvh.SetTransform(uint32_t(k), Transform);
+    }
+    s_Context.SceneBvh.Refit();
+}
+
 // RENDERER
-bool Renderer3D::Initialize(HINSTANCE hInstance)
+bool Renderer3D::Initialize(HINSTANCE hInstance, const wchar_t* lpCommandLine)
 {
     if (!hInstance)
         return GfxError(false, "hInstance is NULL");
+    ParseCommandLine(lpCommandLine);
 
     IMGUI_CHECKVERSION();
     ImGui::CreateContext();
@@ -223,68 +294,155 @@ void Renderer3D::Run()
     };
 }
 
-void Renderer3D::DrawIndexed(uint32_t kIndexCount) noexcept
+void Renderer3D::DrawIndexed(uint32_t kIndexCount, uint32_t kStartIndex, int32_t kBaseVertex) noexcept
 {
-    s_Context.pDeviceContext->DrawIndexed(kIndexCount, 0u, 0);
+    s_Context.kTriangles += kIndexCount / 3u;
+    s_Context.pDeviceContext->DrawIndexed(kIndexCount, kStartIndex, kBaseVertex);
 }
 
-VertexShader* Renderer3D::GetVertexShader(const std::filesystem::path& Filepath, const char* lpEntryPoint) noexcept
+void Renderer3D::Draw(uint32_t kVertexCount, uint32_t kStartVertex) noexcept
 {
-    String Name = Filepath.string();
-    if (size_t kIndex = Name.find_last_of('/', 0u); kIndex != String::npos)
-    {
-        Name = Name.substr(kIndex);
-    }
+    s_Context.kPoints += kVertexCount;
+    s_Context.pDeviceContext->Draw(kVertexCount, kStartVertex);
+}
 
+VertexShader* Renderer3D::GetVertexShader(const std::filesystem::path& Filepath, const char* lpEntryPoint, ID3DBlob* pBytecode) noexcept
+{
+    const String Name = GetShaderName(Filepath);
     if (auto it = s_Context.VertexShaders.find(Name); it != s_Context.VertexShaders.end())
     {
         return it->second;
     }
     else
     {
-        VertexShader* pVS = new VertexShader(Filepath, lpEntryPoint);
+        VertexShader* pVS = new VertexShader(Filepath, lpEntryPoint, pBytecode);
         return (s_Context.VertexShaders[Name] = pVS);
     }
 }
 
-PixelShader* Renderer3D::GetPixelShader(const std::filesystem::path& Filepath, const char* lpEntryPoint) noexcept
+PixelShader* Renderer3D::GetPixelShader(const std::filesystem::path& Filepath, const char* lpEntryPoint, ID3DBlob* pBytecode) noexcept
 {
-    String Name = Filepath.string();
-    if (size_t kIndex = Name.find_last_of('/', 0u); kIndex != String::npos)
+    const String Name = GetShaderName(Filepath);
+    if (auto it = s_Context.PixelShaders.find(Name); it != s_Context.PixelShaders.end())
     {
-        Name = Name.substr(kIndex);
+        return it->second;
+    }
+    else
+    {
+        PixelShader* pPS = new PixelShader(Filepath, lpEntryPoint, pBytecode);
+        return (s_Context.PixelShaders[Name] = pPS);
     }
+}
 
-    if (auto it = s_Context.PixelShaders.find(Name); it != s_Context.PixelShaders.end())
+std::shared_ptr<IAssetLoad> Renderer3D::PrefetchVertexShader(const std::filesystem::path& Filepath, const char* lpEntryPoint) noexcept
+{
+    const String Name = GetShaderName(Filepath);
+    if (s_Context.VertexShaders.count(Name) != 0u)
+    {
+        return nullptr;
+    }
+
+    std::shared_ptr<IAssetLoad>& pLoad = s_Context.VertexShaderLoads[Name];
+    if (pLoad == nullptr)
+    {
+        pLoad = std::make_shared<ShaderLoad>(Filepath, ShaderLoad::Stage::Vertex, lpEntryPoint);
+        s_Context.Streaming->Submit(pLoad);
+    }
+    return pLoad;
+}
+
+std::shared_ptr<IAssetLoad> Renderer3D::PrefetchPixelShader(const std::filesystem::path& Filepath, const char* lpEntryPoint) noexcept
+{
+    const String Name = GetShaderName(Filepath);
+    if (s_Context.PixelShaders.count(Name) != 0u)
+    {
+        return nullptr;
+    }
+
+    std::shared_ptr<IAssetLoad>& pLoad = s_Context.PixelShaderLoads[Name];
+    if (pLoad == nullptr)
+    {
+        pLoad = std::make_shared<ShaderLoad>(Filepath, ShaderLoad::Stage::Pixel, lpEntryPoint);
+        s_Context.Streaming->Submit(pLoad);
+    }
+    return pLoad;
+}
+
+uint32_t Renderer3D::ReloadShaders(const std::filesystem::path& Filepath) noexcept
+{
+    const std::filesystem::path Changed  = Filepath.lexically_normal();
+    const bool                  bInclude = Changed.extension() == ".hlsli";
+
+    uint32_t kQueued = 0u;
+    for (const auto&[Name, pShader] : s_Context.VertexShaders)
+    {
+        if (bInclude || pShader->GetFilepath().lexically_normal() == Changed)
+        {
+            s_Context.Streaming->Submit(std::make_shared<ShaderLoad>(pShader->GetFilepath(), ShaderLoad::Stage::Vertex, pShader->GetEntryPoint(), true));
+            kQueued++;
+        }
+    }
+    for (const auto&[Name, pShader] : s_Context.PixelShaders)
+    {
+        if (bInclude || pShader->GetFilepath().lexically_normal() == Changed)
+        {
+            s_Context.Streaming->Submit(std::make_shared<ShaderLoad>(pShader->GetFilepath(), ShaderLoad::Stage::Pixel, pShader->GetEntryPoint(), true));
+            kQueued++;
+        }
+    }
+    return kQueued;
+}
+
+AssetStream& Renderer3D::GetAssetStream() noexcept
+{
+    return *s_Context.Streaming;
+}
+
+VertexBuffer* Renderer3D::GetVertexBuffer(uint64_t kBufferID, const List<VertexStream>& Streams, size_t kVertexCount)
+{
+    Dictionary<uint64_t, VertexBuffer*>& VertexBuffers = s_Context.VertexBuffers;
+    if (auto it = VertexBuffers.find(kBufferID); it != VertexBuffers.end())
     {
         return it->second;
     }
     else
     {
-        PixelShader* pPS = new PixelShader(Filepath, lpEntryPoint);
-        return (s_Context.PixelShaders[Name] = pPS);
+        return (VertexBuffers[kBufferID] = new VertexBuffer(Streams, kVertexCount));
     }
 }
 
-IndexBuffer* Renderer3D::GetIndexBuffer(uint32_t kTypeID, const List<uint16_t>& Indices)
+IndexBuffer* Renderer3D::GetIndexBuffer(uint64_t kBufferID, const List<uint16_t>& Indices, const List<IndexChunk>& Chunks)
 {
-    Dictionary<uint32_t, IndexBuffer*>& IndexBuffers = s_Context.IndexBuffers;
-    if (auto it = IndexBuffers.find(kTypeID); it != IndexBuffers.end())
+    Dictionary<uint64_t, IndexBuffer*>& IndexBuffers = s_Context.IndexBuffers;
+    if (auto it = IndexBuffers.find(kBufferID); it != IndexBuffers.end())
     {
         return it->second;
     }
     else
     {
-        return (IndexBuffers[kTypeID] = new IndexBuffer(Indices));
+        return (IndexBuffers[kBufferID] = new IndexBuffer(Indices, Chunks));
     }
 }
 
-Dictionary<uint32_t, VertexBuffer*>& Renderer3D::GetVertexBuffers()
+IndexBuffer* Renderer3D::GetIndexBuffer(uint64_t kBufferID, const List<uint32_t>& Indices)
+{
+    Dictionary<uint64_t, IndexBuffer*>& IndexBuffers = s_Context.IndexBuffers;
+    if (auto it = IndexBuffers.find(kBufferID); it != IndexBuffers.end())
+    {
+        return it->second;
+    }
+    else
+    {
+        return (IndexBuffers[kBufferID] = new IndexBuffer(Indices));
+    }
+}
+
+Dictionary<uint64_t, VertexBuffer*>& Renderer3D::GetVertexBuffers()
 {
     return s_Context.VertexBuffers;
 }
 
-Dictionary<uint32_t, IndexBuffer*>& Renderer3D::GetIndexBuffers()
+Dictionary<uint64_t, IndexBuffer*>& Renderer3D::GetIndexBuffers()
 {
     return s_Context.IndexBuffers;
 }
@@ -332,6 +490,59 @@ void Renderer3D::SetViewport() noexcept
     SetProjection(DirectX::XMMatrixPerspectiveLH(Width, Height, 0.5f, 100.0f));
 }
 
+Float2 Renderer3D::GetViewportSize() noexcept
+{
+    return Float2(float(s_Context.Width), float(s_Context.Height));
+}
+
+IDrawable* Renderer3D::Raycast(const Ray& r, RayHit& Hit) noexcept
+{
+    return s_Context.SceneBvh.Intersect(r, Hit) ? s_Context.Pickables[Hit.Instance] : nullptr;
+}
+
+uint32_t Renderer3D::Raycast(const RayPacket& Packet, RayPacketHit& Hit, IDrawable* pDrawables[4]) noexcept
+{
+    const uint32_t kMask = s_Context.SceneBvh.Intersect(Packet, Hit);
+    if (pDrawables)
+    {
+        for (uint32_t k = 0u; k < 4u; k++)
+        {
+            pDrawables[k] = (kMask & (1u << k)) ? s_Context.Pickables[Hit.Instance[k]] : nullptr;
+        }
+    }
+    return kMask;
+}
+
+IDrawable* Renderer3D::Pick(const Float2& Cursor, RayHit* pHit) noexcept
+{
+    RayHit Hit = {};
+    IDrawable* pDrawable = Raycast(GetCursorRay(Cursor), Hit);
+    if (pHit)
+    {
+        *pHit = Hit;
+    }
+    return pDrawable;
+}
+
+Ray Renderer3D::GetCursorRay(const Float2& Cursor) noexcept
+{
+    // Unproject the pixel onto the near and far planes
+    const Float2 Size = GetViewportSize();
+    const float  x    =  2.0f * (Cursor.X + 0.5f) / Size.X - 1.0f;
+    const float  y    = -2.0f * (Cursor.Y + 0.5f) / Size.Y + 1.0f;
+
+    const DirectX::XMMATRIX Inverse = DirectX::XMMatrixInverse(nullptr, GetCameraView() * GetProjection());
+    const DirectX::XMVECTOR Near    = DirectX::XMVector3TransformCoord(DirectX::XMVectorSet(x, y, 0.0f, 1.0f), Inverse);
+    const DirectX::XMVECTOR Far     = DirectX::XMVector3TransformCoord(DirectX::XMVectorSet(x, y, 1.0f, 1.0f), Inverse);
+    const DirectX::XMVECTOR Segment = DirectX::XMVectorSubtract(Far, Near);
+
+    Ray r = {};
+    r.MaxDistance = DirectX::XMVectorGetX(DirectX::XMVector3Length(Segment));
+    DirectX::XMStoreFloat3(reinterpret_cast<DirectX::XMFLOAT3*>(&r.Origin), Near);
+    DirectX::XMStoreFloat3(reinterpret_cast<DirectX::XMFLOAT3*>(&r.Direction), DirectX::XMVector3Normalize(Segment));
+    return r;
+}
+
 // INPUT
 bool Input::IsKeyPressed(int32_t kKeycode) noexcept
 {
@@ -343,22 +554,11 @@ bool Input::IsMouseButtonPressed(int32_t kButton) noexcept
     return s_Context.bMouse[static_cast<uint8_t>(kButton)];
 }
 
-
-uint64_t HashBytes(const void* pBytes, size_t kSize) noexcept
+Float2 Input::GetCursorPosition() noexcept
 {
-#ifdef _MSC_VER
-    return std::_Hash_array_representation(static_cast<const uint8_t*>(pBytes), kSize);
-#else
-    GfxError(false, "Not hash function specified");
-    return uint64_t();
-#endif // _MSC_VER
+    return s_Context.Cursor;
 }
 
-uint32_t NextTypeID() noexcept
-{
-    static uint32_t s_TypeID = 0ul;
-    return ++s_TypeID;
-}
 
 float Clock() noexcept
 {
@@ -366,8 +566,21 @@ float Clock() noexcept
     return float(now); // Is in seconds
 }
 
+String GetShaderName(const std::filesystem::path& Filepath) noexcept
+{
+    String Name = Filepath.string();
+    if (size_t kIndex = Name.find_last_of('/', 0u); kIndex != String::npos)
+    {
+        Name = Name.substr(kIndex);
+    }
+    return Name;
+}
+
 bool InitializeD3D()
 {
+    // Everything under Resources is read from the packed archive when there is one, the loose files otherwise
+    Archive::Mount("Resources.pak", "Resources");
+
     HRESULT hResult = HRESULT(0);
     // Create Device & SwapChain
     DXGI_SWAP_CHAIN_DESC scd = {};
@@ -482,6 +695,9 @@ bool InitializeD3D()
 
     Renderer3D::SetProjection(DirectX::XMMatrixPerspectiveLH(1.0f, 9.0f / 16.0f, 0.5f, 1000.0f));
 
+    // The archive shadows the loose files, there is nothing to reload from them while one is mounted
+    s_Context.Streaming = std::make_unique<AssetStream>();
+    s_Context.Watcher   = Archive::GetMounted() == nullptr ? std::make_unique<FileWatcher>("Resources") : std::make_unique<FileWatcher>();
     DrawTestTriangle();
 
     return true;
@@ -491,6 +707,12 @@ void ShutdownD3D()
 {
     ImGui_ImplDX11_Shutdown();
 
+    // Stopped before the caches go, nothing is uploaded after this
+    s_Context.Watcher.reset();
+    s_Context.Streaming.reset();
+    s_Context.VertexShaderLoads.clear();
+    s_Context.PixelShaderLoads.clear();
+
     for (auto&[Name, pShader] : s_Context.VertexShaders)
     {
         delete pShader;
@@ -517,6 +739,8 @@ void ShutdownD3D()
     SafeRelease(s_Context.pDeviceContext);
     SafeRelease(s_Context.pDevice);
     SafeRelease(s_Context.pSwapChain);
+
+    Archive::Unmount();
 }
 
 void BeginFrame(const Float4& ClearColor)
@@ -528,6 +752,9 @@ void BeginFrame(const Float4& ClearColor)
     ImGui_ImplDX11_NewFrame();
     ImGui_ImplWin32_NewFrame();
     ImGui::NewFrame();
+
+    s_Context.kTriangles = 0u;
+    s_Context.kPoints    = 0u;
 }
 
 void RenderFrame(float dt)
@@ -539,17 +766,47 @@ void RenderFrame(float dt)
     static float s_WindowAlpha = 0.35f;
     static bool  s_Paused = false;
 
+    static IDrawable* s_Picked       = nullptr;
+    static RayHit     s_PickHit      = {};
+    static double     s_PickDuration = 0.0; // Microseconds
+
     // Input
     if (Input::IsKeyPressed(VK_SPACE))
     {
         s_Paused = !s_Paused;
     }
 
+    // Files saved since the last frame are reloaded where they are used, through the stream like any other load
+    static List<String> s_Changed = {};
+    s_Changed.clear();
+    s_Context.Watcher->Poll(s_Changed);
+    for (const String& Filepath : s_Changed)
+    {
+        Renderer3D::ReloadShaders(Filepath);
+        Mesh::Reload(Filepath.c_str());
+    }
+
+    // Assets decoded since the last frame, as many as the upload budget allows
+    s_Context.Streaming->Pump();
+
     // 3D Rendering Goes Here...
     s_Context.Light->Bind();
     for (IDrawable* const& pDrawable : s_Context.Drawables)
     {
         pDrawable->Update(dt * s_SpeedFactor);
+    }
+    Model::SkinPending();
+    UpdateSceneBvh();
+
+    if (Input::IsMouseButtonPressed(VK_LBUTTON))
+    {
+        const auto Start = std::chrono::high_resolution_clock::now();
+        s_Picked       = Renderer3D::Pick(Input::GetCursorPosition(), &s_PickHit);
+        s_PickDuration = std::chrono::duration<double, std::micro>(std::chrono::high_resolution_clock::now() - Start).count();
+    }
+
+    for (IDrawable* const& pDrawable : s_Context.Drawables)
+    {
         pDrawable->Draw();
     }
     s_Context.Light->Draw();
@@ -559,6 +816,35 @@ void RenderFrame(float dt)
     {
         ImGui::SliderFloat("Simulation Speed", &s_TmpSpeed, 0.0f, 1.0f, "%.2f");
         ImGui::SliderFloat("Window Transparency", &s_WindowAlpha, 0.0f, 1.0f, "%.2f");
+        ImGui::SliderFloat("LOD Error (px)", &Mesh::s_LodErrorThreshold, 0.0f, 16.0f, "%.1f");
+        ImGui::SliderFloat("Animation Blend", &Model::s_AnimationBlend, 0.0f, 1.0f, "%.2f");
+        ImGui::SliderFloat("Point Spacing (px)", &PointCloud::s_MaxPointSpacing, 0.5f, 16.0f, "%.1f");
+        ImGui::SliderFloat("Terrain Error (px)", &Terrain::s_MaxPixelError, 0.5f, 16.0f, "%.1f");
+        ImGui::Text("Triangles: %u", s_Context.kTriangles);
+        ImGui::Text("Points: %u", s_Context.kPoints);
+
+        const SkinningStatistics& Skinned = Model::GetSkinningStatistics();
+        ImGui::Text("Skinning: %u models, %zu vertices, %.2f ms", Skinned.Jobs, Skinned.Vertices, Skinned.Milliseconds);
+        ImGui::Text("Morphing: %u vertices", Model::GetMorphedVertexCount());
+
+        const AssetStreamStatistics Streamed = s_Context.Streaming->GetStatistics();
+        ImGui::Text("Streaming: %u reading, %u decoding, %u waiting, %u uploaded (%.2f MB)",
+            Streamed.Reading, Streamed.Decoding, Streamed.Uploading, Streamed.Uploads, double(Streamed.UploadBytes) / (1024.0 * 1024.0));
+
+        const ImportStatistics Imports = GetImportStatistics();
+        ImGui::Text("Import Memory: %.2f MB resident, %.2f MB peak (%u imports, %u evicted)",
+            double(Imports.ResidentBytes) / (1024.0 * 1024.0), double(Imports.PeakBytes) / (1024.0 * 1024.0), Imports.Imports, Imports.Evictions);
+        ImGui::Text("Last Optimized Mesh: ACMR %.3f -> %.3f, ATVR %.3f -> %.3f",
+            Imports.LastOptimization.Before.ACMR, Imports.LastOptimization.After.ACMR, Imports.LastOptimization.Before.ATVR, Imports.LastOptimization.After.ATVR);
+
+        if (s_Picked)
+        {
+            ImGui::Text("Pick: instance %u, triangle %u at %.2f units (%.2f us)", s_PickHit.Instance, s_PickHit.Triangle, s_PickHit.Distance, s_PickDuration);
+        }
+        else
+        {
+            ImGui::Text("Pick: nothing (%.2f us)", s_PickDuration);
+        }
     }
     ImGui::End();
 
@@ -583,6 +869,18 @@ void EndFrame()
 }
 
 
+void ParseCommandLine(const wchar_t* lpCommandLine) noexcept
+{
+    std::wistringstream Arguments = std::wistringstream(lpCommandLine != nullptr ? lpCommandLine : L"");
+    std::wstring        Argument  = {};
+    while (Arguments >> Argument)
+    {
+        s_Context.bVolumeDemo     |= Argument == L"--volume";
+        s_Context.bPointCloudDemo |= Argument == L"--point-cloud";
+        s_Context.bTerrainDemo    |= Argument == L"--terrain";
+    }
+}
+
 void DrawTestTriangle() noexcept
 {
     enum class ShapeKind
@@ -617,9 +915,88 @@ void DrawTestTriangle() noexcept
         }*/
     }
 
+    if (s_Context.bPointCloudDemo)
+    {
+        AddPointCloudDemo();
+    }
+    if (s_Context.bVolumeDemo)
+    {
+        AddVolumeDemo();
+    }
+    if (s_Context.bTerrainDemo)
+    {
+        AddTerrainDemo();
+    }
+
     s_Context.Light = new PointLight{ 5.0f };
 }
 
+// Ground scan stand-in, built once and streamed from disk afterwards. It is generated data, so it goes to the
+// cache rather than among the resources that get baked and packed, and is kept small enough not to stall startup.
+void AddPointCloudDemo() noexcept
+{
+    static constexpr const char* lpCloudPath = "Cache/Terrain.pcot";
+    if (!FileExists(lpCloudPath))
+    {
+        List<Vertex> Points = List<Vertex>(size_t(1u) << 18u);
+        for (Vertex& p : Points)
+        {
+            const float x = Random::Float(-200.0f, 200.0f);
+            const float z = Random::Float(-200.0f, 200.0f);
+            const float y = -60.0f + 12.0f * sinf(x * 0.031f) * cosf(z * 0.027f) + 4.0f * sinf(x * 0.11f + z * 0.07f);
+            const uint8_t Shade = uint8_t(std::clamp((y + 76.0f) * 8.0f, 0.0f, 255.0f));
+            p = Vertex(Float3(x, y, z), Pixel(uint8_t(Shade / 2u), Shade, uint8_t(64u)));
+        }
+
+        std::error_code Error = {};
+        std::filesystem::create_directories(std::filesystem::path(lpCloudPath).parent_path(), Error);
+        ArrayPointSource Source = ArrayPointSource(Points.data(), Points.size());
+        PointCloudBuilder::Build(Source, lpCloudPath);
+    }
+    s_Context.Drawables.emplace_back(new PointCloud{ lpCloudPath });
+}
+
+// A blob of sculptable volume at the centre of the orbiting meshes
+void AddVolumeDemo() noexcept
+{
+    std::shared_ptr<Volume> Field = std::make_shared<Volume>(0.25f, Float3(-8.0f, -8.0f, -8.0f));
+    Field->Apply({ 0, 0, 0 }, { 63, 63, 63 }, [](const Float3& Position, float)
+    {
+        const float Sphere = sqrtf(Position.X * Position.X + Position.Y * Position.Y + Position.Z * Position.Z) - 4.0f;
+        const float Ripple = 0.4f * sinf(Position.X * 1.5f) * sinf(Position.Y * 1.5f) * sinf(Position.Z * 1.5f);
+        return Sphere + Ripple;
+    });
+    s_Context.Drawables.emplace_back(new VolumeSurface{ Field });
+}
+
+// Rolling hills under everything else. The heightmap is made up once and mapped from the cache afterwards, so
+// only the tiles being built page it in.
+void AddTerrainDemo() noexcept
+{
+    static constexpr const char* lpHeightmapPath = "Cache/Terrain.r16";
+    static constexpr uint32_t    kHeightmapSize  = 1025u;
+    if (!FileExists(lpHeightmapPath))
+    {
+        List<uint16_t> Heights = List<uint16_t>(size_t(kHeightmapSize) * kHeightmapSize);
+        for (uint32_t y = 0u; y < kHeightmapSize; y++)
+        {
+            for (uint32_t x = 0u; x < kHeightmapSize; x++)
+            {
+                const float h = 0.5f + 0.3f * sinf(x * 0.013f) * cosf(y * 0.017f) + 0.15f * sinf(x * 0.07f + y * 0.05f) + 0.05f * sinf(x * 0.31f);
+                Heights[size_t(y) * kHeightmapSize + x] = uint16_t(std::clamp(h, 0.0f, 1.0f) * 65535.0f);
+            }
+        }
+
+        std::error_code Error = {};
+        std::filesystem::create_directories(std::filesystem::path(lpHeightmapPath).parent_path(), Error);
+        SaveFile(lpHeightmapPath, Heights.data(), Heights.size() * sizeof(uint16_t));
+    }
+    TerrainSettings Ground = {};
+    Ground.Origin        = Float3(-256.0f, -120.0f, -256.0f);
+    Ground.SampleSpacing = 0.5f;
+    s_Context.Drawables.emplace_back(new Terrain{ std::make_shared<RawHeightSource>(lpHeightmapPath, kHeightmapSize, kHeightmapSize, 40.0f), Ground });
+}
+
 LRESULT CALLBACK WindowProcedure(HWND hWnd, UINT kMsg, WPARAM wParam, LPARAM lParam)
 {
     if (ImGui_ImplWin32_WndProcHandler(hWnd, kMsg, wParam, lParam))
@@ -671,6 +1048,18 @@ LRESULT CALLBACK WindowProcedure(HWND hWnd, UINT kMsg, WPARAM wParam, LPARAM lPa
             s_Context.bKeys[static_cast<uint8_t>(wParam)] = false;
             break;
 
+        case WM_MOUSEMOVE:
+            s_Context.Cursor = Float2(float(int16_t(LOWORD(lParam))), float(int16_t(HIWORD(lParam))));
+            break;
+        case WM_LBUTTONDOWN:
+            if (io.WantCaptureMouse)
+            {
+                break;
+            }
+            s_Context.Cursor = Float2(float(int16_t(LOWORD(lParam))), float(int16_t(HIWORD(lParam))));
+            s_Context.bMouse[VK_LBUTTON] = true;
+            break;
+
         default:
             break;
     }
@@ -8,19 +8,13 @@
   #pragma warning(disable: 26451)
 #endif // _MSC_VER
 
-#include <stdio.h>
-#include <stdint.h>
-
 #include <Windows.h>
 #include <d3d11.h>
 
-#include "Maths.h"
+#include "Core.h"
+#include "Bvh.h"
 #include <DirectXMath.h>
-
-#include <filesystem>
-#include <string>
-#include <vector>
-#include <unordered_map>
+#include <memory>
 
 #ifndef NDEBUG
   #define GfxError(x, ...)  __Assert((x), __FILE__, __LINE__, __VA_ARGS__)
@@ -28,40 +22,51 @@
   #define GfxError(x, ...)  bool(0)
 #endif // !NDEBUG
 
-using String = std::string;
-
-template<typename Tp>
-using List = std::vector<Tp>;
-
-template<typename K, typename V>
-using Dictionary = std::unordered_map<K, V>;
-
 using Matrix4x4 = DirectX::XMMATRIX;
 
 
+class AssetStream;
+class IAssetLoad;
 class VertexShader;
 class PixelShader;
 class VertexBuffer;
 class IndexBuffer;
+struct VertexStream;
+struct IndexChunk;
+class IDrawable;
 
 
 class Renderer3D
 {
 public:
-	static bool                 Initialize(HINSTANCE hInstance);
+	// The demos are only added when the command line asks for them, see the README
+	static bool                 Initialize(HINSTANCE hInstance, const wchar_t* lpCommandLine = L"");
 	static void                 Shutdown();
 	static void                 Run();
 
-	static void                 DrawIndexed(uint32_t kIndexCount) noexcept;
-
-	static VertexShader*        GetVertexShader(const std::filesystem::path& Filepath, const char* lpEntryPoint = "Main") noexcept;
-	static PixelShader*         GetPixelShader(const std::filesystem::path& Filepath, const char* lpEntryPoint = "Main") noexcept;
+	static void                 DrawIndexed(uint32_t kIndexCount, uint32_t kStartIndex = 0u, int32_t kBaseVertex = 0) noexcept;
+	// Non-indexed, counted as points since only point lists draw this way
+	static void                 Draw(uint32_t kVertexCount, uint32_t kStartVertex = 0u) noexcept;
+
+	// Bytecode is only used when the shader is not cached yet, instead of compiling the file
+	static VertexShader*        GetVertexShader(const std::filesystem::path& Filepath, const char* lpEntryPoint = "Main", ID3DBlob* pBytecode = nullptr) noexcept;
+	static PixelShader*         GetPixelShader(const std::filesystem::path& Filepath, const char* lpEntryPoint = "Main", ID3DBlob* pBytecode = nullptr) noexcept;
+	// Compiles on the asset stream unless the shader is cached, Get calls return it once the load is done. Returns
+	// the load to wait for, shared by every prefetch of the file, or nullptr when there is nothing to wait for.
+	static std::shared_ptr<IAssetLoad> PrefetchVertexShader(const std::filesystem::path& Filepath, const char* lpEntryPoint = "Main") noexcept;
+	static std::shared_ptr<IAssetLoad> PrefetchPixelShader(const std::filesystem::path& Filepath, const char* lpEntryPoint = "Main") noexcept;
+	// Recompiles the cached shaders made from a changed file on the asset stream and swaps them in where they are. A
+	// changed .hlsli recompiles all of them, includes are not tracked. Returns how many were queued.
+	static uint32_t             ReloadShaders(const std::filesystem::path& Filepath) noexcept;
+	static AssetStream&         GetAssetStream() noexcept;
 	template<typename V>
-	static VertexBuffer*        GetVertexBuffer(uint32_t kTypeID, const List<V>& Vertices = {});
-	static IndexBuffer*         GetIndexBuffer(uint32_t kTypeID, const List<uint16_t>& Indices = {});
+	static VertexBuffer*        GetVertexBuffer(uint64_t kBufferID, const List<V>& Vertices = {});
+	static VertexBuffer*        GetVertexBuffer(uint64_t kBufferID, const List<VertexStream>& Streams, size_t kVertexCount);
+	static IndexBuffer*         GetIndexBuffer(uint64_t kBufferID, const List<uint16_t>& Indices = {}, const List<IndexChunk>& Chunks = {});
+	static IndexBuffer*         GetIndexBuffer(uint64_t kBufferID, const List<uint32_t>& Indices);
 
-	static Dictionary<uint32_t, VertexBuffer*>& GetVertexBuffers();
-	static Dictionary<uint32_t, IndexBuffer*>&  GetIndexBuffers();
+	static Dictionary<uint64_t, VertexBuffer*>& GetVertexBuffers();
+	static Dictionary<uint64_t, IndexBuffer*>&  GetIndexBuffers();
 
 	static ID3D11Device*        GetDevice() noexcept;
 	static ID3D11DeviceContext* GetDeviceContext() noexcept;
@@ -71,28 +76,23 @@ public:
 	static Matrix4x4            GetCameraView() noexcept;
 
 	static void                 SetViewport() noexcept;
+	static Float2               GetViewportSize() noexcept;
+
+	// Closest drawable along world space rays, against the scene as of the last update. nullptr, or a zero mask for
+	// packets, when nothing is hit.
+	static IDrawable*           Raycast(const Ray& r, RayHit& Hit) noexcept;
+	static uint32_t             Raycast(const RayPacket& Packet, RayPacketHit& Hit, IDrawable* pDrawables[4] = nullptr) noexcept;
+	// Casts through a pixel of the viewport, Hit.Distance is in world units from the near plane
+	static IDrawable*           Pick(const Float2& Cursor, RayHit* pHit = nullptr) noexcept;
+	static Ray                  GetCursorRay(const Float2& Cursor) noexcept;
 };
 
 class Input
 {
 public:
-	static bool IsKeyPressed(int32_t kKeycode) noexcept;
-	static bool IsMouseButtonPressed(int32_t kButton) noexcept;
-};
-
-
-struct Vertex
-{
-	Float3 Position = {};
-	Pixel  Color    = Colors::White;
-
-	constexpr Vertex() = default;
-	constexpr Vertex(const Float3& pos)
-		: Position(pos)
-	{ }
-	constexpr Vertex(const Float3& pos, const Pixel& color)
-		: Position(pos), Color(color)
-	{ }
+	static bool   IsKeyPressed(int32_t kKeycode) noexcept;
+	static bool   IsMouseButtonPressed(int32_t kButton) noexcept;
+	static Float2 GetCursorPosition() noexcept;
 };
 
 
@@ -107,27 +107,17 @@ inline void SafeRelease(Tp*& pResource) noexcept
 }
 
 template<typename V>
-inline VertexBuffer* Renderer3D::GetVertexBuffer(uint32_t kTypeID, const List<V>& Vertices)
+inline VertexBuffer* Renderer3D::GetVertexBuffer(uint64_t kBufferID, const List<V>& Vertices)
 {
-	Dictionary<uint32_t, VertexBuffer*>& VertexBuffers = Renderer3D::GetVertexBuffers();
-	if (auto it = VertexBuffers.find(kTypeID); it != VertexBuffers.end())
+	Dictionary<uint64_t, VertexBuffer*>& VertexBuffers = Renderer3D::GetVertexBuffers();
+	if (auto it = VertexBuffers.find(kBufferID); it != VertexBuffers.end())
 	{
 		return it->second;
 	}
 	else
 	{
-		return (VertexBuffers[kTypeID] = new VertexBuffer(Vertices));
+		return (VertexBuffers[kBufferID] = new VertexBuffer(Vertices));
 	}
 }
 
-uint64_t HashBytes(const void* pBytes, size_t kSize) noexcept;
-uint32_t NextTypeID() noexcept;
-
-template<typename Tp>
-uint32_t GetTypeID() noexcept
-{
-	static const uint32_t s_TypeID = NextTypeID();
-	return s_TypeID;
-}
-
 bool __Assert(bool bCondition, const char* lpFile, int kLine, const char* lpMsg = NULL, ...) noexcept;
\ No newline at end of file
@@ -3,6 +3,7 @@
 #include "Image.h"
 
 #include <d3dcompiler.h>
+#include <algorithm>
 
 #ifdef _MSC_VER
   #pragma comment (lib, "d3d11.lib")
@@ -15,30 +16,105 @@
 // VERTEX BUFFER
 VertexBuffer::~VertexBuffer() noexcept
 {
-    m_VertexBuffer->Release();
-    m_VertexBuffer = nullptr;
-    m_Stride = 0u;
+    for (uint32_t k = 0u; k < m_StreamCount; k++)
+    {
+        m_VertexBuffers[k]->Release();
+        m_VertexBuffers[k] = nullptr;
+        m_Strides[k] = 0u;
+    }
+    m_StreamCount = 0u;
 }
 
 void VertexBuffer::Bind() noexcept
+{
+    const UINT kOffsets[MaxStreams] = {};
+    Renderer3D::GetDeviceContext()->IASetVertexBuffers(0u, m_StreamCount, m_VertexBuffers, m_Strides, kOffsets);
+}
+
+void VertexBuffer::BindPositions() noexcept
 {
     const UINT kOffset = 0;
-    Renderer3D::GetDeviceContext()->IASetVertexBuffers(0u, 1u, &m_VertexBuffer, &m_Stride, &kOffset);
+    Renderer3D::GetDeviceContext()->IASetVertexBuffers(0u, 1u, &m_VertexBuffers[0], &m_Strides[0], &kOffset);
+}
+
+uint32_t VertexBuffer::GetStreamCount() const noexcept
+{
+    return m_StreamCount;
+}
+
+void VertexBuffer::Swap(VertexBuffer& Other) noexcept
+{
+    std::swap(m_VertexBuffers, Other.m_VertexBuffers);
+    std::swap(m_Strides, Other.m_Strides);
+    std::swap(m_StreamCount, Other.m_StreamCount);
+    std::swap(m_Size, Other.m_Size);
+}
+
+void VertexBuffer::Create(const VertexStream* pStreams, size_t kStreamCount, size_t kCount, bool bDynamic) noexcept
+{
+    assert(kStreamCount > 0u && kStreamCount <= MaxStreams);
+    m_StreamCount = uint32_t(kStreamCount);
+    m_Size        = pStreams[0].Stride * uint32_t(kCount);
+
+    for (size_t k = 0u; k < kStreamCount; k++)
+    {
+        D3D11_BUFFER_DESC      bd = {};
+        D3D11_SUBRESOURCE_DATA sd = {};
+
+        ZeroMemory(&bd, sizeof(bd));
+        bd.BindFlags           = D3D11_BIND_VERTEX_BUFFER;
+        bd.ByteWidth           = pStreams[k].Stride * UINT(kCount);
+        bd.CPUAccessFlags      = bDynamic ? D3D11_CPU_ACCESS_WRITE : 0u;
+        bd.MiscFlags           = 0u;
+        bd.StructureByteStride = pStreams[k].Stride;
+        bd.Usage               = bDynamic ? D3D11_USAGE_DYNAMIC : D3D11_USAGE_DEFAULT;
+        ZeroMemory(&sd, sizeof(sd));
+        sd.pSysMem          = pStreams[k].pData;
+        sd.SysMemPitch      = 0u;
+        sd.SysMemSlicePitch = 0u;
+
+        Renderer3D::GetDevice()->CreateBuffer(&bd, &sd, &m_VertexBuffers[k]);
+        assert(m_VertexBuffers[k] != nullptr);
+        m_Strides[k] = pStreams[k].Stride;
+    }
 }
 
 // INDEX BUFFER
-IndexBuffer::IndexBuffer(const uint16_t* pIndices, size_t kCount)
+IndexBuffer::IndexBuffer(const uint16_t* pIndices, size_t kCount, const List<IndexChunk>& Chunks)
+    : m_Count(uint32_t(kCount)), m_Chunks(Chunks)
+{
+    Create(pIndices, kCount, DXGI_FORMAT_R16_UINT);
+}
+
+IndexBuffer::IndexBuffer(const uint32_t* pIndices, size_t kCount)
     : m_Count(uint32_t(kCount))
 {
+    const uint32_t kMaxIndex = kCount > 0u ? *std::max_element(pIndices, pIndices + kCount) : 0u;
+    if (kMaxIndex <= UINT16_MAX)
+    {
+        const List<uint16_t> Narrow = List<uint16_t>(pIndices, pIndices + kCount);
+        Create(Narrow.data(), kCount, DXGI_FORMAT_R16_UINT);
+    }
+    else
+    {
+        Create(pIndices, kCount, DXGI_FORMAT_R32_UINT);
+    }
+}
+
+void IndexBuffer::Create(const void* pIndices, size_t kCount, DXGI_FORMAT Format) noexcept
+{
+    const UINT kStride = Format == DXGI_FORMAT_R32_UINT ? sizeof(uint32_t) : sizeof(uint16_t);
+    m_Format = Format;
+
     D3D11_BUFFER_DESC      bd = {};
     D3D11_SUBRESOURCE_DATA sd = {};
 
     ZeroMemory(&bd, sizeof(bd));
     bd.BindFlags           = D3D11_BIND_INDEX_BUFFER;
-    bd.ByteWidth           = sizeof(uint16_t) * UINT(kCount);
+    bd.ByteWidth           = kStride * UINT(kCount);
     bd.CPUAccessFlags      = 0u;
     bd.MiscFlags           = 0u;
-    bd.StructureByteStride = sizeof(uint16_t);
+    bd.StructureByteStride = kStride;
     bd.Usage               = D3D11_USAGE_DEFAULT;
     ZeroMemory(&sd, sizeof(sd));
     sd.pSysMem          = pIndices;
@@ -58,7 +134,7 @@ IndexBuffer::~IndexBuffer() noexcept
 
 void IndexBuffer::Bind() noexcept
 {
-    Renderer3D::GetDeviceContext()->IASetIndexBuffer(m_IndexBuffer, DXGI_FORMAT_R16_UINT, 0u);
+    Renderer3D::GetDeviceContext()->IASetIndexBuffer(m_IndexBuffer, m_Format, 0u);
 }
 
 uint32_t IndexBuffer::GetCount() const noexcept
@@ -66,10 +142,116 @@ uint32_t IndexBuffer::GetCount() const noexcept
     return m_Count;
 }
 
+DXGI_FORMAT IndexBuffer::GetFormat() const noexcept
+{
+    return m_Format;
+}
+
+const List<IndexChunk>& IndexBuffer::GetChunks() const noexcept
+{
+    return m_Chunks;
+}
+
+void IndexBuffer::Swap(IndexBuffer& Other) noexcept
+{
+    std::swap(m_IndexBuffer, Other.m_IndexBuffer);
+    std::swap(m_Count, Other.m_Count);
+    std::swap(m_Format, Other.m_Format);
+    m_Chunks.swap(Other.m_Chunks);
+}
+
+// SHADERS
+// Includes resolve next to the file that includes them, as D3D_COMPILE_STANDARD_FILE_INCLUDE does, but are read
+// through MappedFile so the mounted archive has them too
+class ShaderInclude : public ID3DInclude
+{
+public:
+    explicit ShaderInclude(const std::filesystem::path& Filepath)
+        : m_Directory(Filepath.parent_path())
+    { }
+
+    HRESULT __stdcall Open(D3D_INCLUDE_TYPE, LPCSTR lpFilename, LPCVOID pParentData, LPCVOID* ppData, UINT* pBytes) noexcept override
+    {
+        const auto                  it       = m_Directories.find(pParentData);
+        const std::filesystem::path Filepath = (it != m_Directories.end() ? it->second : m_Directory) / lpFilename;
+
+        MappedFile File = MappedFile(Filepath.string().c_str());
+        if (!File.IsOpen() || File.GetSize() == 0u)
+        {
+            return E_FAIL;
+        }
+        *ppData = File.GetData();
+        *pBytes = UINT(File.GetSize());
+        m_Directories[File.GetData()] = Filepath.parent_path();
+        m_Files.push_back(std::move(File));
+        return S_OK;
+    }
+
+    HRESULT __stdcall Close(LPCVOID pData) noexcept override
+    {
+        m_Directories.erase(pData);
+        m_Files.erase(std::remove_if(m_Files.begin(), m_Files.end(), [pData](const MappedFile& File) { return File.GetData() == pData; }), m_Files.end());
+        return S_OK;
+    }
+
+private:
+    std::filesystem::path                          m_Directory   = {};
+    Dictionary<const void*, std::filesystem::path> m_Directories = {}; // Of the files open, by their data
+    List<MappedFile>                               m_Files       = {};
+};
+
+// Only the "Main" entry point is baked, any other is compiled from the file every time
+static String GetShaderReadPath(const std::filesystem::path& Filepath, const char* lpEntryPoint) noexcept
+{
+    const String Source = Filepath.string();
+    return strcmp(lpEntryPoint, "Main") == 0 ? GetBakedReadPath(Source.c_str(), ".cso") : Source;
+}
+
+static ID3DBlob* CopyBytecode(const MappedFile& File) noexcept
+{
+    ID3DBlob* pBlob = nullptr;
+    if (File.GetSize() == 0u || FAILED(D3DCreateBlob(File.GetSize(), &pBlob)))
+    {
+        return nullptr;
+    }
+    memcpy(pBlob->GetBufferPointer(), File.GetData(), File.GetSize());
+    return pBlob;
+}
+
+static HRESULT CompileShader(const MappedFile& File, const std::filesystem::path& Filepath, const char* lpEntryPoint, const char* lpTarget, ID3DBlob** ppBlob, ID3DBlob** ppErrors) noexcept
+{
+    const String  Name    = Filepath.string();
+    ShaderInclude Include = ShaderInclude(Filepath);
+    return D3DCompile(File.GetData(), File.GetSize(), Name.c_str(), nullptr, &Include, lpEntryPoint, lpTarget, 0u, 0u, ppBlob, ppErrors);
+}
+
+// Bytecode and source alike are mapped, from the mounted archive when it has them
+static ID3DBlob* LoadShader(const std::filesystem::path& Filepath, const char* lpEntryPoint, const char* lpTarget) noexcept
+{
+    ID3DBlob* pBlob = nullptr;
+    if (const std::filesystem::path ReadPath = GetShaderReadPath(Filepath, lpEntryPoint); ReadPath.extension() == ".cso")
+    {
+        pBlob = CopyBytecode(MappedFile(ReadPath.string().c_str()));
+    }
+    if (pBlob == nullptr)
+    {
+        CompileShader(MappedFile(Filepath.string().c_str()), Filepath, lpEntryPoint, lpTarget, &pBlob, nullptr);
+    }
+    return pBlob;
+}
+
 // VERTEX SHADER
-VertexShader::VertexShader(const std::filesystem::path& Filepath, const char* lpEntryPoint)
+VertexShader::VertexShader(const std::filesystem::path& Filepath, const char* lpEntryPoint, ID3DBlob* pBytecode)
+    : m_Blob(pBytecode), m_Filepath(Filepath), m_EntryPoint(lpEntryPoint)
 {
-    D3DCompileFromFile(Filepath.c_str(), nullptr, nullptr, lpEntryPoint, "vs_5_0", 0u, 0u, &m_Blob, nullptr);
+    if (m_Blob != nullptr)
+    {
+        m_Blob->AddRef();
+    }
+    else
+    {
+        m_Blob = LoadShader(Filepath, lpEntryPoint, "vs_5_0");
+    }
     assert(m_Blob != nullptr);
     Renderer3D::GetDevice()->CreateVertexShader(m_Blob->GetBufferPointer(), m_Blob->GetBufferSize(), nullptr, &m_VertexShader);
     assert(m_VertexShader != nullptr);
@@ -88,20 +270,56 @@ void VertexShader::Bind() noexcept
     Renderer3D::GetDeviceContext()->VSSetShader(m_VertexShader, nullptr, 0u);
 }
 
+void VertexShader::Replace(ID3DBlob* pBytecode) noexcept
+{
+    ID3D11VertexShader* pShader = nullptr;
+    Renderer3D::GetDevice()->CreateVertexShader(pBytecode->GetBufferPointer(), pBytecode->GetBufferSize(), nullptr, &pShader);
+    if (pShader == nullptr)
+    {
+        return;
+    }
+
+    pBytecode->AddRef();
+    m_Blob->Release();
+    m_Blob = pBytecode;
+    m_VertexShader->Release();
+    m_VertexShader = pShader;
+}
+
 ID3DBlob* VertexShader::GetBytecode()  noexcept
 {
     return m_Blob;
 }
 
+const std::filesystem::path& VertexShader::GetFilepath() const noexcept
+{
+    return m_Filepath;
+}
+
+const char* VertexShader::GetEntryPoint() const noexcept
+{
+    return m_EntryPoint.c_str();
+}
+
 // PIXEL SHADER
-PixelShader::PixelShader(const std::filesystem::path& Filepath, const char* lpEntryPoint)
+PixelShader::PixelShader(const std::filesystem::path& Filepath, const char* lpEntryPoint, ID3DBlob* pBytecode)
+    : m_Filepath(Filepath), m_EntryPoint(lpEntryPoint)
 {
-    ID3DBlob* pBlob = nullptr;
+    ID3DBlob* pBlob = pBytecode;
 
-    D3DCompileFromFile(Filepath.c_str(), nullptr, nullptr, lpEntryPoint, "ps_5_0", 0u, 0u, &pBlob, nullptr);
+    if (pBlob == nullptr)
+    {
+        pBlob = LoadShader(Filepath, lpEntryPoint, "ps_5_0");
+    }
     assert(pBlob != nullptr);
     Renderer3D::GetDevice()->CreatePixelShader(pBlob->GetBufferPointer(), pBlob->GetBufferSize(), nullptr, &m_PixelShader);
     assert(m_PixelShader != nullptr);
+
+    // Given bytecode stays with the caller
+    if (pBlob != pBytecode)
+    {
+        pBlob->Release();
+    }
 }
 
 PixelShader::~PixelShader() noexcept
@@ -115,6 +333,90 @@ void PixelShader::Bind() noexcept
     Renderer3D::GetDeviceContext()->PSSetShader(m_PixelShader, nullptr, 0u);
 }
 
+void PixelShader::Replace(ID3DBlob* pBytecode) noexcept
+{
+    ID3D11PixelShader* pShader = nullptr;
+    Renderer3D::GetDevice()->CreatePixelShader(pBytecode->GetBufferPointer(), pBytecode->GetBufferSize(), nullptr, &pShader);
+    if (pShader == nullptr)
+    {
+        return;
+    }
+
+    m_PixelShader->Release();
+    m_PixelShader = pShader;
+}
+
+const std::filesystem::path& PixelShader::GetFilepath() const noexcept
+{
+    return m_Filepath;
+}
+
+const char* PixelShader::GetEntryPoint() const noexcept
+{
+    return m_EntryPoint.c_str();
+}
+
+// SHADER LOAD
+ShaderLoad::ShaderLoad(const std::filesystem::path& Filepath, Stage kStage, const char* lpEntryPoint, bool bReplace)
+    : IAssetLoad(bReplace ? Filepath.string() : GetShaderReadPath(Filepath, lpEntryPoint)), m_Source(Filepath), m_EntryPoint(lpEntryPoint),
+      m_Stage(kStage), m_bReplace(bReplace)
+{ }
+
+ShaderLoad::~ShaderLoad() noexcept
+{
+    SafeRelease(m_Blob);
+}
+
+bool ShaderLoad::Decode(const MappedFile& File) noexcept
+{
+    // Baked bytecode only needs copying into a blob, reloads always compile since includes may have changed
+    if (GetFilepath().extension() == ".cso")
+    {
+        m_Blob = CopyBytecode(File);
+        return m_Blob != nullptr;
+    }
+
+    const char*   lpTarget = m_Stage == Stage::Vertex ? "vs_5_0" : "ps_5_0";
+    ID3DBlob*     pErrors  = nullptr;
+    const HRESULT hResult  = CompileShader(File, GetFilepath(), m_EntryPoint.c_str(), lpTarget, &m_Blob, &pErrors);
+
+    // Warnings as well, an edited file should say what is wrong with it
+    if (pErrors != nullptr)
+    {
+        OutputDebugStringA(static_cast<const char*>(pErrors->GetBufferPointer()));
+        pErrors->Release();
+    }
+    return SUCCEEDED(hResult) && m_Blob != nullptr;
+}
+
+void ShaderLoad::Upload() noexcept
+{
+    // Replacing loads are only made for cached shaders, the lookups find them without compiling
+    if (m_Stage == Stage::Vertex)
+    {
+        VertexShader* pShader = Renderer3D::GetVertexShader(m_Source, m_EntryPoint.c_str(), m_Blob);
+        if (m_bReplace)
+        {
+            pShader->Replace(m_Blob);
+        }
+    }
+    else
+    {
+        PixelShader* pShader = Renderer3D::GetPixelShader(m_Source, m_EntryPoint.c_str(), m_Blob);
+        if (m_bReplace)
+        {
+            pShader->Replace(m_Blob);
+        }
+    }
+    SafeRelease(m_Blob);
+}
+
+size_t ShaderLoad::GetUploadBytes() const noexcept
+{
+    return m_Blob != nullptr ? m_Blob->GetBufferSize() : 0u;
+}
+
+// INPUT LAYOUT
 InputLayout::InputLayout(const D3D11_INPUT_ELEMENT_DESC* pInputElements, size_t kCount, ID3DBlob* pVertexShaderBlob)
     : m_VertexShaderBlob(pVertexShaderBlob)
 {
@@ -171,7 +473,11 @@ TransformConstantBuffer::~TransformConstantBuffer() noexcept
 
 void TransformConstantBuffer::Bind() noexcept
 {
-    const Matrix4x4 Model = m_Parent->GetTransform();
+    Bind(m_Parent->GetTransform());
+}
+
+void TransformConstantBuffer::Bind(const Matrix4x4& Model) noexcept
+{
     s_TransformCB->Update(
     {
         DirectX::XMMatrixTranspose(Model),
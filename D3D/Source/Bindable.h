@@ -1,6 +1,8 @@
 #pragma once
 
 #include "Base.h"
+#include "AssetStream.h"
+#include "MeshOptimizer.h"
 
 // BINDABLE
 class IBindable
@@ -15,78 +17,151 @@ public:
 class VertexShader : public IBindable
 {
 public:
-	VertexShader(const std::filesystem::path& Filepath, const char* lpEntryPoint = "Main");
+	// Compiles the file unless its bytecode is given, e.g. compiled ahead on the asset stream
+	VertexShader(const std::filesystem::path& Filepath, const char* lpEntryPoint = "Main", ID3DBlob* pBytecode = nullptr);
 	virtual ~VertexShader() noexcept;
 
 	virtual void Bind() noexcept override;
+	// Swaps in code compiled from the changed file, everything holding the shader draws with it from then on. Input
+	// layouts stay as they were made, so the vertex inputs have to stay the same.
+	void         Replace(ID3DBlob* pBytecode) noexcept;
 
-	ID3DBlob* GetBytecode() noexcept;
+	ID3DBlob*                    GetBytecode() noexcept;
+	const std::filesystem::path& GetFilepath() const noexcept;
+	const char*                  GetEntryPoint() const noexcept;
 
 private:
-	ID3D11VertexShader* m_VertexShader = nullptr;
-	ID3DBlob* m_Blob = nullptr;
+	ID3D11VertexShader*   m_VertexShader = nullptr;
+	ID3DBlob*             m_Blob         = nullptr;
+	std::filesystem::path m_Filepath     = {};
+	String                m_EntryPoint   = {};
 };
 
 // PIXEL SHADER
 class PixelShader : public IBindable
 {
 public:
-	PixelShader(const std::filesystem::path& Filepath, const char* lpEntryPoint = "Main");
+	PixelShader(const std::filesystem::path& Filepath, const char* lpEntryPoint = "Main", ID3DBlob* pBytecode = nullptr);
 	virtual ~PixelShader() noexcept;
 
 	virtual void Bind() noexcept override;
+	void         Replace(ID3DBlob* pBytecode) noexcept;
+
+	const std::filesystem::path& GetFilepath() const noexcept;
+	const char*                  GetEntryPoint() const noexcept;
 
 private:
-	ID3D11PixelShader* m_PixelShader = nullptr;
+	ID3D11PixelShader*    m_PixelShader = nullptr;
+	std::filesystem::path m_Filepath    = {};
+	String                m_EntryPoint  = {};
+};
+
+// SHADER LOAD
+// Compiles a shader on the asset stream's workers and hands it to the renderer's cache, where it is only added if
+// nothing compiled the same file meanwhile. Replacing loads swap their code into the cached shader instead, a file
+// that no longer compiles fails the load and leaves the shader as it was.
+class ShaderLoad : public IAssetLoad
+{
+public:
+	enum class Stage : uint8_t
+	{
+		Vertex,
+		Pixel,
+	};
+
+public:
+	ShaderLoad(const std::filesystem::path& Filepath, Stage kStage, const char* lpEntryPoint = "Main", bool bReplace = false);
+	virtual ~ShaderLoad() noexcept;
+
+protected:
+	virtual bool   Decode(const MappedFile& File) noexcept override;
+	virtual void   Upload() noexcept override;
+	virtual size_t GetUploadBytes() const noexcept override;
+
+private:
+	std::filesystem::path m_Source     = {}; // GetFilepath() is the baked bytecode when there is some
+	String                m_EntryPoint = {};
+	Stage                 m_Stage      = Stage::Vertex;
+	bool                  m_bReplace   = false;
+	ID3DBlob*             m_Blob       = nullptr;
 };
 
 // VERTEX BUFFER
+// One stream of a vertex layout, vertex k starts at pData + k * Stride. Streams bind to consecutive input slots in
+// order, so input elements name the stream they come from in InputSlot.
+struct VertexStream
+{
+	const void* pData  = nullptr;
+	uint32_t    Stride = 0u;
+};
+
 class VertexBuffer : public IBindable
 {
 public:
+	static constexpr uint32_t MaxStreams = 4u;
+
+	// Dynamic buffers can be rewritten every frame with Update(), e.g. by CPU skinning
 	template<typename V>
-	VertexBuffer(const V* pVertices, size_t kCount)
-		: m_Stride(sizeof(V))
+	VertexBuffer(const V* pVertices, size_t kCount, bool bDynamic = false)
 	{
-		D3D11_BUFFER_DESC      bd = {};
-		D3D11_SUBRESOURCE_DATA sd = {};
-
-		ZeroMemory(&bd, sizeof(bd));
-		bd.BindFlags           = D3D11_BIND_VERTEX_BUFFER;
-		bd.ByteWidth           = sizeof(V) * UINT(kCount);
-		bd.CPUAccessFlags      = 0u;
-		bd.MiscFlags           = 0u;
-		bd.StructureByteStride = sizeof(V);
-		bd.Usage               = D3D11_USAGE_DEFAULT;
-		ZeroMemory(&sd, sizeof(sd));
-		sd.pSysMem          = pVertices;
-		sd.SysMemPitch      = 0u;
-		sd.SysMemSlicePitch = 0u;
-
-		Renderer3D::GetDevice()->CreateBuffer(&bd, &sd, &m_VertexBuffer);
-		assert(m_VertexBuffer != nullptr);
+		const VertexStream Stream = { pVertices, uint32_t(sizeof(V)) };
+		Create(&Stream, 1u, kCount, bDynamic);
 	}
 
 	template<typename V>
-	VertexBuffer(const List<V>& Vertices)
-		: VertexBuffer(Vertices.data(), Vertices.size())
+	VertexBuffer(const List<V>& Vertices, bool bDynamic = false)
+		: VertexBuffer(Vertices.data(), Vertices.size(), bDynamic)
 	{ }
 
+	// Split layouts: positions first so position-only passes can bind them alone with BindPositions()
+	VertexBuffer(const List<VertexStream>& Streams, size_t kCount, bool bDynamic = false)
+	{
+		Create(Streams.data(), Streams.size(), kCount, bDynamic);
+	}
+
 	virtual ~VertexBuffer() noexcept;
 
 	virtual void Bind() noexcept override;
+	// First stream at slot 0 only, for depth, shadow and other passes whose input layout reads nothing but positions
+	void         BindPositions() noexcept;
+
+	uint32_t GetStreamCount() const noexcept;
+	// Exchanges the GPU buffers, so whatever holds this one draws the other's vertices from then on
+	void     Swap(VertexBuffer& Other) noexcept;
+
+	template<typename V>
+	void Update(const List<V>& Vertices) noexcept
+	{
+		assert(m_StreamCount == 1u && sizeof(V) == m_Strides[0] && Vertices.size() * sizeof(V) <= m_Size);
+
+		D3D11_MAPPED_SUBRESOURCE ms = {};
+		ZeroMemory(&ms, sizeof(ms));
+		Renderer3D::GetDeviceContext()->Map(m_VertexBuffers[0], 0u, D3D11_MAP_WRITE_DISCARD, 0u, &ms);
+		CopyMemory(ms.pData, Vertices.data(), Vertices.size() * sizeof(V));
+		Renderer3D::GetDeviceContext()->Unmap(m_VertexBuffers[0], 0u);
+	}
 
 private:
-	ID3D11Buffer* m_VertexBuffer = nullptr;
-	uint32_t      m_Stride = 0u;
+	void Create(const VertexStream* pStreams, size_t kStreamCount, size_t kCount, bool bDynamic) noexcept;
+
+private:
+	ID3D11Buffer* m_VertexBuffers[MaxStreams] = {};
+	uint32_t      m_Strides[MaxStreams]       = {};
+	uint32_t      m_StreamCount               = 0u;
+	uint32_t      m_Size                      = 0u; // Of the first stream
 };
 
 // INDEX BUFFER
 class IndexBuffer : public IBindable
 {
 public:
-	IndexBuffer(const uint16_t* pIndices, size_t kCount);
-	IndexBuffer(const List<uint16_t>& Indices)
+	IndexBuffer(const uint16_t* pIndices, size_t kCount, const List<IndexChunk>& Chunks = {});
+	IndexBuffer(const List<uint16_t>& Indices, const List<IndexChunk>& Chunks = {})
+		: IndexBuffer(Indices.data(), Indices.size(), Chunks)
+	{ }
+	// Stored as 16-bit when every index fits, 32-bit otherwise
+	IndexBuffer(const uint32_t* pIndices, size_t kCount);
+	IndexBuffer(const List<uint32_t>& Indices)
 		: IndexBuffer(Indices.data(), Indices.size())
 	{ }
 
@@ -94,11 +169,20 @@ public:
 
 	virtual void Bind() noexcept override;
 
-	uint32_t GetCount() const noexcept;
+	uint32_t                GetCount() const noexcept;
+	DXGI_FORMAT             GetFormat() const noexcept;
+	const List<IndexChunk>& GetChunks() const noexcept;
+	// Exchanges the GPU buffers and their chunks, like VertexBuffer::Swap()
+	void                    Swap(IndexBuffer& Other) noexcept;
+
+private:
+	void Create(const void* pIndices, size_t kCount, DXGI_FORMAT Format) noexcept;
 
 private:
-	ID3D11Buffer* m_IndexBuffer = nullptr;
-	uint32_t      m_Count = 0u;
+	ID3D11Buffer*    m_IndexBuffer = nullptr;
+	uint32_t         m_Count = 0u;
+	DXGI_FORMAT      m_Format = DXGI_FORMAT_R16_UINT;
+	List<IndexChunk> m_Chunks = {}; // Empty unless split (see MeshOptimizer::SplitIndexChunks())
 };
 
 // CONSTANT BUFFER
@@ -198,6 +282,8 @@ public:
 	virtual ~TransformConstantBuffer() noexcept;
 
 	virtual void Bind() noexcept override;
+	// Binds an explicit model matrix, for drawables made of several separately transformed parts
+	void         Bind(const Matrix4x4& Model) noexcept;
 
 private:
 	class IDrawable* m_Parent = nullptr;
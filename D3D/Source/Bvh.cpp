@@ -0,0 +1,801 @@
+#include "Bvh.h"
+
+#include <algorithm>
+#include <emmintrin.h>
+
+static constexpr uint32_t s_BinCount     = 16u;
+static constexpr uint32_t s_MaxSahDepth  = 64u;  // Deeper nodes split at the median, so the depth stays within the stack
+static constexpr size_t   s_StackSize    = 128u;
+
+static inline float MinF(float a, float b) noexcept { return a < b ? a : b; }
+static inline float MaxF(float a, float b) noexcept { return a > b ? a : b; }
+
+static inline Float3 Min3(const Float3& a, const Float3& b) noexcept
+{
+    return Float3(MinF(a.X, b.X), MinF(a.Y, b.Y), MinF(a.Z, b.Z));
+}
+
+static inline Float3 Max3(const Float3& a, const Float3& b) noexcept
+{
+    return Float3(MaxF(a.X, b.X), MaxF(a.Y, b.Y), MaxF(a.Z, b.Z));
+}
+
+static inline void Grow(BoundingBox& Box, const BoundingBox& Other) noexcept
+{
+    Box.Min = Min3(Box.Min, Other.Min);
+    Box.Max = Max3(Box.Max, Other.Max);
+}
+
+// Half the surface area, the constant factor cancels out in every comparison
+static inline float HalfArea(const BoundingBox& Box) noexcept
+{
+    const float x = Box.Max.X - Box.Min.X;
+    const float y = Box.Max.Y - Box.Min.Y;
+    const float z = Box.Max.Z - Box.Min.Z;
+    return x < 0.0f ? 0.0f : x * y + y * z + z * x;
+}
+
+static inline float Axis(const Float3& v, uint32_t kAxis) noexcept
+{
+    return (&v.X)[kAxis];
+}
+
+static inline Float3 Cross(const Float3& u, const Float3& v) noexcept
+{
+    return Float3(u.Y * v.Z - u.Z * v.Y, u.Z * v.X - u.X * v.Z, u.X * v.Y - u.Y * v.X);
+}
+
+static inline float Dot(const Float3& u, const Float3& v) noexcept
+{
+    return u.X * v.X + u.Y * v.Y + u.Z * v.Z;
+}
+
+// Zero components would make 0 * inf = NaN in the slab test, a tiny value of the same sign behaves the same otherwise
+static inline float SafeInverse(float d) noexcept
+{
+    return 1.0f / (fabsf(d) > 1e-20f ? d : (d < 0.0f ? -1e-20f : 1e-20f));
+}
+
+// Binned SAH over primitive boxes. Children are allocated in pairs, after their parent, so refitting is one backwards
+// pass and the tree needs no child pointers.
+static void BuildNodes(const BoundingBox* pBounds, size_t kCount, uint32_t kMaxLeafSize, List<BvhNode>& Nodes, List<uint32_t>& Order) noexcept
+{
+    Nodes.clear();
+    Order.resize(kCount);
+    for (size_t k = 0u; k < kCount; k++)
+    {
+        Order[k] = uint32_t(k);
+    }
+    if (kCount == 0u)
+    {
+        return;
+    }
+
+    List<Float3> Centroids = List<Float3>(kCount);
+    for (size_t k = 0u; k < kCount; k++)
+    {
+        Centroids[k] = Float3((pBounds[k].Min.X + pBounds[k].Max.X) * 0.5f, (pBounds[k].Min.Y + pBounds[k].Max.Y) * 0.5f, (pBounds[k].Min.Z + pBounds[k].Max.Z) * 0.5f);
+    }
+
+    Nodes.reserve(kCount * 2u);
+    Nodes.emplace_back();
+    Nodes[0].Index = 0u;
+    Nodes[0].Count = uint32_t(kCount);
+
+    struct Task
+    {
+        uint32_t Node  = 0u;
+        uint32_t Depth = 0u;
+    };
+    List<Task> Tasks = { { 0u, 0u } };
+    while (!Tasks.empty())
+    {
+        const Task Current = Tasks.back();
+        Tasks.pop_back();
+
+        BvhNode&       Node   = Nodes[Current.Node];
+        const uint32_t kFirst = Node.Index;
+        const uint32_t kSize  = Node.Count;
+
+        BoundingBox Bounds    = {};
+        BoundingBox Centroid  = {};
+        for (uint32_t k = kFirst; k < kFirst + kSize; k++)
+        {
+            Grow(Bounds, pBounds[Order[k]]);
+            Centroid.Min = Min3(Centroid.Min, Centroids[Order[k]]);
+            Centroid.Max = Max3(Centroid.Max, Centroids[Order[k]]);
+        }
+        Node.Min = Bounds.Min;
+        Node.Max = Bounds.Max;
+
+        if (kSize <= kMaxLeafSize)
+        {
+            continue;
+        }
+
+        // Cost in units of one primitive test, with a traversal step costing the same
+        const float LeafCost  = float(kSize);
+        float       BestCost  = FLT_MAX;
+        uint32_t    kBestAxis = 0u;
+        uint32_t    kBestBin  = 0u;
+        if (Current.Depth < s_MaxSahDepth)
+        {
+            const float Area = MaxF(HalfArea(Bounds), 1e-30f);
+            for (uint32_t a = 0u; a < 3u; a++)
+            {
+                const float Low    = Axis(Centroid.Min, a);
+                const float Extent = Axis(Centroid.Max, a) - Low;
+                if (Extent <= 0.0f)
+                {
+                    continue;
+                }
+
+                BoundingBox Bins[s_BinCount]   = {};
+                uint32_t    Counts[s_BinCount] = {};
+                const float Scale = float(s_BinCount) / Extent;
+                for (uint32_t k = kFirst; k < kFirst + kSize; k++)
+                {
+                    const uint32_t b = std::min(uint32_t((Axis(Centroids[Order[k]], a) - Low) * Scale), s_BinCount - 1u);
+                    Grow(Bins[b], pBounds[Order[k]]);
+                    Counts[b]++;
+                }
+
+                // Sweep from the right, then from the left evaluating every split plane
+                float       RightAreas[s_BinCount] = {};
+                BoundingBox Right    = {};
+                uint32_t    kRight   = 0u;
+                for (uint32_t b = s_BinCount - 1u; b > 0u; b--)
+                {
+                    Grow(Right, Bins[b]);
+                    kRight       += Counts[b];
+                    RightAreas[b] = HalfArea(Right) * float(kRight);
+                }
+
+                BoundingBox Left  = {};
+                uint32_t    kLeft = 0u;
+                for (uint32_t b = 0u; b < s_BinCount - 1u; b++)
+                {
+                    Grow(Left, Bins[b]);
+                    kLeft += Counts[b];
+
+                    const float Cost = 1.0f + (HalfArea(Left) * float(kLeft) + RightAreas[b + 1u]) / Area;
+                    if (kLeft > 0u && kLeft < kSize && Cost < BestCost)
+                    {
+                        BestCost  = Cost;
+                        kBestAxis = a;
+                        kBestBin  = b;
+                    }
+                }
+            }
+        }
+
+        uint32_t kMiddle = kFirst;
+        if (BestCost < FLT_MAX)
+        {
+            if (BestCost >= LeafCost && kSize <= kMaxLeafSize * 4u)
+            {
+                continue;
+            }
+
+            const float Low   = Axis(Centroid.Min, kBestAxis);
+            const float Scale = float(s_BinCount) / (Axis(Centroid.Max, kBestAxis) - Low);
+            kMiddle = uint32_t(std::partition(Order.begin() + kFirst, Order.begin() + kFirst + kSize, [&](uint32_t kPrimitive)
+            {
+                return std::min(uint32_t((Axis(Centroids[kPrimitive], kBestAxis) - Low) * Scale), s_BinCount - 1u) <= kBestBin;
+            }) - Order.begin());
+        }
+        else
+        {
+            // Too deep or every centroid in one place, halve along the widest axis
+            const Float3   Extent = Centroid.Max - Centroid.Min;
+            const uint32_t a      = Extent.X > Extent.Y ? (Extent.X > Extent.Z ? 0u : 2u) : (Extent.Y > Extent.Z ? 1u : 2u);
+            kMiddle = kFirst + kSize / 2u;
+            std::nth_element(Order.begin() + kFirst, Order.begin() + kMiddle, Order.begin() + kFirst + kSize, [&](uint32_t i, uint32_t j)
+            {
+                return Axis(Centroids[i], a) < Axis(Centroids[j], a);
+            });
+        }
+
+        const uint32_t kChild = uint32_t(Nodes.size());
+        Node.Index = kChild;
+        Node.Count = 0u;
+
+        Nodes.emplace_back();
+        Nodes.emplace_back();
+        Nodes[kChild + 0u].Index = kFirst;
+        Nodes[kChild + 0u].Count = kMiddle - kFirst;
+        Nodes[kChild + 1u].Index = kMiddle;
+        Nodes[kChild + 1u].Count = kFirst + kSize - kMiddle;
+
+        Tasks.push_back({ kChild + 1u, Current.Depth + 1u });
+        Tasks.push_back({ kChild + 0u, Current.Depth + 1u });
+    }
+}
+
+// Entry distance of a ray into a node, FLT_MAX if it misses or enters beyond Closest
+static inline float EnterNode(const BvhNode& Node, const Float3& Origin, const Float3& Inverse, float Closest) noexcept
+{
+    const float x1 = (Node.Min.X - Origin.X) * Inverse.X;
+    const float x2 = (Node.Max.X - Origin.X) * Inverse.X;
+    const float y1 = (Node.Min.Y - Origin.Y) * Inverse.Y;
+    const float y2 = (Node.Max.Y - Origin.Y) * Inverse.Y;
+    const float z1 = (Node.Min.Z - Origin.Z) * Inverse.Z;
+    const float z2 = (Node.Max.Z - Origin.Z) * Inverse.Z;
+
+    const float Enter = MaxF(MaxF(MinF(x1, x2), MinF(y1, y2)), MaxF(MinF(z1, z2), 0.0f));
+    const float Exit  = MinF(MinF(MaxF(x1, x2), MaxF(y1, y2)), MinF(MaxF(z1, z2), Closest));
+    return Enter <= Exit ? Enter : FLT_MAX;
+}
+
+// Four rays against one node, SoA registers in the order origin xyz, inverse direction xyz
+struct PacketRegisters
+{
+    __m128 Origin[3];
+    __m128 Inverse[3];
+    __m128 Direction[3];
+};
+
+static inline __m128 EnterNode(const BvhNode& Node, const PacketRegisters& r, __m128 Closest, __m128& Enter) noexcept
+{
+    const __m128 x1 = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(Node.Min.X), r.Origin[0]), r.Inverse[0]);
+    const __m128 x2 = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(Node.Max.X), r.Origin[0]), r.Inverse[0]);
+    const __m128 y1 = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(Node.Min.Y), r.Origin[1]), r.Inverse[1]);
+    const __m128 y2 = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(Node.Max.Y), r.Origin[1]), r.Inverse[1]);
+    const __m128 z1 = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(Node.Min.Z), r.Origin[2]), r.Inverse[2]);
+    const __m128 z2 = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(Node.Max.Z), r.Origin[2]), r.Inverse[2]);
+
+    Enter = _mm_max_ps(_mm_max_ps(_mm_min_ps(x1, x2), _mm_min_ps(y1, y2)), _mm_max_ps(_mm_min_ps(z1, z2), _mm_setzero_ps()));
+    const __m128 Exit = _mm_min_ps(_mm_min_ps(_mm_max_ps(x1, x2), _mm_max_ps(y1, y2)), _mm_min_ps(_mm_max_ps(z1, z2), Closest));
+    return _mm_cmple_ps(Enter, Exit);
+}
+
+static inline void LoadPacket(const RayPacket& Packet, PacketRegisters& r) noexcept
+{
+    r.Origin[0]    = _mm_load_ps(Packet.OriginX);
+    r.Origin[1]    = _mm_load_ps(Packet.OriginY);
+    r.Origin[2]    = _mm_load_ps(Packet.OriginZ);
+    r.Direction[0] = _mm_load_ps(Packet.DirectionX);
+    r.Direction[1] = _mm_load_ps(Packet.DirectionY);
+    r.Direction[2] = _mm_load_ps(Packet.DirectionZ);
+    for (uint32_t a = 0u; a < 3u; a++)
+    {
+        // Same guard as SafeInverse, keeping the sign of zero components
+        const __m128 Sign = _mm_and_ps(r.Direction[a], _mm_set1_ps(-0.0f));
+        const __m128 Size = _mm_max_ps(_mm_andnot_ps(_mm_set1_ps(-0.0f), r.Direction[a]), _mm_set1_ps(1e-20f));
+        r.Inverse[a] = _mm_div_ps(_mm_set1_ps(1.0f), _mm_or_ps(Size, Sign));
+    }
+}
+
+// Affine inverse, the last column is assumed to be (0, 0, 0, 1)
+static Float4x4 InvertAffine(const Float4x4& m) noexcept
+{
+    const float a = m[0][0], b = m[0][1], c = m[0][2];
+    const float d = m[1][0], e = m[1][1], f = m[1][2];
+    const float g = m[2][0], h = m[2][1], i = m[2][2];
+
+    const float Determinant = a * (e * i - f * h) - b * (d * i - f * g) + c * (d * h - e * g);
+    const float s           = fabsf(Determinant) > 0.0f ? 1.0f / Determinant : 0.0f;
+
+    Float4x4 r = Float4x4(1.0f);
+    r[0][0] = (e * i - f * h) * s; r[0][1] = (c * h - b * i) * s; r[0][2] = (b * f - c * e) * s;
+    r[1][0] = (f * g - d * i) * s; r[1][1] = (a * i - c * g) * s; r[1][2] = (c * d - a * f) * s;
+    r[2][0] = (d * h - e * g) * s; r[2][1] = (b * g - a * h) * s; r[2][2] = (a * e - b * d) * s;
+
+    const float x = m[3][0], y = m[3][1], z = m[3][2];
+    r[3][0] = -(x * r[0][0] + y * r[1][0] + z * r[2][0]);
+    r[3][1] = -(x * r[0][1] + y * r[1][1] + z * r[2][1]);
+    r[3][2] = -(x * r[0][2] + y * r[1][2] + z * r[2][2]);
+    return r;
+}
+
+// Box around a transformed box (Arvo 1990)
+static BoundingBox TransformBounds(const BoundingBox& Box, const Float4x4& m) noexcept
+{
+    BoundingBox Result = {};
+    Result.Min = Float3(m[3][0], m[3][1], m[3][2]);
+    Result.Max = Result.Min;
+    for (uint32_t r = 0u; r < 3u; r++)
+    {
+        for (uint32_t c = 0u; c < 3u; c++)
+        {
+            const float u = Axis(Box.Min, r) * m[r][c];
+            const float v = Axis(Box.Max, r) * m[r][c];
+            (&Result.Min.X)[c] += MinF(u, v);
+            (&Result.Max.X)[c] += MaxF(u, v);
+        }
+    }
+    return Result;
+}
+
+// RAY PACKET
+void RayPacket::Set(uint32_t kLane, const Ray& r) noexcept
+{
+    OriginX[kLane]     = r.Origin.X;
+    OriginY[kLane]     = r.Origin.Y;
+    OriginZ[kLane]     = r.Origin.Z;
+    DirectionX[kLane]  = r.Direction.X;
+    DirectionY[kLane]  = r.Direction.Y;
+    DirectionZ[kLane]  = r.Direction.Z;
+    MaxDistance[kLane] = r.MaxDistance;
+}
+
+RayHit RayPacketHit::Get(uint32_t kLane) const noexcept
+{
+    RayHit Hit = {};
+    Hit.Distance = Distance[kLane];
+    Hit.Instance = Instance[kLane];
+    Hit.Triangle = Triangle[kLane];
+    Hit.U        = U[kLane];
+    Hit.V        = V[kLane];
+    return Hit;
+}
+
+// TRIANGLE BVH
+void TriangleBvh::Build(const Float3* pPositions, size_t kPositionStride, size_t kVertexCount, const uint32_t* pIndices, size_t kIndexCount) noexcept
+{
+    const auto PositionAt = [&](uint32_t kIndex) -> const Float3&
+    {
+        assert(kIndex < kVertexCount && "Index out of range");
+        return *reinterpret_cast<const Float3*>(reinterpret_cast<const uint8_t*>(pPositions) + size_t(kIndex) * kPositionStride);
+    };
+
+    const size_t      kTriangleCount = kIndexCount / 3u;
+    List<BoundingBox> Bounds         = List<BoundingBox>(kTriangleCount);
+    for (size_t t = 0u; t < kTriangleCount; t++)
+    {
+        for (uint32_t j = 0u; j < 3u; j++)
+        {
+            const Float3& p = PositionAt(pIndices[t * 3u + j]);
+            Bounds[t].Min = Min3(Bounds[t].Min, p);
+            Bounds[t].Max = Max3(Bounds[t].Max, p);
+        }
+    }
+
+    BuildNodes(Bounds.data(), kTriangleCount, MaxLeafSize, m_Nodes, m_Ids);
+
+    m_Triangles.resize(kTriangleCount);
+    for (size_t k = 0u; k < kTriangleCount; k++)
+    {
+        const uint32_t* pTriangle = pIndices + size_t(m_Ids[k]) * 3u;
+        const Float3&   a         = PositionAt(pTriangle[0]);
+        m_Triangles[k].Corner = a;
+        m_Triangles[k].Edge1  = PositionAt(pTriangle[1]) - a;
+        m_Triangles[k].Edge2  = PositionAt(pTriangle[2]) - a;
+    }
+
+    m_Nodes.shrink_to_fit();
+}
+
+bool TriangleBvh::Intersect(const Ray& r, RayHit& Hit) const noexcept
+{
+    if (m_Nodes.empty())
+    {
+        return false;
+    }
+
+    const Float3 Inverse = Float3(SafeInverse(r.Direction.X), SafeInverse(r.Direction.Y), SafeInverse(r.Direction.Z));
+    float        Closest = MinF(Hit.Distance, r.MaxDistance);
+    bool         bHit    = false;
+
+    if (EnterNode(m_Nodes[0], r.Origin, Inverse, Closest) == FLT_MAX)
+    {
+        return false;
+    }
+
+    // Nearer child first, the other one waits on the stack with its entry distance so it can be skipped later
+    uint32_t Stack[s_StackSize];
+    float    Entries[s_StackSize];
+    size_t   kTop  = 0u;
+    uint32_t kNode = 0u;
+    while (true)
+    {
+        const BvhNode& Node = m_Nodes[kNode];
+        if (Node.Count > 0u)
+        {
+            // Möller-Trumbore
+            for (uint32_t k = Node.Index; k < Node.Index + Node.Count; k++)
+            {
+                const BvhTriangle& t = m_Triangles[k];
+                const Float3       p = Cross(r.Direction, t.Edge2);
+                const float        Determinant = Dot(t.Edge1, p);
+                if (fabsf(Determinant) < 1e-20f)
+                {
+                    continue;
+                }
+
+                const float  s = 1.0f / Determinant;
+                const Float3 o = r.Origin - t.Corner;
+                const float  u = Dot(o, p) * s;
+                if (u < 0.0f || u > 1.0f)
+                {
+                    continue;
+                }
+
+                const Float3 q = Cross(o, t.Edge1);
+                const float  v = Dot(r.Direction, q) * s;
+                const float  d = Dot(t.Edge2, q) * s;
+                if (v < 0.0f || u + v > 1.0f || d < 0.0f || d >= Closest)
+                {
+                    continue;
+                }
+
+                Closest      = d;
+                bHit         = true;
+                Hit.Distance = d;
+                Hit.Triangle = m_Ids[k];
+                Hit.U        = u;
+                Hit.V        = v;
+            }
+        }
+        else
+        {
+            uint32_t kNear = Node.Index;
+            uint32_t kFar  = Node.Index + 1u;
+            float    Near  = EnterNode(m_Nodes[kNear], r.Origin, Inverse, Closest);
+            float    Far   = EnterNode(m_Nodes[kFar],  r.Origin, Inverse, Closest);
+            if (Far < Near)
+            {
+                std::swap(kNear, kFar);
+                std::swap(Near, Far);
+            }
+            if (Near != FLT_MAX)
+            {
+                if (Far != FLT_MAX)
+                {
+                    Stack[kTop]   = kFar;
+                    Entries[kTop] = Far;
+                    kTop++;
+                }
+                kNode = kNear;
+                continue;
+            }
+        }
+
+        // Pop, dropping nodes that now start beyond the closest hit
+        do
+        {
+            if (kTop == 0u)
+            {
+                return bHit;
+            }
+            kTop--;
+        } while (Entries[kTop] > Closest);
+        kNode = Stack[kTop];
+    }
+}
+
+uint32_t TriangleBvh::Intersect(const RayPacket& Packet, RayPacketHit& Hit) const noexcept
+{
+    if (m_Nodes.empty())
+    {
+        return 0u;
+    }
+
+    PacketRegisters r = {};
+    LoadPacket(Packet, r);
+
+    __m128 Closest = _mm_min_ps(_mm_load_ps(Hit.Distance), _mm_load_ps(Packet.MaxDistance));
+    __m128 Updated = _mm_setzero_ps();
+
+    // Visited while any lane still hits, with the node the first active lane enters first on top
+    uint32_t Stack[s_StackSize];
+    size_t   kTop = 0u;
+    Stack[kTop++] = 0u;
+    while (kTop > 0u)
+    {
+        const BvhNode& Node = m_Nodes[Stack[--kTop]];
+
+        __m128 Enter  = {};
+        const __m128 Active = EnterNode(Node, r, Closest, Enter);
+        if (_mm_movemask_ps(Active) == 0)
+        {
+            continue;
+        }
+
+        if (Node.Count == 0u)
+        {
+            __m128 EnterLeft  = {};
+            __m128 EnterRight = {};
+            const int kLeft   = _mm_movemask_ps(EnterNode(m_Nodes[Node.Index],      r, Closest, EnterLeft));
+            const int kRight  = _mm_movemask_ps(EnterNode(m_Nodes[Node.Index + 1u], r, Closest, EnterRight));
+
+            // Order by the summed entry distance of the lanes that hit both
+            const __m128 Both   = _mm_and_ps(_mm_cmplt_ps(EnterLeft, _mm_set1_ps(FLT_MAX)), _mm_cmplt_ps(EnterRight, _mm_set1_ps(FLT_MAX)));
+            const __m128 Signed = _mm_and_ps(Both, _mm_sub_ps(EnterLeft, EnterRight));
+            alignas(16) float Differences[4];
+            _mm_store_ps(Differences, Signed);
+            const bool bLeftFirst = Differences[0] + Differences[1] + Differences[2] + Differences[3] <= 0.0f;
+
+            const uint32_t kFirst  = bLeftFirst ? Node.Index : Node.Index + 1u;
+            const uint32_t kSecond = bLeftFirst ? Node.Index + 1u : Node.Index;
+            const int      kMaskFirst  = bLeftFirst ? kLeft : kRight;
+            const int      kMaskSecond = bLeftFirst ? kRight : kLeft;
+            if (kMaskSecond != 0)
+            {
+                Stack[kTop++] = kSecond;
+            }
+            if (kMaskFirst != 0)
+            {
+                Stack[kTop++] = kFirst;
+            }
+            continue;
+        }
+
+        for (uint32_t k = Node.Index; k < Node.Index + Node.Count; k++)
+        {
+            const BvhTriangle& t = m_Triangles[k];
+            const __m128 e1[3] = { _mm_set1_ps(t.Edge1.X), _mm_set1_ps(t.Edge1.Y), _mm_set1_ps(t.Edge1.Z) };
+            const __m128 e2[3] = { _mm_set1_ps(t.Edge2.X), _mm_set1_ps(t.Edge2.Y), _mm_set1_ps(t.Edge2.Z) };
+
+            // p = d x e2
+            const __m128 px = _mm_sub_ps(_mm_mul_ps(r.Direction[1], e2[2]), _mm_mul_ps(r.Direction[2], e2[1]));
+            const __m128 py = _mm_sub_ps(_mm_mul_ps(r.Direction[2], e2[0]), _mm_mul_ps(r.Direction[0], e2[2]));
+            const __m128 pz = _mm_sub_ps(_mm_mul_ps(r.Direction[0], e2[1]), _mm_mul_ps(r.Direction[1], e2[0]));
+            const __m128 Determinant = _mm_add_ps(_mm_add_ps(_mm_mul_ps(e1[0], px), _mm_mul_ps(e1[1], py)), _mm_mul_ps(e1[2], pz));
+            const __m128 s  = _mm_div_ps(_mm_set1_ps(1.0f), Determinant);
+
+            const __m128 ox = _mm_sub_ps(r.Origin[0], _mm_set1_ps(t.Corner.X));
+            const __m128 oy = _mm_sub_ps(r.Origin[1], _mm_set1_ps(t.Corner.Y));
+            const __m128 oz = _mm_sub_ps(r.Origin[2], _mm_set1_ps(t.Corner.Z));
+            const __m128 u  = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(ox, px), _mm_mul_ps(oy, py)), _mm_mul_ps(oz, pz)), s);
+
+            // q = o x e1
+            const __m128 qx = _mm_sub_ps(_mm_mul_ps(oy, e1[2]), _mm_mul_ps(oz, e1[1]));
+            const __m128 qy = _mm_sub_ps(_mm_mul_ps(oz, e1[0]), _mm_mul_ps(ox, e1[2]));
+            const __m128 qz = _mm_sub_ps(_mm_mul_ps(ox, e1[1]), _mm_mul_ps(oy, e1[0]));
+            const __m128 v  = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(r.Direction[0], qx), _mm_mul_ps(r.Direction[1], qy)), _mm_mul_ps(r.Direction[2], qz)), s);
+            const __m128 d  = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(e2[0], qx), _mm_mul_ps(e2[1], qy)), _mm_mul_ps(e2[2], qz)), s);
+
+            // Comparisons with NaN are false, which also rejects a zero determinant
+            __m128 Mask = _mm_cmpge_ps(u, _mm_setzero_ps());
+            Mask = _mm_and_ps(Mask, _mm_cmpge_ps(v, _mm_setzero_ps()));
+            Mask = _mm_and_ps(Mask, _mm_cmple_ps(_mm_add_ps(u, v), _mm_set1_ps(1.0f)));
+            Mask = _mm_and_ps(Mask, _mm_cmpge_ps(d, _mm_setzero_ps()));
+            Mask = _mm_and_ps(Mask, _mm_cmplt_ps(d, Closest));
+            const int kMask = _mm_movemask_ps(Mask);
+            if (kMask == 0)
+            {
+                continue;
+            }
+
+            Closest = _mm_or_ps(_mm_and_ps(Mask, d), _mm_andnot_ps(Mask, Closest));
+            Updated = _mm_or_ps(Updated, Mask);
+
+            alignas(16) float Us[4];
+            alignas(16) float Vs[4];
+            _mm_store_ps(Us, u);
+            _mm_store_ps(Vs, v);
+            for (uint32_t j = 0u; j < 4u; j++)
+            {
+                if (kMask & (1 << j))
+                {
+                    Hit.Triangle[j] = m_Ids[k];
+                    Hit.U[j]        = Us[j];
+                    Hit.V[j]        = Vs[j];
+                }
+            }
+        }
+    }
+
+    const int kUpdated = _mm_movemask_ps(Updated);
+    _mm_store_ps(Hit.Distance, _mm_or_ps(_mm_and_ps(Updated, Closest), _mm_andnot_ps(Updated, _mm_load_ps(Hit.Distance))));
+    return uint32_t(kUpdated);
+}
+
+BoundingBox TriangleBvh::GetBounds() const noexcept
+{
+    BoundingBox Bounds = {};
+    if (!m_Nodes.empty())
+    {
+        Bounds.Min = m_Nodes[0].Min;
+        Bounds.Max = m_Nodes[0].Max;
+    }
+    return Bounds;
+}
+
+size_t TriangleBvh::GetByteSize() const noexcept
+{
+    return m_Nodes.capacity() * sizeof(BvhNode) + m_Triangles.capacity() * sizeof(BvhTriangle) + m_Ids.capacity() * sizeof(uint32_t);
+}
+
+// INSTANCE BVH
+void InstanceBvh::Build(const BvhInstance* pInstances, size_t kCount) noexcept
+{
+    m_Bvhs.resize(kCount);
+    m_LocalBounds.resize(kCount);
+    m_WorldBounds.resize(kCount);
+    m_WorldToLocal.resize(kCount);
+    for (size_t k = 0u; k < kCount; k++)
+    {
+        m_Bvhs[k]        = pInstances[k].pBvh;
+        m_LocalBounds[k] = pInstances[k].pBvh->GetBounds();
+        SetTransform(uint32_t(k), pInstances[k].Transform);
+    }
+    Rebuild();
+}
+
+void InstanceBvh::SetTransform(uint32_t kInstance, const Float4x4& Transform) noexcept
+{
+    m_WorldToLocal[kInstance] = InvertAffine(Transform);
+    m_WorldBounds[kInstance]  = TransformBounds(m_LocalBounds[kInstance], Transform);
+}
+
+void InstanceBvh::Rebuild() noexcept
+{
+    BuildNodes(m_WorldBounds.data(), m_WorldBounds.size(), MaxLeafSize, m_Nodes, m_Order);
+
+    m_BuildArea = 0.0f;
+    for (const BvhNode& Node : m_Nodes)
+    {
+        m_BuildArea += HalfArea(BoundingBox{ Node.Min, Node.Max });
+    }
+}
+
+void InstanceBvh::Refit() noexcept
+{
+    // Children always come after their parent
+    float Area = 0.0f;
+    for (size_t k = m_Nodes.size(); k > 0u; k--)
+    {
+        BvhNode&    Node   = m_Nodes[k - 1u];
+        BoundingBox Bounds = {};
+        if (Node.Count > 0u)
+        {
+            for (uint32_t j = Node.Index; j < Node.Index + Node.Count; j++)
+            {
+                Grow(Bounds, m_WorldBounds[m_Order[j]]);
+            }
+        }
+        else
+        {
+            Grow(Bounds, BoundingBox{ m_Nodes[Node.Index].Min, m_Nodes[Node.Index].Max });
+            Grow(Bounds, BoundingBox{ m_Nodes[Node.Index + 1u].Min, m_Nodes[Node.Index + 1u].Max });
+        }
+        Node.Min = Bounds.Min;
+        Node.Max = Bounds.Max;
+        Area    += HalfArea(Bounds);
+    }
+
+    if (Area > m_BuildArea * RebuildFactor)
+    {
+        Rebuild();
+    }
+}
+
+bool InstanceBvh::Intersect(const Ray& r, RayHit& Hit) const noexcept
+{
+    if (m_Nodes.empty())
+    {
+        return false;
+    }
+
+    const Float3 Inverse = Float3(SafeInverse(r.Direction.X), SafeInverse(r.Direction.Y), SafeInverse(r.Direction.Z));
+    bool         bHit    = false;
+
+    uint32_t Stack[s_StackSize];
+    float    Entries[s_StackSize];
+    size_t   kTop = 0u;
+    Stack[kTop]   = 0u;
+    Entries[kTop] = EnterNode(m_Nodes[0], r.Origin, Inverse, MinF(Hit.Distance, r.MaxDistance));
+    kTop += Entries[0] != FLT_MAX ? 1u : 0u;
+    while (kTop > 0u)
+    {
+        kTop--;
+        if (Entries[kTop] > MinF(Hit.Distance, r.MaxDistance))
+        {
+            continue;
+        }
+
+        const BvhNode& Node = m_Nodes[Stack[kTop]];
+        if (Node.Count > 0u)
+        {
+            for (uint32_t k = Node.Index; k < Node.Index + Node.Count; k++)
+            {
+                const uint32_t  kInstance = m_Order[k];
+                const Float4x4& m         = m_WorldToLocal[kInstance];
+
+                Ray Local = r;
+                Local.Origin.X    = r.Origin.X * m[0][0] + r.Origin.Y * m[1][0] + r.Origin.Z * m[2][0] + m[3][0];
+                Local.Origin.Y    = r.Origin.X * m[0][1] + r.Origin.Y * m[1][1] + r.Origin.Z * m[2][1] + m[3][1];
+                Local.Origin.Z    = r.Origin.X * m[0][2] + r.Origin.Y * m[1][2] + r.Origin.Z * m[2][2] + m[3][2];
+                Local.Direction.X = r.Direction.X * m[0][0] + r.Direction.Y * m[1][0] + r.Direction.Z * m[2][0];
+                Local.Direction.Y = r.Direction.X * m[0][1] + r.Direction.Y * m[1][1] + r.Direction.Z * m[2][1];
+                Local.Direction.Z = r.Direction.X * m[0][2] + r.Direction.Y * m[1][2] + r.Direction.Z * m[2][2];
+                if (m_Bvhs[kInstance]->Intersect(Local, Hit))
+                {
+                    Hit.Instance = kInstance;
+                    bHit = true;
+                }
+            }
+            continue;
+        }
+
+        const float Closest = MinF(Hit.Distance, r.MaxDistance);
+        uint32_t    kNear   = Node.Index;
+        uint32_t    kFar    = Node.Index + 1u;
+        float       Near    = EnterNode(m_Nodes[kNear], r.Origin, Inverse, Closest);
+        float       Far     = EnterNode(m_Nodes[kFar],  r.Origin, Inverse, Closest);
+        if (Far < Near)
+        {
+            std::swap(kNear, kFar);
+            std::swap(Near, Far);
+        }
+        if (Far != FLT_MAX)
+        {
+            Stack[kTop]   = kFar;
+            Entries[kTop] = Far;
+            kTop++;
+        }
+        if (Near != FLT_MAX)
+        {
+            Stack[kTop]   = kNear;
+            Entries[kTop] = Near;
+            kTop++;
+        }
+    }
+    return bHit;
+}
+
+uint32_t InstanceBvh::Intersect(const RayPacket& Packet, RayPacketHit& Hit) const noexcept
+{
+    if (m_Nodes.empty())
+    {
+        return 0u;
+    }
+
+    PacketRegisters r = {};
+    LoadPacket(Packet, r);
+    const __m128 MaxDistance = _mm_load_ps(Packet.MaxDistance);
+
+    uint32_t kUpdated = 0u;
+    uint32_t Stack[s_StackSize];
+    size_t   kTop = 0u;
+    Stack[kTop++] = 0u;
+    while (kTop > 0u)
+    {
+        const BvhNode& Node    = m_Nodes[Stack[--kTop]];
+        const __m128   Closest = _mm_min_ps(_mm_load_ps(Hit.Distance), MaxDistance);
+
+        __m128 Enter = {};
+        if (_mm_movemask_ps(EnterNode(Node, r, Closest, Enter)) == 0)
+        {
+            continue;
+        }
+
+        if (Node.Count == 0u)
+        {
+            Stack[kTop++] = Node.Index + 1u;
+            Stack[kTop++] = Node.Index;
+            continue;
+        }
+
+        for (uint32_t k = Node.Index; k < Node.Index + Node.Count; k++)
+        {
+            const uint32_t  kInstance = m_Order[k];
+            const Float4x4& m         = m_WorldToLocal[kInstance];
+
+            // Every lane through the same matrix, row vector convention
+            RayPacket Local = Packet;
+            for (uint32_t c = 0u; c < 3u; c++)
+            {
+                const __m128 Origin    = _mm_add_ps(_mm_add_ps(_mm_mul_ps(r.Origin[0], _mm_set1_ps(m[0][c])), _mm_mul_ps(r.Origin[1], _mm_set1_ps(m[1][c]))),
+                                                    _mm_add_ps(_mm_mul_ps(r.Origin[2], _mm_set1_ps(m[2][c])), _mm_set1_ps(m[3][c])));
+                const __m128 Direction = _mm_add_ps(_mm_add_ps(_mm_mul_ps(r.Direction[0], _mm_set1_ps(m[0][c])), _mm_mul_ps(r.Direction[1], _mm_set1_ps(m[1][c]))),
+                                                    _mm_mul_ps(r.Direction[2], _mm_set1_ps(m[2][c])));
+                _mm_store_ps(c == 0u ? Local.OriginX : (c == 1u ? Local.OriginY : Local.OriginZ), Origin);
+                _mm_store_ps(c == 0u ? Local.DirectionX : (c == 1u ? Local.DirectionY : Local.DirectionZ), Direction);
+            }
+
+            const uint32_t kLanes = m_Bvhs[kInstance]->Intersect(Local, Hit);
+            for (uint32_t j = 0u; j < 4u; j++)
+            {
+                if (kLanes & (1u << j))
+                {
+                    Hit.Instance[j] = kInstance;
+                }
+            }
+            kUpdated |= kLanes;
+        }
+    }
+    return kUpdated;
+}
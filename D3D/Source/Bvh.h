@@ -0,0 +1,134 @@
+#pragma once
+
+#include "Core.h"
+
+#include <cfloat>
+
+struct Ray
+{
+	Float3 Origin      = {};
+	Float3 Direction   = {};      // Need not be unit length, distances are in multiples of it
+	float  MaxDistance = FLT_MAX;
+};
+
+struct RayHit
+{
+	static constexpr uint32_t NoHit = UINT32_MAX;
+
+	float    Distance = FLT_MAX;
+	uint32_t Instance = NoHit;   // Set by InstanceBvh queries
+	uint32_t Triangle = NoHit;   // Position in the index list divided by three
+	float    U        = 0.0f;    // Barycentric weights of the triangle's second and third corner
+	float    V        = 0.0f;
+};
+
+// Four rays side by side, one SSE lane each
+struct alignas(16) RayPacket
+{
+	float OriginX[4]     = {};
+	float OriginY[4]     = {};
+	float OriginZ[4]     = {};
+	float DirectionX[4]  = {};
+	float DirectionY[4]  = {};
+	float DirectionZ[4]  = {};
+	float MaxDistance[4] = { FLT_MAX, FLT_MAX, FLT_MAX, FLT_MAX };
+
+	void Set(uint32_t kLane, const Ray& r) noexcept;
+};
+
+struct alignas(16) RayPacketHit
+{
+	float    Distance[4] = { FLT_MAX, FLT_MAX, FLT_MAX, FLT_MAX };
+	uint32_t Instance[4] = { RayHit::NoHit, RayHit::NoHit, RayHit::NoHit, RayHit::NoHit };
+	uint32_t Triangle[4] = { RayHit::NoHit, RayHit::NoHit, RayHit::NoHit, RayHit::NoHit };
+	float    U[4]        = {};
+	float    V[4]        = {};
+
+	RayHit Get(uint32_t kLane) const noexcept;
+};
+
+struct BoundingBox
+{
+	Float3 Min = Float3( FLT_MAX);
+	Float3 Max = Float3(-FLT_MAX);
+};
+
+// 32 bytes. Interior nodes have a Count of zero and their children at Index and Index + 1,
+// leaves cover Count primitives starting at Index.
+struct BvhNode
+{
+	Float3   Min   = {};
+	uint32_t Index = 0u;
+	Float3   Max   = {};
+	uint32_t Count = 0u;
+};
+
+// Triangles as a corner and two edges, what the intersection test wants
+struct BvhTriangle
+{
+	Float3 Corner = {};
+	Float3 Edge1  = {};
+	Float3 Edge2  = {};
+};
+
+// Binned SAH tree over one mesh in model space. Triangles are copied in leaf order, so it stands on its own once built.
+// Hits count from both sides.
+class TriangleBvh
+{
+public:
+	static constexpr uint32_t MaxLeafSize = 4u;
+
+	void        Build(const Float3* pPositions, size_t kPositionStride, size_t kVertexCount, const uint32_t* pIndices, size_t kIndexCount) noexcept;
+
+	// Both keep the closest hit, so one RayHit can be passed through several queries. The single ray version returns
+	// whether it found a closer hit, the packet version a mask of the lanes that did.
+	bool        Intersect(const Ray& r, RayHit& Hit) const noexcept;
+	uint32_t    Intersect(const RayPacket& Packet, RayPacketHit& Hit) const noexcept;
+
+	BoundingBox GetBounds() const noexcept;
+	size_t      GetByteSize() const noexcept;
+	bool        IsEmpty() const noexcept { return m_Nodes.empty(); }
+
+private:
+	List<BvhNode>     m_Nodes     = {};
+	List<BvhTriangle> m_Triangles = {};
+	List<uint32_t>    m_Ids       = {}; // Source triangle of every stored triangle
+};
+
+struct BvhInstance
+{
+	const TriangleBvh* pBvh      = nullptr;
+	Float4x4           Transform = Float4x4(1.0f); // Model to world, row vector convention
+};
+
+// Tree over instances of triangle BVHs. Moving instances only refits the boxes, the tree is rebuilt once refitting
+// has loosened it too much. Rays are moved into each instance's model space without renormalizing, so distances stay
+// comparable between instances.
+class InstanceBvh
+{
+public:
+	static constexpr uint32_t MaxLeafSize   = 2u;
+	static constexpr float    RebuildFactor = 2.0f; // Rebuild once the summed node area has grown by this much
+
+	void     Build(const BvhInstance* pInstances, size_t kCount) noexcept;
+	void     SetTransform(uint32_t kInstance, const Float4x4& Transform) noexcept;
+	// Updates the boxes after SetTransform() calls
+	void     Refit() noexcept;
+
+	bool     Intersect(const Ray& r, RayHit& Hit) const noexcept;
+	uint32_t Intersect(const RayPacket& Packet, RayPacketHit& Hit) const noexcept;
+
+	size_t   GetInstanceCount() const noexcept { return m_Bvhs.size(); }
+
+private:
+	void     Rebuild() noexcept;
+
+private:
+	List<BvhNode>            m_Nodes        = {};
+	List<uint32_t>           m_Order        = {}; // Instances in leaf order
+	List<const TriangleBvh*> m_Bvhs         = {};
+	List<BoundingBox>        m_LocalBounds  = {};
+	List<BoundingBox>        m_WorldBounds  = {};
+	List<Float4x4>           m_WorldToLocal = {};
+	float                    m_BuildArea    = 0.0f;
+};
@@ -0,0 +1,24 @@
+#include "Core.h"
+
+uint64_t HashBytes(const void* pBytes, size_t kSize) noexcept
+{
+#ifdef _MSC_VER
+    return std::_Hash_array_representation(static_cast<const uint8_t*>(pBytes), kSize);
+#else
+    // FNV-1a, same algorithm the MSVC standard library uses above
+    const uint8_t* pData = static_cast<const uint8_t*>(pBytes);
+    uint64_t kHash = 14695981039346656037ull;
+    for (size_t k = 0; k < kSize; k++)
+    {
+        kHash ^= uint64_t(pData[k]);
+        kHash *= 1099511628211ull;
+    }
+    return kHash;
+#endif // _MSC_VER
+}
+
+uint32_t NextTypeID() noexcept
+{
+    static uint32_t s_TypeID = 0ul;
+    return ++s_TypeID;
+}
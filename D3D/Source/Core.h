@@ -0,0 +1,60 @@
+#pragma once
+
+// Platform independent part of Base.h, for code that does not touch Win32 or Direct3D
+// (importers, geometry processing) so it can also be built and profiled off Windows.
+
+#include <stdio.h>
+#include <stdint.h>
+#include <assert.h>
+
+#include "Maths.h"
+
+#include <filesystem>
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+using String = std::string;
+
+template<typename Tp>
+using List = std::vector<Tp>;
+
+template<typename K, typename V>
+using Dictionary = std::unordered_map<K, V>;
+
+
+struct Vertex
+{
+	Float3 Position = {};
+	Pixel  Color    = Colors::White;
+
+	constexpr Vertex() = default;
+	constexpr Vertex(const Float3& pos)
+		: Position(pos)
+	{ }
+	constexpr Vertex(const Float3& pos, const Pixel& color)
+		: Position(pos), Color(color)
+	{ }
+};
+
+struct MeshVertex
+{
+	Float3 Position = {};
+	Float3 Normal   = {};
+
+	constexpr MeshVertex() = default;
+	constexpr MeshVertex(const Float3& pos, const Float3& n)
+		: Position(pos), Normal(n)
+	{ }
+};
+
+
+uint64_t HashBytes(const void* pBytes, size_t kSize) noexcept;
+uint32_t NextTypeID() noexcept;
+
+template<typename Tp>
+uint32_t GetTypeID() noexcept
+{
+	static const uint32_t s_TypeID = NextTypeID();
+	return s_TypeID;
+}
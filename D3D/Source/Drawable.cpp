@@ -1,16 +1,22 @@
 #include "Drawable.h"
 #include "Image.h"
-#include <assimp/Importer.hpp>
-#include <assimp/scene.h>
-#include <assimp/postprocess.h>
+#include "MeshCodec.h"
+#include "ObjLoader.h"
+#include "Parallel.h"
+#include "Primitives.h"
+#include "Welder.h"
+#include <algorithm>
+#include <mutex>
 
-#ifdef _MSC_VER
-  #pragma comment (lib, "assimp-vc140-mt.lib")
-#else
-  // error "Please link assimp-vc140-mt.lib"
-#endif
-
-static const aiScene* LoadSceneFromFile(const char* lpFilepath) noexcept;
+static std::shared_ptr<const ObjModel> LoadObjModelFromFile(const char* lpFilepath, String& Error, const MappedFile* pFile = nullptr) noexcept;
+static std::shared_ptr<const Scene>    LoadModelSceneFromFile(const char* lpFilepath, String& Error) noexcept;
+template<typename Tp>
+static uint64_t                        GetGeometryKey(const char* lpFilepath, float Scale) noexcept;
+static void                            RecordOptimization(const MeshOptimizationReport& Report) noexcept;
+static String                          GetMeshReadPath(const char* lpFilepath) noexcept;
+static void                            InvalidateImport(const char* lpFilepath) noexcept;
+static uint64_t                        GetSubdivisionKey(const SubdivisionOptions& Options) noexcept;
+static void                            ExtractFrustumPlanes(const DirectX::XMMATRIX& Clip, Float4 Planes[6]) noexcept;
 
 IDrawable::~IDrawable() noexcept
 {
@@ -21,20 +27,59 @@ IDrawable::~IDrawable() noexcept
     }
 }
 
-void IDrawable::EmplaceIndexBuffer(uint32_t kDrawableID, const List<uint16_t>& Indices) noexcept
+void IDrawable::EmplaceIndexBuffer(uint64_t kDrawableID, const List<uint16_t>& Indices, const List<IndexChunk>& Chunks) noexcept
+{
+    assert(m_IndexBuffer == nullptr && "Index buffer is already set");
+    m_IndexBuffer = Renderer3D::GetIndexBuffer(kDrawableID, Indices, Chunks);
+    m_Bindables.emplace_back(m_IndexBuffer);
+}
+
+void IDrawable::EmplaceIndexBuffer(uint64_t kDrawableID, const List<uint32_t>& Indices) noexcept
 {
     assert(m_IndexBuffer == nullptr && "Index buffer is already set");
     m_IndexBuffer = Renderer3D::GetIndexBuffer(kDrawableID, Indices);
     m_Bindables.emplace_back(m_IndexBuffer);
 }
 
+void IDrawable::DrawRange(uint32_t kIndexCount, uint32_t kStartIndex) const noexcept
+{
+    const List<IndexChunk>& Chunks = m_IndexBuffer->GetChunks();
+    if (Chunks.empty())
+    {
+        Renderer3D::DrawIndexed(kIndexCount, kStartIndex);
+        return;
+    }
+
+    const uint32_t kEndIndex = kStartIndex + kIndexCount;
+    auto it = std::upper_bound(Chunks.begin(), Chunks.end(), kStartIndex, [](uint32_t kIndex, const IndexChunk& Chunk)
+    {
+        return kIndex < Chunk.IndexOffset;
+    });
+    for (it = it == Chunks.begin() ? it : it - 1; it != Chunks.end() && it->IndexOffset < kEndIndex; ++it)
+    {
+        const uint32_t kBegin = std::max(kStartIndex, it->IndexOffset);
+        const uint32_t kEnd   = std::min(kEndIndex, it->IndexOffset + it->IndexCount);
+        Renderer3D::DrawIndexed(kEnd - kBegin, kBegin, it->BaseVertex);
+    }
+}
+
+const TriangleBvh* IDrawable::GetBvh() const noexcept
+{
+    return nullptr;
+}
+
 void IDrawable::Draw() const noexcept
 {
     for (IBindable* const& pBindable : m_Bindables)
     {
         pBindable->Bind();
     }
-    Renderer3D::DrawIndexed(m_IndexBuffer->GetCount());
+    Submit();
+}
+
+void IDrawable::Submit() const noexcept
+{
+    DrawRange(m_IndexBuffer->GetCount(), 0u);
 }
 
 // PLANE
@@ -77,26 +122,13 @@ Box::Box()
 {
     const uint32_t kID = GetTypeID<Box>();
 
-    const List<Vertex> Vertices =
-    {
-        { { -1.0f, -1.0f, -1.0f }, Colors::Red   },
-        { {  1.0f, -1.0f, -1.0f }, Colors::Red   },
-        { { -1.0f,  1.0f, -1.0f }, Colors::Red   },
-        { {  1.0f,  1.0f, -1.0f }, Colors::Red   },
-        { { -1.0f, -1.0f,  1.0f }, Colors::Green },
-        { {  1.0f, -1.0f,  1.0f }, Colors::Green },
-        { { -1.0f,  1.0f,  1.0f }, Colors::Green },
-        { {  1.0f,  1.0f,  1.0f }, Colors::Green },
-    };
-    const List<uint16_t> Indices =
+    List<Vertex>   Vertices = {};
+    List<uint32_t> Indices  = {};
+    Primitives::Box(Vertices, Indices, Float3(1.0f, 1.0f, 1.0f), [](const Float3& Position, const Float3&)
     {
-        0u, 2u, 1u,  2u, 3u, 1u,
-        1u, 3u, 5u,  3u, 7u, 5u,
-        2u, 6u, 3u,  3u, 6u, 7u,
-        4u, 5u, 7u,  4u, 7u, 6u,
-        0u, 4u, 2u,  2u, 4u, 6u,
-        0u, 1u, 4u,  1u, 5u, 4u,
-    };
+        return Vertex(Position, Position.Z < 0.0f ? Colors::Red : Colors::Green);
+    });
+
     const List<D3D11_INPUT_ELEMENT_DESC> InputElements =
     {
         { "POSITION", 0u, DXGI_FORMAT_R32G32B32_FLOAT, 0u,  0u, D3D11_INPUT_PER_VERTEX_DATA, 0u },
@@ -119,23 +151,15 @@ Pyramid::Pyramid()
 {
     const uint32_t kID = GetTypeID<Pyramid>();
 
-    const List<Vertex> Vertices =
+    // Square based cone, turned so the base edges line up with X and Y and its axis runs from Z = -1 to the apex at Z = 2
+    List<Vertex>   Vertices = {};
+    List<uint32_t> Indices  = {};
+    Primitives::Cone(Vertices, Indices, sqrtf(2.0f), 3.0f, 4u, true, [](const Float3& Position, const Float3&)
     {
-        { { -1.0f, -1.0f, -1.0f }, Colors::Black },
-        { {  1.0f, -1.0f, -1.0f }, Colors::Black },
-        { { -1.0f,  1.0f, -1.0f }, Colors::Black },
-        { {  1.0f,  1.0f, -1.0f }, Colors::Black },
-        { {  0.0f,  0.0f,  2.0f }, Colors::White },
-    };
-    const List<uint16_t> Indices =
-    {
-        0u, 2u, 1u, // Floor Tri 0
-        2u, 3u, 1u, // Floor Tri 1
-        0u, 4u, 2u,
-        0u, 1u, 4u,
-        1u, 3u, 4u,
-        3u, 2u, 4u,
-    };
+        const float c = 0.70710678f;
+        return Vertex(Float3((Position.Z + Position.X) * c, (Position.X - Position.Z) * c, Position.Y + 0.5f), Position.Y > 0.0f ? Colors::White : Colors::Black);
+    });
+
     const List<D3D11_INPUT_ELEMENT_DESC> InputElements =
     {
         { "POSITION", 0u, DXGI_FORMAT_R32G32B32_FLOAT, 0u,  0u, D3D11_INPUT_PER_VERTEX_DATA, 0u },
@@ -158,30 +182,14 @@ Prism::Prism()
 {
     const uint32_t kID = GetTypeID<Prism>();
 
-    const List<Vertex> Vertices =
-    {
-        { { -1.0f, -1.0f, -1.0f }, Colors::Blue },
-        { {  1.0f, -1.0f, -1.0f }, Colors::Blue },
-        { {  0.0f,  1.0f, -1.0f }, Colors::Blue },
-        { { -1.0f, -1.0f,  1.0f }, Colors::Cyan },
-        { {  1.0f, -1.0f,  1.0f }, Colors::Cyan },
-        { {  0.0f,  1.0f,  1.0f }, Colors::Cyan },
-    };
-    const List<uint16_t> Indices =
+    // Three sided cylinder with its axis along Z
+    List<Vertex>   Vertices = {};
+    List<uint32_t> Indices  = {};
+    Primitives::Cylinder(Vertices, Indices, 1.0f, 2.0f, 3u, 1u, true, [](const Float3& Position, const Float3&)
     {
-        0u, 2u, 1u,
+        return Vertex(Float3(Position.Z, Position.X, Position.Y), Position.Y < 0.0f ? Colors::Blue : Colors::Cyan);
+    });
 
-        0u, 1u, 3u,
-        1u, 4u, 3u,
-        
-        1u, 2u, 4u,
-        2u, 5u, 4u,
-        
-        2u, 0u, 5u,
-        0u, 3u, 5u,
-        
-        3u, 4u, 5u,
-    };
     const List<D3D11_INPUT_ELEMENT_DESC> InputElements =
     {
         { "POSITION", 0u, DXGI_FORMAT_R32G32B32_FLOAT, 0u,  0u, D3D11_INPUT_PER_VERTEX_DATA, 0u },
@@ -244,44 +252,458 @@ Surface::Surface()
 }
 
 // MESH
-Mesh::Mesh(const char* lpFilepath, float Scale)
+static Dictionary<uint64_t, MeshGeometry> s_GeometryStorage = {};
+
+// Geometry of one file and set of options, imported and processed on the asset stream's workers. Upload() puts the
+// buffers and the derived data in the shared caches, where every instance waiting for them finds them, or over what
+// an earlier load of the file put there.
+class MeshLoad : public IAssetLoad
+{
+public:
+    MeshLoad(const char* lpFilepath, uint64_t kID, uint32_t kGeneration, float Scale, const SubdivisionOptions& Smoothing);
+
+protected:
+    virtual bool   Decode(const MappedFile& File) noexcept override;
+    virtual void   Upload() noexcept override;
+    virtual size_t GetUploadBytes() const noexcept override;
+
+private:
+    String             m_Source     = {};
+    uint64_t           m_ID         = 0u;
+    uint32_t           m_Generation = 0u;
+    float              m_Scale      = 1.0f;
+    SubdivisionOptions m_Smoothing  = {};
+
+    MeshGeometry     m_Geometry       = {};
+    List<Float3>     m_Positions      = {};
+    List<Float3>     m_Normals        = {};
+    List<uint32_t>   m_Indices        = {};
+    List<uint16_t>   m_ChunkedIndices = {};
+    List<IndexChunk> m_Chunks         = {};
+};
+
+struct MeshSource
+{
+    String             Filepath   = {};
+    float              Scale      = 1.0f;
+    SubdivisionOptions Smoothing  = {};
+    uint32_t           Generation = 0u; // Of the newest load, a reload bumps it
+};
+
+static Dictionary<uint64_t, std::shared_ptr<MeshLoad>> s_MeshLoads       = {}; // Not uploaded yet, by geometry key
+static Dictionary<uint64_t, MeshSource>                s_MeshSources     = {}; // What each geometry key is loaded from
+static uint32_t                                        s_GeometryVersion = 0u;
+
+static constexpr const char* s_MeshVertexShader = "Resources/Shaders/PhongShaderVS.hlsl";
+static constexpr const char* s_MeshPixelShader  = "Resources/Shaders/PhongShaderPS.hlsl";
+
+float Mesh::s_LodErrorThreshold = 1.0f;
+
+MeshLoad::MeshLoad(const char* lpFilepath, uint64_t kID, uint32_t kGeneration, float Scale, const SubdivisionOptions& Smoothing)
+    : IAssetLoad(GetMeshReadPath(lpFilepath)), m_Source(lpFilepath), m_ID(kID), m_Generation(kGeneration), m_Scale(Scale), m_Smoothing(Smoothing)
+{ }
+
+bool MeshLoad::Decode(const MappedFile& File) noexcept
+{
+    List<MeshVertex> Vertices = {};
+    List<uint32_t>   Indices  = {};
+    String           Error    = {};
+
+    // Bake keeps optimized imports compressed next to their source, the renderer decodes those instead of importing
+    // but never writes them: a decode worker writing into Resources would race the tool
+    const bool bCompressed = GetFilepath().extension() == ".mesh";
+    if (!bCompressed || !MeshCodec::DecodeMesh(File.GetData(), File.GetSize(), Vertices, Indices))
+    {
+        // Only a mapped source can be parsed in place, a stale or broken .mesh leaves the importers to read it
+        const MappedFile* pSource = bCompressed ? nullptr : &File;
+        if (std::filesystem::path(m_Source).extension() == ".obj")
+        {
+            const std::shared_ptr<const ObjModel> pModel = LoadObjModelFromFile(m_Source.c_str(), Error, pSource);
+
+            // The loader only joins exact duplicates, scans and CAD exports also have near ones
+            Vertices = pModel->Vertices;
+            Indices  = pModel->Indices;
+            VertexWelder::Weld(Vertices, Indices);
+        }
+        else if (const std::shared_ptr<const Scene> pScene = LoadModelSceneFromFile(m_Source.c_str(), Error); !pScene->Meshes.empty())
+        {
+            // Only the first part, Model draws whole scenes
+            const SceneMesh& Part = pScene->Meshes[0];
+
+            Vertices.assign(pScene->Vertices.begin() + Part.VertexOffset, pScene->Vertices.begin() + Part.VertexOffset + Part.VertexCount);
+            Indices.assign(pScene->Indices.begin() + Part.IndexOffset, pScene->Indices.begin() + Part.IndexOffset + Part.IndexCount);
+        }
+
+        // Only imports are reported, not the procedural meshes or the subdivided copies optimized below
+        RecordOptimization(MeshOptimizer::Optimize(Vertices, Indices));
+    }
+    if (Vertices.empty())
+    {
+        SetError(Error.empty() ? "No triangles in '" + m_Source + "'" : std::move(Error));
+        return false;
+    }
+
+    // The cache holds the control mesh, subdivided meshes are rebuilt from it and optimized again
+    if (m_Smoothing.Levels > 0u)
+    {
+        Subdivision::Subdivide(Vertices, Indices, m_Smoothing);
+        MeshOptimizer::Optimize(Vertices, Indices);
+    }
+
+    for (MeshVertex& v : Vertices)
+    {
+        v.Position = v.Position * m_Scale;
+    }
+
+    m_Geometry.Lods     = MeshSimplifier::GenerateLodChain(Vertices, Indices);
+    m_Geometry.Bounds   = MeshOptimizer::ComputeBoundingSphere(&Vertices[0].Position, sizeof(MeshVertex), Vertices.size());
+    m_Geometry.Meshlets = MeshletBuilder::Build(Indices.data(), Indices.data(), m_Geometry.Lods[0].IndexCount, 0u, &Vertices[0].Position, sizeof(MeshVertex), Vertices.size());
+    m_Geometry.Bvh.Build(&Vertices[0].Position, sizeof(MeshVertex), Vertices.size(), Indices.data() + m_Geometry.Lods[0].IndexOffset, m_Geometry.Lods[0].IndexCount);
+
+    // Too many vertices for 16-bit indices: split into 16-bit chunks if the duplicated vertices cost less than 32-bit indices
+    if (Vertices.size() > size_t(UINT16_MAX) + 1u)
+    {
+        List<MeshVertex> Split = Vertices;
+        MeshOptimizer::SplitIndexChunks(Split, Indices, m_ChunkedIndices, m_Chunks);
+        if ((Split.size() - Vertices.size()) * sizeof(MeshVertex) < Indices.size() * sizeof(uint16_t))
+        {
+            Vertices.swap(Split);
+        }
+        else
+        {
+            m_ChunkedIndices.clear();
+            m_Chunks.clear();
+        }
+    }
+
+    // Positions and normals in separate streams, passes that only need positions fetch half the bytes
+    m_Positions.resize(Vertices.size());
+    m_Normals.resize(Vertices.size());
+    for (size_t k = 0u; k < Vertices.size(); k++)
+    {
+        m_Positions[k] = Vertices[k].Position;
+        m_Normals[k]   = Vertices[k].Normal;
+    }
+    m_Indices.swap(Indices);
+    return true;
+}
+
+// Cached buffers are kept and given the new one's contents, the drawables bound to them draw the new data
+template<typename B>
+static void PlaceBuffer(Dictionary<uint64_t, B*>& Buffers, uint64_t kID, B* pBuffer) noexcept
+{
+    if (auto it = Buffers.find(kID); it != Buffers.end())
+    {
+        it->second->Swap(*pBuffer);
+        delete pBuffer;
+    }
+    else
+    {
+        Buffers[kID] = pBuffer;
+    }
+}
+
+void MeshLoad::Upload() noexcept
+{
+    // Decodes finish in any order, a load the file was reloaded after would put older geometry over newer
+    if (s_MeshSources.at(m_ID).Generation != m_Generation)
+    {
+        m_Positions      = {};
+        m_Normals        = {};
+        m_Indices        = {};
+        m_ChunkedIndices = {};
+        m_Chunks         = {};
+        return;
+    }
+
+    // Assigned into the stored entry on a reload, so the instances' pointers to it stay valid
+    s_GeometryStorage[m_ID] = std::move(m_Geometry);
+    s_GeometryVersion++;
+
+    const List<VertexStream> Streams =
+    {
+        { m_Positions.data(), uint32_t(sizeof(Float3)) },
+        { m_Normals.data(),   uint32_t(sizeof(Float3)) },
+    };
+    PlaceBuffer(Renderer3D::GetVertexBuffers(), m_ID, new VertexBuffer(Streams, m_Positions.size()));
+    if (!m_Chunks.empty())
+    {
+        PlaceBuffer(Renderer3D::GetIndexBuffers(), m_ID, new IndexBuffer(m_ChunkedIndices, m_Chunks));
+    }
+    else
+    {
+        PlaceBuffer(Renderer3D::GetIndexBuffers(), m_ID, new IndexBuffer(m_Indices));
+    }
+
+    // The GPU has its copy, the instances only need the geometry
+    m_Positions      = {};
+    m_Normals        = {};
+    m_Indices        = {};
+    m_ChunkedIndices = {};
+    m_Chunks         = {};
+}
+
+size_t MeshLoad::GetUploadBytes() const noexcept
+{
+    return (m_Positions.size() + m_Normals.size()) * sizeof(Float3) + m_Indices.size() * sizeof(uint32_t) + m_ChunkedIndices.size() * sizeof(uint16_t);
+}
+
+Mesh::Mesh(const char* lpFilepath, float Scale, const SubdivisionOptions& Smoothing)
     : IDrawableChild<Mesh>()
 {
-    struct MeshVertex
+    m_GeometryID = GetGeometryKey<Mesh>(lpFilepath, Scale) ^ GetSubdivisionKey(Smoothing);
+
+    // Buffers are shared per file and options, repeated instances only pay for this lookup
+    if (s_GeometryStorage.count(m_GeometryID) != 0u)
     {
-        Float3 Position = {};
-        Float3 Normal   = {};
+        CreateBindables();
+        return;
+    }
+
+    // Otherwise the instance waits for the one load of its file and its shaders, and draws nothing until they are in
+    std::shared_ptr<MeshLoad>& pLoad = s_MeshLoads[m_GeometryID];
+    if (pLoad == nullptr)
+    {
+        MeshSource& Source = s_MeshSources[m_GeometryID];
+        Source = { lpFilepath, Scale, Smoothing, Source.Generation + 1u };
+        pLoad = std::make_shared<MeshLoad>(lpFilepath, m_GeometryID, Source.Generation, Scale, Smoothing);
+        Renderer3D::GetAssetStream().Submit(pLoad);
+    }
+    m_PendingLoads.push_back(pLoad);
 
-        constexpr MeshVertex() = default;
-        constexpr MeshVertex(const Float3& pos, const Float3& n)
-            : Position(pos), Normal(n)
-        { }
+    if (std::shared_ptr<IAssetLoad> pShader = Renderer3D::PrefetchVertexShader(s_MeshVertexShader))
+    {
+        m_PendingLoads.push_back(pShader);
+    }
+    if (std::shared_ptr<IAssetLoad> pShader = Renderer3D::PrefetchPixelShader(s_MeshPixelShader))
+    {
+        m_PendingLoads.push_back(pShader);
+    }
+}
+
+void Mesh::CreateBindables() noexcept
+{
+    // The load created the shared buffers, these only look them up
+    m_Geometry = &s_GeometryStorage.at(m_GeometryID);
+
+    const List<D3D11_INPUT_ELEMENT_DESC> InputElements =
+    {
+        { "POSITION", 0u, DXGI_FORMAT_R32G32B32_FLOAT, 0u, 0u, D3D11_INPUT_PER_VERTEX_DATA, 0u },
+        { "NORMAL",   0u, DXGI_FORMAT_R32G32B32_FLOAT, 1u, 0u, D3D11_INPUT_PER_VERTEX_DATA, 0u },
     };
 
-    const uint32_t kID = GetTypeID<Mesh>();
+    EmplaceBindable<VertexBuffer>(m_GeometryID, List<VertexStream>(), 0u);
+    ID3DBlob* pBlob = EmplaceBindable<VertexShader>(m_GeometryID, s_MeshVertexShader)->GetBytecode();
+    EmplaceBindable<PixelShader>(m_GeometryID, s_MeshPixelShader);
+    EmplaceIndexBuffer(m_GeometryID, List<uint16_t>());
+    EmplaceBindable<InputLayout>(m_GeometryID, InputElements, pBlob);
+    EmplaceBindable<PrimitiveTopology>(m_GeometryID, D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+    EmplaceBindable<TransformConstantBuffer>(m_GeometryID, this);
+}
 
-    const aiScene* pModel = LoadSceneFromFile(lpFilepath);
-    const aiMesh*  pMesh  = pModel->mMeshes[0];
+bool Mesh::IsLoaded() const noexcept
+{
+    return m_Geometry != nullptr;
+}
 
-    List<MeshVertex> Vertices = {};
-    Vertices.reserve(pMesh->mNumVertices);
-    for (size_t k = 0; k < pMesh->mNumVertices; k++)
+uint32_t Mesh::Reload(const char* lpFilepath) noexcept
+{
+    const std::filesystem::path Changed = std::filesystem::path(lpFilepath).lexically_normal();
+
+    // A load still in flight for the key is superseded, its upload is dropped whenever its decode finishes
+    uint32_t kQueued = 0u;
+    for (auto&[kID, Source] : s_MeshSources)
     {
-        const Float3 position = *reinterpret_cast<const Float3*>(&pMesh->mVertices[k]) * Scale;
-        const Float3 normal   = *reinterpret_cast<const Float3*>(&pMesh->mNormals[k]);
-        Vertices.emplace_back(position, normal);
+        if (std::filesystem::path(Source.Filepath).lexically_normal() != Changed)
+        {
+            continue;
+        }
+
+        InvalidateImport(Source.Filepath.c_str());
+        Source.Generation++;
+        Renderer3D::GetAssetStream().Submit(std::make_shared<MeshLoad>(Source.Filepath.c_str(), kID, Source.Generation, Source.Scale, Source.Smoothing));
+        kQueued++;
     }
-    
-    List<uint16_t> Indices = {};
-    Indices.reserve(pMesh->mNumFaces * 3u);
-    for (size_t k = 0; k < pMesh->mNumFaces; k++)
+    return kQueued;
+}
+
+uint32_t Mesh::GetGeometryVersion() noexcept
+{
+    return s_GeometryVersion;
+}
+
+void Mesh::Update(float dt) noexcept
+{
+    IDrawableChild<Mesh>::Update(dt);
+
+    if (m_Geometry == nullptr)
+    {
+        if (std::any_of(m_PendingLoads.begin(), m_PendingLoads.end(), [](const std::shared_ptr<IAssetLoad>& pLoad) { return !pLoad->IsDone(); }))
+        {
+            return;
+        }
+
+        // A failed load is forgotten, so the next instance of the file tries again. Its error is reported here, on the
+        // main thread, by the first instance to find it done.
+        if (auto it = s_MeshLoads.find(m_GeometryID); !m_PendingLoads.empty() && it != s_MeshLoads.end() && it->second == m_PendingLoads.front())
+        {
+            if (it->second->GetState() == AssetState::Failed)
+            {
+                GfxError(false, "%s", it->second->GetError().c_str());
+            }
+            s_MeshLoads.erase(it);
+        }
+        m_PendingLoads.clear();
+        if (s_GeometryStorage.count(m_GeometryID) == 0u)
+        {
+            return;
+        }
+        CreateBindables();
+    }
+
+    const DirectX::XMMATRIX ModelView = GetTransform() * Renderer3D::GetCameraView();
+    const DirectX::XMMATRIX Clip      = DirectX::XMMatrixTranspose(ModelView * Renderer3D::GetProjection());
+
+    Float4 Planes[6] = {};
+    ExtractFrustumPlanes(Clip, Planes);
+
+    m_DrawRanges.clear();
+    if (!MeshletBuilder::IsVisible(m_Geometry->Bounds, Planes))
+    {
+        return;
+    }
+
+    // Pick the coarsest level whose error, projected at the closest point of the bounding sphere, stays under the threshold
+    const BoundingSphere& Bounds = m_Geometry->Bounds;
+    const DirectX::XMVECTOR Center = DirectX::XMVector3Transform(DirectX::XMVectorSet(Bounds.Center.X, Bounds.Center.Y, Bounds.Center.Z, 1.0f), ModelView);
+    const float Depth = DirectX::XMVectorGetZ(Center) - Bounds.Radius;
+    const float PixelsPerUnit = DirectX::XMVectorGetY(Renderer3D::GetProjection().r[1]) * 0.5f * Renderer3D::GetViewportSize().Y;
+
+    m_LodLevel = 0u;
+    if (Depth > 0.0f)
+    {
+        for (uint32_t k = uint32_t(m_Geometry->Lods.size()) - 1u; k > 0u; k--)
+        {
+            if (m_Geometry->Lods[k].Error * PixelsPerUnit / Depth <= s_LodErrorThreshold)
+            {
+                m_LodLevel = k;
+                break;
+            }
+        }
+    }
+
+    const MeshLod& Lod = m_Geometry->Lods[m_LodLevel];
+    if (m_LodLevel > 0u || m_Geometry->Meshlets.empty())
+    {
+        m_DrawRanges.push_back({ Lod.IndexOffset, Lod.IndexCount });
+        return;
+    }
+
+    Float3 CameraPosition = {};
+    DirectX::XMStoreFloat3(reinterpret_cast<DirectX::XMFLOAT3*>(&CameraPosition), DirectX::XMMatrixInverse(nullptr, ModelView).r[3]);
+    MeshletBuilder::Cull(m_Geometry->Meshlets, Planes, CameraPosition, m_DrawRanges);
+}
+
+const TriangleBvh* Mesh::GetBvh() const noexcept
+{
+    return m_Geometry != nullptr ? &m_Geometry->Bvh : nullptr;
+}
+
+uint32_t Mesh::GetLodLevel() const noexcept
+{
+    return m_LodLevel;
+}
+
+void Mesh::Submit() const noexcept
+{
+    for (const IndexRange& Range : m_DrawRanges)
     {
-        const aiFace& face = pMesh->mFaces[k];
-        assert(face.mNumIndices == 3u);
-        Indices.emplace_back(face.mIndices[0]);
-        Indices.emplace_back(face.mIndices[1]);
-        Indices.emplace_back(face.mIndices[2]);
+        DrawRange(Range.IndexCount, Range.IndexOffset);
     }
+}
+
+// MODEL
+static List<Model*>       s_PendingModels      = {};
+static List<SkinningJob>  s_SkinningJobs       = {};
+static SkinningStatistics s_SkinningStatistics = {};
+static uint32_t           s_MorphedVertices    = 0u;
+static uint32_t           s_MorphedLastFrame   = 0u;
+
+float Model::s_AnimationBlend = 0.0f;
+
+// A file's scene, imported on the asset stream's workers. Assimp opens the file again through its own IO system, as
+// it may pull in others next to it, and finds it in the page cache the reader just filled. The instances create their
+// buffers from the scene once it is in, animated ones need their own.
+class ModelLoad : public IAssetLoad
+{
+public:
+    explicit ModelLoad(const char* lpFilepath)
+        : IAssetLoad(lpFilepath), m_Source(lpFilepath)
+    { }
+
+    const std::shared_ptr<const Scene>& GetScene() const noexcept { return m_Scene; }
+
+protected:
+    virtual bool   Decode(const MappedFile& File) noexcept override;
+    virtual void   Upload() noexcept override;
+    virtual size_t GetUploadBytes() const noexcept override;
+
+private:
+    String                       m_Source = {};
+    std::shared_ptr<const Scene> m_Scene  = nullptr;
+};
+
+static Dictionary<uint64_t, std::shared_ptr<ModelLoad>> s_ModelLoads = {}; // Not done yet, by geometry key
+
+bool ModelLoad::Decode(const MappedFile&) noexcept
+{
+    String Error = {};
+    m_Scene = LoadModelSceneFromFile(m_Source.c_str(), Error);
+    if (m_Scene->Meshes.empty())
+    {
+        SetError(Error.empty() ? "No meshes in '" + m_Source + "'" : std::move(Error));
+        return false;
+    }
+    return true;
+}
+
+void ModelLoad::Upload() noexcept
+{ }
+
+size_t ModelLoad::GetUploadBytes() const noexcept
+{
+    return m_Scene->Vertices.size() * sizeof(MeshVertex) + m_Scene->Indices.size() * sizeof(uint32_t);
+}
+
+Model::Model(const char* lpFilepath, float Scale)
+    : IDrawableChild<Model>()
+{
+    // Scale is part of the instance transform, so every scale shares the same buffers
+    m_GeometryID = GetGeometryKey<Model>(lpFilepath, 1.0f);
+    m_Scale      = Scale;
+
+    // Instances of a file share one import, the scene cache has it once the first is done
+    std::shared_ptr<ModelLoad>& pLoad = s_ModelLoads[m_GeometryID];
+    if (pLoad == nullptr)
+    {
+        pLoad = std::make_shared<ModelLoad>(lpFilepath);
+        Renderer3D::GetAssetStream().Submit(pLoad);
+    }
+    m_Load = pLoad;
+
+    if (std::shared_ptr<IAssetLoad> pShader = Renderer3D::PrefetchVertexShader(s_MeshVertexShader))
+    {
+        m_PendingShaders.push_back(pShader);
+    }
+    if (std::shared_ptr<IAssetLoad> pShader = Renderer3D::PrefetchPixelShader(s_MeshPixelShader))
+    {
+        m_PendingShaders.push_back(pShader);
+    }
+}
+
+void Model::CreateBindables() noexcept
+{
+    const uint64_t kID = m_GeometryID;
 
     const List<D3D11_INPUT_ELEMENT_DESC> InputElements =
     {
@@ -289,43 +711,232 @@ Mesh::Mesh(const char* lpFilepath, float Scale)
         { "NORMAL",   0u, DXGI_FORMAT_R32G32B32_FLOAT, 0u, 12u, D3D11_INPUT_PER_VERTEX_DATA, 0u },
     };
 
-    EmplaceBindable<VertexBuffer>(kID, Vertices);
-    ID3DBlob* pBlob = EmplaceBindable<VertexShader>(kID, "Resources/Shaders/PhongShaderVS.hlsl")->GetBytecode();
-    EmplaceBindable<PixelShader>(kID, "Resources/Shaders/PhongShaderPS.hlsl");
-    EmplaceIndexBuffer(kID, Indices);
+    const bool bSkinned = !m_Scene->Influences.empty() && !m_Scene->Clips.empty();
+    const bool bMorphed = !m_Scene->MorphTargets.empty();
+    if (bSkinned)
+    {
+        m_SkinnedVertices = m_Scene->Vertices;
+
+        m_RestPose.reserve(m_Scene->LocalTransforms.size());
+        for (const Float4x4& Local : m_Scene->LocalTransforms)
+        {
+            m_RestPose.emplace_back(Animation::Decompose(Local));
+        }
+        m_Poses = m_RestPose;
+        m_ModelMatrices.resize(m_RestPose.size());
+        m_Palette.resize(m_Scene->JointNodes.size());
+    }
+    if (bMorphed)
+    {
+        m_MorphedVertices = m_Scene->Vertices;
+        for (const MorphTarget& Target : m_Scene->MorphTargets)
+        {
+            m_RestMorphWeights.emplace_back(Target.DefaultWeight);
+        }
+        m_MorphWeights = m_RestMorphWeights;
+    }
+
+    if (bSkinned || bMorphed)
+    {
+        m_DynamicBuffer = new VertexBuffer(m_Scene->Vertices, true);
+        m_Bindables.emplace_back(m_DynamicBuffer);
+
+        // Instances start at different points of the clip so crowds don't move in lockstep
+        m_AnimationTime = m_Scene->Clips.empty() ? 0.0f : Random::Float(0.0f, std::max(m_Scene->Clips[0].Duration, 0.0f));
+    }
+    else
+    {
+        EmplaceBindable<VertexBuffer>(kID, m_Scene->Vertices);
+    }
+    ID3DBlob* pBlob = EmplaceBindable<VertexShader>(kID, s_MeshVertexShader)->GetBytecode();
+    EmplaceBindable<PixelShader>(kID, s_MeshPixelShader);
+    EmplaceIndexBuffer(kID, m_Scene->Indices);
     EmplaceBindable<InputLayout>(kID, InputElements, pBlob);
     EmplaceBindable<PrimitiveTopology>(kID, D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
-    EmplaceBindable<TransformConstantBuffer>(kID, this);
+    m_Transform = EmplaceBindable<TransformConstantBuffer>(kID, this);
 }
 
-// SOLID SPHERE
-SolidSphere::SolidSphere(float Radius)
-    : IDrawableChild<SolidSphere>()
+void Model::Update(float dt) noexcept
 {
-    const uint32_t kID = GetTypeID<SolidSphere>();
+    IDrawableChild<Model>::Update(dt);
+    m_ModelTransform = DirectX::XMMatrixScaling(m_Scale, m_Scale, m_Scale) * GetTransform();
 
-    const aiScene* pModel = LoadSceneFromFile("Resources/Models/Sphere.obj");
-    const aiMesh* pMesh = pModel->mMeshes[0];
+    if (m_Load != nullptr)
+    {
+        if (!m_Load->IsDone() || std::any_of(m_PendingShaders.begin(), m_PendingShaders.end(), [](const std::shared_ptr<IAssetLoad>& pLoad) { return !pLoad->IsDone(); }))
+        {
+            return;
+        }
 
-    List<Vertex> Vertices = {};
-    Vertices.reserve(pMesh->mNumVertices);
-    for (size_t k = 0; k < pMesh->mNumVertices; k++)
+        // A failed load is forgotten like a mesh's and its error reported once, the next instance of the file tries again
+        if (auto it = s_ModelLoads.find(m_GeometryID); it != s_ModelLoads.end() && it->second == m_Load)
+        {
+            if (m_Load->GetState() == AssetState::Failed)
+            {
+                GfxError(false, "%s", m_Load->GetError().c_str());
+            }
+            s_ModelLoads.erase(it);
+        }
+        if (m_Load->IsReady())
+        {
+            m_Scene = m_Load->GetScene();
+            CreateBindables();
+        }
+        m_Load = nullptr;
+        m_PendingShaders.clear();
+    }
+    if (m_Scene == nullptr)
     {
-        const Float3 pos = *reinterpret_cast<const Float3*>(&pMesh->mVertices[k]);
-        Vertices.emplace_back(pos, Colors::White);
+        return;
     }
 
-    List<uint16_t> Indices = {};
-    Indices.reserve(pMesh->mNumFaces * 3u);
-    for (size_t k = 0; k < pMesh->mNumFaces; k++)
+    if (!IsAnimated())
+    {
+        return;
+    }
+
+    // Cross-fade between the first two clips
+    const List<AnimationClip>& Clips = m_Scene->Clips;
+    m_AnimationTime += dt;
+
+    const float          Blend     = Clips.size() > 1u ? s_AnimationBlend : 0.0f;
+    const AnimationLayer Layers[2] =
+    {
+        { Clips.size() > 0u ? &Clips[0] : nullptr, m_AnimationTime, 1.0f - Blend, true },
+        { Clips.size() > 1u ? &Clips[1] : nullptr, m_AnimationTime, Blend,        true },
+    };
+
+    // Blend shapes first, skinning then deforms the morphed shape
+    if (!m_MorphedVertices.empty())
+    {
+        const List<MorphTarget>& Targets = m_Scene->MorphTargets;
+        Animation::BlendMorphWeights(Layers, 2u, m_RestMorphWeights.data(), m_RestMorphWeights.size(), m_MorphWeights.data(), m_MorphWeightScratch);
+        s_MorphedVertices += Morphing::Apply(m_Scene->Vertices.data(), Targets.data(), m_MorphWeights.data(), Targets.size(), m_MorphedVertices.data(), m_ActiveMorphTargets);
+    }
+
+    if (IsSkinned())
     {
-        const aiFace& face = pMesh->mFaces[k];
-        assert(face.mNumIndices == 3u);
-        Indices.emplace_back(face.mIndices[0]);
-        Indices.emplace_back(face.mIndices[1]);
-        Indices.emplace_back(face.mIndices[2]);
+        Animation::Blend(Layers, 2u, m_RestPose.data(), m_RestPose.size(), m_Poses.data(), m_BlendScratch);
+        Animation::ComputeModelMatrices(m_Poses.data(), m_Scene->Parents.data(), m_Poses.size(), m_ModelMatrices.data());
+        Animation::ComputePalette(m_ModelMatrices.data(), m_Scene->JointNodes.data(), m_Scene->InverseBindMatrices.data(), m_Palette.size(), m_Palette.data());
     }
 
+    s_PendingModels.emplace_back(this);
+}
+
+bool Model::IsAnimated() const noexcept
+{
+    return m_DynamicBuffer != nullptr;
+}
+
+bool Model::IsLoaded() const noexcept
+{
+    return m_Scene != nullptr;
+}
+
+bool Model::IsSkinned() const noexcept
+{
+    return !m_SkinnedVertices.empty();
+}
+
+void Model::SkinPending() noexcept
+{
+    s_SkinningJobs.clear();
+    for (Model* pModel : s_PendingModels)
+    {
+        if (!pModel->IsSkinned())
+        {
+            continue;
+        }
+
+        const Scene& s = *pModel->m_Scene;
+        SkinningJob& Job = s_SkinningJobs.emplace_back();
+        Job.pSource      = pModel->m_MorphedVertices.empty() ? s.Vertices.data() : pModel->m_MorphedVertices.data();
+        Job.pInfluences  = s.Influences.data();
+        Job.pPalette     = pModel->m_Palette.data();
+        Job.pDestination = pModel->m_SkinnedVertices.data();
+        Job.kVertexCount = pModel->m_SkinnedVertices.size();
+    }
+    s_SkinningStatistics = Skinning::SkinBatch(s_SkinningJobs.data(), s_SkinningJobs.size());
+
+    // Uploads stay on this thread, the immediate context is not thread safe
+    for (Model* pModel : s_PendingModels)
+    {
+        pModel->m_DynamicBuffer->Update(pModel->IsSkinned() ? pModel->m_SkinnedVertices : pModel->m_MorphedVertices);
+    }
+    s_PendingModels.clear();
+
+    s_MorphedLastFrame = s_MorphedVertices;
+    s_MorphedVertices  = 0u;
+}
+
+const SkinningStatistics& Model::GetSkinningStatistics() noexcept
+{
+    return s_SkinningStatistics;
+}
+
+uint32_t Model::GetMorphedVertexCount() noexcept
+{
+    return s_MorphedLastFrame;
+}
+
+void Model::Submit() const noexcept
+{
+    if (m_Scene == nullptr)
+    {
+        return;
+    }
+    const Scene& s = *m_Scene;
+
+    // Skinned vertices are already in model space, each part is drawn once
+    if (IsSkinned())
+    {
+        m_Transform->Bind(m_ModelTransform);
+        for (const SceneMesh& Part : s.Meshes)
+        {
+            Renderer3D::DrawIndexed(Part.IndexCount, Part.IndexOffset, int32_t(Part.VertexOffset));
+        }
+        return;
+    }
+
+    for (size_t kNode = 0u; kNode < s.Parents.size(); kNode++)
+    {
+        if (s.NodeMeshCounts[kNode] == 0u)
+        {
+            continue;
+        }
+
+        const Matrix4x4 World = DirectX::XMLoadFloat4x4(reinterpret_cast<const DirectX::XMFLOAT4X4*>(&s.WorldTransforms[kNode]));
+        m_Transform->Bind(World * m_ModelTransform);
+
+        const uint32_t* pMeshes = s.NodeMeshes.data() + s.NodeMeshOffsets[kNode];
+        for (uint32_t k = 0u; k < s.NodeMeshCounts[kNode]; k++)
+        {
+            const SceneMesh& Part = s.Meshes[pMeshes[k]];
+            Renderer3D::DrawIndexed(Part.IndexCount, Part.IndexOffset, int32_t(Part.VertexOffset));
+        }
+    }
+}
+
+// SOLID SPHERE
+static constexpr uint32_t s_SphereSubdivisions = 3u; // 642 vertices, plenty for a light gizmo
+
+SolidSphere::SolidSphere(float Radius)
+    : IDrawableChild<SolidSphere>()
+{
+    // Generated geometry has no file to key it by, the parameters stand in for one
+    const float    Parameters[2] = { Radius, float(s_SphereSubdivisions) };
+    const uint64_t kID           = HashBytes(Parameters, sizeof(Parameters)) ^ GetTypeID<SolidSphere>();
+
+    List<Vertex>   Vertices = {};
+    List<uint32_t> Indices  = {};
+    Primitives::IcoSphere(Vertices, Indices, Radius, s_SphereSubdivisions, [](const Float3& Position, const Float3&)
+    {
+        return Vertex(Position, Colors::White);
+    });
+
+    MeshOptimizer::Optimize(Vertices, Indices);
+
     const List<D3D11_INPUT_ELEMENT_DESC> InputElements =
     {
         { "POSITION", 0u, DXGI_FORMAT_R32G32B32_FLOAT, 0u,  0u, D3D11_INPUT_PER_VERTEX_DATA, 0u },
@@ -341,27 +952,614 @@ SolidSphere::SolidSphere(float Radius)
     EmplaceBindable<TransformConstantBuffer>(kID, this);
 }
 
+// POINT CLOUD
+float    PointCloud::s_MaxPointSpacing     = 2.0f;
+uint64_t PointCloud::s_PointBudget         = uint64_t(3u) << 20u;
+uint64_t PointCloud::s_ResidentPointBudget = uint64_t(6u) << 20u;
+uint32_t PointCloud::s_MaxUploadsPerFrame  = 16u;
+
+PointCloud::PointCloud(const char* lpFilepath)
+    : IDrawableChild<PointCloud>()
+{
+    // Points live in per-node buffers of their own, only the pipeline state is shared
+    const uint64_t kID = GetTypeID<PointCloud>();
+
+    m_Stream = std::make_unique<PointCloudStream>(lpFilepath);
+
+    const List<D3D11_INPUT_ELEMENT_DESC> InputElements =
+    {
+        { "POSITION", 0u, DXGI_FORMAT_R32G32B32_FLOAT, 0u,  0u, D3D11_INPUT_PER_VERTEX_DATA, 0u },
+        { "COLOR",    0u, DXGI_FORMAT_R8G8B8A8_UNORM,  0u, 12u, D3D11_INPUT_PER_VERTEX_DATA, 0u },
+    };
+
+    ID3DBlob* pBlob = EmplaceBindable<VertexShader>(kID, "Resources/Shaders/ColorShaderVS.hlsl")->GetBytecode();
+    EmplaceBindable<PixelShader>(kID, "Resources/Shaders/ColorShaderPS.hlsl");
+    EmplaceBindable<InputLayout>(kID, InputElements, pBlob);
+    EmplaceBindable<PrimitiveTopology>(kID, D3D11_PRIMITIVE_TOPOLOGY_POINTLIST);
+    EmplaceBindable<TransformConstantBuffer>(kID, this);
+}
+
+PointCloud::~PointCloud() noexcept
+{
+    // The loader thread stops before the buffers go
+    m_Stream.reset();
+    for (auto&[kNode, Node] : m_Resident)
+    {
+        delete Node.Points;
+    }
+}
+
+void PointCloud::Update(float dt) noexcept
+{
+    m_Frame++;
+    m_Drawn.clear();
+    if (!IsOpen())
+    {
+        return;
+    }
+    const List<PointCloudNode>& Nodes = m_Stream->GetNodes();
+
+    const DirectX::XMMATRIX ModelView = GetTransform() * Renderer3D::GetCameraView();
+    const DirectX::XMMATRIX Clip      = DirectX::XMMatrixTranspose(ModelView * Renderer3D::GetProjection());
+
+    PointCloudView View = {};
+    ExtractFrustumPlanes(Clip, View.Planes);
+    DirectX::XMStoreFloat3(reinterpret_cast<DirectX::XMFLOAT3*>(&View.CameraPosition), DirectX::XMMatrixInverse(nullptr, ModelView).r[3]);
+    View.PixelsPerUnit = DirectX::XMVectorGetY(Renderer3D::GetProjection().r[1]) * 0.5f * Renderer3D::GetViewportSize().Y;
+    View.MaxSpacing    = s_MaxPointSpacing;
+    View.PointBudget   = s_PointBudget;
+    PointCloudLod::Select(Nodes.data(), Nodes.size(), View, m_Selected);
+
+    // Upload a few of the nodes that arrived, the rest wait for the next frames
+    m_Stream->TakeLoaded(m_Arrived);
+    uint32_t kUploads = 0u;
+    size_t   kWaiting = 0u;
+    for (PointCloudStream::LoadedNode& Loaded : m_Arrived)
+    {
+        if (m_Resident.count(Loaded.Node) != 0u)
+        {
+            continue;
+        }
+        if (kUploads == s_MaxUploadsPerFrame)
+        {
+            m_Arrived[kWaiting++] = std::move(Loaded);
+            continue;
+        }
+
+        ResidentNode& Node = m_Resident[Loaded.Node];
+        Node.Points    = new VertexBuffer(Loaded.Points);
+        Node.Count     = uint32_t(Loaded.Points.size());
+        Node.LastFrame = m_Frame;
+        m_ResidentPoints += Node.Count;
+        kUploads++;
+    }
+    m_Arrived.resize(kWaiting);
+
+    // Draw what is resident, request the rest most important first
+    m_Missing.clear();
+    for (const uint32_t& kNode : m_Selected)
+    {
+        if (Nodes[kNode].PointCount == 0u)
+        {
+            continue;
+        }
+
+        const auto it = m_Resident.find(kNode);
+        if (it != m_Resident.end())
+        {
+            it->second.LastFrame = m_Frame;
+            m_Drawn.push_back(kNode);
+        }
+        else if (std::none_of(m_Arrived.begin(), m_Arrived.end(), [&](const PointCloudStream::LoadedNode& Loaded) { return Loaded.Node == kNode; }))
+        {
+            m_Missing.push_back(kNode);
+        }
+    }
+    m_Stream->Request(m_Missing);
+
+    if (m_ResidentPoints <= s_ResidentPointBudget)
+    {
+        return;
+    }
+
+    // Least recently used first, never a node drawn this frame
+    List<std::pair<uint64_t, uint32_t>> Candidates = {};
+    for (const auto&[kNode, Node] : m_Resident)
+    {
+        if (Node.LastFrame != m_Frame)
+        {
+            Candidates.emplace_back(Node.LastFrame, kNode);
+        }
+    }
+    std::sort(Candidates.begin(), Candidates.end());
+    for (size_t k = 0u; k < Candidates.size() && m_ResidentPoints > s_ResidentPointBudget; k++)
+    {
+        ResidentNode& Node = m_Resident[Candidates[k].second];
+        m_ResidentPoints -= Node.Count;
+        delete Node.Points;
+        m_Resident.erase(Candidates[k].second);
+    }
+}
+
+Matrix4x4 PointCloud::GetTransform() noexcept
+{
+    return DirectX::XMMatrixIdentity();
+}
+
+bool PointCloud::IsOpen() const noexcept
+{
+    return m_Stream->IsOpen();
+}
+
+uint64_t PointCloud::GetResidentPointCount() const noexcept
+{
+    return m_ResidentPoints;
+}
+
+void PointCloud::Submit() const noexcept
+{
+    for (const uint32_t& kNode : m_Drawn)
+    {
+        const ResidentNode& Node = m_Resident.at(kNode);
+        Node.Points->Bind();
+        Renderer3D::Draw(Node.Count);
+    }
+}
+
+// VOLUME SURFACE
+VolumeSurface::VolumeSurface(const std::shared_ptr<Volume>& Field, float IsoValue)
+    : IDrawableChild<VolumeSurface>(), m_Volume(Field), m_IsoValue(IsoValue)
+{
+    // Buffers are per chunk and per instance, only the pipeline state is shared
+    const uint64_t kID = GetTypeID<VolumeSurface>();
+
+    const List<D3D11_INPUT_ELEMENT_DESC> InputElements =
+    {
+        { "POSITION", 0u, DXGI_FORMAT_R32G32B32_FLOAT, 0u, 0u, D3D11_INPUT_PER_VERTEX_DATA, 0u },
+        { "NORMAL",   0u, DXGI_FORMAT_R32G32B32_FLOAT, 1u, 0u, D3D11_INPUT_PER_VERTEX_DATA, 0u },
+    };
+
+    ID3DBlob* pBlob = EmplaceBindable<VertexShader>(kID, "Resources/Shaders/PhongShaderVS.hlsl")->GetBytecode();
+    EmplaceBindable<PixelShader>(kID, "Resources/Shaders/PhongShaderPS.hlsl");
+    EmplaceBindable<InputLayout>(kID, InputElements, pBlob);
+    EmplaceBindable<PrimitiveTopology>(kID, D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+    EmplaceBindable<TransformConstantBuffer>(kID, this);
+}
+
+VolumeSurface::~VolumeSurface() noexcept
+{
+    for (auto&[kChunk, Buffers] : m_Buffers)
+    {
+        delete Buffers.Vertices;
+        delete Buffers.Indices;
+    }
+}
+
+void VolumeSurface::Update(float dt) noexcept
+{
+    // The volume stays where it was built, only its surface changes
+    m_Remeshed = 0u;
+    if (!m_Volume->HasDirtyChunks())
+    {
+        return;
+    }
+
+    List<uint64_t> Changed = {};
+    VolumeMesher::Update(*m_Volume, m_IsoValue, m_Surfaces, &Changed);
+    m_Remeshed = Changed.size();
+
+    for (const uint64_t& kChunk : Changed)
+    {
+        const auto itBuffers = m_Buffers.find(kChunk);
+        if (itBuffers != m_Buffers.end())
+        {
+            delete itBuffers->second.Vertices;
+            delete itBuffers->second.Indices;
+            m_Buffers.erase(itBuffers);
+        }
+
+        const auto itSurface = m_Surfaces.find(kChunk);
+        if (itSurface == m_Surfaces.end())
+        {
+            continue;
+        }
+
+        const ChunkSurface&      Surface = itSurface->second;
+        const List<VertexStream> Streams =
+        {
+            { Surface.Positions.data(), uint32_t(sizeof(Float3)) },
+            { Surface.Normals.data(),   uint32_t(sizeof(Float3)) },
+        };
+        ChunkBuffers& Buffers = m_Buffers[kChunk];
+        Buffers.Vertices = new VertexBuffer(Streams, Surface.Positions.size());
+        Buffers.Indices  = new IndexBuffer(Surface.Indices.data(), Surface.Indices.size());
+    }
+}
+
+Matrix4x4 VolumeSurface::GetTransform() noexcept
+{
+    return DirectX::XMMatrixIdentity();
+}
+
+Volume& VolumeSurface::GetVolume() noexcept
+{
+    return *m_Volume;
+}
+
+size_t VolumeSurface::GetRemeshedChunkCount() const noexcept
+{
+    return m_Remeshed;
+}
+
+void VolumeSurface::Submit() const noexcept
+{
+    for (const auto&[kChunk, Buffers] : m_Buffers)
+    {
+        Buffers.Vertices->Bind();
+        Buffers.Indices->Bind();
+        Renderer3D::DrawIndexed(Buffers.Indices->GetCount());
+    }
+}
+
+
+// TERRAIN
+float    Terrain::s_MaxPixelError      = 2.0f;
+uint32_t Terrain::s_MaxPatches         = 512u;
+uint32_t Terrain::s_MaxResidentTiles   = 1024u;
+uint32_t Terrain::s_MaxUploadsPerFrame = 16u;
+
+Terrain::Terrain(const std::shared_ptr<IHeightSource>& Source, const TerrainSettings& Settings)
+    : IDrawableChild<Terrain>(), m_Settings(Settings)
+{
+    // Tiles are per node and per instance, only the pipeline state is shared
+    const uint64_t kID = GetTypeID<Terrain>();
+
+    m_Stream = std::make_unique<TerrainStream>(Source, Settings);
+
+    List<uint16_t> Indices = {};
+    for (uint32_t kStitch = 0u; kStitch < TerrainPatch::PatternCount; kStitch++)
+    {
+        TerrainLod::BuildPatternIndices(Source->GetPatchSize(), uint8_t(kStitch), Indices);
+        m_Patterns[kStitch] = new IndexBuffer(Indices);
+    }
+
+    const List<D3D11_INPUT_ELEMENT_DESC> InputElements =
+    {
+        { "POSITION", 0u, DXGI_FORMAT_R32G32B32_FLOAT, 0u, 0u, D3D11_INPUT_PER_VERTEX_DATA, 0u },
+        { "NORMAL",   0u, DXGI_FORMAT_R32G32B32_FLOAT, 1u, 0u, D3D11_INPUT_PER_VERTEX_DATA, 0u },
+    };
+
+    ID3DBlob* pBlob = EmplaceBindable<VertexShader>(kID, "Resources/Shaders/PhongShaderVS.hlsl")->GetBytecode();
+    EmplaceBindable<PixelShader>(kID, "Resources/Shaders/PhongShaderPS.hlsl");
+    EmplaceBindable<InputLayout>(kID, InputElements, pBlob);
+    EmplaceBindable<PrimitiveTopology>(kID, D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+    EmplaceBindable<TransformConstantBuffer>(kID, this);
+}
+
+Terrain::~Terrain() noexcept
+{
+    // The loader thread stops before the buffers go
+    m_Stream.reset();
+    for (IndexBuffer*& pPattern : m_Patterns)
+    {
+        delete pPattern;
+        pPattern = nullptr;
+    }
+    for (auto&[kNode, Tile] : m_Resident)
+    {
+        delete Tile.Vertices;
+    }
+}
+
+void Terrain::Update(float dt) noexcept
+{
+    m_Frame++;
 
-static Dictionary<uint64_t, const aiScene*> s_MeshStorage = {};
+    const DirectX::XMMATRIX ModelView = GetTransform() * Renderer3D::GetCameraView();
+    const DirectX::XMMATRIX Clip      = DirectX::XMMatrixTranspose(ModelView * Renderer3D::GetProjection());
 
-const aiScene* LoadSceneFromFile(const char* lpFilepath) noexcept
+    TerrainView View = {};
+    ExtractFrustumPlanes(Clip, View.Planes);
+    DirectX::XMStoreFloat3(reinterpret_cast<DirectX::XMFLOAT3*>(&View.CameraPosition), DirectX::XMMatrixInverse(nullptr, ModelView).r[3]);
+    View.PixelsPerUnit = DirectX::XMVectorGetY(Renderer3D::GetProjection().r[1]) * 0.5f * Renderer3D::GetViewportSize().Y;
+    View.MaxError      = s_MaxPixelError;
+    View.MaxPatches    = s_MaxPatches;
+
+    // Upload a few of the tiles that were built, the rest wait for the next frames
+    m_Stream->TakeLoaded(m_Arrived);
+    uint32_t kUploads = 0u;
+    size_t   kWaiting = 0u;
+    for (TerrainStream::LoadedTile& Loaded : m_Arrived)
+    {
+        if (m_Resident.count(Loaded.Node.GetKey()) != 0u)
+        {
+            continue;
+        }
+        if (kUploads == s_MaxUploadsPerFrame)
+        {
+            m_Arrived[kWaiting++] = std::move(Loaded);
+            continue;
+        }
+
+        const List<VertexStream> Streams =
+        {
+            { Loaded.Tile.Positions.data(), uint32_t(sizeof(Float3)) },
+            { Loaded.Tile.Normals.data(),   uint32_t(sizeof(Float3)) },
+        };
+        ResidentTile& Tile = m_Resident[Loaded.Node.GetKey()];
+        Tile.Vertices  = new VertexBuffer(Streams, Loaded.Tile.Positions.size());
+        Tile.LastFrame = m_Frame;
+        kUploads++;
+    }
+    m_Arrived.resize(kWaiting);
+
+    TerrainLod::Select(m_Stream->GetSource(), m_Settings, View, [&](uint64_t kNode) { return m_Resident.count(kNode) != 0u; }, m_Selected, m_Requests);
+
+    // What the selection draws is built first, then the children it would refine into. The last selection that had
+    // all its tiles is drawn until this one does, so the terrain never shows a hole while tiles are being built.
+    m_Missing.clear();
+    bool       bComplete = true;
+    const auto Need      = [&](const TerrainPatch& Node)
+    {
+        if (m_Resident.count(Node.GetKey()) != 0u)
+        {
+            return true;
+        }
+        if (std::none_of(m_Arrived.begin(), m_Arrived.end(), [&](const TerrainStream::LoadedTile& Loaded) { return Loaded.Node.GetKey() == Node.GetKey(); }))
+        {
+            m_Missing.push_back(Node);
+        }
+        return false;
+    };
+    for (const TerrainPatch& Patch : m_Selected)
+    {
+        bComplete = Need(Patch) && bComplete;
+    }
+    for (const TerrainPatch& Request : m_Requests)
+    {
+        Need(Request);
+    }
+    m_Stream->Request(m_Missing);
+
+    if (bComplete)
+    {
+        std::swap(m_Patches, m_Selected);
+    }
+    for (const TerrainPatch& Patch : m_Patches)
+    {
+        m_Resident[Patch.GetKey()].LastFrame = m_Frame;
+    }
+
+    if (m_Resident.size() <= s_MaxResidentTiles)
+    {
+        return;
+    }
+
+    // Least recently used first, never a tile drawn this frame
+    List<std::pair<uint64_t, uint64_t>> Candidates = {};
+    for (const auto&[kNode, Tile] : m_Resident)
+    {
+        if (Tile.LastFrame != m_Frame)
+        {
+            Candidates.emplace_back(Tile.LastFrame, kNode);
+        }
+    }
+    std::sort(Candidates.begin(), Candidates.end());
+    for (size_t k = 0u; k < Candidates.size() && m_Resident.size() > s_MaxResidentTiles; k++)
+    {
+        delete m_Resident[Candidates[k].second].Vertices;
+        m_Resident.erase(Candidates[k].second);
+    }
+}
+
+Matrix4x4 Terrain::GetTransform() noexcept
+{
+    return DirectX::XMMatrixIdentity();
+}
+
+size_t Terrain::GetPatchCount() const noexcept
 {
-    static Assimp::Importer Imp;
+    return m_Patches.size();
+}
 
-    if (!std::filesystem::exists(lpFilepath))
+size_t Terrain::GetResidentCount() const noexcept
+{
+    return m_Resident.size();
+}
+
+void Terrain::Submit() const noexcept
+{
+    for (const TerrainPatch& Patch : m_Patches)
     {
-        GfxError(false, "FileNotFoundException: '%s'", lpFilepath);
-        return nullptr;
+        IndexBuffer* const pPattern = m_Patterns[Patch.Stitch];
+        m_Resident.at(Patch.GetKey()).Vertices->Bind();
+        pPattern->Bind();
+        Renderer3D::DrawIndexed(pPattern->GetCount());
     }
+}
+
+// A .mesh file itself, or the .mesh Bake wrote beside any other source unless the source has changed since
+String GetMeshReadPath(const char* lpFilepath) noexcept
+{
+    if (std::filesystem::path(lpFilepath).extension() == ".mesh")
+    {
+        return lpFilepath;
+    }
+    return GetBakedReadPath(lpFilepath, ".mesh");
+}
+
+template<typename Tp>
+uint64_t GetGeometryKey(const char* lpFilepath, float Scale) noexcept
+{
+    // Normalized so "./Resources/x.obj" and "Resources/x.obj" share buffers, the type keeps vertex layouts apart
+    String Key = std::filesystem::path(lpFilepath).lexically_normal().generic_string();
+
+    const uint32_t kTypeID = GetTypeID<Tp>();
+    Key.append(reinterpret_cast<const char*>(&kTypeID), sizeof(kTypeID));
+    Key.append(reinterpret_cast<const char*>(&Scale), sizeof(Scale));
+    return HashBytes(Key.data(), Key.size());
+}
+
+static uint64_t GetSubdivisionKey(const SubdivisionOptions& Options) noexcept
+{
+    if (Options.Levels == 0u)
+    {
+        return 0u;
+    }
+
+    // Field by field, the padding between them is not guaranteed to be zero
+    String Key = {};
+    Key.append(reinterpret_cast<const char*>(&Options.Levels), sizeof(Options.Levels));
+    Key.append(reinterpret_cast<const char*>(&Options.Scheme), sizeof(Options.Scheme));
+    Key.append(reinterpret_cast<const char*>(&Options.MaxTriangles), sizeof(Options.MaxTriangles));
+    if (Options.bAdaptive)
+    {
+        Key.append(reinterpret_cast<const char*>(&Options.CurvatureAngle), sizeof(Options.CurvatureAngle));
+        Key.push_back(Options.bSilhouettes ? 's' : 'c');
+        Key.append(reinterpret_cast<const char*>(&Options.ViewPosition), sizeof(Options.ViewPosition));
+    }
+    return HashBytes(Key.data(), Key.size());
+}
+
+// Frustum planes in object space (Gribb & Hartmann), rows of the transposed model-view-projection
+void ExtractFrustumPlanes(const DirectX::XMMATRIX& Clip, Float4 Planes[6]) noexcept
+{
+    DirectX::XMStoreFloat4(reinterpret_cast<DirectX::XMFLOAT4*>(&Planes[0]), DirectX::XMVectorAdd(Clip.r[3], Clip.r[0]));
+    DirectX::XMStoreFloat4(reinterpret_cast<DirectX::XMFLOAT4*>(&Planes[1]), DirectX::XMVectorSubtract(Clip.r[3], Clip.r[0]));
+    DirectX::XMStoreFloat4(reinterpret_cast<DirectX::XMFLOAT4*>(&Planes[2]), DirectX::XMVectorAdd(Clip.r[3], Clip.r[1]));
+    DirectX::XMStoreFloat4(reinterpret_cast<DirectX::XMFLOAT4*>(&Planes[3]), DirectX::XMVectorSubtract(Clip.r[3], Clip.r[1]));
+    DirectX::XMStoreFloat4(reinterpret_cast<DirectX::XMFLOAT4*>(&Planes[4]), Clip.r[2]);
+    DirectX::XMStoreFloat4(reinterpret_cast<DirectX::XMFLOAT4*>(&Planes[5]), DirectX::XMVectorSubtract(Clip.r[3], Clip.r[2]));
+}
+
+// IMPORT CACHE
+// Converted import data is only needed until the GPU buffers exist. Recently used files stay around for re-instancing
+// within a budget, the Assimp scenes themselves are freed as soon as they are converted.
+static constexpr size_t s_ImportCacheBudget = size_t(64u) << 20u;
+
+static AssetCache<const ObjModel> s_ObjCache   = AssetCache<const ObjModel>(s_ImportCacheBudget / 2u);
+static AssetCache<const Scene>    s_SceneCache = AssetCache<const Scene>(s_ImportCacheBudget / 2u);
+static ImportStatistics           s_ImportStatistics = {};
+static std::mutex                 s_ImportMutex      = {}; // Imports run on the asset stream's workers
+
+static size_t GetByteSize(const ObjModel& Model) noexcept
+{
+    size_t kBytes = 0u;
+    for (const ObjMaterial& Material : Model.Materials)
+    {
+        kBytes += Material.Name.capacity();
+    }
+    kBytes += Model.Vertices.capacity()  * sizeof(MeshVertex);
+    kBytes += Model.Indices.capacity()   * sizeof(uint32_t);
+    kBytes += Model.Submeshes.capacity() * sizeof(ObjSubmesh);
+    kBytes += Model.Materials.capacity() * sizeof(ObjMaterial);
+    return kBytes;
+}
+
+static void RecordImport(size_t kImporterBytes, size_t kConvertedBytes) noexcept
+{
+    const size_t kResidentBytes = s_ObjCache.GetResidentBytes() + s_SceneCache.GetResidentBytes();
+
+    s_ImportStatistics.Imports++;
+    s_ImportStatistics.LastImportBytes = kImporterBytes;
+    s_ImportStatistics.PeakBytes       = std::max(s_ImportStatistics.PeakBytes, kResidentBytes + kImporterBytes + kConvertedBytes);
+}
+
+void RecordOptimization(const MeshOptimizationReport& Report) noexcept
+{
+    std::lock_guard<std::mutex> Lock = std::lock_guard<std::mutex>(s_ImportMutex);
+    s_ImportStatistics.LastOptimization = Report;
+}
+
+static void RecordCacheState() noexcept
+{
+    s_ImportStatistics.ResidentBytes = s_ObjCache.GetResidentBytes() + s_SceneCache.GetResidentBytes();
+    s_ImportStatistics.Evictions     = s_ObjCache.GetEvictions() + s_SceneCache.GetEvictions();
+}
+
+ImportStatistics GetImportStatistics() noexcept
+{
+    std::lock_guard<std::mutex> Lock = std::lock_guard<std::mutex>(s_ImportMutex);
+    return s_ImportStatistics;
+}
+
+// Two loads of the same file at once both import it, the caches are only locked around lookups and inserts
+// Failures are returned in Error rather than raised, imports run on the asset stream's workers
+std::shared_ptr<const ObjModel> LoadObjModelFromFile(const char* lpFilepath, String& Error, const MappedFile* pFile) noexcept
+{
     const uint64_t kHash = HashBytes(lpFilepath, strlen(lpFilepath));
-    
-    if (auto it = s_MeshStorage.find(kHash); it != s_MeshStorage.end())
+
     {
-        return it->second;
+        std::lock_guard<std::mutex> Lock = std::lock_guard<std::mutex>(s_ImportMutex);
+        if (std::shared_ptr<const ObjModel> pModel = s_ObjCache.Find(kHash))
+        {
+            return pModel;
+        }
     }
-    else
+
+    // A file the asset stream already mapped is parsed where it is
+    std::shared_ptr<ObjModel> pModel = std::make_shared<ObjModel>();
+    const bool bLoaded = pFile != nullptr && pFile->IsOpen() ?
+        ObjLoader::LoadFromMemory(reinterpret_cast<const char*>(pFile->GetData()), pFile->GetSize(), *pModel, std::filesystem::path(lpFilepath).parent_path()) :
+        ObjLoader::LoadFromFile(lpFilepath, *pModel);
+    if (!bLoaded)
     {
-        const aiScene* pScene = Imp.ReadFile(lpFilepath, aiProcess_Triangulate | aiProcess_JoinIdenticalVertices);
-        return (s_MeshStorage[kHash] = pScene);
+        // Not cached, so the next load of the file tries again. Whatever was parsed before the error is dropped.
+        Error = "Failed to load OBJ model: '" + String(lpFilepath) + "'";
+        return std::make_shared<const ObjModel>();
     }
+
+    // The OBJ loader works on a mapped file, the converted model is its whole heap footprint
+    const size_t kBytes = GetByteSize(*pModel);
+    std::lock_guard<std::mutex> Lock = std::lock_guard<std::mutex>(s_ImportMutex);
+    RecordImport(0u, kBytes);
+    s_ObjCache.Insert(kHash, pModel, kBytes);
+    RecordCacheState();
+    return pModel;
+}
+
+std::shared_ptr<const Scene> LoadModelSceneFromFile(const char* lpFilepath, String& Error) noexcept
+{
+    const uint64_t kHash = HashBytes(lpFilepath, strlen(lpFilepath));
+
+    {
+        std::lock_guard<std::mutex> Lock = std::lock_guard<std::mutex>(s_ImportMutex);
+        if (std::shared_ptr<const Scene> pScene = s_SceneCache.Find(kHash))
+        {
+            return pScene;
+        }
+    }
+
+    if (!FileExists(lpFilepath))
+    {
+        Error = "FileNotFoundException: '" + String(lpFilepath) + "'";
+        return std::make_shared<const Scene>();
+    }
+
+    size_t kImporterBytes = 0u;
+    std::shared_ptr<Scene> pScene = std::make_shared<Scene>();
+    if (!SceneImporter::LoadFromFile(lpFilepath, *pScene, 1.0f, &kImporterBytes))
+    {
+        // Not cached, so the next load of the file tries again
+        Error = "Failed to import scene: '" + String(lpFilepath) + "'";
+        return std::make_shared<const Scene>();
+    }
+
+    const size_t kBytes = SceneImporter::GetByteSize(*pScene);
+    std::lock_guard<std::mutex> Lock = std::lock_guard<std::mutex>(s_ImportMutex);
+    RecordImport(kImporterBytes, kBytes);
+    s_SceneCache.Insert(kHash, pScene, kBytes);
+    RecordCacheState();
+    return pScene;
+}
+
+// The file changed, its converted data is dropped so the next load imports it again
+void InvalidateImport(const char* lpFilepath) noexcept
+{
+    const uint64_t kHash = HashBytes(lpFilepath, strlen(lpFilepath));
+
+    std::lock_guard<std::mutex> Lock = std::lock_guard<std::mutex>(s_ImportMutex);
+    s_ObjCache.Erase(kHash);
+    s_SceneCache.Erase(kHash);
+    RecordCacheState();
 }
@@ -1,7 +1,17 @@
 #pragma once
 
 #include "Base.h"
+#include "AssetCache.h"
 #include "Bindable.h"
+#include "Bvh.h"
+#include "MeshOptimizer.h"
+#include "Meshlet.h"
+#include "PointCloud.h"
+#include "Scene.h"
+#include "Simplifier.h"
+#include "Subdivision.h"
+#include "Terrain.h"
+#include "Volume.h"
 
 // DRAWABLE
 class IDrawable
@@ -12,13 +22,22 @@ public:
 
 	virtual Matrix4x4 GetTransform() noexcept = 0;
 	virtual void      Update(float dt) noexcept = 0;
+	// Model space triangles for ray queries, nullptr for drawables that cannot be picked
+	virtual const TriangleBvh* GetBvh() const noexcept;
 
 	void Draw() const noexcept;
 	
 protected:
-	void EmplaceIndexBuffer(uint32_t kDrawableID, const List<uint16_t>& Indices) noexcept;
+	// Issues the draw call once every bindable is bound, the default draws the whole index buffer
+	virtual void Submit() const noexcept;
+
+	void EmplaceIndexBuffer(uint64_t kDrawableID, const List<uint16_t>& Indices, const List<IndexChunk>& Chunks = {}) noexcept;
+	void EmplaceIndexBuffer(uint64_t kDrawableID, const List<uint32_t>& Indices) noexcept;
 	template<typename B, typename... TArgs>
-	B*   EmplaceBindable(uint32_t kDrawableID, TArgs&&... Args) noexcept;
+	B*   EmplaceBindable(uint64_t kDrawableID, TArgs&&... Args) noexcept;
+
+	// Draws part of the index buffer, going through its 16-bit chunks if it was split
+	void DrawRange(uint32_t kIndexCount, uint32_t kStartIndex) const noexcept;
 
 protected:
 	IndexBuffer*     m_IndexBuffer = nullptr;
@@ -47,9 +66,9 @@ protected:
 		const List<D3D11_INPUT_ELEMENT_DESC>& InputElements
 	);
 
-	void EmplaceSharedIndexBuffer(uint32_t kDrawableID, const List<uint16_t>& Indices) noexcept;
+	void EmplaceSharedIndexBuffer(uint64_t kDrawableID, const List<uint16_t>& Indices) noexcept;
 	template<typename B, typename... TArgs>
-	B*   EmplaceSharedBindable(uint32_t kDrawableID, TArgs&&... Args) noexcept;
+	B*   EmplaceSharedBindable(uint64_t kDrawableID, TArgs&&... Args) noexcept;
 
 protected:
 	Float3 m_Radius = {};
@@ -98,13 +117,113 @@ public:
 	virtual ~Surface() noexcept = default;
 };
 
+// Data derived once from a mesh's vertices and indices, shared by every instance drawing the same buffers
+struct MeshGeometry
+{
+	BoundingSphere Bounds   = {};
+	List<MeshLod>  Lods     = {};
+	List<Meshlet>  Meshlets = {}; // LOD 0 only, coarser levels are cheap enough to draw whole
+	TriangleBvh    Bvh      = {}; // LOD 0 as well
+};
+
 class Mesh : public IDrawableChild<Mesh>
 {
 public:
-	Mesh(const char* lpFilepath, float Scale);
+	// With Smoothing.Levels set the import is subdivided before LODs and meshlets are built from it
+	Mesh(const char* lpFilepath, float Scale, const SubdivisionOptions& Smoothing = {});
 	virtual ~Mesh() noexcept = default;
+
+	virtual void Update(float dt) noexcept override;
+	virtual const TriangleBvh* GetBvh() const noexcept override;
+
+	uint32_t GetLodLevel() const noexcept;
+	// False until the file is imported and uploaded on the asset stream, the mesh draws nothing before
+	bool     IsLoaded() const noexcept;
+
+	// Imports a changed file again, for every set of options it is loaded with, and swaps the new geometry and
+	// buffers in under the instances already drawing it. Returns how many loads were queued.
+	static uint32_t Reload(const char* lpFilepath) noexcept;
+	// Counts geometry uploads, the shapes and bounds behind GetBvh() change with it
+	static uint32_t GetGeometryVersion() noexcept;
+
+public:
+	static float s_LodErrorThreshold; // Largest projected simplification error allowed, in pixels
+
+protected:
+	virtual void Submit() const noexcept override;
+
+private:
+	void CreateBindables() noexcept;
+
+private:
+	const MeshGeometry*               m_Geometry     = nullptr;
+	uint64_t                          m_GeometryID   = 0u;
+	List<std::shared_ptr<IAssetLoad>> m_PendingLoads = {}; // Geometry and shaders, empty once loaded
+	uint32_t                          m_LodLevel     = 0u;
+	List<IndexRange>                  m_DrawRanges   = {};
+};
+
+class ModelLoad;
+
+// Every part of an imported file, drawn by walking the flattened node arrays. Files with animation or blend shapes are
+// deformed on the CPU into a dynamic vertex buffer per instance.
+class Model : public IDrawableChild<Model>
+{
+public:
+	Model(const char* lpFilepath, float Scale);
+	virtual ~Model() noexcept = default;
+
+	virtual void Update(float dt) noexcept override;
+
+	bool IsAnimated() const noexcept;
+	// False until the file is imported on the asset stream, the model draws nothing before
+	bool IsLoaded() const noexcept;
+
+	// Skins every model animated since the last call in one multithreaded batch and uploads the results.
+	// Call between updating and drawing.
+	static void                      SkinPending() noexcept;
+	static const SkinningStatistics& GetSkinningStatistics() noexcept;
+	static uint32_t                  GetMorphedVertexCount() noexcept;
+
+public:
+	static float s_AnimationBlend; // Weight of the second clip when a file has more than one
+
+protected:
+	virtual void Submit() const noexcept override;
+
+private:
+	void CreateBindables() noexcept;
+	bool IsSkinned() const noexcept;
+
+private:
+	std::shared_ptr<ModelLoad>        m_Load           = nullptr; // Until the scene is in
+	List<std::shared_ptr<IAssetLoad>> m_PendingShaders = {};
+	uint64_t                          m_GeometryID     = 0u;
+	std::shared_ptr<const Scene>      m_Scene          = nullptr;
+	TransformConstantBuffer*          m_Transform      = nullptr;
+	float                             m_Scale          = 1.0f;
+	Matrix4x4                         m_ModelTransform = DirectX::XMMatrixIdentity();
+
+	// Animation, only for files with clips or morph targets
+	VertexBuffer*    m_DynamicBuffer      = nullptr;
+	List<MeshVertex> m_SkinnedVertices    = {};
+	List<JointPose>  m_RestPose           = {};
+	List<JointPose>  m_Poses              = {};
+	List<JointPose>  m_BlendScratch       = {};
+	List<Float4x4>   m_ModelMatrices      = {};
+	List<Float4x4>   m_Palette            = {};
+	float            m_AnimationTime      = 0.0f;
+
+	List<MeshVertex> m_MorphedVertices    = {};
+	List<float>      m_RestMorphWeights   = {};
+	List<float>      m_MorphWeights       = {};
+	List<float>      m_MorphWeightScratch = {};
+	List<uint32_t>   m_ActiveMorphTargets = {};
 };
 
+// Importer memory across every Mesh and Model load
+ImportStatistics GetImportStatistics() noexcept;
+
 class SolidSphere : public IDrawableChild<SolidSphere>
 {
 public:
@@ -112,9 +231,124 @@ public:
 	virtual ~SolidSphere() noexcept = default;
 };
 
+// Out-of-core point cloud from a file PointCloudBuilder wrote. Every update picks octree nodes by projected point
+// spacing within the point budget, nodes that are not resident are read on the stream's thread and uploaded as they
+// arrive, and the nodes unused the longest are evicted once over the resident budget.
+class PointCloud : public IDrawableChild<PointCloud>
+{
+public:
+	PointCloud(const char* lpFilepath);
+	virtual ~PointCloud() noexcept;
+
+	virtual void      Update(float dt) noexcept override;
+	virtual Matrix4x4 GetTransform() noexcept override;
+
+	bool     IsOpen() const noexcept;
+	uint64_t GetResidentPointCount() const noexcept;
+
+public:
+	static float    s_MaxPointSpacing;     // Pixels between points beyond which a node is refined
+	static uint64_t s_PointBudget;         // Drawn per cloud and frame
+	static uint64_t s_ResidentPointBudget; // Kept in vertex buffers per cloud
+	static uint32_t s_MaxUploadsPerFrame;
+
+protected:
+	virtual void Submit() const noexcept override;
+
+private:
+	struct ResidentNode
+	{
+		VertexBuffer* Points    = nullptr;
+		uint32_t      Count     = 0u;
+		uint64_t      LastFrame = 0u;
+	};
+
+	std::unique_ptr<PointCloudStream>  m_Stream         = nullptr;
+	Dictionary<uint32_t, ResidentNode> m_Resident       = {};
+	List<PointCloudStream::LoadedNode> m_Arrived        = {}; // Read but not uploaded yet
+	List<uint32_t>                     m_Selected       = {};
+	List<uint32_t>                     m_Missing        = {};
+	List<uint32_t>                     m_Drawn          = {};
+	uint64_t                           m_Frame          = 0u;
+	uint64_t                           m_ResidentPoints = 0u;
+};
+
+// Isosurface of a chunked volume. Every chunk has its own buffers, so an edit re-meshes and uploads only the chunks
+// it touched, on the next update.
+class VolumeSurface : public IDrawableChild<VolumeSurface>
+{
+public:
+	VolumeSurface(const std::shared_ptr<Volume>& Field, float IsoValue = 0.0f);
+	virtual ~VolumeSurface() noexcept;
+
+	virtual void      Update(float dt) noexcept override;
+	virtual Matrix4x4 GetTransform() noexcept override;
+
+	Volume& GetVolume() noexcept;
+	size_t  GetRemeshedChunkCount() const noexcept; // In the last update
+
+protected:
+	virtual void Submit() const noexcept override;
+
+private:
+	struct ChunkBuffers
+	{
+		VertexBuffer* Vertices = nullptr;
+		IndexBuffer*  Indices  = nullptr;
+	};
+
+	std::shared_ptr<Volume>            m_Volume   = nullptr;
+	float                              m_IsoValue = 0.0f;
+	Dictionary<uint64_t, ChunkSurface> m_Surfaces = {};
+	Dictionary<uint64_t, ChunkBuffers> m_Buffers  = {};
+	size_t                             m_Remeshed = 0u;
+};
+
+
+// Heightfield drawn as equal sized patches from a quadtree. Patch vertices are built from height tiles as nodes come
+// into view and dropped least recently used first, every patch shares one of sixteen index buffers.
+class Terrain : public IDrawableChild<Terrain>
+{
+public:
+	Terrain(const std::shared_ptr<IHeightSource>& Source, const TerrainSettings& Settings = {});
+	virtual ~Terrain() noexcept;
+
+	virtual void      Update(float dt) noexcept override;
+	virtual Matrix4x4 GetTransform() noexcept override;
+
+	size_t GetPatchCount() const noexcept;    // Drawn in the last update
+	size_t GetResidentCount() const noexcept;
+
+public:
+	static float    s_MaxPixelError;      // Pixels of height error beyond which a patch is refined
+	static uint32_t s_MaxPatches;         // Drawn per terrain and frame
+	static uint32_t s_MaxResidentTiles;   // Kept in vertex buffers per terrain
+	static uint32_t s_MaxUploadsPerFrame; // Built tiles turned into vertex buffers a frame
+
+protected:
+	virtual void Submit() const noexcept override;
+
+private:
+	struct ResidentTile
+	{
+		VertexBuffer* Vertices  = nullptr;
+		uint64_t      LastFrame = 0u;
+	};
+
+	std::unique_ptr<TerrainStream>     m_Stream   = nullptr;
+	TerrainSettings                    m_Settings = {};
+	IndexBuffer*                       m_Patterns[TerrainPatch::PatternCount] = {};
+	Dictionary<uint64_t, ResidentTile> m_Resident = {};
+	List<TerrainStream::LoadedTile>    m_Arrived  = {}; // Built but not uploaded yet
+	List<TerrainPatch>                 m_Patches  = {}; // The last selection with every tile resident
+	List<TerrainPatch>                 m_Selected = {};
+	List<TerrainPatch>                 m_Requests = {};
+	List<TerrainPatch>                 m_Missing  = {};
+	uint64_t                           m_Frame    = 0u;
+};
 
 template<typename B, typename... TArgs>
-B* IDrawable::EmplaceBindable(uint32_t kDrawableID, TArgs&&... Args) noexcept
+B* IDrawable::EmplaceBindable(uint64_t kDrawableID, TArgs&&... Args) noexcept
 {
 	// static_assert(std::is_base_of_v<IBindable, B>, "type is not a child of 'IBindable'");
 	// TODO: Messy (but efficient?)
@@ -194,7 +428,7 @@ inline IDrawableChild<Tp>::IDrawableChild(const List<V>& Vertices, const List<ui
 }
 
 template<typename Tp>
-inline void IDrawableChild<Tp>::EmplaceSharedIndexBuffer(uint32_t kDrawableID, const List<uint16_t>& Indices) noexcept
+inline void IDrawableChild<Tp>::EmplaceSharedIndexBuffer(uint64_t kDrawableID, const List<uint16_t>& Indices) noexcept
 {
 	assert(m_SharedIndexBuffer == nullptr && "Shared index buffer is already set");
 	m_SharedIndexBuffer = Renderer3D::GetIndexBuffer(kDrawableID, Indices);
@@ -203,7 +437,7 @@ inline void IDrawableChild<Tp>::EmplaceSharedIndexBuffer(uint32_t kDrawableID, c
 
 template<typename Tp>
 template<typename B, typename ...TArgs>
-inline B* IDrawableChild<Tp>::EmplaceSharedBindable(uint32_t kDrawableID, TArgs && ...Args) noexcept
+inline B* IDrawableChild<Tp>::EmplaceSharedBindable(uint64_t kDrawableID, TArgs && ...Args) noexcept
 {
 	assert(typeid(B) != typeid(IndexBuffer) && "MUST use EmplaceSharedIndexBuffer() to add an index buffer to a drawable");
 	return (B*)m_SharedBindables.emplace_back(new B(std::forward<TArgs>(Args)...));
@@ -0,0 +1,229 @@
+#include "File.h"
+#include "Archive.h"
+
+#ifdef _WIN32
+  #define WIN32_LEAN_AND_MEAN
+  #define NOMINMAX
+  #include <Windows.h>
+#else
+  #include <fcntl.h>
+  #include <sys/mman.h>
+  #include <sys/stat.h>
+  #include <unistd.h>
+#endif // _WIN32
+
+// MAPPED FILE
+MappedFile::MappedFile(const char* lpFilepath)
+{
+    // Nothing is opened for what the mounted archive has
+    const Archive* pArchive = Archive::GetMounted();
+    if (const ArchiveEntry* pEntry = pArchive != nullptr ? pArchive->FindFile(lpFilepath) : nullptr)
+    {
+        pArchive->Read(*pEntry, *this);
+        return;
+    }
+    Map(lpFilepath, true);
+}
+
+void MappedFile::Map(const char* lpFilepath, bool bSequential) noexcept
+{
+    Close();
+#ifdef _WIN32
+    HANDLE hFile = CreateFileA(lpFilepath, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, bSequential ? FILE_FLAG_SEQUENTIAL_SCAN : 0u, NULL);
+    if (hFile == INVALID_HANDLE_VALUE)
+    {
+        return;
+    }
+
+    LARGE_INTEGER kFileSize = {};
+    if (!GetFileSizeEx(hFile, &kFileSize))
+    {
+        CloseHandle(hFile);
+        return;
+    }
+
+    m_File = reinterpret_cast<intptr_t>(hFile);
+    m_Size = size_t(kFileSize.QuadPart);
+    if (m_Size == 0u)
+    {
+        return;
+    }
+
+    HANDLE hMapping = CreateFileMappingA(hFile, NULL, PAGE_READONLY, 0u, 0u, NULL);
+    if (hMapping == NULL)
+    {
+        Close();
+        return;
+    }
+    m_Mapping = hMapping;
+    m_Data    = static_cast<const uint8_t*>(MapViewOfFile(hMapping, FILE_MAP_READ, 0u, 0u, 0u));
+    if (m_Data == nullptr)
+    {
+        Close();
+    }
+#else
+    const int32_t kFile = open(lpFilepath, O_RDONLY);
+    if (kFile < 0)
+    {
+        return;
+    }
+
+    struct stat Stat = {};
+    if (fstat(kFile, &Stat) != 0)
+    {
+        close(kFile);
+        return;
+    }
+
+    m_File = intptr_t(kFile);
+    m_Size = size_t(Stat.st_size);
+    if (m_Size == 0u)
+    {
+        return;
+    }
+
+    void* pData = mmap(nullptr, m_Size, PROT_READ, MAP_PRIVATE, kFile, 0);
+    if (pData == MAP_FAILED)
+    {
+        Close();
+        return;
+    }
+    madvise(pData, m_Size, bSequential ? MADV_SEQUENTIAL : MADV_NORMAL);
+    m_Data = static_cast<const uint8_t*>(pData);
+#endif // _WIN32
+}
+
+MappedFile::MappedFile(List<uint8_t>&& Bytes) noexcept
+    : m_Buffer(std::move(Bytes)), m_bInMemory(true)
+{
+    m_Data = m_Buffer.data();
+    m_Size = m_Buffer.size();
+}
+
+MappedFile::~MappedFile() noexcept
+{
+    Close();
+}
+
+MappedFile::MappedFile(MappedFile&& Other) noexcept
+    : m_Data(Other.m_Data), m_Size(Other.m_Size), m_File(Other.m_File), m_Mapping(Other.m_Mapping), m_Buffer(std::move(Other.m_Buffer)),
+      m_bInMemory(Other.m_bInMemory)
+{
+    Other.m_Data      = nullptr;
+    Other.m_Size      = 0u;
+    Other.m_File      = -1;
+    Other.m_Mapping   = nullptr;
+    Other.m_bInMemory = false;
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& Other) noexcept
+{
+    if (this != &Other)
+    {
+        Close();
+        std::swap(m_Data,      Other.m_Data);
+        std::swap(m_Size,      Other.m_Size);
+        std::swap(m_File,      Other.m_File);
+        std::swap(m_Mapping,   Other.m_Mapping);
+        std::swap(m_Buffer,    Other.m_Buffer);
+        std::swap(m_bInMemory, Other.m_bInMemory);
+    }
+    return *this;
+}
+
+bool MappedFile::IsOpen() const noexcept
+{
+    return m_File != -1 || m_bInMemory;
+}
+
+const uint8_t* MappedFile::GetData() const noexcept
+{
+    return m_Data;
+}
+
+size_t MappedFile::GetSize() const noexcept
+{
+    return m_Size;
+}
+
+void MappedFile::Close() noexcept
+{
+#ifdef _WIN32
+    if (m_Mapping != nullptr && m_Data != nullptr)
+    {
+        UnmapViewOfFile(m_Data);
+    }
+    if (m_Mapping != nullptr)
+    {
+        CloseHandle(static_cast<HANDLE>(m_Mapping));
+    }
+    if (m_File != -1)
+    {
+        CloseHandle(reinterpret_cast<HANDLE>(m_File));
+    }
+#else
+    if (m_File != -1 && m_Data != nullptr)
+    {
+        munmap(const_cast<uint8_t*>(m_Data), m_Size);
+    }
+    if (m_File != -1)
+    {
+        close(int32_t(m_File));
+    }
+#endif // _WIN32
+
+    m_Data      = nullptr;
+    m_Size      = 0u;
+    m_File      = -1;
+    m_Mapping   = nullptr;
+    m_bInMemory = false;
+    m_Buffer.clear();
+}
+
+// FILES
+bool SaveFile(const char* lpFilepath, const void* pData, size_t kSize) noexcept
+{
+    const String Temporary = String(lpFilepath) + ".tmp";
+    FILE* pFile = fopen(Temporary.c_str(), "wb");
+    if (!pFile)
+    {
+        return false;
+    }
+    const bool bWritten = fwrite(pData, 1u, kSize, pFile) == kSize;
+    if (fclose(pFile) != 0 || !bWritten)
+    {
+        remove(Temporary.c_str());
+        return false;
+    }
+
+    std::error_code Error = {};
+    std::filesystem::rename(Temporary, lpFilepath, Error);
+    return !Error;
+}
+
+bool FileExists(const char* lpFilepath) noexcept
+{
+    const Archive*  pArchive = Archive::GetMounted();
+    std::error_code Error    = {};
+    return (pArchive != nullptr && pArchive->FindFile(lpFilepath) != nullptr) || std::filesystem::is_regular_file(lpFilepath, Error);
+}
+
+String GetBakedReadPath(const char* lpFilepath, const char* lpExtension) noexcept
+{
+    const String   Baked    = String(lpFilepath) + lpExtension;
+    const Archive* pArchive = Archive::GetMounted();
+    if (pArchive != nullptr && pArchive->FindFile(Baked.c_str()) != nullptr)
+    {
+        return Baked;
+    }
+    if (pArchive != nullptr && pArchive->FindFile(lpFilepath) != nullptr)
+    {
+        return String(lpFilepath);
+    }
+
+    std::error_code SourceError = {};
+    std::error_code BakedError  = {};
+    const auto      kSource     = std::filesystem::last_write_time(lpFilepath, SourceError);
+    const auto      kBaked      = std::filesystem::last_write_time(Baked, BakedError);
+    return !SourceError && !BakedError && kBaked >= kSource ? Baked : String(lpFilepath);
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include "Core.h"
+
+// Read-only view of a whole file mapped into the address space, or of its entry in the mounted archive.
+class MappedFile
+{
+public:
+	MappedFile() = default;
+	MappedFile(const char* lpFilepath);
+	// Bytes that were read rather than mapped, for code that takes either
+	explicit MappedFile(List<uint8_t>&& Bytes) noexcept;
+	~MappedFile() noexcept;
+
+	MappedFile(MappedFile&& Other) noexcept;
+	MappedFile& operator=(MappedFile&& Other) noexcept;
+
+	bool           IsOpen() const noexcept;
+	const uint8_t* GetData() const noexcept;
+	size_t         GetSize() const noexcept;
+
+	void           Close() noexcept;
+
+private:
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	// The file on the disk, whether an archive has it or not
+	void Map(const char* lpFilepath, bool bSequential) noexcept;
+
+private:
+	friend class Archive;
+
+	const uint8_t* m_Data      = nullptr;
+	size_t         m_Size      = 0u;
+	intptr_t       m_File      = -1;
+	void*          m_Mapping   = nullptr;
+	List<uint8_t>  m_Buffer    = {};    // Decompressed archive entry, or the bytes that were read
+	bool           m_bInMemory = false; // Not a mapping of its own: an archive's entry or m_Buffer
+};
+
+// Writes through a temporary beside the file, so a crash never leaves a truncated one behind
+bool   SaveFile(const char* lpFilepath, const void* pData, size_t kSize) noexcept;
+
+// In the mounted archive or on the disk
+bool   FileExists(const char* lpFilepath) noexcept;
+
+// Baked assets sit beside their source with an extension appended, e.g. "Sphere.obj.mesh". Returns the baked file
+// when it exists and is at least as new as the source, the source otherwise. An archive is packed with the files that
+// were current, whichever of the two it has is taken as it is.
+String GetBakedReadPath(const char* lpFilepath, const char* lpExtension) noexcept;
@@ -0,0 +1,223 @@
+#include "FileWatcher.h"
+
+#ifdef _WIN32
+  #define WIN32_LEAN_AND_MEAN
+  #define NOMINMAX
+  #include <Windows.h>
+#else
+  #include <sys/inotify.h>
+  #include <unistd.h>
+#endif // _WIN32
+
+// FILE WATCHER
+#ifdef _WIN32
+static constexpr DWORD  s_NotifyFilter = FILE_NOTIFY_CHANGE_FILE_NAME | FILE_NOTIFY_CHANGE_LAST_WRITE;
+static constexpr size_t s_BufferSize  = size_t(64u) << 10u; // Largest a network share accepts
+
+static bool IssueRead(HANDLE hDirectory, OVERLAPPED* pOverlapped, List<uint32_t>& Buffer) noexcept
+{
+    return ReadDirectoryChangesW(hDirectory, Buffer.data(), DWORD(Buffer.size() * sizeof(uint32_t)), TRUE, s_NotifyFilter, nullptr, pOverlapped, nullptr) != FALSE;
+}
+#else
+static constexpr uint32_t s_FileEvents      = IN_CLOSE_WRITE | IN_MOVED_TO;
+static constexpr uint32_t s_DirectoryEvents = IN_CREATE | IN_MOVED_TO;
+#endif // _WIN32
+
+FileWatcher::FileWatcher(const char* lpDirectory, uint32_t kSettleMilliseconds)
+    : m_Directory(std::filesystem::path(lpDirectory).lexically_normal()), m_SettleTime(std::chrono::milliseconds(kSettleMilliseconds))
+{
+#ifdef _WIN32
+    HANDLE hDirectory = CreateFileA(lpDirectory, FILE_LIST_DIRECTORY, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, NULL, OPEN_EXISTING,
+                                    FILE_FLAG_BACKUP_SEMANTICS | FILE_FLAG_OVERLAPPED, NULL);
+    if (hDirectory == INVALID_HANDLE_VALUE)
+    {
+        return;
+    }
+
+    OVERLAPPED* pOverlapped = new OVERLAPPED();
+    pOverlapped->hEvent = CreateEventA(NULL, TRUE, FALSE, NULL);
+    m_Buffer.resize(s_BufferSize / sizeof(uint32_t));
+    if (!IssueRead(hDirectory, pOverlapped, m_Buffer))
+    {
+        CloseHandle(pOverlapped->hEvent);
+        delete pOverlapped;
+        CloseHandle(hDirectory);
+        return;
+    }
+
+    m_Handle     = reinterpret_cast<intptr_t>(hDirectory);
+    m_Overlapped = pOverlapped;
+#else
+    const int kDescriptor = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (kDescriptor < 0)
+    {
+        return;
+    }
+
+    m_Handle = kDescriptor;
+    AddWatches(m_Directory, false);
+#endif // _WIN32
+}
+
+FileWatcher::~FileWatcher() noexcept
+{
+    if (!IsOpen())
+    {
+        return;
+    }
+
+#ifdef _WIN32
+    HANDLE      hDirectory  = reinterpret_cast<HANDLE>(m_Handle);
+    OVERLAPPED* pOverlapped = static_cast<OVERLAPPED*>(m_Overlapped);
+
+    // The read still writes to the buffer until the cancellation completes
+    DWORD kBytes = 0u;
+    CancelIoEx(hDirectory, pOverlapped);
+    GetOverlappedResult(hDirectory, pOverlapped, &kBytes, TRUE);
+    CloseHandle(pOverlapped->hEvent);
+    delete pOverlapped;
+    CloseHandle(hDirectory);
+    m_Overlapped = nullptr;
+#else
+    close(int(m_Handle));
+    m_Watches.clear();
+#endif // _WIN32
+    m_Handle = -1;
+}
+
+bool FileWatcher::IsOpen() const noexcept
+{
+    return m_Handle != -1;
+}
+
+void FileWatcher::Poll(List<String>& Changed) noexcept
+{
+    if (!IsOpen())
+    {
+        return;
+    }
+
+    ReadEvents();
+
+    const Clock::time_point Now = Clock::now();
+    for (auto it = m_Pending.begin(); it != m_Pending.end();)
+    {
+        if (Now - it->second >= m_SettleTime)
+        {
+            Changed.push_back(it->first);
+            it = m_Pending.erase(it);
+        }
+        else
+        {
+            ++it;
+        }
+    }
+}
+
+void FileWatcher::Touch(const std::filesystem::path& Filepath) noexcept
+{
+    m_Pending[Filepath.lexically_normal().generic_string()] = Clock::now();
+}
+
+void FileWatcher::ReadEvents() noexcept
+{
+#ifdef _WIN32
+    HANDLE      hDirectory  = reinterpret_cast<HANDLE>(m_Handle);
+    OVERLAPPED* pOverlapped = static_cast<OVERLAPPED*>(m_Overlapped);
+
+    // One completed read per poll, the next is issued right away so nothing is missed in between
+    DWORD kBytes = 0u;
+    if (!GetOverlappedResult(hDirectory, pOverlapped, &kBytes, FALSE))
+    {
+        return;
+    }
+
+    // No bytes means the buffer overflowed and the changes are lost, there is nothing to report them by
+    const uint8_t* pRecord = reinterpret_cast<const uint8_t*>(m_Buffer.data());
+    while (kBytes > 0u)
+    {
+        const FILE_NOTIFY_INFORMATION* pInfo = reinterpret_cast<const FILE_NOTIFY_INFORMATION*>(pRecord);
+        if (pInfo->Action == FILE_ACTION_ADDED || pInfo->Action == FILE_ACTION_MODIFIED || pInfo->Action == FILE_ACTION_RENAMED_NEW_NAME)
+        {
+            const std::wstring Name = std::wstring(pInfo->FileName, pInfo->FileNameLength / sizeof(WCHAR));
+            Touch(m_Directory / std::filesystem::path(Name));
+        }
+
+        if (pInfo->NextEntryOffset == 0u)
+        {
+            break;
+        }
+        pRecord += pInfo->NextEntryOffset;
+    }
+
+    ResetEvent(pOverlapped->hEvent);
+    IssueRead(hDirectory, pOverlapped, m_Buffer);
+#else
+    alignas(inotify_event) char lpBuffer[4096] = {};
+    while (true)
+    {
+        const ssize_t kBytes = read(int(m_Handle), lpBuffer, sizeof(lpBuffer));
+        if (kBytes <= 0)
+        {
+            break;
+        }
+
+        for (ssize_t k = 0; k < kBytes;)
+        {
+            const inotify_event* pEvent = reinterpret_cast<const inotify_event*>(lpBuffer + k);
+            k += sizeof(inotify_event) + pEvent->len;
+
+            auto it = m_Watches.find(pEvent->wd);
+            if (it == m_Watches.end())
+            {
+                continue;
+            }
+            if (pEvent->mask & IN_IGNORED)
+            {
+                m_Watches.erase(it);
+                continue;
+            }
+
+            const std::filesystem::path Filepath = it->second / pEvent->name;
+            if (pEvent->mask & IN_ISDIR)
+            {
+                // Anything written into it before the watch was added is found by walking it
+                if (pEvent->mask & s_DirectoryEvents)
+                {
+                    AddWatches(Filepath, true);
+                }
+            }
+            else if (pEvent->mask & s_FileEvents)
+            {
+                Touch(Filepath);
+            }
+        }
+    }
+#endif // _WIN32
+}
+
+#ifndef _WIN32
+void FileWatcher::AddWatches(const std::filesystem::path& Directory, bool bReportFiles) noexcept
+{
+    // inotify is not recursive, every directory below gets its own watch
+    const int kWatch = inotify_add_watch(int(m_Handle), Directory.c_str(), s_FileEvents | s_DirectoryEvents);
+    if (kWatch < 0)
+    {
+        return;
+    }
+    m_Watches[kWatch] = Directory;
+
+    std::error_code Error = {};
+    for (const std::filesystem::directory_entry& Entry : std::filesystem::directory_iterator(Directory, Error))
+    {
+        if (Entry.is_directory(Error))
+        {
+            AddWatches(Entry.path(), bReportFiles);
+        }
+        else if (bReportFiles && Entry.is_regular_file(Error))
+        {
+            Touch(Entry.path());
+        }
+    }
+}
+#endif // !_WIN32
@@ -0,0 +1,46 @@
+#pragma once
+
+#include "Core.h"
+
+#include <chrono>
+
+// Files written anywhere below a directory, polled from the thread that owns the watcher without ever blocking it.
+// Editors save in bursts (truncate and write, or write a temporary and rename it over), so a file is only reported
+// once it has been quiet for the settle time, and once however many events it had.
+class FileWatcher
+{
+public:
+	FileWatcher() = default;
+	explicit FileWatcher(const char* lpDirectory, uint32_t kSettleMilliseconds = 50u);
+	~FileWatcher() noexcept;
+
+	bool IsOpen() const noexcept;
+
+	// Appends the files that settled since the last call, as the watched directory joined with their path below it
+	void Poll(List<String>& Changed) noexcept;
+
+private:
+	FileWatcher(const FileWatcher&) = delete;
+	FileWatcher& operator=(const FileWatcher&) = delete;
+
+	void ReadEvents() noexcept;
+	void Touch(const std::filesystem::path& Filepath) noexcept;
+#ifndef _WIN32
+	// Files already in directories that appear later are reported, they were written before the watch could see them
+	void AddWatches(const std::filesystem::path& Directory, bool bReportFiles) noexcept;
+#endif // !_WIN32
+
+private:
+	using Clock = std::chrono::steady_clock;
+
+	std::filesystem::path                  m_Directory  = {};
+	Clock::duration                        m_SettleTime = {};
+	Dictionary<String, Clock::time_point>  m_Pending    = {}; // Last event per file
+	intptr_t                               m_Handle     = -1; // inotify descriptor, or the directory's handle
+#ifdef _WIN32
+	void*                                  m_Overlapped = nullptr;
+	List<uint32_t>                         m_Buffer     = {}; // FILE_NOTIFY_INFORMATION records are DWORD aligned
+#else
+	Dictionary<int, std::filesystem::path> m_Watches    = {}; // Watched directory per watch descriptor
+#endif // _WIN32
+};
@@ -1,6 +1,6 @@
 #include "Image.h"
 #include "Maths.h"
-#include "Base.h"
+#include "File.h"
 
 #define STB_IMAGE_IMPLEMENTATION
 #include <stb/stb_image.h>
@@ -30,10 +30,35 @@ Image::Image(uint32_t Width, uint32_t Height, const Pixel& Color)
 Image::Image(const char* lpFilepath)
     : m_Width(0u), m_Height(0u)
 {
-    int32_t kWidth    = 0;
-    int32_t kHeight   = 0;
-    int32_t kChannels = 0;
-    stbi_uc* pPixels = stbi_load(lpFilepath, &kWidth, &kHeight, &kChannels, 4);
+    const String Baked = GetBakedReadPath(lpFilepath, ".image");
+    if (Baked != lpFilepath)
+    {
+        const MappedFile File   = MappedFile(Baked.c_str());
+        BakedHeader      Header = {};
+        if (File.GetSize() >= sizeof(Header))
+        {
+            memcpy(&Header, File.GetData(), sizeof(Header));
+        }
+
+        // Anything else about the file that is off falls back to decoding the source
+        const size_t kSize = size_t(Header.Width) * size_t(Header.Height);
+        if (Header.Magic == BakedHeader().Magic && Header.Version == BakedHeader().Version && kSize > 0u && File.GetSize() == sizeof(Header) + kSize * sizeof(Pixel))
+        {
+            m_Width  = Header.Width;
+            m_Height = Header.Height;
+            m_Pixels = new Pixel[kSize]{};
+
+            memcpy(m_Pixels, File.GetData() + sizeof(Header), GetBufferSize());
+            return;
+        }
+    }
+
+    // Decoded from memory, so a source in the mounted archive is read from there too
+    const MappedFile File      = MappedFile(lpFilepath);
+    int32_t          kWidth    = 0;
+    int32_t          kHeight   = 0;
+    int32_t          kChannels = 0;
+    stbi_uc* pPixels = File.GetSize() > 0u ? stbi_load_from_memory(File.GetData(), int32_t(File.GetSize()), &kWidth, &kHeight, &kChannels, 4) : nullptr;
     if (pPixels == nullptr || kWidth < 1 || kHeight < 1)
     {
         assert(false && "Failed to load image");
@@ -78,6 +103,18 @@ void Image::Save(const char* lpFilepath)
     assert(false && "NotImplementedException");
 }
 
+bool Image::SaveBaked(const char* lpFilepath, const Pixel* pPixels, uint32_t kWidth, uint32_t kHeight) noexcept
+{
+    BakedHeader Header = {};
+    Header.Width  = kWidth;
+    Header.Height = kHeight;
+
+    List<uint8_t> Bytes = List<uint8_t>(sizeof(Header) + size_t(kWidth) * size_t(kHeight) * sizeof(Pixel));
+    memcpy(Bytes.data(), &Header, sizeof(Header));
+    memcpy(Bytes.data() + sizeof(Header), pPixels, Bytes.size() - sizeof(Header));
+    return SaveFile(lpFilepath, Bytes.data(), Bytes.size());
+}
+
 Pixel* Image::GetBufferPointer() noexcept
 {
     return m_Pixels;
@@ -4,14 +4,27 @@
 
 class Image
 {
+public:
+	// Baked images are the pixels as they are in memory after this header, loaded without decoding anything
+	struct BakedHeader
+	{
+		uint32_t Magic   = 0x474D4942u; // "BIMG"
+		uint32_t Version = 1u;
+		uint32_t Width   = 0u;
+		uint32_t Height  = 0u;
+	};
+
 public:
 	Image(uint32_t Width, uint32_t Height, const Pixel& Color = Colors::Blank);
+	// Loads the baked image beside the file instead when it is up to date
 	Image(const char* lpFilepath);
 	~Image() noexcept;
 
 	Image Copy();
 	void  Save(const char* lpFilepath);
 
+	static bool SaveBaked(const char* lpFilepath, const Pixel* pPixels, uint32_t kWidth, uint32_t kHeight) noexcept;
+
 	Pixel*       GetBufferPointer() noexcept;
 	const Pixel* GetBufferPointer() const noexcept;
 	size_t       GetBufferSize() const noexcept;
@@ -14,7 +14,7 @@ static std::uniform_int_distribution<uint64_t>  s_RandomDistributionU64;
 
 // RANDOM
 template<typename Real>
-inline static Real RandomReal(const std::uniform_real_distribution<Real>& Dist, Real First, Real Last) noexcept
+inline static Real RandomReal(std::uniform_real_distribution<Real>& Dist, Real First, Real Last) noexcept
 {
     static const Real Max = Dist.max();
     
@@ -23,7 +23,7 @@ inline static Real RandomReal(const std::uniform_real_distribution<Real>& Dist,
 }
 
 template<typename Int>
-inline static Int RandomInt(const std::uniform_int_distribution<Int>& Dist, Int kMax) noexcept
+inline static Int RandomInt(std::uniform_int_distribution<Int>& Dist, Int kMax) noexcept
 {
     if (kMax == Int(0))
     {
@@ -54,7 +54,7 @@ double Random::Double(double First, double Last) noexcept
 
 int64_t Random::Int() noexcept
 {
-    return RandomInt(s_RandomDistributionI64, 1ll);
+    return RandomInt(s_RandomDistributionI64, int64_t(1));
 }
 
 int64_t Random::Int(int64_t kMax) noexcept
@@ -64,7 +64,7 @@ int64_t Random::Int(int64_t kMax) noexcept
 
 uint64_t Random::UInt() noexcept
 {
-    return RandomInt(s_RandomDistributionU64, 1ull);
+    return RandomInt(s_RandomDistributionU64, uint64_t(1u));
 }
 
 uint64_t Random::UInt(uint64_t kMax) noexcept
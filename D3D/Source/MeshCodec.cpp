@@ -0,0 +1,710 @@
+#include "MeshCodec.h"
+#include "File.h"
+#include "Parallel.h"
+
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+#include <emmintrin.h>
+
+static_assert(sizeof(MeshVertex) == 24u, "Vertex reconstruction writes MeshVertex as six packed floats");
+
+// ENTROPY CODER
+// rANS (Duda 2013) with 12-bit probabilities and eight interleaved states sharing one stream, decoding is bound by
+// the latency of each state's chain so more states run more of them side by side. States renormalize in
+// 16-bit words: a state below s_StateLow after decoding is still at least 2^4, so a single word always brings it back
+// and the decoder needs no loop or branch for it.
+static constexpr uint32_t s_ProbabilityBits  = 12u;
+static constexpr uint32_t s_ProbabilityScale = 1u << s_ProbabilityBits;
+static constexpr uint32_t s_StateLow         = 1u << 16u;
+static constexpr uint32_t s_StateCount       = 8u;
+
+enum class BlockMode : uint8_t
+{
+    Stored,
+    Constant,
+    Rans,
+};
+
+static void WriteVarint(List<uint8_t>& Output, uint32_t kValue) noexcept
+{
+    while (kValue >= 0x80u)
+    {
+        Output.push_back(uint8_t(kValue | 0x80u));
+        kValue >>= 7u;
+    }
+    Output.push_back(uint8_t(kValue));
+}
+
+static bool ReadVarint(const uint8_t*& pData, const uint8_t* pEnd, uint32_t& kValue) noexcept
+{
+    kValue = 0u;
+    for (uint32_t kShift = 0u; kShift < 35u; kShift += 7u)
+    {
+        if (pData == pEnd)
+        {
+            return false;
+        }
+        const uint8_t kByte = *pData++;
+        kValue |= uint32_t(kByte & 0x7Fu) << kShift;
+        if (!(kByte & 0x80u))
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Scales the histogram to sum to s_ProbabilityScale, keeping every present symbol at 1 or more
+static void NormalizeFrequencies(const uint32_t Counts[256], size_t kTotal, uint32_t Frequencies[256]) noexcept
+{
+    uint32_t kSum = 0u;
+    for (uint32_t s = 0u; s < 256u; s++)
+    {
+        Frequencies[s] = Counts[s] ? std::max(1u, uint32_t(uint64_t(Counts[s]) * s_ProbabilityScale / kTotal)) : 0u;
+        kSum += Frequencies[s];
+    }
+
+    // Rounding errors go to the most frequent symbols, where they cost the least
+    while (kSum != s_ProbabilityScale)
+    {
+        uint32_t kBest = 0u;
+        for (uint32_t s = 1u; s < 256u; s++)
+        {
+            if (Frequencies[s] > Frequencies[kBest])
+            {
+                kBest = s;
+            }
+        }
+
+        if (kSum < s_ProbabilityScale)
+        {
+            Frequencies[kBest] += s_ProbabilityScale - kSum;
+            kSum = s_ProbabilityScale;
+        }
+        else
+        {
+            const uint32_t kTake = std::min(kSum - s_ProbabilityScale, Frequencies[kBest] - 1u);
+            Frequencies[kBest] -= kTake;
+            kSum               -= kTake;
+            if (kTake == 0u)
+            {
+                break; // Cannot happen with fewer than s_ProbabilityScale symbols, which there always are
+            }
+        }
+    }
+}
+
+void MeshCodec::EncodeBytes(const uint8_t* pBytes, size_t kSize, List<uint8_t>& Output) noexcept
+{
+    WriteVarint(Output, uint32_t(kSize));
+    if (kSize == 0u)
+    {
+        return;
+    }
+
+    uint32_t Counts[256] = {};
+    for (size_t k = 0u; k < kSize; k++)
+    {
+        Counts[pBytes[k]]++;
+    }
+
+    uint32_t kSymbols = 0u;
+    for (uint32_t s = 0u; s < 256u; s++)
+    {
+        kSymbols += Counts[s] ? 1u : 0u;
+    }
+    if (kSymbols == 1u)
+    {
+        Output.push_back(uint8_t(BlockMode::Constant));
+        Output.push_back(pBytes[0]);
+        return;
+    }
+
+    uint32_t Frequencies[256] = {};
+    uint32_t Starts[256]      = {};
+    NormalizeFrequencies(Counts, kSize, Frequencies);
+    for (uint32_t s = 1u; s < 256u; s++)
+    {
+        Starts[s] = Starts[s - 1u] + Frequencies[s - 1u];
+    }
+
+    // The encoder runs backwards so the decoder can read forwards, every symbol takes at most one word
+    List<uint8_t>  Payload = List<uint8_t>(kSize * 2u + s_StateCount * 4u);
+    uint8_t*       pWrite  = Payload.data() + Payload.size();
+    uint32_t       States[s_StateCount] = {};
+    for (uint32_t& x : States)
+    {
+        x = s_StateLow;
+    }
+    for (size_t k = kSize; k-- > 0u;)
+    {
+        uint32_t&      x          = States[k % s_StateCount];
+        const uint32_t kFrequency = Frequencies[pBytes[k]];
+        if (x >= ((s_StateLow >> s_ProbabilityBits) << 16u) * kFrequency)
+        {
+            pWrite -= 2u;
+            pWrite[0] = uint8_t(x);
+            pWrite[1] = uint8_t(x >> 8u);
+            x >>= 16u;
+        }
+        x = ((x / kFrequency) << s_ProbabilityBits) + (x % kFrequency) + Starts[pBytes[k]];
+    }
+    for (uint32_t s = s_StateCount; s-- > 0u;)
+    {
+        pWrite -= 4u;
+        pWrite[0] = uint8_t(States[s]);
+        pWrite[1] = uint8_t(States[s] >> 8u);
+        pWrite[2] = uint8_t(States[s] >> 16u);
+        pWrite[3] = uint8_t(States[s] >> 24u);
+    }
+    const size_t kPayloadSize = size_t(Payload.data() + Payload.size() - pWrite);
+
+    // Table: presence bitmap, then every present symbol's frequency
+    List<uint8_t> Table = List<uint8_t>(32u, 0u);
+    for (uint32_t s = 0u; s < 256u; s++)
+    {
+        if (Frequencies[s])
+        {
+            Table[s >> 3u] |= uint8_t(1u << (s & 7u));
+        }
+    }
+    for (uint32_t s = 0u; s < 256u; s++)
+    {
+        if (Frequencies[s])
+        {
+            WriteVarint(Table, Frequencies[s] - 1u);
+        }
+    }
+
+    if (Table.size() + kPayloadSize + 5u >= kSize)
+    {
+        Output.push_back(uint8_t(BlockMode::Stored));
+        Output.insert(Output.end(), pBytes, pBytes + kSize);
+        return;
+    }
+
+    Output.push_back(uint8_t(BlockMode::Rans));
+    Output.insert(Output.end(), Table.begin(), Table.end());
+    WriteVarint(Output, uint32_t(kPayloadSize));
+    Output.insert(Output.end(), pWrite, pWrite + kPayloadSize);
+}
+
+size_t MeshCodec::DecodeBytes(const uint8_t* pData, size_t kSize, List<uint8_t>& Output, size_t kMaxCount) noexcept
+{
+    const uint8_t* const pBegin = pData;
+    const uint8_t* const pEnd   = pData + kSize;
+
+    uint32_t kCount = 0u;
+    if (!ReadVarint(pData, pEnd, kCount) || kCount > kMaxCount)
+    {
+        return 0u;
+    }
+    Output.resize(kCount);
+    if (kCount == 0u)
+    {
+        return size_t(pData - pBegin);
+    }
+    if (pData == pEnd)
+    {
+        return 0u;
+    }
+
+    switch (BlockMode(*pData++))
+    {
+        case BlockMode::Stored:
+            if (size_t(pEnd - pData) < kCount)
+            {
+                return 0u;
+            }
+            memcpy(Output.data(), pData, kCount);
+            return size_t(pData + kCount - pBegin);
+
+        case BlockMode::Constant:
+            if (pData == pEnd)
+            {
+                return 0u;
+            }
+            memset(Output.data(), *pData, kCount);
+            return size_t(pData + 1u - pBegin);
+
+        case BlockMode::Rans:
+            break;
+
+        default:
+            return 0u;
+    }
+
+    if (pEnd - pData < 32)
+    {
+        return 0u;
+    }
+    const uint8_t* pPresent = pData;
+    pData += 32u;
+
+    // One entry per probability slot: the symbol's frequency and the slot's offset from the symbol's start
+    struct Slot
+    {
+        uint16_t Frequency = 0u;
+        uint16_t Offset    = 0u;
+    };
+    List<Slot>    Slots   = List<Slot>(s_ProbabilityScale);
+    List<uint8_t> Symbols = List<uint8_t>(s_ProbabilityScale);
+    uint32_t      kStart  = 0u;
+    for (uint32_t s = 0u; s < 256u; s++)
+    {
+        if (!(pPresent[s >> 3u] & (1u << (s & 7u))))
+        {
+            continue;
+        }
+
+        uint32_t kFrequency = 0u;
+        if (!ReadVarint(pData, pEnd, kFrequency) || kFrequency + 1u > s_ProbabilityScale - kStart)
+        {
+            return 0u;
+        }
+        kFrequency++;
+        for (uint32_t j = 0u; j < kFrequency; j++)
+        {
+            Slots[kStart + j]   = { uint16_t(kFrequency), uint16_t(j) };
+            Symbols[kStart + j] = uint8_t(s);
+        }
+        kStart += kFrequency;
+    }
+
+    uint32_t kPayloadSize = 0u;
+    if (kStart != s_ProbabilityScale || !ReadVarint(pData, pEnd, kPayloadSize) || size_t(pEnd - pData) < kPayloadSize || kPayloadSize < s_StateCount * 4u)
+    {
+        return 0u;
+    }
+
+    const uint8_t* pRead    = pData;
+    const uint8_t* pStream  = pData + kPayloadSize;
+    uint32_t       States[s_StateCount] = {};
+    for (uint32_t s = 0u; s < s_StateCount; s++)
+    {
+        States[s] = uint32_t(pRead[0]) | (uint32_t(pRead[1]) << 8u) | (uint32_t(pRead[2]) << 16u) | (uint32_t(pRead[3]) << 24u);
+        pRead += 4u;
+    }
+
+    const Slot*    pSlots       = Slots.data();
+    const uint8_t* pSymbols     = Symbols.data();
+    const auto     DecodeSymbol = [pSlots, pSymbols](uint32_t& x) noexcept -> uint8_t
+    {
+        const uint32_t kSlot = x & (s_ProbabilityScale - 1u);
+        x = uint32_t(pSlots[kSlot].Frequency) * (x >> s_ProbabilityBits) + pSlots[kSlot].Offset;
+        return pSymbols[kSlot];
+    };
+    const auto     Renormalize  = [](uint32_t& x, const uint8_t* pWord) noexcept
+    {
+        // Masks rather than a select, compilers turn the select into a branch that mispredicts on every other word
+        uint16_t kWord = 0u;
+        memcpy(&kWord, pWord, sizeof(kWord));
+        const uint32_t kMask = 0u - uint32_t(x < s_StateLow);
+        x = (x & ~kMask) | (((x << 16u) | kWord) & kMask);
+    };
+
+    // Every state reads at most one word per round, the checked tail handles the end of the stream
+    uint8_t* pOutput = Output.data();
+    size_t   k       = 0u;
+    for (; k + s_StateCount <= kCount && size_t(pStream - pRead) >= s_StateCount * 2u; k += s_StateCount)
+    {
+        for (uint32_t s = 0u; s < s_StateCount; s++)
+        {
+            pOutput[k + s] = DecodeSymbol(States[s]);
+        }
+
+        // Word positions from the states alone, so the reads do not wait on each other
+        size_t kOffsets[s_StateCount] = {};
+        size_t kOffset                = 0u;
+        for (uint32_t s = 0u; s < s_StateCount; s++)
+        {
+            kOffsets[s] = kOffset;
+            kOffset    += States[s] < s_StateLow ? 2u : 0u;
+        }
+        for (uint32_t s = 0u; s < s_StateCount; s++)
+        {
+            Renormalize(States[s], pRead + kOffsets[s]);
+        }
+        pRead += kOffset;
+    }
+
+    for (; k < kCount; k++)
+    {
+        uint32_t& x = States[k % s_StateCount];
+        pOutput[k] = DecodeSymbol(x);
+        if (x < s_StateLow)
+        {
+            if (pStream - pRead < 2)
+            {
+                return 0u;
+            }
+            x = (x << 16u) | uint32_t(pRead[0]) | (uint32_t(pRead[1]) << 8u);
+            pRead += 2u;
+        }
+    }
+    return size_t(pStream - pBegin);
+}
+
+// QUANTIZATION
+enum MeshStream : uint32_t
+{
+    PositionX,  // Every vertex stream is a low byte plane followed by a high byte plane
+    PositionY = PositionX + 2u,
+    PositionZ = PositionY + 2u,
+    NormalU   = PositionZ + 2u,
+    NormalV   = NormalU + 2u,
+    IndexDeltas = NormalV + 2u,
+    StreamCount
+};
+static constexpr uint32_t s_ComponentCount = 5u;
+
+struct MeshHeader
+{
+    static constexpr uint32_t MagicValue = 0x3143534Du; // "MSC1"
+
+    uint32_t Magic       = MagicValue;
+    uint32_t Version     = MeshCodec::Version;
+    uint64_t Checksum    = 0u;                 // Of the header with this zeroed, the counts size every allocation
+    uint32_t VertexCount = 0u;
+    uint32_t IndexCount  = 0u;
+    Float3   Minimum     = {};
+    Float3   Step        = {};                 // Position units per quantization step
+    uint32_t StreamEnds[StreamCount] = {};     // Relative to the end of the header
+};
+
+static constexpr float s_PositionSteps = float((1u << MeshCodec::PositionBits) - 1u);
+static constexpr float s_NormalSteps   = float((1u << MeshCodec::NormalBits) - 1u);
+
+static inline uint16_t ZigZag(uint16_t kValue) noexcept
+{
+    return uint16_t((kValue << 1u) ^ uint16_t(int16_t(kValue) >> 15));
+}
+
+static inline uint32_t ZigZag(uint32_t kValue) noexcept
+{
+    return (kValue << 1u) ^ uint32_t(int32_t(kValue) >> 31);
+}
+
+static inline uint32_t UnZigZag(uint32_t kValue) noexcept
+{
+    return (kValue >> 1u) ^ (0u - (kValue & 1u));
+}
+
+// Octahedral mapping (Meyer et al. 2010) onto [0, s_NormalSteps]^2
+static void EncodeOctahedral(const Float3& n, uint16_t& u, uint16_t& v) noexcept
+{
+    const float Sum = fabsf(n.X) + fabsf(n.Y) + fabsf(n.Z);
+    float x = Sum > 0.0f ? n.X / Sum : 0.0f;
+    float y = Sum > 0.0f ? n.Y / Sum : 0.0f;
+    if (n.Z < 0.0f)
+    {
+        const float Fx = (1.0f - fabsf(y)) * (x >= 0.0f ? 1.0f : -1.0f);
+        const float Fy = (1.0f - fabsf(x)) * (y >= 0.0f ? 1.0f : -1.0f);
+        x = Fx;
+        y = Fy;
+    }
+    u = uint16_t(lroundf((x * 0.5f + 0.5f) * s_NormalSteps));
+    v = uint16_t(lroundf((y * 0.5f + 0.5f) * s_NormalSteps));
+}
+
+static Float3 DecodeOctahedral(uint16_t u, uint16_t v) noexcept
+{
+    float x = float(u) * (2.0f / s_NormalSteps) - 1.0f;
+    float y = float(v) * (2.0f / s_NormalSteps) - 1.0f;
+    const float z = 1.0f - fabsf(x) - fabsf(y);
+    const float t = std::max(-z, 0.0f);
+    x -= x >= 0.0f ? t : -t;
+    y -= y >= 0.0f ? t : -t;
+
+    const float Length = sqrtf(x * x + y * y + z * z);
+    return Float3(x / Length, y / Length, z / Length);
+}
+
+// Running sum of zigzag deltas back to quantized values, eight per step
+static void ReconstructComponent(const uint8_t* pLow, const uint8_t* pHigh, size_t kCount, uint16_t* pValues) noexcept
+{
+    const __m128i One   = _mm_set1_epi16(1);
+    __m128i       Carry = _mm_setzero_si128();
+
+    size_t k = 0u;
+    for (; k + 8u <= kCount; k += 8u)
+    {
+        __m128i d = _mm_unpacklo_epi8(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(pLow + k)), _mm_loadl_epi64(reinterpret_cast<const __m128i*>(pHigh + k)));
+        d = _mm_xor_si128(_mm_srli_epi16(d, 1), _mm_sub_epi16(_mm_setzero_si128(), _mm_and_si128(d, One)));
+
+        d = _mm_add_epi16(d, _mm_slli_si128(d, 2));
+        d = _mm_add_epi16(d, _mm_slli_si128(d, 4));
+        d = _mm_add_epi16(d, _mm_slli_si128(d, 8));
+        d = _mm_add_epi16(d, Carry);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(pValues + k), d);
+
+        const __m128i Last = _mm_shufflehi_epi16(d, _MM_SHUFFLE(3, 3, 3, 3));
+        Carry = _mm_unpackhi_epi64(Last, Last);
+    }
+
+    uint16_t kPrevious = uint16_t(_mm_cvtsi128_si32(Carry));
+    for (; k < kCount; k++)
+    {
+        const uint16_t d = uint16_t(pLow[k] | (pHigh[k] << 8u));
+        kPrevious = uint16_t(kPrevious + uint16_t((d >> 1u) ^ (0u - (d & 1u))));
+        pValues[k] = kPrevious;
+    }
+}
+
+// Quantized SoA components to MeshVertex, four vertices per step written as six packed float4
+static void DequantizeVertices(const MeshHeader& Header, const uint16_t* const pComponents[s_ComponentCount], size_t kBegin, size_t kEnd, MeshVertex* pVertices) noexcept
+{
+    const __m128 Minimum[3] = { _mm_set1_ps(Header.Minimum.X), _mm_set1_ps(Header.Minimum.Y), _mm_set1_ps(Header.Minimum.Z) };
+    const __m128 Step[3]    = { _mm_set1_ps(Header.Step.X),    _mm_set1_ps(Header.Step.Y),    _mm_set1_ps(Header.Step.Z) };
+    const __m128 NormalStep = _mm_set1_ps(2.0f / s_NormalSteps);
+    const __m128 One        = _mm_set1_ps(1.0f);
+    const __m128 SignMask   = _mm_set1_ps(-0.0f);
+
+    const auto Load = [](const uint16_t* pValues) noexcept
+    {
+        return _mm_cvtepi32_ps(_mm_unpacklo_epi16(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(pValues)), _mm_setzero_si128()));
+    };
+
+    size_t k = kBegin;
+    for (; k + 4u <= kEnd; k += 4u)
+    {
+        const __m128 px = _mm_add_ps(_mm_mul_ps(Load(pComponents[0] + k), Step[0]), Minimum[0]);
+        const __m128 py = _mm_add_ps(_mm_mul_ps(Load(pComponents[1] + k), Step[1]), Minimum[1]);
+        const __m128 pz = _mm_add_ps(_mm_mul_ps(Load(pComponents[2] + k), Step[2]), Minimum[2]);
+
+        __m128 nx = _mm_sub_ps(_mm_mul_ps(Load(pComponents[3] + k), NormalStep), One);
+        __m128 ny = _mm_sub_ps(_mm_mul_ps(Load(pComponents[4] + k), NormalStep), One);
+        __m128 nz = _mm_sub_ps(_mm_sub_ps(One, _mm_andnot_ps(SignMask, nx)), _mm_andnot_ps(SignMask, ny));
+        const __m128 t = _mm_max_ps(_mm_sub_ps(_mm_setzero_ps(), nz), _mm_setzero_ps());
+        nx = _mm_sub_ps(nx, _mm_or_ps(t, _mm_and_ps(nx, SignMask)));
+        ny = _mm_sub_ps(ny, _mm_or_ps(t, _mm_and_ps(ny, SignMask)));
+
+        const __m128 Length = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(nx, nx), _mm_mul_ps(ny, ny)), _mm_mul_ps(nz, nz)));
+        nx = _mm_div_ps(nx, Length);
+        ny = _mm_div_ps(ny, Length);
+        nz = _mm_div_ps(nz, Length);
+
+        // (px py pz nx) per vertex, then splice in (ny nz)
+        __m128 a0 = px, a1 = py, a2 = pz, a3 = nx;
+        _MM_TRANSPOSE4_PS(a0, a1, a2, a3);
+        const __m128 b01 = _mm_unpacklo_ps(ny, nz);
+        const __m128 b23 = _mm_unpackhi_ps(ny, nz);
+
+        float* pOutput = &pVertices[k].Position.X;
+        _mm_storeu_ps(pOutput +  0u, a0);
+        _mm_storeu_ps(pOutput +  4u, _mm_movelh_ps(b01, a1));
+        _mm_storeu_ps(pOutput +  8u, _mm_shuffle_ps(a1, b01, _MM_SHUFFLE(3, 2, 3, 2)));
+        _mm_storeu_ps(pOutput + 12u, a2);
+        _mm_storeu_ps(pOutput + 16u, _mm_movelh_ps(b23, a3));
+        _mm_storeu_ps(pOutput + 20u, _mm_shuffle_ps(a3, b23, _MM_SHUFFLE(3, 2, 3, 2)));
+    }
+    for (; k < kEnd; k++)
+    {
+        pVertices[k].Position = Header.Minimum + Float3(float(pComponents[0][k]), float(pComponents[1][k]), float(pComponents[2][k])) * Header.Step;
+        pVertices[k].Normal   = DecodeOctahedral(pComponents[3][k], pComponents[4][k]);
+    }
+}
+
+// MESH
+void MeshCodec::EncodeMesh(const MeshVertex* pVertices, size_t kVertexCount, const uint32_t* pIndices, size_t kIndexCount, List<uint8_t>& Output) noexcept
+{
+    MeshHeader Header  = {};
+    Header.VertexCount = uint32_t(kVertexCount);
+    Header.IndexCount  = uint32_t(kIndexCount);
+
+    Float3 Maximum = Float3(-FLT_MAX);
+    Header.Minimum = Float3(FLT_MAX);
+    for (size_t k = 0u; k < kVertexCount; k++)
+    {
+        const Float3& p = pVertices[k].Position;
+        Header.Minimum = Float3(std::min(Header.Minimum.X, p.X), std::min(Header.Minimum.Y, p.Y), std::min(Header.Minimum.Z, p.Z));
+        Maximum        = Float3(std::max(Maximum.X, p.X), std::max(Maximum.Y, p.Y), std::max(Maximum.Z, p.Z));
+    }
+    if (kVertexCount == 0u)
+    {
+        Header.Minimum = Float3(0.0f);
+        Maximum        = Float3(0.0f);
+    }
+    Header.Step = (Maximum - Header.Minimum) / Float3(s_PositionSteps);
+
+    // Byte planes of the zigzagged deltas, component after component
+    List<uint8_t> Planes = List<uint8_t>(kVertexCount * s_ComponentCount * 2u);
+    uint16_t      Previous[s_ComponentCount] = {};
+    for (size_t k = 0u; k < kVertexCount; k++)
+    {
+        const Float3& p = pVertices[k].Position;
+        uint16_t Values[s_ComponentCount] = {};
+        for (uint32_t a = 0u; a < 3u; a++)
+        {
+            const float Step = (&Header.Step.X)[a];
+            Values[a] = Step > 0.0f ? uint16_t(lroundf(std::min(((&p.X)[a] - (&Header.Minimum.X)[a]) / Step, s_PositionSteps))) : 0u;
+        }
+        EncodeOctahedral(pVertices[k].Normal, Values[3], Values[4]);
+
+        for (uint32_t c = 0u; c < s_ComponentCount; c++)
+        {
+            const uint16_t d = ZigZag(uint16_t(Values[c] - Previous[c]));
+            Planes[(c * 2u + 0u) * kVertexCount + k] = uint8_t(d);
+            Planes[(c * 2u + 1u) * kVertexCount + k] = uint8_t(d >> 8u);
+            Previous[c] = Values[c];
+        }
+    }
+
+    // Triangle deltas: the first corner against the previous triangle's, the others against the first
+    List<uint8_t> Varints = {};
+    Varints.reserve(kIndexCount * 2u);
+    uint32_t kPrevious = 0u;
+    for (size_t k = 0u; k + 2u < kIndexCount; k += 3u)
+    {
+        WriteVarint(Varints, ZigZag(pIndices[k] - kPrevious));
+        WriteVarint(Varints, ZigZag(pIndices[k + 1u] - pIndices[k]));
+        WriteVarint(Varints, ZigZag(pIndices[k + 2u] - pIndices[k]));
+        kPrevious = pIndices[k];
+    }
+
+    List<List<uint8_t>> Streams = List<List<uint8_t>>(StreamCount);
+    Parallel::For(StreamCount, 1u, [&](size_t kBegin, size_t kEnd)
+    {
+        for (size_t s = kBegin; s < kEnd; s++)
+        {
+            if (s == IndexDeltas)
+            {
+                EncodeBytes(Varints.data(), Varints.size(), Streams[s]);
+            }
+            else
+            {
+                EncodeBytes(Planes.data() + s * kVertexCount, kVertexCount, Streams[s]);
+            }
+        }
+    });
+
+    size_t kOffset = 0u;
+    for (uint32_t s = 0u; s < StreamCount; s++)
+    {
+        kOffset += Streams[s].size();
+        Header.StreamEnds[s] = uint32_t(kOffset);
+    }
+
+    Header.Checksum = HashBytes(&Header, sizeof(MeshHeader));
+
+    Output.resize(sizeof(MeshHeader));
+    memcpy(Output.data(), &Header, sizeof(MeshHeader));
+    for (const List<uint8_t>& Stream : Streams)
+    {
+        Output.insert(Output.end(), Stream.begin(), Stream.end());
+    }
+}
+
+bool MeshCodec::DecodeMesh(const uint8_t* pData, size_t kSize, List<MeshVertex>& Vertices, List<uint32_t>& Indices) noexcept
+{
+    MeshHeader Header = {};
+    if (kSize < sizeof(MeshHeader))
+    {
+        return false;
+    }
+    memcpy(&Header, pData, sizeof(MeshHeader));
+
+    const uint64_t kChecksum = Header.Checksum;
+    Header.Checksum = 0u;
+    if (Header.Magic != MeshHeader::MagicValue || Header.Version != Version || HashBytes(&Header, sizeof(MeshHeader)) != kChecksum ||
+        Header.StreamEnds[StreamCount - 1u] > kSize - sizeof(MeshHeader))
+    {
+        return false;
+    }
+
+    const uint8_t* pStreams       = pData + sizeof(MeshHeader);
+    const size_t   kVertexCount   = Header.VertexCount;
+    List<List<uint8_t>> Streams   = List<List<uint8_t>>(StreamCount);
+    bool                bStreamsValid[StreamCount] = {};
+    Parallel::For(StreamCount, 1u, [&](size_t kBegin, size_t kEnd)
+    {
+        for (size_t s = kBegin; s < kEnd; s++)
+        {
+            const uint32_t kStart = s > 0u ? Header.StreamEnds[s - 1u] : 0u;
+            const size_t   kMaxCount = s == IndexDeltas ? size_t(Header.IndexCount) * 5u : kVertexCount;
+            bStreamsValid[s] = kStart <= Header.StreamEnds[s] && DecodeBytes(pStreams + kStart, Header.StreamEnds[s] - kStart, Streams[s], kMaxCount) > 0u;
+        }
+    });
+    for (uint32_t s = 0u; s < StreamCount; s++)
+    {
+        if (!bStreamsValid[s] || (s != IndexDeltas && Streams[s].size() != kVertexCount))
+        {
+            return false;
+        }
+    }
+
+    List<uint16_t> Quantized = List<uint16_t>(kVertexCount * s_ComponentCount);
+    Parallel::For(s_ComponentCount, 1u, [&](size_t kBegin, size_t kEnd)
+    {
+        for (size_t c = kBegin; c < kEnd; c++)
+        {
+            ReconstructComponent(Streams[c * 2u].data(), Streams[c * 2u + 1u].data(), kVertexCount, Quantized.data() + c * kVertexCount);
+        }
+    });
+
+    const uint16_t* pComponents[s_ComponentCount] = {};
+    for (uint32_t c = 0u; c < s_ComponentCount; c++)
+    {
+        pComponents[c] = Quantized.data() + c * kVertexCount;
+    }
+
+    Vertices.resize(kVertexCount);
+    Parallel::For(kVertexCount, 65536u, [&](size_t kBegin, size_t kEnd)
+    {
+        DequantizeVertices(Header, pComponents, kBegin, kEnd, Vertices.data());
+    });
+
+    const List<uint8_t>& Varints = Streams[IndexDeltas];
+    const uint8_t*       pRead   = Varints.data();
+    const uint8_t*       pEnd    = pRead + Varints.size();
+    uint32_t             kFirst  = 0u;
+    Indices.resize(Header.IndexCount);
+    for (size_t k = 0u; k + 2u < Indices.size(); k += 3u)
+    {
+        uint32_t d[3] = {};
+        if (!ReadVarint(pRead, pEnd, d[0]) || !ReadVarint(pRead, pEnd, d[1]) || !ReadVarint(pRead, pEnd, d[2]))
+        {
+            return false;
+        }
+        kFirst          = kFirst + UnZigZag(d[0]);
+        Indices[k]      = kFirst;
+        Indices[k + 1u] = kFirst + UnZigZag(d[1]);
+        Indices[k + 2u] = kFirst + UnZigZag(d[2]);
+        if (Indices[k] >= kVertexCount || Indices[k + 1u] >= kVertexCount || Indices[k + 2u] >= kVertexCount)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+// FILES
+bool MeshCodec::SaveToFile(const char* lpFilepath, const List<MeshVertex>& Vertices, const List<uint32_t>& Indices) noexcept
+{
+    List<uint8_t> Bytes = {};
+    EncodeMesh(Vertices.data(), Vertices.size(), Indices.data(), Indices.size(), Bytes);
+
+    const String Temporary = String(lpFilepath) + ".tmp";
+    FILE* pFile = fopen(Temporary.c_str(), "wb");
+    if (!pFile)
+    {
+        return false;
+    }
+    const bool bWritten = fwrite(Bytes.data(), 1u, Bytes.size(), pFile) == Bytes.size();
+    if (fclose(pFile) != 0 || !bWritten)
+    {
+        remove(Temporary.c_str());
+        return false;
+    }
+
+    std::error_code Error = {};
+    std::filesystem::rename(Temporary, lpFilepath, Error);
+    return !Error;
+}
+
+bool MeshCodec::LoadFromFile(const char* lpFilepath, List<MeshVertex>& Vertices, List<uint32_t>& Indices) noexcept
+{
+    const MappedFile File = MappedFile(lpFilepath);
+    return File.IsOpen() && DecodeMesh(File.GetData(), File.GetSize(), Vertices, Indices);
+}
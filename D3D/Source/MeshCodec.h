@@ -0,0 +1,28 @@
+#pragma once
+
+#include "Core.h"
+
+// Compressed mesh assets. Indices are stored as per-triangle deltas, vertices are quantized (positions to the bounding
+// box, normals octahedrally), delta coded against the previous vertex and split into byte planes. Every stream then
+// goes through an order-0 rANS coder. Streams are independent, so decoding spreads them over the worker threads, and
+// the delta and dequantization passes run on SSE2.
+// Vertices should come in first use order, as MeshOptimizer::OptimizeVertexFetch() leaves them, for the deltas to stay small.
+class MeshCodec
+{
+public:
+	static constexpr uint32_t PositionBits = 16u; // Per axis, over the bounding box
+	static constexpr uint32_t NormalBits   = 12u; // Per octahedral coordinate
+	static constexpr uint32_t Version      = 1u;
+
+	static void EncodeMesh(const MeshVertex* pVertices, size_t kVertexCount, const uint32_t* pIndices, size_t kIndexCount, List<uint8_t>& Output) noexcept;
+	static bool DecodeMesh(const uint8_t* pData, size_t kSize, List<MeshVertex>& Vertices, List<uint32_t>& Indices) noexcept;
+
+	// Whole files, SaveToFile() writes through a temporary so a crash never leaves a truncated asset behind
+	static bool SaveToFile(const char* lpFilepath, const List<MeshVertex>& Vertices, const List<uint32_t>& Indices) noexcept;
+	static bool LoadFromFile(const char* lpFilepath, List<MeshVertex>& Vertices, List<uint32_t>& Indices) noexcept;
+
+	// Entropy coder on its own. DecodeBytes() returns the number of input bytes consumed, 0 for malformed input or
+	// blocks that would decode to more than kMaxCount bytes.
+	static void   EncodeBytes(const uint8_t* pBytes, size_t kSize, List<uint8_t>& Output) noexcept;
+	static size_t DecodeBytes(const uint8_t* pData, size_t kSize, List<uint8_t>& Output, size_t kMaxCount = SIZE_MAX) noexcept;
+};
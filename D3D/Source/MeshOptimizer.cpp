@@ -0,0 +1,451 @@
+#include "MeshOptimizer.h"
+
+#include <algorithm>
+#include <string.h>
+
+// Vertex -> triangles lookup in compressed row form
+struct TriangleAdjacency
+{
+    List<uint32_t> Offsets   = {};
+    List<uint32_t> Counts    = {};
+    List<uint32_t> Triangles = {};
+
+    TriangleAdjacency(const uint32_t* pIndices, size_t kIndexCount, size_t kVertexCount)
+        : Offsets(kVertexCount, 0u), Counts(kVertexCount, 0u), Triangles(kIndexCount, 0u)
+    {
+        for (size_t k = 0u; k < kIndexCount; k++)
+        {
+            Counts[pIndices[k]]++;
+        }
+
+        uint32_t kOffset = 0u;
+        for (size_t k = 0u; k < kVertexCount; k++)
+        {
+            Offsets[k] = kOffset;
+            kOffset   += Counts[k];
+        }
+
+        for (size_t k = 0u; k < kIndexCount; k++)
+        {
+            Triangles[Offsets[pIndices[k]]++] = uint32_t(k / 3u);
+        }
+        for (size_t k = 0u; k < kVertexCount; k++)
+        {
+            Offsets[k] -= Counts[k];
+        }
+    }
+};
+
+static inline Float3 Cross(const Float3& u, const Float3& v) noexcept
+{
+    return Float3(u.Y * v.Z - u.Z * v.Y, u.Z * v.X - u.X * v.Z, u.X * v.Y - u.Y * v.X);
+}
+
+static inline float Dot(const Float3& u, const Float3& v) noexcept
+{
+    return u.X * v.X + u.Y * v.Y + u.Z * v.Z;
+}
+
+// MESH OPTIMIZER
+VertexCacheStatistics MeshOptimizer::AnalyzeVertexCache(const uint32_t* pIndices, size_t kIndexCount, size_t kVertexCount, uint32_t kCacheSize) noexcept
+{
+    VertexCacheStatistics Statistics = {};
+    if (kIndexCount < 3u)
+    {
+        return Statistics;
+    }
+
+    // A vertex is in the FIFO if fewer than kCacheSize misses happened since it was inserted
+    List<uint32_t> Timestamps = List<uint32_t>(kVertexCount, 0u);
+    List<uint8_t>  Referenced = List<uint8_t>(kVertexCount, 0u);
+    uint32_t kTime = kCacheSize + 1u;
+    for (size_t k = 0u; k < kIndexCount; k++)
+    {
+        const uint32_t kVertex = pIndices[k];
+        Referenced[kVertex] = 1u;
+        if (kTime - Timestamps[kVertex] > kCacheSize)
+        {
+            Timestamps[kVertex] = kTime++;
+            Statistics.Misses++;
+        }
+    }
+
+    const size_t kUniqueCount = size_t(std::count(Referenced.begin(), Referenced.end(), uint8_t(1u)));
+    Statistics.ACMR = float(Statistics.Misses) / float(kIndexCount / 3u);
+    Statistics.ATVR = float(Statistics.Misses) / float(std::max<size_t>(1u, kUniqueCount));
+    return Statistics;
+}
+
+void MeshOptimizer::OptimizeVertexCache(uint32_t* pDestination, const uint32_t* pIndices, size_t kIndexCount, size_t kVertexCount, uint32_t kCacheSize, List<uint32_t>* pClusters) noexcept
+{
+    if (pClusters != nullptr)
+    {
+        pClusters->clear();
+    }
+    if (kIndexCount < 3u || kVertexCount == 0u)
+    {
+        return;
+    }
+
+    List<uint32_t> Indices = List<uint32_t>(pIndices, pIndices + kIndexCount); // pDestination may alias pIndices
+
+    const TriangleAdjacency Adjacency = TriangleAdjacency(Indices.data(), kIndexCount, kVertexCount);
+    List<uint32_t> LiveTriangles = Adjacency.Counts;
+    List<uint32_t> CacheTimes    = List<uint32_t>(kVertexCount, 0u);
+    List<uint8_t>  Emitted       = List<uint8_t>(kIndexCount / 3u, 0u);
+    List<uint32_t> DeadEnds      = {};
+    List<uint32_t> Candidates    = {};
+    DeadEnds.reserve(kIndexCount);
+    Candidates.reserve(64u);
+
+    uint32_t kTime        = kCacheSize + 1u;
+    uint32_t kCursor      = 0u;
+    uint32_t kOutputCount = 0u;
+    int64_t  kFanning     = 0;
+
+    auto SkipDeadEnd = [&]() -> int64_t
+    {
+        while (!DeadEnds.empty())
+        {
+            const uint32_t kVertex = DeadEnds.back();
+            DeadEnds.pop_back();
+            if (LiveTriangles[kVertex] > 0u)
+            {
+                return int64_t(kVertex);
+            }
+        }
+        while (kCursor < kVertexCount)
+        {
+            if (LiveTriangles[kCursor] > 0u)
+            {
+                return int64_t(kCursor);
+            }
+            kCursor++;
+        }
+        return -1;
+    };
+
+    // Unused vertices must not stall the cursor on the first restart
+    while (kCursor < kVertexCount && LiveTriangles[kCursor] == 0u)
+    {
+        kCursor++;
+    }
+    kFanning = kCursor < kVertexCount ? int64_t(kCursor) : -1;
+    if (pClusters != nullptr && kFanning >= 0)
+    {
+        pClusters->emplace_back(0u);
+    }
+
+    while (kFanning >= 0)
+    {
+        Candidates.clear();
+
+        const uint32_t kVertex = uint32_t(kFanning);
+        const uint32_t kBegin  = Adjacency.Offsets[kVertex];
+        const uint32_t kEnd    = kBegin + Adjacency.Counts[kVertex];
+        for (uint32_t j = kBegin; j < kEnd; j++)
+        {
+            const uint32_t kTriangle = Adjacency.Triangles[j];
+            if (Emitted[kTriangle])
+            {
+                continue;
+            }
+
+            for (uint32_t c = 0u; c < 3u; c++)
+            {
+                const uint32_t kCorner = Indices[kTriangle * 3u + c];
+                pDestination[kOutputCount++] = kCorner;
+                DeadEnds.emplace_back(kCorner);
+                Candidates.emplace_back(kCorner);
+                LiveTriangles[kCorner]--;
+                if (kTime - CacheTimes[kCorner] > kCacheSize)
+                {
+                    CacheTimes[kCorner] = kTime++;
+                }
+            }
+            Emitted[kTriangle] = 1u;
+        }
+
+        // Prefer the candidate that stays in the cache the longest while all of its triangles are emitted
+        int64_t kBest     = -1;
+        int64_t kPriority = -1;
+        for (const uint32_t& kCandidate : Candidates)
+        {
+            if (LiveTriangles[kCandidate] == 0u)
+            {
+                continue;
+            }
+
+            int64_t kCandidatePriority = 0;
+            const int64_t kAge = int64_t(kTime) - int64_t(CacheTimes[kCandidate]);
+            if (kAge + 2 * int64_t(LiveTriangles[kCandidate]) <= int64_t(kCacheSize))
+            {
+                kCandidatePriority = kAge;
+            }
+            if (kCandidatePriority > kPriority)
+            {
+                kPriority = kCandidatePriority;
+                kBest     = int64_t(kCandidate);
+            }
+        }
+
+        if (kBest < 0)
+        {
+            kBest = SkipDeadEnd();
+            if (pClusters != nullptr && kBest >= 0)
+            {
+                pClusters->emplace_back(kOutputCount / 3u);
+            }
+        }
+        kFanning = kBest;
+    }
+
+    assert(kOutputCount == kIndexCount);
+}
+
+void MeshOptimizer::OptimizeOverdraw(uint32_t* pDestination, const uint32_t* pIndices, size_t kIndexCount, const Float3* pPositions, size_t kPositionStride, size_t kVertexCount, const List<uint32_t>& Clusters, uint32_t kCacheSize, float Threshold) noexcept
+{
+    assert(pDestination != pIndices);
+
+    const size_t kTriangleCount = kIndexCount / 3u;
+    if (kTriangleCount == 0u)
+    {
+        return;
+    }
+    if (Clusters.size() <= 1u && kTriangleCount < 2u)
+    {
+        memcpy(pDestination, pIndices, kIndexCount * sizeof(uint32_t));
+        return;
+    }
+
+    auto Position = [pPositions, kPositionStride](uint32_t kVertex) -> const Float3&
+    {
+        return *reinterpret_cast<const Float3*>(reinterpret_cast<const uint8_t*>(pPositions) + size_t(kVertex) * kPositionStride);
+    };
+
+    // Soft boundaries: inside every hard cluster, cut again whenever the cache has warmed up enough
+    const float GlobalACMR = AnalyzeVertexCache(pIndices, kIndexCount, kVertexCount, kCacheSize).ACMR;
+
+    List<uint32_t> Boundaries = {};
+    Boundaries.reserve(Clusters.size() * 2u);
+    {
+        List<uint32_t> Timestamps = List<uint32_t>(kVertexCount, 0u);
+        uint32_t kTime = kCacheSize + 1u;
+
+        List<uint32_t> HardBoundaries = Clusters;
+        if (HardBoundaries.empty() || HardBoundaries.front() != 0u)
+        {
+            HardBoundaries.insert(HardBoundaries.begin(), 0u);
+        }
+        HardBoundaries.emplace_back(uint32_t(kTriangleCount));
+
+        for (size_t c = 0u; c + 1u < HardBoundaries.size(); c++)
+        {
+            uint32_t kStart  = HardBoundaries[c];
+            uint32_t kMisses = 0u;
+            Boundaries.emplace_back(kStart);
+            for (uint32_t t = HardBoundaries[c]; t < HardBoundaries[c + 1u]; t++)
+            {
+                for (uint32_t j = 0u; j < 3u; j++)
+                {
+                    const uint32_t kVertex = pIndices[t * 3u + j];
+                    if (kTime - Timestamps[kVertex] > kCacheSize)
+                    {
+                        Timestamps[kVertex] = kTime++;
+                        kMisses++;
+                    }
+                }
+
+                const uint32_t kLength = t + 1u - kStart;
+                if (t + 1u < HardBoundaries[c + 1u] && float(kMisses) / float(kLength) <= Threshold * GlobalACMR)
+                {
+                    kStart  = t + 1u;
+                    kMisses = 0u;
+                    Boundaries.emplace_back(kStart);
+                    // Next cluster starts cold so it can be moved anywhere
+                    kTime += kCacheSize + 1u;
+                }
+            }
+        }
+        Boundaries.emplace_back(uint32_t(kTriangleCount));
+    }
+
+    // Sort key: how much the cluster faces away from the mesh centre
+    Float3 MeshCentroid = Float3(0.0f);
+    for (size_t k = 0u; k < kIndexCount; k++)
+    {
+        MeshCentroid = MeshCentroid + Position(pIndices[k]);
+    }
+    MeshCentroid = MeshCentroid / Float3(float(kIndexCount));
+
+    const size_t kClusterCount = Boundaries.size() - 1u;
+    List<float>    SortKeys = List<float>(kClusterCount, 0.0f);
+    List<uint32_t> Order    = List<uint32_t>(kClusterCount, 0u);
+    for (size_t c = 0u; c < kClusterCount; c++)
+    {
+        Float3 Centroid = Float3(0.0f);
+        Float3 Normal   = Float3(0.0f);
+        float  Area     = 0.0f;
+        for (uint32_t t = Boundaries[c]; t < Boundaries[c + 1u]; t++)
+        {
+            const Float3& a = Position(pIndices[t * 3u + 0u]);
+            const Float3& b = Position(pIndices[t * 3u + 1u]);
+            const Float3& d = Position(pIndices[t * 3u + 2u]);
+            const Float3  n = Cross(b - a, d - a);
+            const float   TriangleArea = sqrtf(Dot(n, n));
+
+            Centroid = Centroid + (a + b + d) * Float3(TriangleArea / 3.0f);
+            Normal   = Normal + n;
+            Area    += TriangleArea;
+        }
+        if (Area > 0.0f)
+        {
+            Centroid = Centroid / Float3(Area);
+        }
+        const float Length = sqrtf(Dot(Normal, Normal));
+        if (Length > 0.0f)
+        {
+            Normal = Normal / Float3(Length);
+        }
+        SortKeys[c] = Dot(Centroid - MeshCentroid, Normal);
+        Order[c]    = uint32_t(c);
+    }
+
+    std::stable_sort(Order.begin(), Order.end(), [&SortKeys](uint32_t a, uint32_t b) { return SortKeys[a] > SortKeys[b]; });
+
+    size_t kOffset = 0u;
+    for (const uint32_t& kCluster : Order)
+    {
+        const size_t kBegin = size_t(Boundaries[kCluster]) * 3u;
+        const size_t kCount = size_t(Boundaries[kCluster + 1u]) * 3u - kBegin;
+        memcpy(pDestination + kOffset, pIndices + kBegin, kCount * sizeof(uint32_t));
+        kOffset += kCount;
+    }
+    assert(kOffset == kTriangleCount * 3u);
+}
+
+size_t MeshOptimizer::OptimizeVertexFetch(void* pDestination, uint32_t* pIndices, size_t kIndexCount, const void* pVertices, size_t kVertexCount, size_t kVertexSize) noexcept
+{
+    assert(pDestination != pVertices);
+
+    List<uint32_t> Remap = List<uint32_t>(kVertexCount, UINT32_MAX);
+    uint32_t kNextVertex = 0u;
+    for (size_t k = 0u; k < kIndexCount; k++)
+    {
+        uint32_t& kTarget = Remap[pIndices[k]];
+        if (kTarget == UINT32_MAX)
+        {
+            kTarget = kNextVertex++;
+            memcpy(static_cast<uint8_t*>(pDestination) + size_t(kTarget) * kVertexSize,
+                   static_cast<const uint8_t*>(pVertices) + size_t(pIndices[k]) * kVertexSize, kVertexSize);
+        }
+        pIndices[k] = kTarget;
+    }
+    return size_t(kNextVertex);
+}
+
+void MeshOptimizer::SplitIndexChunks(uint16_t* pDestination, const uint32_t* pIndices, size_t kIndexCount, size_t kVertexCount, List<uint32_t>& VertexRemap, List<IndexChunk>& Chunks) noexcept
+{
+    static constexpr uint32_t s_MaxChunkVertices = uint32_t(UINT16_MAX) + 1u;
+
+    VertexRemap.clear();
+    Chunks.clear();
+
+    // Local index of every source vertex in the current chunk, valid when its stamp matches the chunk
+    List<uint32_t> Stamps = List<uint32_t>(kVertexCount, UINT32_MAX);
+    List<uint16_t> Local  = List<uint16_t>(kVertexCount, 0u);
+
+    IndexChunk Current = {};
+    uint32_t   kLocalCount = 0u;
+    for (size_t k = 0u; k + 2u < kIndexCount; k += 3u)
+    {
+        const uint32_t kChunk = uint32_t(Chunks.size());
+
+        uint32_t kNewVertices = 0u;
+        for (size_t j = 0u; j < 3u; j++)
+        {
+            kNewVertices += Stamps[pIndices[k + j]] != kChunk ? 1u : 0u;
+        }
+        if (kLocalCount + kNewVertices > s_MaxChunkVertices)
+        {
+            Chunks.push_back(Current);
+            Current = {};
+            Current.IndexOffset = uint32_t(k);
+            Current.BaseVertex  = int32_t(VertexRemap.size());
+            kLocalCount = 0u;
+        }
+
+        for (size_t j = 0u; j < 3u; j++)
+        {
+            const uint32_t kVertex = pIndices[k + j];
+            if (Stamps[kVertex] != uint32_t(Chunks.size()))
+            {
+                Stamps[kVertex] = uint32_t(Chunks.size());
+                Local[kVertex]  = uint16_t(kLocalCount++);
+                VertexRemap.push_back(kVertex);
+            }
+            pDestination[k + j] = Local[kVertex];
+        }
+        Current.IndexCount += 3u;
+    }
+
+    if (Current.IndexCount > 0u)
+    {
+        Chunks.push_back(Current);
+    }
+}
+
+BoundingSphere MeshOptimizer::ComputeBoundingSphere(const Float3* pPositions, size_t kPositionStride, size_t kVertexCount) noexcept
+{
+    auto Position = [pPositions, kPositionStride](size_t kVertex) -> const Float3&
+    {
+        return *reinterpret_cast<const Float3*>(reinterpret_cast<const uint8_t*>(pPositions) + kVertex * kPositionStride);
+    };
+
+    BoundingSphere Sphere = {};
+    if (kVertexCount == 0u)
+    {
+        return Sphere;
+    }
+
+    // Widest pair of axis extremes seeds the sphere
+    size_t kMin[3] = { 0u, 0u, 0u };
+    size_t kMax[3] = { 0u, 0u, 0u };
+    for (size_t k = 1u; k < kVertexCount; k++)
+    {
+        const float* p = &Position(k).X;
+        for (size_t a = 0u; a < 3u; a++)
+        {
+            if (p[a] < (&Position(kMin[a]).X)[a]) kMin[a] = k;
+            if (p[a] > (&Position(kMax[a]).X)[a]) kMax[a] = k;
+        }
+    }
+
+    float BestSpan = -1.0f;
+    for (size_t a = 0u; a < 3u; a++)
+    {
+        const Float3 d    = Position(kMax[a]) - Position(kMin[a]);
+        const float  Span = Dot(d, d);
+        if (Span > BestSpan)
+        {
+            BestSpan      = Span;
+            Sphere.Center = (Position(kMin[a]) + Position(kMax[a])) * Float3(0.5f);
+            Sphere.Radius = sqrtf(Span) * 0.5f;
+        }
+    }
+
+    // Grow towards every point left outside
+    for (size_t k = 0u; k < kVertexCount; k++)
+    {
+        const Float3 d = Position(k) - Sphere.Center;
+        const float  Distance = sqrtf(Dot(d, d));
+        if (Distance > Sphere.Radius)
+        {
+            const float Radius = (Sphere.Radius + Distance) * 0.5f;
+            Sphere.Center = Sphere.Center + d * Float3((Radius - Sphere.Radius) / Distance);
+            Sphere.Radius = Radius;
+        }
+    }
+
+    return Sphere;
+}
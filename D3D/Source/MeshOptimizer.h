@@ -0,0 +1,123 @@
+#pragma once
+
+#include "Core.h"
+
+struct VertexCacheStatistics
+{
+	uint32_t Misses = 0u;
+	float    ACMR   = 0.0f; // Average cache misses per triangle, 0.5 is the ideal for large meshes
+	float    ATVR   = 0.0f; // Average transforms per referenced vertex, 1.0 is the ideal
+};
+
+struct BoundingSphere
+{
+	Float3 Center = {};
+	float  Radius = 0.0f;
+};
+
+// A run of 16-bit indices drawn relative to BaseVertex
+struct IndexChunk
+{
+	uint32_t IndexOffset = 0u;
+	uint32_t IndexCount  = 0u;
+	int32_t  BaseVertex  = 0;
+};
+
+struct MeshOptimizationReport
+{
+	VertexCacheStatistics Before = {};
+	VertexCacheStatistics After  = {};
+};
+
+// Index/vertex reordering for the post-transform vertex cache, overdraw and vertex fetch locality.
+// Everything here is pure CPU and works on 32-bit triangle lists.
+class MeshOptimizer
+{
+public:
+	static constexpr uint32_t DefaultCacheSize = 16u;
+
+	// FIFO cache simulation
+	static VertexCacheStatistics AnalyzeVertexCache(const uint32_t* pIndices, size_t kIndexCount, size_t kVertexCount, uint32_t kCacheSize = DefaultCacheSize) noexcept;
+
+	// Tipsify (Sander, Nehab & Barczak 2007). pClusters receives the first triangle of every cluster the fan
+	// walk had to restart from a dead end, which is what OptimizeOverdraw() reorders.
+	static void   OptimizeVertexCache(uint32_t* pDestination, const uint32_t* pIndices, size_t kIndexCount, size_t kVertexCount, uint32_t kCacheSize = DefaultCacheSize, List<uint32_t>* pClusters = nullptr) noexcept;
+
+	// Splits the clusters further where the cache is warm (local ACMR <= Threshold * global ACMR) and sorts them
+	// so outward facing clusters are drawn first. pDestination must not alias pIndices.
+	static void   OptimizeOverdraw(uint32_t* pDestination, const uint32_t* pIndices, size_t kIndexCount, const Float3* pPositions, size_t kPositionStride, size_t kVertexCount, const List<uint32_t>& Clusters, uint32_t kCacheSize = DefaultCacheSize, float Threshold = 1.05f) noexcept;
+
+	// Reorders vertices by first use and rewrites the indices. Unreferenced vertices are dropped, returns the new vertex count.
+	static size_t OptimizeVertexFetch(void* pDestination, uint32_t* pIndices, size_t kIndexCount, const void* pVertices, size_t kVertexCount, size_t kVertexSize) noexcept;
+
+	// Cuts a triangle list into consecutive chunks referencing at most 65536 vertices each and gives every chunk its own
+	// contiguous copy of them, so the indices fit in 16 bits relative to the chunk's BaseVertex. Index positions are
+	// unchanged. VertexRemap receives the source vertex of every output vertex.
+	static void   SplitIndexChunks(uint16_t* pDestination, const uint32_t* pIndices, size_t kIndexCount, size_t kVertexCount, List<uint32_t>& VertexRemap, List<IndexChunk>& Chunks) noexcept;
+
+	// Ritter's approximate bounding sphere, within a few percent of the minimal one
+	static BoundingSphere ComputeBoundingSphere(const Float3* pPositions, size_t kPositionStride, size_t kVertexCount) noexcept;
+
+	// As above, rebuilding Vertices in place
+	template<typename V>
+	static void   SplitIndexChunks(List<V>& Vertices, const List<uint32_t>& Indices, List<uint16_t>& Destination, List<IndexChunk>& Chunks);
+
+	// Runs the three passes above in order on a vertex type with a Float3 Position member. Each triangle order is
+	// only kept when it misses the cache less than the input: faceted meshes leave Tipsify so many small clusters
+	// that sorting them for overdraw can cost more than it saves, and then the Tipsify order, or failing that the
+	// input order, is kept instead.
+	template<typename V>
+	static MeshOptimizationReport Optimize(List<V>& Vertices, List<uint32_t>& Indices, uint32_t kCacheSize = DefaultCacheSize);
+};
+
+
+template<typename V>
+inline MeshOptimizationReport MeshOptimizer::Optimize(List<V>& Vertices, List<uint32_t>& Indices, uint32_t kCacheSize)
+{
+	MeshOptimizationReport Report = {};
+	if (Vertices.empty() || Indices.empty())
+	{
+		return Report;
+	}
+
+	Report.Before = AnalyzeVertexCache(Indices.data(), Indices.size(), Vertices.size(), kCacheSize);
+
+	List<uint32_t> Clusters  = {};
+	List<uint32_t> Reordered = List<uint32_t>(Indices.size());
+	List<uint32_t> Sorted    = List<uint32_t>(Indices.size());
+	OptimizeVertexCache(Reordered.data(), Indices.data(), Indices.size(), Vertices.size(), kCacheSize, &Clusters);
+	OptimizeOverdraw(Sorted.data(), Reordered.data(), Indices.size(), &Vertices[0].Position, sizeof(V), Vertices.size(), Clusters, kCacheSize);
+
+	// Vertex fetch order does not change either statistic, they can be compared before it
+	if (AnalyzeVertexCache(Sorted.data(), Sorted.size(), Vertices.size(), kCacheSize).Misses < Report.Before.Misses)
+	{
+		Indices.swap(Sorted);
+	}
+	else if (AnalyzeVertexCache(Reordered.data(), Reordered.size(), Vertices.size(), kCacheSize).Misses < Report.Before.Misses)
+	{
+		Indices.swap(Reordered);
+	}
+
+	List<V> Fetched = List<V>(Vertices.size());
+	const size_t kVertexCount = OptimizeVertexFetch(Fetched.data(), Indices.data(), Indices.size(), Vertices.data(), Vertices.size(), sizeof(V));
+	Fetched.resize(kVertexCount);
+	Vertices.swap(Fetched);
+
+	Report.After = AnalyzeVertexCache(Indices.data(), Indices.size(), Vertices.size(), kCacheSize);
+	return Report;
+}
+
+template<typename V>
+inline void MeshOptimizer::SplitIndexChunks(List<V>& Vertices, const List<uint32_t>& Indices, List<uint16_t>& Destination, List<IndexChunk>& Chunks)
+{
+	List<uint32_t> VertexRemap = {};
+	Destination.resize(Indices.size());
+	SplitIndexChunks(Destination.data(), Indices.data(), Indices.size(), Vertices.size(), VertexRemap, Chunks);
+
+	List<V> Split = List<V>(VertexRemap.size());
+	for (size_t k = 0u; k < VertexRemap.size(); k++)
+	{
+		Split[k] = Vertices[VertexRemap[k]];
+	}
+	Vertices.swap(Split);
+}
@@ -0,0 +1,327 @@
+#include "Meshlet.h"
+
+#include <algorithm>
+#include <float.h>
+#include <string.h>
+
+static inline Float3 Cross(const Float3& u, const Float3& v) noexcept
+{
+    return Float3(u.Y * v.Z - u.Z * v.Y, u.Z * v.X - u.X * v.Z, u.X * v.Y - u.Y * v.X);
+}
+
+static inline float Dot(const Float3& u, const Float3& v) noexcept
+{
+    return u.X * v.X + u.Y * v.Y + u.Z * v.Z;
+}
+
+// Bounding sphere of the vertices and normal cone of the triangles, the average facing and the widest deviation from it
+static void FinishMeshlet(Meshlet& m, const List<Float3>& Points, const List<Float3>& Normals, const List<uint32_t>& Triangles) noexcept
+{
+    m.Bounds = MeshOptimizer::ComputeBoundingSphere(Points.data(), sizeof(Float3), Points.size());
+
+    Float3 Axis = {};
+    for (const uint32_t& kTriangle : Triangles)
+    {
+        Axis = Axis + Normals[kTriangle];
+    }
+
+    const float AxisLength = sqrtf(Dot(Axis, Axis));
+    float MinDot = 1.0f;
+    if (AxisLength > 0.0f)
+    {
+        Axis = Axis / Float3(AxisLength);
+        for (const uint32_t& kTriangle : Triangles)
+        {
+            const Float3& n = Normals[kTriangle];
+            if (Dot(n, n) > 0.0f)
+            {
+                MinDot = std::min(MinDot, Dot(n, Axis));
+            }
+        }
+    }
+
+    // Cones wider than ~85 degrees almost never cull anything, don't bother testing them
+    if (AxisLength > 0.0f && MinDot > 0.1f)
+    {
+        m.ConeAxis   = Axis;
+        m.ConeCutoff = sqrtf(1.0f - MinDot * MinDot);
+    }
+    else
+    {
+        m.ConeAxis   = Float3();
+        m.ConeCutoff = 1.0f;
+    }
+}
+
+// MESHLET BUILDER
+List<Meshlet> MeshletBuilder::Build(uint32_t* pDestination, const uint32_t* pIndices, size_t kIndexCount, uint32_t kIndexOffset, const Float3* pPositions, size_t kPositionStride, size_t kVertexCount, uint32_t kMaxVertices, uint32_t kMaxTriangles) noexcept
+{
+    auto Position = [pPositions, kPositionStride](uint32_t kVertex) -> const Float3&
+    {
+        return *reinterpret_cast<const Float3*>(reinterpret_cast<const uint8_t*>(pPositions) + size_t(kVertex) * kPositionStride);
+    };
+
+    const size_t kTriangleCount = kIndexCount / 3u;
+
+    // Flat shaded meshes share no vertices, so neighbours are found through positions
+    List<uint32_t> Canonical = List<uint32_t>(kVertexCount, 0u);
+    {
+        List<uint32_t> Order = List<uint32_t>(kVertexCount, 0u);
+        for (uint32_t k = 0u; k < uint32_t(kVertexCount); k++)
+        {
+            Order[k] = k;
+        }
+        std::sort(Order.begin(), Order.end(), [&Position](uint32_t a, uint32_t b)
+        {
+            const Float3& p = Position(a);
+            const Float3& q = Position(b);
+            if (p.X != q.X) return p.X < q.X;
+            if (p.Y != q.Y) return p.Y < q.Y;
+            if (p.Z != q.Z) return p.Z < q.Z;
+            return a < b;
+        });
+        for (size_t k = 0u; k < kVertexCount; k++)
+        {
+            const bool bSame = k > 0u && memcmp(&Position(Order[k]), &Position(Order[k - 1u]), sizeof(Float3)) == 0;
+            Canonical[Order[k]] = bSame ? Canonical[Order[k - 1u]] : Order[k];
+        }
+    }
+
+    List<uint32_t> Offsets  = List<uint32_t>(kVertexCount + 1u, 0u);
+    List<uint32_t> Adjacent = List<uint32_t>(kTriangleCount * 3u, 0u);
+    for (size_t k = 0u; k < kTriangleCount * 3u; k++)
+    {
+        Offsets[Canonical[pIndices[k]] + 1u]++;
+    }
+    for (size_t k = 0u; k < kVertexCount; k++)
+    {
+        Offsets[k + 1u] += Offsets[k];
+    }
+    {
+        List<uint32_t> Cursor = List<uint32_t>(Offsets.begin(), Offsets.end() - 1);
+        for (size_t k = 0u; k < kTriangleCount * 3u; k++)
+        {
+            Adjacent[Cursor[Canonical[pIndices[k]]]++] = uint32_t(k / 3u);
+        }
+    }
+
+    List<Float3> Normals = List<Float3>(kTriangleCount);
+    for (size_t k = 0u; k < kTriangleCount; k++)
+    {
+        const Float3& p0 = Position(pIndices[k * 3u + 0u]);
+        const Float3& p1 = Position(pIndices[k * 3u + 1u]);
+        const Float3& p2 = Position(pIndices[k * 3u + 2u]);
+        const Float3  n  = Cross(p1 - p0, p2 - p0);
+        const float   Length = sqrtf(Dot(n, n));
+        Normals[k] = Length > 0.0f ? n / Float3(Length) : Float3();
+    }
+
+    List<Meshlet>  Meshlets   = {};
+    List<uint32_t> Result     = {};
+    List<uint32_t> Owner      = List<uint32_t>(kVertexCount, UINT32_MAX);
+    List<uint32_t> Listed     = List<uint32_t>(kTriangleCount, UINT32_MAX);
+    List<uint8_t>  Used       = List<uint8_t>(kTriangleCount, 0u);
+    List<uint32_t> Candidates = {};
+    List<uint32_t> Members    = {};
+    List<Float3>   Points     = {};
+    Result.reserve(kTriangleCount * 3u);
+    Members.reserve(kMaxTriangles);
+    Points.reserve(kMaxVertices);
+
+    size_t kSeed = 0u;
+    while (true)
+    {
+        while (kSeed < kTriangleCount && Used[kSeed])
+        {
+            kSeed++;
+        }
+        if (kSeed == kTriangleCount)
+        {
+            break;
+        }
+
+        const uint32_t kMeshlet = uint32_t(Meshlets.size());
+
+        Meshlet Current = {};
+        Current.IndexOffset = kIndexOffset + uint32_t(Result.size());
+        Float3 Axis = {};
+        Candidates.clear();
+        Members.clear();
+        Points.clear();
+
+        uint32_t kNext = uint32_t(kSeed);
+        while (true)
+        {
+            // Add the triangle and queue its unused neighbours
+            Used[kNext] = 1u;
+            Members.push_back(kNext);
+            Axis = Axis + Normals[kNext];
+            for (size_t j = 0u; j < 3u; j++)
+            {
+                const uint32_t kVertex = pIndices[size_t(kNext) * 3u + j];
+                Result.push_back(kVertex);
+                if (Owner[kVertex] != kMeshlet)
+                {
+                    Owner[kVertex] = kMeshlet;
+                    Points.push_back(Position(kVertex));
+                    Current.VertexCount++;
+                }
+
+                const uint32_t kCanonical = Canonical[kVertex];
+                for (uint32_t a = Offsets[kCanonical]; a < Offsets[kCanonical + 1u]; a++)
+                {
+                    const uint32_t kTriangle = Adjacent[a];
+                    if (!Used[kTriangle] && Listed[kTriangle] != kMeshlet)
+                    {
+                        Listed[kTriangle] = kMeshlet;
+                        Candidates.push_back(kTriangle);
+                    }
+                }
+            }
+            Current.TriangleCount++;
+
+            if (Current.TriangleCount >= kMaxTriangles)
+            {
+                break;
+            }
+
+            // Fewest new vertices first, then the triangle closest to the current facing
+            const float AxisLength = sqrtf(Dot(Axis, Axis));
+            const Float3 Facing = AxisLength > 0.0f ? Axis / Float3(AxisLength) : Float3();
+
+            float  BestScore = FLT_MAX;
+            size_t kBest     = SIZE_MAX;
+            size_t kKept     = 0u;
+            for (size_t c = 0u; c < Candidates.size(); c++)
+            {
+                const uint32_t kTriangle = Candidates[c];
+                if (Used[kTriangle])
+                {
+                    continue;
+                }
+                Candidates[kKept] = kTriangle;
+
+                uint32_t kNewVertices = 0u;
+                for (size_t j = 0u; j < 3u; j++)
+                {
+                    kNewVertices += Owner[pIndices[size_t(kTriangle) * 3u + j]] != kMeshlet ? 1u : 0u;
+                }
+                if (Current.VertexCount + kNewVertices <= kMaxVertices)
+                {
+                    const float Score = float(kNewVertices) + (1.0f - Dot(Normals[kTriangle], Facing));
+                    if (Score < BestScore)
+                    {
+                        BestScore = Score;
+                        kBest     = kKept;
+                    }
+                }
+                kKept++;
+            }
+            Candidates.resize(kKept);
+
+            if (kBest == SIZE_MAX)
+            {
+                break;
+            }
+            kNext = Candidates[kBest];
+        }
+
+        FinishMeshlet(Current, Points, Normals, Members);
+        Meshlets.push_back(Current);
+    }
+
+    // Meshlets facing the same way get culled together, keep them adjacent so the visible ones merge into few draws
+    auto Bucket = [](const Meshlet& m) -> uint32_t
+    {
+        if (m.ConeCutoff >= 1.0f)
+        {
+            return 6u;
+        }
+        const float x = fabsf(m.ConeAxis.X), y = fabsf(m.ConeAxis.Y), z = fabsf(m.ConeAxis.Z);
+        const uint32_t kAxis = x >= y && x >= z ? 0u : (y >= z ? 1u : 2u);
+        return kAxis * 2u + ((&m.ConeAxis.X)[kAxis] < 0.0f ? 1u : 0u);
+    };
+    List<uint32_t> Order = List<uint32_t>(Meshlets.size(), 0u);
+    for (uint32_t k = 0u; k < uint32_t(Meshlets.size()); k++)
+    {
+        Order[k] = k;
+    }
+    std::stable_sort(Order.begin(), Order.end(), [&](uint32_t a, uint32_t b) { return Bucket(Meshlets[a]) < Bucket(Meshlets[b]); });
+
+    // Growth order is poor for the vertex cache, re-run it inside each meshlet on local vertex ids
+    List<Meshlet>  Sorted = {};
+    List<uint32_t> Local  = {};
+    List<uint32_t> Global = {};
+    Sorted.reserve(Meshlets.size());
+    uint32_t kOffset = 0u;
+    for (const uint32_t& kMeshlet : Order)
+    {
+        Meshlet m = Meshlets[kMeshlet];
+        const uint32_t* pSource = Result.data() + (m.IndexOffset - kIndexOffset);
+        const size_t    kCount  = size_t(m.TriangleCount) * 3u;
+
+        Local.resize(kCount);
+        Global.clear();
+        for (size_t k = 0u; k < kCount; k++)
+        {
+            const uint32_t kVertex = pSource[k];
+            auto it = std::find(Global.begin(), Global.end(), kVertex);
+            Local[k] = uint32_t(it - Global.begin());
+            if (it == Global.end())
+            {
+                Global.push_back(kVertex);
+            }
+        }
+        MeshOptimizer::OptimizeVertexCache(Local.data(), Local.data(), kCount, Global.size());
+        for (size_t k = 0u; k < kCount; k++)
+        {
+            pDestination[kOffset + k] = Global[Local[k]];
+        }
+
+        m.IndexOffset = kIndexOffset + kOffset;
+        kOffset += uint32_t(kCount);
+        Sorted.push_back(m);
+    }
+
+    return Sorted;
+}
+
+void MeshletBuilder::Cull(const List<Meshlet>& Meshlets, const Float4* pPlanes, const Float3& CameraPosition, List<IndexRange>& Ranges, uint32_t kMaxGap) noexcept
+{
+    for (const Meshlet& m : Meshlets)
+    {
+        if (!IsVisible(m.Bounds, pPlanes))
+        {
+            continue;
+        }
+
+        const Float3 d = m.Bounds.Center - CameraPosition;
+        if (Dot(d, m.ConeAxis) >= m.ConeCutoff * sqrtf(Dot(d, d)) + m.Bounds.Radius)
+        {
+            continue;
+        }
+
+        if (!Ranges.empty() && Ranges.back().IndexOffset + Ranges.back().IndexCount + kMaxGap >= m.IndexOffset)
+        {
+            Ranges.back().IndexCount = m.IndexOffset + m.TriangleCount * 3u - Ranges.back().IndexOffset;
+        }
+        else
+        {
+            Ranges.push_back({ m.IndexOffset, m.TriangleCount * 3u });
+        }
+    }
+}
+
+bool MeshletBuilder::IsVisible(const BoundingSphere& Bounds, const Float4* pPlanes) noexcept
+{
+    for (size_t k = 0u; k < 6u; k++)
+    {
+        const Float4& p = pPlanes[k];
+        const float Distance = p.X * Bounds.Center.X + p.Y * Bounds.Center.Y + p.Z * Bounds.Center.Z + p.W;
+        if (Distance < -Bounds.Radius * sqrtf(p.X * p.X + p.Y * p.Y + p.Z * p.Z))
+        {
+            return false;
+        }
+    }
+    return true;
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include "Core.h"
+#include "MeshOptimizer.h"
+
+struct IndexRange
+{
+	uint32_t IndexOffset = 0u;
+	uint32_t IndexCount  = 0u;
+};
+
+// A run of consecutive triangles in the index buffer, small enough that a bounding sphere and a normal cone
+// describe it well. D3D11 has no mesh shaders, so a meshlet is drawn as a plain index range.
+struct Meshlet
+{
+	uint32_t       IndexOffset   = 0u;
+	uint32_t       TriangleCount = 0u;
+	uint32_t       VertexCount   = 0u;
+	BoundingSphere Bounds        = {};
+	Float3         ConeAxis      = {};
+	float          ConeCutoff    = 1.0f; // Back facing from every point p with dot(c - p, axis) >= cutoff * |c - p| + radius, 1 never culls
+};
+
+class MeshletBuilder
+{
+public:
+	static constexpr uint32_t MaxVertices  = 64u;
+	static constexpr uint32_t MaxTriangles = 124u;
+
+	// Grows meshlets greedily over triangles sharing a position, preferring ones that add few vertices and keep the
+	// normal cone narrow, and writes the triangles grouped by meshlet to pDestination (may alias pIndices).
+	// kIndexOffset is where the indices start in the index buffer.
+	static List<Meshlet> Build(uint32_t* pDestination, const uint32_t* pIndices, size_t kIndexCount, uint32_t kIndexOffset, const Float3* pPositions, size_t kPositionStride, size_t kVertexCount, uint32_t kMaxVertices = MaxVertices, uint32_t kMaxTriangles = MaxTriangles) noexcept;
+
+	// Appends the index ranges of the meshlets that are inside the frustum and not back facing. Ranges closer than
+	// kMaxGap indices are merged, drawing a few culled triangles is cheaper than another draw call.
+	// Planes and camera are in the meshlets' space, planes are (n, d) with dot(n, p) + d >= 0 inside.
+	static void          Cull(const List<Meshlet>& Meshlets, const Float4* pPlanes, const Float3& CameraPosition, List<IndexRange>& Ranges, uint32_t kMaxGap = MaxTriangles * 3u) noexcept;
+
+	static bool          IsVisible(const BoundingSphere& Bounds, const Float4* pPlanes) noexcept;
+};
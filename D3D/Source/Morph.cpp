@@ -0,0 +1,76 @@
+#include "Morph.h"
+
+#include <algorithm>
+#include <emmintrin.h>
+
+static_assert(sizeof(MorphDelta) == sizeof(MeshVertex), "MorphDelta must match the MeshVertex layout");
+
+// MORPHING
+void Morphing::AddDeltas(MorphTarget& Target, const MeshVertex* pBase, const MeshVertex* pMorphed, const uint32_t* pVertices, size_t kCount, float Tolerance) noexcept
+{
+    for (size_t k = 0u; k < kCount; k++)
+    {
+        const MeshVertex& a = pBase[k];
+        const MeshVertex& b = pMorphed[k];
+
+        MorphDelta Delta = {};
+        Delta.Position = Float3(b.Position.X - a.Position.X, b.Position.Y - a.Position.Y, b.Position.Z - a.Position.Z);
+        Delta.Normal   = Float3(b.Normal.X   - a.Normal.X,   b.Normal.Y   - a.Normal.Y,   b.Normal.Z   - a.Normal.Z);
+
+        const float Largest = std::max({ fabsf(Delta.Position.X), fabsf(Delta.Position.Y), fabsf(Delta.Position.Z),
+                                         fabsf(Delta.Normal.X),   fabsf(Delta.Normal.Y),   fabsf(Delta.Normal.Z) });
+        if (Largest > Tolerance)
+        {
+            Target.Vertices.emplace_back(pVertices[k]);
+            Target.Deltas.emplace_back(Delta);
+        }
+    }
+}
+
+uint32_t Morphing::Apply(const MeshVertex* pBase, const MorphTarget* pTargets, const float* pWeights, size_t kTargetCount, MeshVertex* pVertices, List<uint32_t>& ActiveTargets) noexcept
+{
+    uint32_t kWritten = 0u;
+
+    // Back to the base shape, only where something was added last time
+    for (const uint32_t kTarget : ActiveTargets)
+    {
+        for (const uint32_t v : pTargets[kTarget].Vertices)
+        {
+            pVertices[v] = pBase[v];
+        }
+        kWritten += uint32_t(pTargets[kTarget].Vertices.size());
+    }
+    ActiveTargets.clear();
+
+    for (size_t t = 0u; t < kTargetCount; t++)
+    {
+        if (pWeights[t] == 0.0f)
+        {
+            continue;
+        }
+        ActiveTargets.emplace_back(uint32_t(t));
+
+        // Six floats per vertex: position and normal X in one register, normal Y and Z in the low half of another
+        const MorphTarget& Target = pTargets[t];
+        const __m128       Weight = _mm_set1_ps(pWeights[t]);
+        for (size_t k = 0u; k < Target.Vertices.size(); k++)
+        {
+            float*       pV = &pVertices[Target.Vertices[k]].Position.X;
+            const float* pD = &Target.Deltas[k].Position.X;
+
+            _mm_storeu_ps(pV, _mm_add_ps(_mm_loadu_ps(pV), _mm_mul_ps(_mm_loadu_ps(pD), Weight)));
+
+            const __m128 v = _mm_loadl_pi(_mm_setzero_ps(), reinterpret_cast<const __m64*>(pV + 4));
+            const __m128 d = _mm_loadl_pi(_mm_setzero_ps(), reinterpret_cast<const __m64*>(pD + 4));
+            _mm_storel_pi(reinterpret_cast<__m64*>(pV + 4), _mm_add_ps(v, _mm_mul_ps(d, Weight)));
+        }
+        kWritten += uint32_t(Target.Vertices.size());
+    }
+
+    return kWritten;
+}
+
+size_t Morphing::GetByteSize(const MorphTarget& Target) noexcept
+{
+    return Target.Name.capacity() + Target.Vertices.capacity() * sizeof(uint32_t) + Target.Deltas.capacity() * sizeof(MorphDelta);
+}
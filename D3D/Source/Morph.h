@@ -0,0 +1,36 @@
+#pragma once
+
+#include "Core.h"
+
+// Offset of one vertex at full weight, laid out like MeshVertex so both can be processed the same way
+struct MorphDelta
+{
+	Float3 Position = {};
+	Float3 Normal   = {};
+};
+
+// A blend shape stored sparsely, only the vertices it actually moves
+struct MorphTarget
+{
+	String           Name          = {};
+	uint32_t         Mesh          = 0u;   // Part it deforms
+	float            DefaultWeight = 0.0f;
+	List<uint32_t>   Vertices      = {};   // Ascending, into the same vertex array the part's VertexOffset refers to
+	List<MorphDelta> Deltas        = {};
+};
+
+class Morphing
+{
+public:
+	static constexpr float DefaultTolerance = 1e-5f;
+
+	// Appends the vertices of a target whose position or normal moves by more than Tolerance
+	static void     AddDeltas(MorphTarget& Target, const MeshVertex* pBase, const MeshVertex* pMorphed, const uint32_t* pVertices, size_t kCount, float Tolerance = DefaultTolerance) noexcept;
+
+	// Resets the vertices of the targets applied last time from pBase, then adds every target with a non-zero weight.
+	// ActiveTargets carries the applied targets from one call to the next, so only vertices that moved are touched.
+	// Normals are not renormalized, skinning and the shaders already do. Returns the number of vertices written.
+	static uint32_t Apply(const MeshVertex* pBase, const MorphTarget* pTargets, const float* pWeights, size_t kTargetCount, MeshVertex* pVertices, List<uint32_t>& ActiveTargets) noexcept;
+
+	static size_t   GetByteSize(const MorphTarget& Target) noexcept;
+};
@@ -0,0 +1,801 @@
+#include "ObjLoader.h"
+#include "File.h"
+#include "Parallel.h"
+#include "TangentSpace.h"
+
+#include <emmintrin.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _MSC_VER
+  #include <intrin.h>
+#endif // _MSC_VER
+
+// Chunks smaller than this are not worth a thread of their own
+static constexpr size_t s_MinChunkSize = 256u * 1024u;
+
+static constexpr double s_Pow10[] =
+{
+    1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22,
+};
+
+enum ObjCornerFlags : uint8_t
+{
+    ObjCornerFlags_None             = 0u,
+    ObjCornerFlags_RelativePosition = 1u << 0u,
+    ObjCornerFlags_RelativeNormal   = 1u << 1u,
+};
+
+// One triangle corner as written in the file. Indices are 0-based and global unless flagged
+// as relative, in which case they are local to the chunk and fixed up after the prefix sums.
+struct ObjCorner
+{
+    int32_t Position = 0;
+    int32_t Normal   = -1;
+    uint8_t Flags    = ObjCornerFlags_None;
+};
+
+struct ObjMaterialSwitch
+{
+    uint32_t Triangle = 0u;
+    String   Name     = {};
+};
+
+struct ObjChunk
+{
+    const char*             pBegin            = nullptr;
+    const char*             pEnd              = nullptr;
+    List<Float3>            Positions         = {};
+    List<Float3>            Normals           = {};
+    List<ObjCorner>         Corners           = {};
+    List<ObjMaterialSwitch> MaterialSwitches  = {};
+    List<String>            MaterialLibraries = {};
+    bool                    bValid            = true;
+};
+
+
+static inline uint32_t CountTrailingZeros(uint32_t kValue) noexcept
+{
+#ifdef _MSC_VER
+    unsigned long kIndex = 0ul;
+    _BitScanForward(&kIndex, kValue);
+    return uint32_t(kIndex);
+#else
+    return uint32_t(__builtin_ctz(kValue));
+#endif // _MSC_VER
+}
+
+static inline bool IsSpace(char c) noexcept
+{
+    return c == ' ' || c == '\t';
+}
+
+static inline bool IsLineEnd(char c) noexcept
+{
+    return c == '\n' || c == '\r';
+}
+
+static inline bool IsDigit(char c) noexcept
+{
+    return uint8_t(c - '0') < 10u;
+}
+
+static inline const char* SkipSpaces(const char* p, const char* pEnd) noexcept
+{
+    while (p < pEnd && IsSpace(*p))
+    {
+        p++;
+    }
+    return p;
+}
+
+// Returns the first character of the next line. pSafe is the last address a 16 byte load may start at.
+static inline const char* SkipLine(const char* p, const char* pEnd, const char* pSafe) noexcept
+{
+    const __m128i NewLine = _mm_set1_epi8('\n');
+    while (p < pEnd && p <= pSafe)
+    {
+        const __m128i  Chars = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        const uint32_t kMask = uint32_t(_mm_movemask_epi8(_mm_cmpeq_epi8(Chars, NewLine)));
+        if (kMask != 0u)
+        {
+            return std::min(p + CountTrailingZeros(kMask) + 1, pEnd);
+        }
+        p += 16;
+    }
+    while (p < pEnd && *p != '\n')
+    {
+        p++;
+    }
+    return p < pEnd ? p + 1 : pEnd;
+}
+
+// Number of consecutive decimal digits at p (at most 16 per call when a vector load is possible)
+static inline size_t CountDigits(const char* p, const char* pEnd, const char* pSafe) noexcept
+{
+    if (p <= pSafe)
+    {
+        const __m128i  Chars  = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        const __m128i  Values = _mm_sub_epi8(Chars, _mm_set1_epi8('0'));
+        const __m128i  Digits = _mm_and_si128(_mm_cmpgt_epi8(Values, _mm_set1_epi8(-1)), _mm_cmplt_epi8(Values, _mm_set1_epi8(10)));
+        const uint32_t kMask  = uint32_t(_mm_movemask_epi8(Digits));
+        return std::min<size_t>(CountTrailingZeros(~kMask), size_t(pEnd - p));
+    }
+
+    size_t kCount = 0u;
+    while (p + kCount < pEnd && IsDigit(p[kCount]))
+    {
+        kCount++;
+    }
+    return kCount;
+}
+
+// Converts 8 ASCII digits at once (SWAR)
+static inline uint32_t ParseEightDigits(const char* p) noexcept
+{
+    uint64_t kValue = 0u;
+    memcpy(&kValue, p, sizeof(kValue));
+    kValue = (kValue & 0x0F0F0F0F0F0F0F0Full) * 2561u >> 8u;
+    kValue = (kValue & 0x00FF00FF00FF00FFull) * 6553601u >> 16u;
+    return uint32_t((kValue & 0x0000FFFF0000FFFFull) * 42949672960001ull >> 32u);
+}
+
+static inline uint64_t AccumulateDigits(const char* p, size_t kCount, uint64_t kValue) noexcept
+{
+    for (; kCount >= 8u; kCount -= 8u, p += 8)
+    {
+        kValue = kValue * 100000000ull + ParseEightDigits(p);
+    }
+    for (; kCount > 0u; kCount--, p++)
+    {
+        kValue = kValue * 10ull + uint64_t(*p - '0');
+    }
+    return kValue;
+}
+
+static const char* ParseFloat(const char* p, const char* pEnd, const char* pSafe, float& Value) noexcept
+{
+    const char* pStart = p;
+
+    bool bNegative = false;
+    if (p < pEnd && (*p == '-' || *p == '+'))
+    {
+        bNegative = *p == '-';
+        p++;
+    }
+
+    uint64_t kMantissa = 0u;
+    int32_t  kExponent = 0;
+    size_t   kDigits   = 0u;
+    size_t   kRun      = 0u;
+    do
+    {
+        kRun       = CountDigits(p, pEnd, pSafe);
+        kMantissa  = AccumulateDigits(p, kRun, kMantissa);
+        kDigits   += kRun;
+        p         += kRun;
+    } while (kRun == 16u);
+
+    if (p < pEnd && *p == '.')
+    {
+        p++;
+        do
+        {
+            kRun       = CountDigits(p, pEnd, pSafe);
+            kMantissa  = AccumulateDigits(p, kRun, kMantissa);
+            kDigits   += kRun;
+            kExponent -= int32_t(kRun);
+            p         += kRun;
+        } while (kRun == 16u);
+    }
+
+    if (kDigits == 0u)
+    {
+        return nullptr;
+    }
+
+    if (p < pEnd && (*p == 'e' || *p == 'E'))
+    {
+        p++;
+        bool bNegativeExponent = false;
+        if (p < pEnd && (*p == '-' || *p == '+'))
+        {
+            bNegativeExponent = *p == '-';
+            p++;
+        }
+        int32_t kValue = 0;
+        while (p < pEnd && IsDigit(*p))
+        {
+            kValue = std::min(kValue * 10 + int32_t(*p - '0'), 100000);
+            p++;
+        }
+        kExponent += bNegativeExponent ? -kValue : kValue;
+    }
+
+    if (kDigits > 19u || kExponent < -22 || kExponent > 22)
+    {
+        // Rare in practice: hand it to the C library on a terminated copy
+        char lpText[128] = { 0 };
+        const size_t kLength = std::min<size_t>(size_t(p - pStart), sizeof(lpText) - 1u);
+        memcpy(lpText, pStart, kLength);
+        Value = float(strtod(lpText, nullptr));
+        return p;
+    }
+
+    double Result = double(kMantissa);
+    Result = kExponent < 0 ? Result / s_Pow10[-kExponent] : Result * s_Pow10[kExponent];
+    Value  = float(bNegative ? -Result : Result);
+    return p;
+}
+
+static const char* ParseFloat3(const char* p, const char* pEnd, const char* pSafe, Float3& Value) noexcept
+{
+    float* pComponents = &Value.X;
+    for (size_t k = 0u; k < 3u && p != nullptr; k++)
+    {
+        p = ParseFloat(SkipSpaces(p, pEnd), pEnd, pSafe, pComponents[k]);
+    }
+    return p;
+}
+
+static const char* ParseIndex(const char* p, const char* pEnd, int32_t& kIndex) noexcept
+{
+    bool bNegative = false;
+    if (p < pEnd && *p == '-')
+    {
+        bNegative = true;
+        p++;
+    }
+    if (p >= pEnd || !IsDigit(*p))
+    {
+        return nullptr;
+    }
+
+    int64_t kValue = 0;
+    while (p < pEnd && IsDigit(*p))
+    {
+        kValue = std::min<int64_t>(kValue * 10 + int64_t(*p - '0'), INT32_MAX);
+        p++;
+    }
+    kIndex = int32_t(bNegative ? -kValue : kValue);
+    return p;
+}
+
+static String ParseName(const char* p, const char* pEnd) noexcept
+{
+    p = SkipSpaces(p, pEnd);
+    const char* pLast = p;
+    while (pLast < pEnd && !IsLineEnd(*pLast))
+    {
+        pLast++;
+    }
+    while (pLast > p && IsSpace(pLast[-1]))
+    {
+        pLast--;
+    }
+    return String(p, pLast);
+}
+
+static inline bool StartsWith(const char* p, const char* pEnd, const char* lpPrefix) noexcept
+{
+    const size_t kLength = strlen(lpPrefix);
+    return size_t(pEnd - p) > kLength && memcmp(p, lpPrefix, kLength) == 0 && IsSpace(p[kLength]);
+}
+
+// Reads "v", "v/t", "v//n" or "v/t/n" and converts it to a 0-based corner
+static const char* ParseCorner(const char* p, const char* pEnd, const ObjChunk& Chunk, ObjCorner& Corner) noexcept
+{
+    int32_t kPosition = 0;
+    p = ParseIndex(p, pEnd, kPosition);
+    if (p == nullptr || kPosition == 0)
+    {
+        return nullptr;
+    }
+    if (kPosition < 0)
+    {
+        Corner.Position = int32_t(Chunk.Positions.size()) + kPosition;
+        Corner.Flags   |= ObjCornerFlags_RelativePosition;
+    }
+    else
+    {
+        Corner.Position = kPosition - 1;
+    }
+
+    if (p < pEnd && *p == '/')
+    {
+        p++;
+        if (p < pEnd && *p != '/')
+        {
+            int32_t kTexCoord = 0; // Not part of MeshVertex
+            p = ParseIndex(p, pEnd, kTexCoord);
+            if (p == nullptr)
+            {
+                return nullptr;
+            }
+        }
+        if (p < pEnd && *p == '/')
+        {
+            int32_t kNormal = 0;
+            p = ParseIndex(p + 1, pEnd, kNormal);
+            if (p == nullptr || kNormal == 0)
+            {
+                return nullptr;
+            }
+            if (kNormal < 0)
+            {
+                Corner.Normal = int32_t(Chunk.Normals.size()) + kNormal;
+                Corner.Flags |= ObjCornerFlags_RelativeNormal;
+            }
+            else
+            {
+                Corner.Normal = kNormal - 1;
+            }
+        }
+    }
+    return p;
+}
+
+// Polygons are triangulated as fans
+static const char* ParseFace(const char* p, const char* pEnd, ObjChunk& Chunk) noexcept
+{
+    ObjCorner First    = {};
+    ObjCorner Previous = {};
+    uint32_t  kCount   = 0u;
+    while (true)
+    {
+        p = SkipSpaces(p, pEnd);
+        if (p >= pEnd || IsLineEnd(*p))
+        {
+            break;
+        }
+
+        ObjCorner Corner = {};
+        p = ParseCorner(p, pEnd, Chunk, Corner);
+        if (p == nullptr)
+        {
+            return nullptr;
+        }
+
+        if (kCount == 0u)
+        {
+            First = Corner;
+        }
+        else if (kCount >= 2u)
+        {
+            Chunk.Corners.emplace_back(First);
+            Chunk.Corners.emplace_back(Previous);
+            Chunk.Corners.emplace_back(Corner);
+        }
+        Previous = Corner;
+        kCount++;
+    }
+    return kCount >= 3u ? p : nullptr;
+}
+
+static void ParseChunk(ObjChunk& Chunk, const char* pSafe) noexcept
+{
+    // Rough guess: a third of the chunk is positions, the rest faces
+    const size_t kBytes = size_t(Chunk.pEnd - Chunk.pBegin);
+    Chunk.Positions.reserve(kBytes / 96u);
+    Chunk.Corners.reserve(kBytes / 16u);
+
+    const char* p    = Chunk.pBegin;
+    const char* pEnd = Chunk.pEnd;
+    while (p < pEnd && Chunk.bValid)
+    {
+        p = SkipSpaces(p, pEnd);
+        if (p >= pEnd)
+        {
+            break;
+        }
+
+        const char* pLine = p;
+        switch (*p)
+        {
+            case 'v':
+            {
+                if (pEnd - p > 1 && IsSpace(p[1]))
+                {
+                    Float3 Position = {};
+                    pLine = ParseFloat3(p + 2, pEnd, pSafe, Position);
+                    Chunk.Positions.emplace_back(Position);
+                }
+                else if (pEnd - p > 2 && p[1] == 'n' && IsSpace(p[2]))
+                {
+                    Float3 Normal = {};
+                    pLine = ParseFloat3(p + 3, pEnd, pSafe, Normal);
+                    Chunk.Normals.emplace_back(Normal);
+                }
+                break;
+            }
+            case 'f':
+            {
+                if (pEnd - p > 1 && IsSpace(p[1]))
+                {
+                    pLine = ParseFace(p + 2, pEnd, Chunk);
+                }
+                break;
+            }
+            case 'u':
+            {
+                if (StartsWith(p, pEnd, "usemtl"))
+                {
+                    const uint32_t kTriangle = uint32_t(Chunk.Corners.size() / 3u);
+                    Chunk.MaterialSwitches.push_back({ kTriangle, ParseName(p + 6, pEnd) });
+                }
+                break;
+            }
+            case 'm':
+            {
+                if (StartsWith(p, pEnd, "mtllib"))
+                {
+                    Chunk.MaterialLibraries.emplace_back(ParseName(p + 6, pEnd));
+                }
+                break;
+            }
+            default:
+                break; // Comments, groups, smoothing groups, texture coordinates...
+        }
+
+        if (pLine == nullptr)
+        {
+            Chunk.bValid = false;
+            break;
+        }
+        p = SkipLine(pLine, pEnd, pSafe);
+    }
+}
+
+static inline uint64_t MixBits(uint64_t kValue) noexcept
+{
+    kValue ^= kValue >> 33u;
+    kValue *= 0xFF51AFD7ED558CCDull;
+    kValue ^= kValue >> 33u;
+    kValue *= 0xC4CEB9FE1A85EC53ull;
+    kValue ^= kValue >> 33u;
+    return kValue;
+}
+
+// Open addressing (position, normal) -> vertex table
+class ObjVertexWelder
+{
+public:
+    ObjVertexWelder(size_t kExpectedCount)
+    {
+        Resize(std::max<size_t>(64u, kExpectedCount * 2u));
+    }
+
+    uint32_t Insert(uint64_t kKey, uint32_t kNextIndex, bool& bInserted) noexcept
+    {
+        if ((m_Count + 1u) * 2u > m_Keys.size())
+        {
+            Resize(m_Keys.size() * 2u);
+        }
+
+        const size_t kMask = m_Keys.size() - 1u;
+        for (size_t k = MixBits(kKey) & kMask; ; k = (k + 1u) & kMask)
+        {
+            if (m_Keys[k] == kKey)
+            {
+                bInserted = false;
+                return m_Values[k];
+            }
+            if (m_Keys[k] == s_EmptyKey)
+            {
+                m_Keys[k]   = kKey;
+                m_Values[k] = kNextIndex;
+                m_Count++;
+                bInserted = true;
+                return kNextIndex;
+            }
+        }
+    }
+
+private:
+    void Resize(size_t kMinCapacity) noexcept
+    {
+        size_t kCapacity = 64u;
+        while (kCapacity < kMinCapacity)
+        {
+            kCapacity *= 2u;
+        }
+
+        List<uint64_t> Keys(kCapacity, s_EmptyKey);
+        List<uint32_t> Values(kCapacity, 0u);
+        const size_t kMask = kCapacity - 1u;
+        for (size_t j = 0u; j < m_Keys.size(); j++)
+        {
+            if (m_Keys[j] == s_EmptyKey)
+            {
+                continue;
+            }
+            size_t k = MixBits(m_Keys[j]) & kMask;
+            while (Keys[k] != s_EmptyKey)
+            {
+                k = (k + 1u) & kMask;
+            }
+            Keys[k]   = m_Keys[j];
+            Values[k] = m_Values[j];
+        }
+        m_Keys.swap(Keys);
+        m_Values.swap(Values);
+    }
+
+private:
+    static constexpr uint64_t s_EmptyKey = UINT64_MAX;
+
+    List<uint64_t> m_Keys   = {};
+    List<uint32_t> m_Values = {};
+    size_t         m_Count  = 0u;
+};
+
+
+// OBJ LOADER
+bool ObjLoader::LoadFromFile(const char* lpFilepath, ObjModel& Model) noexcept
+{
+    const MappedFile File = MappedFile(lpFilepath);
+    if (!File.IsOpen())
+    {
+        return false;
+    }
+
+    const char* pText = reinterpret_cast<const char*>(File.GetData());
+    return LoadFromMemory(pText, File.GetSize(), Model, std::filesystem::path(lpFilepath).parent_path());
+}
+
+bool ObjLoader::LoadFromMemory(const char* pText, size_t kSize, ObjModel& Model, const std::filesystem::path& Directory) noexcept
+{
+    Model = {};
+
+    // The vectorised scanners read 16 bytes at a time, keep them inside the buffer
+    String Padded = {};
+    if (kSize < 16u)
+    {
+        Padded.assign(pText, kSize);
+        Padded.resize(kSize + 16u, '\0');
+        pText = Padded.data();
+    }
+    const char* pSafe = kSize < 16u ? pText + kSize : pText + kSize - 16u;
+    const char* pEnd  = pText + kSize;
+
+    // Split at line boundaries
+    const size_t kMaxChunks  = size_t(Parallel::GetWorkerCount()) * 4u;
+    const size_t kChunkCount = std::clamp<size_t>(kSize / s_MinChunkSize, 1u, kMaxChunks);
+
+    List<ObjChunk> Chunks(kChunkCount);
+    const char* pBegin = pText;
+    for (size_t k = 0u; k < kChunkCount; k++)
+    {
+        const char* pSplit = k + 1u == kChunkCount ? pEnd : std::max(pBegin, pText + (kSize / kChunkCount) * (k + 1u));
+        if (pSplit < pEnd)
+        {
+            const void* pNewLine = memchr(pSplit, '\n', size_t(pEnd - pSplit));
+            pSplit = pNewLine ? static_cast<const char*>(pNewLine) + 1 : pEnd;
+        }
+        Chunks[k].pBegin = pBegin;
+        Chunks[k].pEnd   = pSplit;
+        pBegin = pSplit;
+    }
+
+    Parallel::For(kChunkCount, 1u, [&Chunks, pSafe](size_t kBegin, size_t kEnd)
+    {
+        for (size_t k = kBegin; k < kEnd; k++)
+        {
+            ParseChunk(Chunks[k], pSafe);
+        }
+    });
+
+    // Prefix sums to turn chunk-local data into global offsets
+    List<size_t> PositionBase(kChunkCount + 1u, 0u);
+    List<size_t> NormalBase(kChunkCount + 1u, 0u);
+    List<size_t> CornerBase(kChunkCount + 1u, 0u);
+    for (size_t k = 0u; k < kChunkCount; k++)
+    {
+        if (!Chunks[k].bValid)
+        {
+            return false;
+        }
+        PositionBase[k + 1u] = PositionBase[k] + Chunks[k].Positions.size();
+        NormalBase[k + 1u]   = NormalBase[k]   + Chunks[k].Normals.size();
+        CornerBase[k + 1u]   = CornerBase[k]   + Chunks[k].Corners.size();
+    }
+
+    const size_t kPositionCount = PositionBase[kChunkCount];
+    const size_t kNormalCount   = NormalBase[kChunkCount];
+    const size_t kCornerCount   = CornerBase[kChunkCount];
+    if (kCornerCount == 0u || kPositionCount >= size_t(INT32_MAX) || kCornerCount >= size_t(UINT32_MAX))
+    {
+        return false;
+    }
+
+    List<Float3>   Positions(kPositionCount);
+    List<Float3>   Normals(kNormalCount);
+    List<uint64_t> Keys(kCornerCount);
+    List<uint8_t>  ValidChunks(kChunkCount, 1u);
+
+    Parallel::For(kChunkCount, 1u, [&](size_t kBegin, size_t kEnd)
+    {
+        for (size_t k = kBegin; k < kEnd; k++)
+        {
+            ObjChunk& Chunk = Chunks[k];
+            std::copy(Chunk.Positions.begin(), Chunk.Positions.end(), Positions.begin() + PositionBase[k]);
+            std::copy(Chunk.Normals.begin(),   Chunk.Normals.end(),   Normals.begin()   + NormalBase[k]);
+
+            uint64_t* pKeys = Keys.data() + CornerBase[k];
+            for (const ObjCorner& Corner : Chunk.Corners)
+            {
+                const int64_t kPosition = Corner.Position + ((Corner.Flags & ObjCornerFlags_RelativePosition) ? int64_t(PositionBase[k]) : 0);
+                const int64_t kNormal   = Corner.Normal < 0 && !(Corner.Flags & ObjCornerFlags_RelativeNormal) ? -1 :
+                                          Corner.Normal + ((Corner.Flags & ObjCornerFlags_RelativeNormal) ? int64_t(NormalBase[k]) : 0);
+                if (kPosition < 0 || kPosition >= int64_t(kPositionCount) || kNormal >= int64_t(kNormalCount) ||
+                    (kNormal < 0 && (Corner.Flags & ObjCornerFlags_RelativeNormal)))
+                {
+                    ValidChunks[k] = 0u;
+                    break;
+                }
+                *pKeys++ = (uint64_t(kPosition) << 32u) | uint64_t(uint32_t(int32_t(kNormal)));
+            }
+
+            Chunk.Positions = {};
+            Chunk.Normals   = {};
+            Chunk.Corners   = {};
+        }
+    });
+
+    if (std::find(ValidChunks.begin(), ValidChunks.end(), 0u) != ValidChunks.end())
+    {
+        return false;
+    }
+
+    // Weld identical (position, normal) pairs
+    bool bMissingNormals = false;
+    {
+        ObjVertexWelder Welder = ObjVertexWelder(kPositionCount);
+        Model.Vertices.reserve(kPositionCount);
+        Model.Indices.resize(kCornerCount);
+        for (size_t k = 0u; k < kCornerCount; k++)
+        {
+            bool bInserted = false;
+            const uint32_t kVertex = Welder.Insert(Keys[k], uint32_t(Model.Vertices.size()), bInserted);
+            if (bInserted)
+            {
+                const uint32_t kPosition = uint32_t(Keys[k] >> 32u);
+                const uint32_t kNormal   = uint32_t(Keys[k]);
+                bMissingNormals |= kNormal == UINT32_MAX;
+                Model.Vertices.emplace_back(Positions[kPosition], kNormal == UINT32_MAX ? Float3(0.0f) : Normals[kNormal]);
+            }
+            Model.Indices[k] = kVertex;
+        }
+    }
+
+    // Faces without "vn" get angle weighted smooth normals, vertices from faces that had them keep theirs
+    if (bMissingNormals)
+    {
+        List<Float3> Generated(Model.Vertices.size());
+        TangentSpace::ComputeSmoothNormals(&Model.Vertices[0].Position, sizeof(MeshVertex), Model.Vertices.size(), Model.Indices.data(), Model.Indices.size(), Generated.data(), sizeof(Float3));
+        for (size_t k = 0u; k < Model.Vertices.size(); k++)
+        {
+            MeshVertex& v = Model.Vertices[k];
+            if (v.Normal.X == 0.0f && v.Normal.Y == 0.0f && v.Normal.Z == 0.0f)
+            {
+                v.Normal = Generated[k];
+            }
+        }
+    }
+
+    // Materials
+    for (const ObjChunk& Chunk : Chunks)
+    {
+        for (const String& Library : Chunk.MaterialLibraries)
+        {
+            const String Filepath = (Directory / Library).string();
+            LoadMaterials(Filepath.c_str(), Model.Materials);
+        }
+    }
+
+    auto FindMaterial = [&Model](const String& Name) -> uint32_t
+    {
+        for (size_t k = 0u; k < Model.Materials.size(); k++)
+        {
+            if (Model.Materials[k].Name == Name)
+            {
+                return uint32_t(k);
+            }
+        }
+        return ObjSubmesh::NoMaterial;
+    };
+
+    uint32_t kFirstTriangle = 0u;
+    uint32_t kMaterial      = ObjSubmesh::NoMaterial;
+    auto EmitSubmesh = [&](uint32_t kLastTriangle)
+    {
+        if (kLastTriangle > kFirstTriangle)
+        {
+            Model.Submeshes.push_back({ kFirstTriangle * 3u, (kLastTriangle - kFirstTriangle) * 3u, kMaterial });
+        }
+        kFirstTriangle = kLastTriangle;
+    };
+    for (size_t k = 0u; k < kChunkCount; k++)
+    {
+        for (const ObjMaterialSwitch& Switch : Chunks[k].MaterialSwitches)
+        {
+            EmitSubmesh(uint32_t(CornerBase[k] / 3u) + Switch.Triangle);
+            kMaterial = FindMaterial(Switch.Name);
+        }
+    }
+    EmitSubmesh(uint32_t(kCornerCount / 3u));
+
+    return true;
+}
+
+bool ObjLoader::LoadMaterials(const char* lpFilepath, List<ObjMaterial>& Materials) noexcept
+{
+    const MappedFile File = MappedFile(lpFilepath);
+    if (!File.IsOpen())
+    {
+        return false;
+    }
+    if (File.GetSize() == 0u)
+    {
+        return true;
+    }
+
+    const char* p     = reinterpret_cast<const char*>(File.GetData());
+    const char* pEnd  = p + File.GetSize();
+    const char* pSafe = File.GetSize() < 16u ? nullptr : pEnd - 16;
+
+    ObjMaterial* pMaterial = nullptr;
+    while (p < pEnd)
+    {
+        p = SkipSpaces(p, pEnd);
+
+        const char* pLine = p;
+        if (StartsWith(p, pEnd, "newmtl"))
+        {
+            pMaterial = &Materials.emplace_back();
+            pMaterial->Name = ParseName(p + 6, pEnd);
+        }
+        else if (pMaterial == nullptr)
+        {
+            // Anything before the first "newmtl" is ignored
+        }
+        else if (StartsWith(p, pEnd, "Ka"))
+        {
+            pLine = ParseFloat3(p + 3, pEnd, pSafe, pMaterial->AmbientColor);
+        }
+        else if (StartsWith(p, pEnd, "Kd"))
+        {
+            pLine = ParseFloat3(p + 3, pEnd, pSafe, pMaterial->DiffuseColor);
+        }
+        else if (StartsWith(p, pEnd, "Ks"))
+        {
+            pLine = ParseFloat3(p + 3, pEnd, pSafe, pMaterial->SpecularColor);
+        }
+        else if (StartsWith(p, pEnd, "Ns"))
+        {
+            pLine = ParseFloat(SkipSpaces(p + 3, pEnd), pEnd, pSafe, pMaterial->SpecularExponent);
+        }
+        else if (StartsWith(p, pEnd, "d"))
+        {
+            pLine = ParseFloat(SkipSpaces(p + 2, pEnd), pEnd, pSafe, pMaterial->Opacity);
+        }
+        else if (StartsWith(p, pEnd, "Tr"))
+        {
+            float Transparency = 0.0f;
+            pLine = ParseFloat(SkipSpaces(p + 3, pEnd), pEnd, pSafe, Transparency);
+            pMaterial->Opacity = 1.0f - Transparency;
+        }
+        else if (StartsWith(p, pEnd, "map_Kd"))
+        {
+            pMaterial->DiffuseMap = ParseName(p + 6, pEnd);
+        }
+
+        if (pLine == nullptr)
+        {
+            return false;
+        }
+        p = SkipLine(pLine, pEnd, pSafe);
+    }
+    return true;
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include "Core.h"
+
+struct ObjMaterial
+{
+	String Name             = {};
+	Float3 AmbientColor     = Float3(0.0f);
+	Float3 DiffuseColor     = Float3(1.0f);
+	Float3 SpecularColor    = Float3(0.0f);
+	float  SpecularExponent = 0.0f;
+	float  Opacity          = 1.0f;
+	String DiffuseMap       = {};
+};
+
+struct ObjSubmesh
+{
+	static constexpr uint32_t NoMaterial = UINT32_MAX;
+
+	uint32_t IndexOffset   = 0u;
+	uint32_t IndexCount    = 0u;
+	uint32_t MaterialIndex = NoMaterial;
+};
+
+// Triangulated, welded model in the layout Mesh uploads directly
+struct ObjModel
+{
+	List<MeshVertex>  Vertices  = {};
+	List<uint32_t>    Indices   = {};
+	List<ObjSubmesh>  Submeshes = {};
+	List<ObjMaterial> Materials = {};
+};
+
+// Wavefront OBJ/MTL reader used instead of Assimp for .obj files. The file is memory-mapped
+// and split at line boundaries into chunks that are parsed on all worker threads, then the
+// per-chunk results are stitched together and welded on (position, normal) pairs.
+class ObjLoader
+{
+public:
+	static bool LoadFromFile(const char* lpFilepath, ObjModel& Model) noexcept;
+	static bool LoadFromMemory(const char* pText, size_t kSize, ObjModel& Model, const std::filesystem::path& Directory = {}) noexcept;
+	static bool LoadMaterials(const char* lpFilepath, List<ObjMaterial>& Materials) noexcept;
+};
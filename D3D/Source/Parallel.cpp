@@ -0,0 +1,162 @@
+#include "Parallel.h"
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+
+// A For() in progress, on the stack of the thread that called it
+struct ParallelJob
+{
+    void (*pRange)(void*, size_t, size_t) = nullptr;
+    void*  pContext   = nullptr;
+    size_t kCount     = 0u;
+    size_t kStep      = 0u;
+    size_t kTaskCount = 0u;
+    size_t kNext      = 0u; // First range nobody took yet
+    size_t kRemaining = 0u; // Ranges not finished yet
+};
+
+// One worker per hardware thread but the caller's. Ranges are handed out under the lock, they are coarse enough
+// that it is never contended, and a job leaves the queue once its last range is taken so nothing touches it after.
+class ParallelPool
+{
+public:
+    ParallelPool();
+    ~ParallelPool() noexcept;
+
+    void Run(ParallelJob& Job) noexcept;
+
+private:
+    ParallelPool(const ParallelPool&) = delete;
+    ParallelPool& operator=(const ParallelPool&) = delete;
+
+    void WorkerMain() noexcept;
+
+private:
+    std::mutex               m_Mutex     = {};
+    std::condition_variable  m_Wake      = {};
+    std::condition_variable  m_Done      = {};
+    std::deque<ParallelJob*> m_Jobs      = {};
+    List<std::thread>        m_Workers   = {};
+    bool                     m_bStopping = false;
+};
+
+static ParallelPool& GetPool() noexcept;
+static void          RunRange(const ParallelJob& Job, size_t kTask) noexcept;
+
+// PARALLEL
+bool& Parallel::IsInline() noexcept
+{
+    static thread_local bool s_bInline = false;
+    return s_bInline;
+}
+
+void Parallel::Run(size_t kCount, size_t kTaskCount, RangeFn pRange, void* pContext) noexcept
+{
+    ParallelJob Job = {};
+    Job.pRange     = pRange;
+    Job.pContext   = pContext;
+    Job.kCount     = kCount;
+    Job.kStep      = (kCount + kTaskCount - 1u) / kTaskCount;
+    Job.kTaskCount = kTaskCount;
+    Job.kRemaining = kTaskCount;
+    GetPool().Run(Job);
+}
+
+// POOL
+ParallelPool::ParallelPool()
+{
+    for (uint32_t k = 1u; k < Parallel::GetWorkerCount(); k++)
+    {
+        m_Workers.emplace_back(&ParallelPool::WorkerMain, this);
+    }
+}
+
+ParallelPool::~ParallelPool() noexcept
+{
+    {
+        std::lock_guard<std::mutex> Lock = std::lock_guard<std::mutex>(m_Mutex);
+        m_bStopping = true;
+    }
+    m_Wake.notify_all();
+
+    for (std::thread& Worker : m_Workers)
+    {
+        Worker.join();
+    }
+}
+
+void ParallelPool::Run(ParallelJob& Job) noexcept
+{
+    {
+        std::lock_guard<std::mutex> Lock = std::lock_guard<std::mutex>(m_Mutex);
+        m_Jobs.push_back(&Job);
+    }
+    m_Wake.notify_all();
+
+    // The caller takes ranges of its own job too, so it finishes even when every worker is busy elsewhere
+    std::unique_lock<std::mutex> Lock = std::unique_lock<std::mutex>(m_Mutex);
+    while (Job.kNext < Job.kTaskCount)
+    {
+        const size_t kTask = Job.kNext++;
+        if (Job.kNext == Job.kTaskCount)
+        {
+            m_Jobs.erase(std::find(m_Jobs.begin(), m_Jobs.end(), &Job));
+        }
+        Lock.unlock();
+
+        RunRange(Job, kTask);
+
+        Lock.lock();
+        Job.kRemaining--;
+    }
+    m_Done.wait(Lock, [&Job]() { return Job.kRemaining == 0u; });
+}
+
+void ParallelPool::WorkerMain() noexcept
+{
+    std::unique_lock<std::mutex> Lock = std::unique_lock<std::mutex>(m_Mutex);
+    while (true)
+    {
+        m_Wake.wait(Lock, [this]() { return m_bStopping || !m_Jobs.empty(); });
+        if (m_bStopping)
+        {
+            break;
+        }
+
+        ParallelJob* pJob  = m_Jobs.front();
+        const size_t kTask = pJob->kNext++;
+        if (pJob->kNext == pJob->kTaskCount)
+        {
+            m_Jobs.pop_front();
+        }
+        Lock.unlock();
+
+        RunRange(*pJob, kTask);
+
+        Lock.lock();
+        if (--pJob->kRemaining == 0u)
+        {
+            m_Done.notify_all();
+        }
+    }
+}
+
+ParallelPool& GetPool() noexcept
+{
+    static ParallelPool s_Pool = {};
+    return s_Pool;
+}
+
+void RunRange(const ParallelJob& Job, size_t kTask) noexcept
+{
+    const size_t kBegin = std::min(Job.kCount, kTask * Job.kStep);
+    const size_t kEnd   = std::min(Job.kCount, kBegin + Job.kStep);
+    if (kBegin == kEnd)
+    {
+        return;
+    }
+
+    // Whatever the range calls For() on runs here
+    Parallel::Inline([&Job, kBegin, kEnd]() { Job.pRange(Job.pContext, kBegin, kEnd); });
+}
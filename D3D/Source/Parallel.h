@@ -0,0 +1,72 @@
+#pragma once
+
+#include "Core.h"
+
+#include <algorithm>
+#include <memory>
+#include <thread>
+#include <type_traits>
+
+class Parallel
+{
+public:
+	static uint32_t GetWorkerCount() noexcept;
+
+	// Splits [0, kCount) into contiguous ranges of at least kGrainSize items and calls Func(kBegin, kEnd) for each
+	// range, at most one range per hardware thread. The ranges run on a pool of threads started on first use and on
+	// the calling thread, which takes ranges as well. Blocks until done.
+	//
+	// A For() made from inside a range runs inline on the thread running it, so the asset stream's decoders and
+	// nested loops share the one pool instead of multiplying threads.
+	template<typename Fn>
+	static void For(size_t kCount, size_t kGrainSize, Fn&& Func);
+
+	// Calls Func() with every For() it makes on this thread running inline, e.g. to time the serial baseline
+	template<typename Fn>
+	static void Inline(Fn&& Func);
+
+private:
+	using RangeFn = void (*)(void* pContext, size_t kBegin, size_t kEnd);
+
+	static bool& IsInline() noexcept;
+	static void  Run(size_t kCount, size_t kTaskCount, RangeFn pRange, void* pContext) noexcept;
+
+};
+
+
+inline uint32_t Parallel::GetWorkerCount() noexcept
+{
+	static const uint32_t s_WorkerCount = std::max(1u, std::thread::hardware_concurrency());
+	return s_WorkerCount;
+}
+
+template<typename Fn>
+inline void Parallel::For(size_t kCount, size_t kGrainSize, Fn&& Func)
+{
+	if (kCount == 0u)
+	{
+		return;
+	}
+
+	const size_t kMaxTasks  = std::max<size_t>(1u, kCount / std::max<size_t>(1u, kGrainSize));
+	const size_t kTaskCount = std::min<size_t>(GetWorkerCount(), kMaxTasks);
+	if (kTaskCount == 1u || IsInline())
+	{
+		Func(size_t(0u), kCount);
+		return;
+	}
+
+	using Callable = std::remove_reference_t<Fn>;
+	const RangeFn pRange = [](void* pContext, size_t kBegin, size_t kEnd) { (*static_cast<Callable*>(pContext))(kBegin, kEnd); };
+	Run(kCount, kTaskCount, pRange, const_cast<void*>(static_cast<const void*>(std::addressof(Func))));
+}
+
+template<typename Fn>
+inline void Parallel::Inline(Fn&& Func)
+{
+	bool& bInline = IsInline();
+	const bool bWasInline = bInline;
+	bInline = true;
+	Func();
+	bInline = bWasInline;
+}
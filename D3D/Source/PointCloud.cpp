@@ -0,0 +1,739 @@
+#include "PointCloud.h"
+#include "Meshlet.h"
+#include "Parallel.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+
+static constexpr uint32_t s_CountingLevel     = 5u;    // Points are counted on a grid of 32 cells per side to place chunks
+static constexpr size_t   s_ChunkBufferPoints = 4096u; // Buffered per chunk while distributing, 64 KB writes
+static constexpr uint32_t s_NoChild           = UINT32_MAX;
+
+struct PointCloudHeader
+{
+    uint32_t Magic      = PointCloudBuilder::Magic;
+    uint32_t Version    = PointCloudBuilder::Version;
+    uint64_t PointCount = 0u;
+    uint64_t NodeOffset = 0u; // Bytes, the node table follows the points
+    uint32_t NodeCount  = 0u;
+    uint32_t NodeStride = uint32_t(sizeof(PointCloudNode));
+};
+
+static bool SeekFile(FILE* pFile, uint64_t kOffset) noexcept
+{
+#ifdef _WIN32
+    return _fseeki64(pFile, int64_t(kOffset), SEEK_SET) == 0;
+#else
+    return fseeko(pFile, off_t(kOffset), SEEK_SET) == 0;
+#endif // _WIN32
+}
+
+static inline uint32_t GridCoordinate(float Value, float Minimum, float InverseCellSize, uint32_t kCells) noexcept
+{
+    const float Cell = (Value - Minimum) * InverseCellSize;
+    return Cell <= 0.0f ? 0u : std::min(uint32_t(Cell), kCells - 1u);
+}
+
+// SOURCES
+void ArrayPointSource::Rewind() noexcept
+{
+    m_Cursor = 0u;
+}
+
+size_t ArrayPointSource::Read(Vertex* pPoints, size_t kCapacity) noexcept
+{
+    const size_t kCount = std::min(kCapacity, m_Count - m_Cursor);
+    std::copy(m_Points + m_Cursor, m_Points + m_Cursor + kCount, pPoints);
+    m_Cursor += kCount;
+    return kCount;
+}
+
+// BUILDING
+struct BuildNode
+{
+    Float3       Minimum     = {};
+    float        Size        = 0.0f;
+    uint32_t     Level       = 0u;
+    uint32_t     Children[8] = { s_NoChild, s_NoChild, s_NoChild, s_NoChild, s_NoChild, s_NoChild, s_NoChild, s_NoChild };
+    List<Vertex> Points      = {};
+    uint32_t     PointCount  = 0u; // Points once they are written and freed
+    uint64_t     PointOffset = 0u;
+    bool         bChunkRoot  = false;
+
+    bool IsLeaf() const noexcept
+    {
+        return std::all_of(Children, Children + 8, [](uint32_t kChild) { return kChild == s_NoChild; });
+    }
+};
+
+// The parent takes the first point of its children in every cell of its grid. Its cells are each inside one child,
+// and a child's points are already its own sample first, so the parent samples the children's samples.
+static void SampleChildren(List<BuildNode>& Nodes, uint32_t kNode, uint32_t kGrid) noexcept
+{
+    const Float3 Minimum     = Nodes[kNode].Minimum;
+    const float  InverseCell = float(kGrid) / Nodes[kNode].Size;
+
+    List<uint64_t> Occupied = List<uint64_t>((size_t(kGrid) * kGrid * kGrid + 63u) / 64u, 0u);
+    List<Vertex>&  Sample   = Nodes[kNode].Points;
+    for (uint32_t kOctant = 0u; kOctant < 8u; kOctant++)
+    {
+        const uint32_t kChild = Nodes[kNode].Children[kOctant];
+        if (kChild == s_NoChild)
+        {
+            continue;
+        }
+
+        List<Vertex>& Points = Nodes[kChild].Points;
+        size_t        kKept  = 0u;
+        for (const Vertex& p : Points)
+        {
+            const size_t kCell = (size_t(GridCoordinate(p.Position.Z, Minimum.Z, InverseCell, kGrid)) * kGrid +
+                                  size_t(GridCoordinate(p.Position.Y, Minimum.Y, InverseCell, kGrid))) * kGrid +
+                                  size_t(GridCoordinate(p.Position.X, Minimum.X, InverseCell, kGrid));
+            const uint64_t kBit = uint64_t(1u) << (kCell & 63u);
+            if (Occupied[kCell >> 6u] & kBit)
+            {
+                Points[kKept++] = p;
+            }
+            else
+            {
+                Occupied[kCell >> 6u] |= kBit;
+                Sample.push_back(p);
+            }
+        }
+        Points.resize(kKept);
+
+        // Leaves the parent took everything from are dropped
+        if (Points.empty() && Nodes[kChild].IsLeaf())
+        {
+            Nodes[kNode].Children[kOctant] = s_NoChild;
+        }
+    }
+}
+
+static void SplitNode(List<BuildNode>& Nodes, uint32_t kNode, const PointCloudBuildOptions& Options) noexcept
+{
+    if (Nodes[kNode].Points.size() <= Options.MaxNodePoints || Nodes[kNode].Level >= Options.MaxDepth)
+    {
+        return;
+    }
+
+    const float  Half   = Nodes[kNode].Size * 0.5f;
+    const Float3 Center = Nodes[kNode].Minimum + Float3(Half, Half, Half);
+
+    List<Vertex> Octants[8] = {};
+    {
+        List<Vertex> Points = {};
+        Points.swap(Nodes[kNode].Points);
+
+        size_t kCounts[8] = {};
+        for (const Vertex& p : Points)
+        {
+            kCounts[uint32_t(p.Position.X >= Center.X) | uint32_t(p.Position.Y >= Center.Y) << 1u | uint32_t(p.Position.Z >= Center.Z) << 2u]++;
+        }
+        for (uint32_t kOctant = 0u; kOctant < 8u; kOctant++)
+        {
+            Octants[kOctant].reserve(kCounts[kOctant]);
+        }
+        for (const Vertex& p : Points)
+        {
+            Octants[uint32_t(p.Position.X >= Center.X) | uint32_t(p.Position.Y >= Center.Y) << 1u | uint32_t(p.Position.Z >= Center.Z) << 2u].push_back(p);
+        }
+    }
+
+    for (uint32_t kOctant = 0u; kOctant < 8u; kOctant++)
+    {
+        if (Octants[kOctant].empty())
+        {
+            continue;
+        }
+
+        BuildNode Child = {};
+        Child.Minimum = Nodes[kNode].Minimum + Float3(kOctant & 1u ? Half : 0.0f, kOctant & 2u ? Half : 0.0f, kOctant & 4u ? Half : 0.0f);
+        Child.Size    = Half;
+        Child.Level   = Nodes[kNode].Level + 1u;
+        Child.Points.swap(Octants[kOctant]);
+
+        Nodes[kNode].Children[kOctant] = uint32_t(Nodes.size());
+        Nodes.emplace_back(std::move(Child));
+    }
+
+    for (uint32_t kOctant = 0u; kOctant < 8u; kOctant++)
+    {
+        if (Nodes[kNode].Children[kOctant] != s_NoChild)
+        {
+            SplitNode(Nodes, Nodes[kNode].Children[kOctant], Options);
+        }
+    }
+    SampleChildren(Nodes, kNode, Options.SampleGrid);
+}
+
+// Nodes above the chunks are filled once every chunk is built, from the chunk roots up
+static void SampleAboveChunks(List<BuildNode>& Nodes, uint32_t kNode, uint32_t kGrid) noexcept
+{
+    if (Nodes[kNode].bChunkRoot)
+    {
+        return;
+    }
+    for (uint32_t kChild : Nodes[kNode].Children)
+    {
+        if (kChild != s_NoChild)
+        {
+            SampleAboveChunks(Nodes, kChild, kGrid);
+        }
+    }
+    SampleChildren(Nodes, kNode, kGrid);
+}
+
+static bool WritePoints(FILE* pFile, uint64_t& kOffset, BuildNode& Node) noexcept
+{
+    Node.PointOffset = kOffset;
+    Node.PointCount  = uint32_t(Node.Points.size());
+    if (!Node.Points.empty() && fwrite(Node.Points.data(), sizeof(Vertex), Node.Points.size(), pFile) != Node.Points.size())
+    {
+        return false;
+    }
+    kOffset += Node.Points.size() * sizeof(Vertex);
+    List<Vertex>().swap(Node.Points);
+    return true;
+}
+
+struct BuildChunk
+{
+    uint32_t     Level   = 0u;
+    uint32_t     X       = 0u;
+    uint32_t     Y       = 0u;
+    uint32_t     Z       = 0u;
+    uint64_t     Count   = 0u;
+    uint64_t     Offset  = 0u; // Points into the temporary file
+    uint64_t     Written = 0u;
+    uint32_t     Node    = 0u; // Its root among the nodes above the chunks
+    List<Vertex> Buffer  = {};
+};
+
+// Largest cells of the counting pyramid with few enough points, down to the counting grid itself
+static void ChooseChunks(const List<List<uint64_t>>& Counts, uint32_t kLevel, uint32_t x, uint32_t y, uint32_t z, size_t kMaxPoints, List<BuildChunk>& Chunks) noexcept
+{
+    const uint32_t kCells = 1u << kLevel;
+    const uint64_t kCount = Counts[kLevel][(size_t(z) * kCells + y) * kCells + x];
+    if (kCount == 0u)
+    {
+        return;
+    }
+
+    if (kCount <= kMaxPoints || kLevel == s_CountingLevel)
+    {
+        BuildChunk Chunk = {};
+        Chunk.Level = kLevel;
+        Chunk.X     = x;
+        Chunk.Y     = y;
+        Chunk.Z     = z;
+        Chunk.Count = kCount;
+        Chunks.emplace_back(std::move(Chunk));
+        return;
+    }
+
+    for (uint32_t kOctant = 0u; kOctant < 8u; kOctant++)
+    {
+        ChooseChunks(Counts, kLevel + 1u, 2u * x + (kOctant & 1u), 2u * y + ((kOctant >> 1u) & 1u), 2u * z + (kOctant >> 2u), kMaxPoints, Chunks);
+    }
+}
+
+bool PointCloudBuilder::Build(IPointSource& Source, const char* lpFilepath, const PointCloudBuildOptions& Options, PointCloudBuildReport* pReport) noexcept
+{
+    List<Vertex> Batch = List<Vertex>(ReadBatch);
+
+    // Bounds, as a cube so every node is one
+    uint64_t kPointCount = 0u;
+    Float3   Lower       = Float3(FLT_MAX, FLT_MAX, FLT_MAX);
+    Float3   Upper       = Float3(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+    Source.Rewind();
+    for (size_t kRead = Source.Read(Batch.data(), Batch.size()); kRead > 0u; kRead = Source.Read(Batch.data(), Batch.size()))
+    {
+        for (size_t k = 0u; k < kRead; k++)
+        {
+            const Float3& p = Batch[k].Position;
+            Lower = Float3(std::min(Lower.X, p.X), std::min(Lower.Y, p.Y), std::min(Lower.Z, p.Z));
+            Upper = Float3(std::max(Upper.X, p.X), std::max(Upper.Y, p.Y), std::max(Upper.Z, p.Z));
+        }
+        kPointCount += kRead;
+    }
+    if (kPointCount == 0u)
+    {
+        return false;
+    }
+
+    float Size = std::max(std::max(Upper.X - Lower.X, Upper.Y - Lower.Y), Upper.Z - Lower.Z);
+    Size = Size > 0.0f ? Size * 1.0001f : 1.0f; // The largest points stay inside
+
+    // Count on the fine grid and sum it up into a pyramid
+    const uint32_t kGridCells   = 1u << s_CountingLevel;
+    const float    InverseCell  = float(kGridCells) / Size;
+    const auto     GetGridCell  = [&](const Float3& p) -> size_t
+    {
+        return (size_t(GridCoordinate(p.Z, Lower.Z, InverseCell, kGridCells)) * kGridCells +
+                size_t(GridCoordinate(p.Y, Lower.Y, InverseCell, kGridCells))) * kGridCells +
+                size_t(GridCoordinate(p.X, Lower.X, InverseCell, kGridCells));
+    };
+
+    List<List<uint64_t>> Counts = List<List<uint64_t>>(s_CountingLevel + 1u);
+    for (uint32_t kLevel = 0u; kLevel <= s_CountingLevel; kLevel++)
+    {
+        Counts[kLevel].assign(size_t(1u) << (3u * kLevel), 0u);
+    }
+    Source.Rewind();
+    for (size_t kRead = Source.Read(Batch.data(), Batch.size()); kRead > 0u; kRead = Source.Read(Batch.data(), Batch.size()))
+    {
+        for (size_t k = 0u; k < kRead; k++)
+        {
+            Counts[s_CountingLevel][GetGridCell(Batch[k].Position)]++;
+        }
+    }
+    for (uint32_t kLevel = s_CountingLevel; kLevel > 0u; kLevel--)
+    {
+        const uint32_t kCells = 1u << kLevel;
+        for (uint32_t z = 0u; z < kCells; z++)
+        {
+            for (uint32_t y = 0u; y < kCells; y++)
+            {
+                for (uint32_t x = 0u; x < kCells; x++)
+                {
+                    Counts[kLevel - 1u][(size_t(z / 2u) * (kCells / 2u) + y / 2u) * (kCells / 2u) + x / 2u] += Counts[kLevel][(size_t(z) * kCells + y) * kCells + x];
+                }
+            }
+        }
+    }
+
+    List<BuildChunk> Chunks = {};
+    ChooseChunks(Counts, 0u, 0u, 0u, 0u, std::max<size_t>(Options.MaxChunkPoints, 1u), Chunks);
+
+    List<uint32_t> GridChunks = List<uint32_t>(Counts[s_CountingLevel].size(), s_NoChild);
+    uint64_t       kOffset    = 0u;
+    for (uint32_t kChunk = 0u; kChunk < uint32_t(Chunks.size()); kChunk++)
+    {
+        BuildChunk&    Chunk  = Chunks[kChunk];
+        const uint32_t kShift = s_CountingLevel - Chunk.Level;
+        const uint32_t kSpan  = 1u << kShift;
+        for (uint32_t z = Chunk.Z << kShift; z < (Chunk.Z + 1u) << kShift; z++)
+        {
+            for (uint32_t y = Chunk.Y << kShift; y < (Chunk.Y + 1u) << kShift; y++)
+            {
+                std::fill_n(GridChunks.begin() + (size_t(z) * kGridCells + y) * kGridCells + (Chunk.X << kShift), kSpan, kChunk);
+            }
+        }
+        Chunk.Offset = kOffset;
+        kOffset += Chunk.Count;
+    }
+
+    // Distribute the points to their chunks' ranges of a temporary file
+    const String Scratch = String(lpFilepath) + ".points.tmp";
+    FILE* pScratch = fopen(Scratch.c_str(), "w+b");
+    if (!pScratch)
+    {
+        return false;
+    }
+
+    bool bOk = true;
+    const auto Flush = [&](BuildChunk& Chunk)
+    {
+        if (!Chunk.Buffer.empty())
+        {
+            bOk = bOk && SeekFile(pScratch, (Chunk.Offset + Chunk.Written) * sizeof(Vertex));
+            bOk = bOk && fwrite(Chunk.Buffer.data(), sizeof(Vertex), Chunk.Buffer.size(), pScratch) == Chunk.Buffer.size();
+            Chunk.Written += Chunk.Buffer.size();
+            Chunk.Buffer.clear();
+        }
+    };
+
+    Source.Rewind();
+    for (size_t kRead = Source.Read(Batch.data(), Batch.size()); kRead > 0u && bOk; kRead = Source.Read(Batch.data(), Batch.size()))
+    {
+        for (size_t k = 0u; k < kRead; k++)
+        {
+            BuildChunk& Chunk = Chunks[GridChunks[GetGridCell(Batch[k].Position)]];
+            if (Chunk.Buffer.capacity() == 0u)
+            {
+                Chunk.Buffer.reserve(size_t(std::min<uint64_t>(Chunk.Count, s_ChunkBufferPoints)));
+            }
+            Chunk.Buffer.push_back(Batch[k]);
+            if (Chunk.Buffer.size() == s_ChunkBufferPoints)
+            {
+                Flush(Chunk);
+            }
+        }
+    }
+    for (BuildChunk& Chunk : Chunks)
+    {
+        Flush(Chunk);
+        List<Vertex>().swap(Chunk.Buffer);
+        bOk = bOk && Chunk.Written == Chunk.Count; // The source changed between passes otherwise
+    }
+    bOk = bOk && fflush(pScratch) == 0;
+    List<Vertex>().swap(Batch);
+
+    // The nodes from the root down to every chunk root
+    List<BuildNode> Nodes = {};
+    Nodes.emplace_back();
+    Nodes[0].Minimum = Lower;
+    Nodes[0].Size    = Size;
+    for (BuildChunk& Chunk : Chunks)
+    {
+        uint32_t kNode = 0u;
+        for (uint32_t kLevel = 1u; kLevel <= Chunk.Level; kLevel++)
+        {
+            const uint32_t kShift  = Chunk.Level - kLevel;
+            const uint32_t kOctant = ((Chunk.X >> kShift) & 1u) | ((Chunk.Y >> kShift) & 1u) << 1u | ((Chunk.Z >> kShift) & 1u) << 2u;
+            if (Nodes[kNode].Children[kOctant] == s_NoChild)
+            {
+                const float Half  = Nodes[kNode].Size * 0.5f;
+                BuildNode   Child = {};
+                Child.Minimum = Nodes[kNode].Minimum + Float3(kOctant & 1u ? Half : 0.0f, kOctant & 2u ? Half : 0.0f, kOctant & 4u ? Half : 0.0f);
+                Child.Size    = Half;
+                Child.Level   = kLevel;
+                Nodes[kNode].Children[kOctant] = uint32_t(Nodes.size());
+                Nodes.emplace_back(std::move(Child));
+            }
+            kNode = Nodes[kNode].Children[kOctant];
+        }
+        Nodes[kNode].bChunkRoot = true;
+        Chunk.Node = kNode;
+    }
+    const uint32_t kTopNodes = uint32_t(Nodes.size());
+
+    const String Temporary = String(lpFilepath) + ".tmp";
+    FILE* pFile = bOk ? fopen(Temporary.c_str(), "wb") : nullptr;
+    bOk = pFile != nullptr;
+
+    PointCloudHeader Header = {};
+    Header.PointCount = kPointCount;
+    bOk = bOk && fwrite(&Header, sizeof(Header), 1u, pFile) == 1u;
+    uint64_t kFileOffset = sizeof(Header);
+
+    // Every chunk's subtree on the workers, each worker one chunk at a time. Nodes below the chunk roots are written
+    // as soon as they are complete, the roots stay for the levels above to sample.
+    std::mutex Mutex = {};
+    Parallel::For(bOk ? Chunks.size() : 0u, 1u, [&](size_t kBegin, size_t kEnd)
+    {
+        FILE* pInput = fopen(Scratch.c_str(), "rb");
+        for (size_t kChunk = kBegin; kChunk < kEnd; kChunk++)
+        {
+            const BuildChunk& Chunk = Chunks[kChunk];
+
+            List<BuildNode> Subtree = List<BuildNode>(1u);
+            {
+                std::lock_guard<std::mutex> Lock = std::lock_guard<std::mutex>(Mutex);
+                Subtree[0].Minimum = Nodes[Chunk.Node].Minimum;
+                Subtree[0].Size    = Nodes[Chunk.Node].Size;
+                Subtree[0].Level   = Nodes[Chunk.Node].Level;
+            }
+
+            Subtree[0].Points.resize(size_t(Chunk.Count));
+            const bool bRead = pInput && SeekFile(pInput, Chunk.Offset * sizeof(Vertex)) && fread(Subtree[0].Points.data(), sizeof(Vertex), size_t(Chunk.Count), pInput) == Chunk.Count;
+            if (bRead)
+            {
+                SplitNode(Subtree, 0u, Options);
+            }
+
+            std::lock_guard<std::mutex> Lock = std::lock_guard<std::mutex>(Mutex);
+            bOk = bOk && bRead;
+            if (!bOk)
+            {
+                continue;
+            }
+
+            // Renumber into the shared list, depth first from the root
+            List<uint32_t> Stack   = { 0u };
+            List<uint32_t> Renamed = List<uint32_t>(Subtree.size(), s_NoChild);
+            Renamed[0] = Chunk.Node;
+            while (!Stack.empty())
+            {
+                const uint32_t kNode = Stack.back();
+                Stack.pop_back();
+
+                BuildNode& Node = Subtree[kNode];
+                for (uint32_t& kChild : Node.Children)
+                {
+                    if (kChild != s_NoChild)
+                    {
+                        Stack.push_back(kChild);
+                        Renamed[kChild] = uint32_t(Nodes.size());
+                        Nodes.emplace_back();
+                        kChild = Renamed[kChild];
+                    }
+                }
+
+                BuildNode& Destination = Nodes[Renamed[kNode]];
+                const bool bChunkRoot  = kNode == 0u;
+                Destination = std::move(Node);
+                Destination.bChunkRoot = bChunkRoot;
+                if (!bChunkRoot)
+                {
+                    bOk = bOk && WritePoints(pFile, kFileOffset, Destination);
+                }
+            }
+        }
+        if (pInput)
+        {
+            fclose(pInput);
+        }
+    });
+
+    fclose(pScratch);
+    remove(Scratch.c_str());
+
+    if (bOk)
+    {
+        SampleAboveChunks(Nodes, 0u, Options.SampleGrid);
+        for (uint32_t kNode = 0u; kNode < kTopNodes && bOk; kNode++)
+        {
+            bOk = WritePoints(pFile, kFileOffset, Nodes[kNode]);
+        }
+    }
+
+    // Breadth first, so every node's children are consecutive
+    List<PointCloudNode> Table = {};
+    if (bOk)
+    {
+        List<uint32_t> Order = { 0u };
+        for (size_t k = 0u; k < Order.size(); k++)
+        {
+            const BuildNode& Node = Nodes[Order[k]];
+
+            PointCloudNode Stored = {};
+            Stored.Minimum     = Node.Minimum;
+            Stored.Size        = Node.Size;
+            Stored.Spacing     = Node.Size / float(Options.SampleGrid);
+            Stored.PointCount  = Node.PointCount;
+            Stored.PointOffset = Node.PointOffset;
+            Stored.Level       = uint8_t(Node.Level);
+            for (uint32_t kOctant = 0u; kOctant < 8u; kOctant++)
+            {
+                if (Node.Children[kOctant] != s_NoChild)
+                {
+                    Stored.FirstChild = Stored.ChildMask == 0u ? uint32_t(Order.size()) : Stored.FirstChild;
+                    Stored.ChildMask |= uint8_t(1u << kOctant);
+                    Order.push_back(Node.Children[kOctant]);
+                }
+            }
+            Table.push_back(Stored);
+        }
+
+        Header.NodeOffset = kFileOffset;
+        Header.NodeCount  = uint32_t(Table.size());
+        bOk = fwrite(Table.data(), sizeof(PointCloudNode), Table.size(), pFile) == Table.size();
+        bOk = bOk && SeekFile(pFile, 0u) && fwrite(&Header, sizeof(Header), 1u, pFile) == 1u;
+    }
+
+    if (pFile && (fclose(pFile) != 0 || !bOk))
+    {
+        remove(Temporary.c_str());
+        return false;
+    }
+    if (!bOk)
+    {
+        return false;
+    }
+
+    std::error_code Error = {};
+    std::filesystem::rename(Temporary, lpFilepath, Error);
+    if (Error)
+    {
+        return false;
+    }
+
+    if (pReport)
+    {
+        pReport->Points   = kPointCount;
+        pReport->Nodes    = uint32_t(Table.size());
+        pReport->Chunks   = uint32_t(Chunks.size());
+        pReport->MaxLevel = 0u;
+        for (const PointCloudNode& Node : Table)
+        {
+            pReport->MaxLevel = std::max<uint32_t>(pReport->MaxLevel, Node.Level);
+        }
+    }
+    return true;
+}
+
+// LOD SELECTION
+static BoundingSphere GetNodeBounds(const PointCloudNode& Node) noexcept
+{
+    const float Half = Node.Size * 0.5f;
+    return { Node.Minimum + Float3(Half, Half, Half), Half * 1.7320508f };
+}
+
+float PointCloudLod::ProjectedSpacing(const PointCloudNode& Node, const PointCloudView& View) noexcept
+{
+    const BoundingSphere Bounds   = GetNodeBounds(Node);
+    const Float3         d        = Bounds.Center - View.CameraPosition;
+    const float          Distance = sqrtf(d.X * d.X + d.Y * d.Y + d.Z * d.Z) - Bounds.Radius;
+    return Distance > 0.0f ? Node.Spacing * View.PixelsPerUnit / Distance : FLT_MAX;
+}
+
+uint64_t PointCloudLod::Select(const PointCloudNode* pNodes, size_t kNodeCount, const PointCloudView& View, List<uint32_t>& Selected) noexcept
+{
+    Selected.clear();
+    if (kNodeCount == 0u || !MeshletBuilder::IsVisible(GetNodeBounds(pNodes[0]), View.Planes))
+    {
+        return 0u;
+    }
+
+    // Max heap on projected spacing, children always project smaller than their parent so it is a valid traversal
+    List<std::pair<float, uint32_t>> Heap = { { ProjectedSpacing(pNodes[0], View), 0u } };
+    uint64_t kPoints = 0u;
+    while (!Heap.empty())
+    {
+        std::pop_heap(Heap.begin(), Heap.end());
+        const auto [Spacing, kNode] = Heap.back();
+        Heap.pop_back();
+
+        const PointCloudNode& Node = pNodes[kNode];
+        if (kPoints + Node.PointCount > View.PointBudget)
+        {
+            break;
+        }
+        kPoints += Node.PointCount;
+        Selected.push_back(kNode);
+
+        if (Spacing <= View.MaxSpacing || Node.ChildMask == 0u)
+        {
+            continue;
+        }
+        for (uint32_t kOctant = 0u; kOctant < 8u; kOctant++)
+        {
+            const uint32_t kChild = Node.GetChild(kOctant);
+            if ((Node.ChildMask >> kOctant) & 1u && kChild < kNodeCount && MeshletBuilder::IsVisible(GetNodeBounds(pNodes[kChild]), View.Planes))
+            {
+                Heap.emplace_back(ProjectedSpacing(pNodes[kChild], View), kChild);
+                std::push_heap(Heap.begin(), Heap.end());
+            }
+        }
+    }
+    return kPoints;
+}
+
+// STREAMING
+PointCloudStream::PointCloudStream(const char* lpFilepath)
+    : m_File(lpFilepath)
+{
+    PointCloudHeader Header = {};
+    if (!m_File.IsOpen() || m_File.GetSize() < sizeof(Header))
+    {
+        m_File.Close();
+        return;
+    }
+    memcpy(&Header, m_File.GetData(), sizeof(Header));
+
+    const bool bValid = Header.Magic == PointCloudBuilder::Magic && Header.Version == PointCloudBuilder::Version &&
+                        Header.NodeStride == sizeof(PointCloudNode) && Header.NodeOffset <= m_File.GetSize() &&
+                        uint64_t(Header.NodeCount) * sizeof(PointCloudNode) <= m_File.GetSize() - Header.NodeOffset;
+    if (!bValid)
+    {
+        m_File.Close();
+        return;
+    }
+
+    m_Nodes.resize(Header.NodeCount);
+    memcpy(m_Nodes.data(), m_File.GetData() + Header.NodeOffset, m_Nodes.size() * sizeof(PointCloudNode));
+    for (const PointCloudNode& Node : m_Nodes)
+    {
+        const bool bChildrenValid = Node.ChildMask == 0u || uint64_t(Node.FirstChild) + (Node.GetChild(8u) - Node.FirstChild) <= m_Nodes.size();
+        if (Node.PointOffset + uint64_t(Node.PointCount) * sizeof(Vertex) > Header.NodeOffset || !bChildrenValid)
+        {
+            m_Nodes.clear();
+            m_File.Close();
+            return;
+        }
+    }
+
+    m_Loader = std::thread(&PointCloudStream::LoaderMain, this);
+}
+
+PointCloudStream::~PointCloudStream() noexcept
+{
+    if (m_Loader.joinable())
+    {
+        {
+            std::lock_guard<std::mutex> Lock = std::lock_guard<std::mutex>(m_Mutex);
+            m_bStopping = true;
+        }
+        m_Wake.notify_all();
+        m_Loader.join();
+    }
+}
+
+bool PointCloudStream::IsOpen() const noexcept
+{
+    return !m_Nodes.empty();
+}
+
+const List<PointCloudNode>& PointCloudStream::GetNodes() const noexcept
+{
+    return m_Nodes;
+}
+
+void PointCloudStream::Request(const List<uint32_t>& Nodes) noexcept
+{
+    {
+        std::lock_guard<std::mutex> Lock = std::lock_guard<std::mutex>(m_Mutex);
+        m_Queue.clear();
+        for (auto it = Nodes.rbegin(); it != Nodes.rend(); ++it)
+        {
+            const bool bLoaded = std::any_of(m_Loaded.begin(), m_Loaded.end(), [&](const LoadedNode& Loaded) { return Loaded.Node == *it; });
+            if (*it < m_Nodes.size() && *it != m_InFlight && !bLoaded)
+            {
+                m_Queue.push_back(*it);
+            }
+        }
+    }
+    m_Wake.notify_one();
+}
+
+void PointCloudStream::TakeLoaded(List<LoadedNode>& Loaded) noexcept
+{
+    std::lock_guard<std::mutex> Lock = std::lock_guard<std::mutex>(m_Mutex);
+    for (LoadedNode& Node : m_Loaded)
+    {
+        Loaded.emplace_back(std::move(Node));
+    }
+    m_Loaded.clear();
+}
+
+void PointCloudStream::Flush() noexcept
+{
+    std::unique_lock<std::mutex> Lock = std::unique_lock<std::mutex>(m_Mutex);
+    m_Idle.wait(Lock, [this]() { return m_Queue.empty() && m_InFlight == UINT32_MAX; });
+}
+
+void PointCloudStream::LoaderMain() noexcept
+{
+    std::unique_lock<std::mutex> Lock = std::unique_lock<std::mutex>(m_Mutex);
+    while (true)
+    {
+        m_Wake.wait(Lock, [this]() { return m_bStopping || !m_Queue.empty(); });
+        if (m_bStopping)
+        {
+            break;
+        }
+
+        m_InFlight = m_Queue.back();
+        m_Queue.pop_back();
+        Lock.unlock();
+
+        LoadedNode           Loaded = {};
+        const PointCloudNode& Node  = m_Nodes[m_InFlight];
+        const Vertex*        pData  = reinterpret_cast<const Vertex*>(m_File.GetData() + Node.PointOffset);
+        Loaded.Node = m_InFlight;
+        Loaded.Points.assign(pData, pData + Node.PointCount);
+
+        Lock.lock();
+        m_Loaded.emplace_back(std::move(Loaded));
+        m_InFlight = UINT32_MAX;
+        if (m_Queue.empty())
+        {
+            m_Idle.notify_all();
+        }
+    }
+}
@@ -0,0 +1,161 @@
+#pragma once
+
+#include "Core.h"
+#include "File.h"
+
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+// Octree node as stored in a point cloud file. Every node holds a sample of the points under it, spaced about
+// Spacing apart, and its descendants only add the points between them, so drawing a node and its ancestors is a
+// complete picture at that node's resolution.
+struct PointCloudNode
+{
+	static constexpr uint32_t NoChildren = UINT32_MAX;
+
+	Float3   Minimum     = {};          // Corner of the node's cube
+	float    Size        = 0.0f;        // Edge length of the cube
+	float    Spacing     = 0.0f;        // Distance between the node's points, the error of stopping here
+	uint32_t PointCount  = 0u;
+	uint64_t PointOffset = 0u;          // Bytes from the start of the file
+	uint32_t FirstChild  = NoChildren;  // Children are consecutive in octant order
+	uint8_t  ChildMask   = 0u;          // Bit i set when octant i has a child, octant bits are X, Y, Z from the lowest
+	uint8_t  Level       = 0u;
+	uint16_t Reserved    = 0u;
+
+	uint32_t GetChild(uint32_t kOctant) const noexcept
+	{
+		uint32_t kIndex = FirstChild;
+		for (uint32_t k = 0u; k < kOctant; k++)
+		{
+			kIndex += (ChildMask >> k) & 1u;
+		}
+		return kIndex;
+	}
+};
+static_assert(sizeof(PointCloudNode) == 40u, "PointCloudNode is stored as is");
+
+// Points from wherever they live, usually too many to hold at once. The builder reads them three times.
+class IPointSource
+{
+public:
+	virtual ~IPointSource() = default;
+
+	virtual void   Rewind() noexcept = 0;
+	// Returns how many points were written to pPoints, 0 once there are none left
+	virtual size_t Read(Vertex* pPoints, size_t kCapacity) noexcept = 0;
+};
+
+class ArrayPointSource : public IPointSource
+{
+public:
+	ArrayPointSource(const Vertex* pPoints, size_t kCount) noexcept
+		: m_Points(pPoints), m_Count(kCount)
+	{ }
+
+	virtual void   Rewind() noexcept override;
+	virtual size_t Read(Vertex* pPoints, size_t kCapacity) noexcept override;
+
+private:
+	const Vertex* m_Points = nullptr;
+	size_t        m_Count  = 0u;
+	size_t        m_Cursor = 0u;
+};
+
+struct PointCloudBuildOptions
+{
+	uint32_t MaxNodePoints  = 20000u;          // Nodes with more points are split
+	uint32_t SampleGrid     = 64u;             // Cells per side of a node, inner nodes keep one point per cell
+	size_t   MaxChunkPoints = size_t(4u) << 20u; // Points a worker builds in memory at once
+	uint32_t MaxDepth       = 20u;             // Nodes this deep are never split, however many points they get
+};
+
+struct PointCloudBuildReport
+{
+	uint64_t Points   = 0u;
+	uint32_t Nodes    = 0u;
+	uint32_t Chunks   = 0u;
+	uint32_t MaxLevel = 0u;
+};
+
+// Offline octree construction in the style of Potree (Schütz 2016, 2020). Points are counted on a coarse grid and
+// distributed to chunks small enough to build in memory, written to a temporary file, then every chunk's subtree is
+// built on the worker threads and the levels above the chunks are sampled from the chunk roots. Inner nodes are
+// filled bottom up, each taking one point per grid cell from its children.
+class PointCloudBuilder
+{
+public:
+	static constexpr uint32_t Magic     = 0x544F4350u; // "PCOT"
+	static constexpr uint32_t Version   = 1u;
+	static constexpr size_t   ReadBatch = 65536u;      // Points
+
+	// Writes through a temporary like MeshCodec::SaveToFile(). Fails for empty sources and on file errors.
+	static bool Build(IPointSource& Source, const char* lpFilepath, const PointCloudBuildOptions& Options = {}, PointCloudBuildReport* pReport = nullptr) noexcept;
+};
+
+struct PointCloudView
+{
+	Float4   Planes[6]      = {};   // (n, d) with dot(n, p) + d >= 0 inside, in the cloud's space
+	Float3   CameraPosition = {};
+	float    PixelsPerUnit  = 1.0f; // Pixels a unit covers at a depth of one
+	float    MaxSpacing     = 2.0f; // Pixels between points on screen beyond which a node is refined
+	uint64_t PointBudget    = 0u;
+};
+
+class PointCloudLod
+{
+public:
+	// Visible nodes in order of projected spacing, largest first, descending into a node's children while its
+	// projected spacing is above View.MaxSpacing. Stops at the first node that would go over the point budget.
+	// Returns the selected point count.
+	static uint64_t Select(const PointCloudNode* pNodes, size_t kNodeCount, const PointCloudView& View, List<uint32_t>& Selected) noexcept;
+
+	// Spacing in pixels at the point of the node's bounding sphere closest to the camera, infinite inside it
+	static float ProjectedSpacing(const PointCloudNode& Node, const PointCloudView& View) noexcept;
+};
+
+// A built file's node table, with node points read on a background thread. The file is mapped, so reading a node is
+// copying it out of the mapping and the page faults happen on the loader thread.
+class PointCloudStream
+{
+public:
+	struct LoadedNode
+	{
+		uint32_t     Node   = 0u;
+		List<Vertex> Points = {};
+	};
+
+public:
+	PointCloudStream(const char* lpFilepath);
+	~PointCloudStream() noexcept;
+
+	bool                        IsOpen() const noexcept;
+	const List<PointCloudNode>& GetNodes() const noexcept;
+
+	// Replaces the queued requests, nodes are read in the given order. Nodes already being read are not read again.
+	void Request(const List<uint32_t>& Nodes) noexcept;
+	// Moves the nodes read since the last call to the end of Loaded
+	void TakeLoaded(List<LoadedNode>& Loaded) noexcept;
+	// Blocks until the queue is empty and nothing is being read
+	void Flush() noexcept;
+
+private:
+	PointCloudStream(const PointCloudStream&) = delete;
+	PointCloudStream& operator=(const PointCloudStream&) = delete;
+
+	void LoaderMain() noexcept;
+
+private:
+	MappedFile           m_File  = {};
+	List<PointCloudNode> m_Nodes = {};
+
+	std::thread             m_Loader     = {};
+	std::mutex              m_Mutex      = {};
+	std::condition_variable m_Wake       = {};
+	std::condition_variable m_Idle       = {};
+	List<uint32_t>          m_Queue      = {}; // Reversed, the next node is at the back
+	List<LoadedNode>        m_Loaded     = {};
+	uint32_t                m_InFlight   = UINT32_MAX;
+	bool                    m_bStopping  = false;
+};
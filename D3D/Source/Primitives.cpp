@@ -0,0 +1,66 @@
+#include "Primitives.h"
+
+// PRIMITIVES
+void Primitives::Icosahedron(List<Float3>& Positions, List<uint32_t>& Indices, uint32_t kSubdivisions) noexcept
+{
+    const float t = (1.0f + sqrtf(5.0f)) * 0.5f;
+    const float s = 1.0f / sqrtf(1.0f + t * t);
+
+    Positions =
+    {
+        { -s,  t * s, 0.0f }, {  s,  t * s, 0.0f }, { -s, -t * s, 0.0f }, {  s, -t * s, 0.0f },
+        { 0.0f, -s,  t * s }, { 0.0f,  s,  t * s }, { 0.0f, -s, -t * s }, { 0.0f,  s, -t * s },
+        {  t * s, 0.0f, -s }, {  t * s, 0.0f,  s }, { -t * s, 0.0f, -s }, { -t * s, 0.0f,  s },
+    };
+    Indices =
+    {
+        0u, 11u, 5u,  0u, 5u, 1u,  0u, 1u, 7u,  0u, 7u, 10u,  0u, 10u, 11u,
+        1u, 5u, 9u,   5u, 11u, 4u, 11u, 10u, 2u, 10u, 7u, 6u,  7u, 1u, 8u,
+        3u, 9u, 4u,   3u, 4u, 2u,  3u, 2u, 6u,  3u, 6u, 8u,   3u, 8u, 9u,
+        4u, 9u, 5u,   2u, 4u, 11u, 6u, 2u, 10u, 8u, 6u, 7u,   9u, 8u, 1u,
+    };
+
+    Dictionary<uint64_t, uint32_t> Midpoints = {};
+    List<uint32_t>                 Split     = {};
+    for (uint32_t kLevel = 0u; kLevel < kSubdivisions; kLevel++)
+    {
+        // Every edge gains one vertex, a closed mesh has one edge per two indices
+        Midpoints.clear();
+        Midpoints.reserve(Indices.size() / 2u);
+        Positions.reserve(Positions.size() + Indices.size() / 2u);
+
+        auto Midpoint = [&](uint32_t a, uint32_t b) -> uint32_t
+        {
+            const uint64_t kEdge = a < b ? (uint64_t(a) << 32u) | b : (uint64_t(b) << 32u) | a;
+            const auto     it    = Midpoints.find(kEdge);
+            if (it != Midpoints.end())
+            {
+                return it->second;
+            }
+
+            const Float3& p = Positions[a];
+            const Float3& q = Positions[b];
+            const Float3  m = Float3(p.X + q.X, p.Y + q.Y, p.Z + q.Z);
+            const float   l = 1.0f / sqrtf(m.X * m.X + m.Y * m.Y + m.Z * m.Z);
+
+            const uint32_t kIndex = uint32_t(Positions.size());
+            Positions.emplace_back(m.X * l, m.Y * l, m.Z * l);
+            Midpoints.emplace(kEdge, kIndex);
+            return kIndex;
+        };
+
+        Split.clear();
+        Split.reserve(Indices.size() * 4u);
+        for (size_t k = 0u; k < Indices.size(); k += 3u)
+        {
+            const uint32_t a  = Indices[k + 0u];
+            const uint32_t b  = Indices[k + 1u];
+            const uint32_t c  = Indices[k + 2u];
+            const uint32_t ab = Midpoint(a, b);
+            const uint32_t bc = Midpoint(b, c);
+            const uint32_t ca = Midpoint(c, a);
+            Split.insert(Split.end(), { a, ab, ca,  b, bc, ab,  c, ca, bc,  ab, bc, ca });
+        }
+        Indices.swap(Split);
+    }
+}
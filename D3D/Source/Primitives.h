@@ -0,0 +1,321 @@
+#pragma once
+
+#include "Core.h"
+
+#include <algorithm>
+
+// Indexed shapes generated straight into the caller's vertex layout, so primitives need no file or importer and any
+// tessellation level can be made on demand. Shapes are centred on the origin with Y up, outward normals and clockwise
+// front faces. MakeVertex(Position, Normal) returns one vertex, indices are offset by the vertices already in the list
+// so several shapes can share one buffer.
+class Primitives
+{
+public:
+	// Latitude/longitude sphere, the seam column and the poles are duplicated so every vertex has one normal
+	template<typename V, typename Fn>
+	static void UVSphere(List<V>& Vertices, List<uint32_t>& Indices, float Radius, uint32_t kSlices, uint32_t kStacks, Fn&& MakeVertex);
+
+	// Subdivided icosahedron, 10 * 4^kSubdivisions + 2 vertices spread far more evenly than a UV sphere
+	template<typename V, typename Fn>
+	static void IcoSphere(List<V>& Vertices, List<uint32_t>& Indices, float Radius, uint32_t kSubdivisions, Fn&& MakeVertex);
+
+	// Plane in XZ facing +Y, kColumns cells along X and kRows along Z
+	template<typename V, typename Fn>
+	static void Grid(List<V>& Vertices, List<uint32_t>& Indices, float Width, float Depth, uint32_t kColumns, uint32_t kRows, Fn&& MakeVertex);
+
+	// Ring around the Y axis, kRings segments along the ring and kSides around the tube
+	template<typename V, typename Fn>
+	static void Torus(List<V>& Vertices, List<uint32_t>& Indices, float MajorRadius, float MinorRadius, uint32_t kRings, uint32_t kSides, Fn&& MakeVertex);
+
+	// Truncated cone along Y with smooth sides and flat caps, a radius of zero closes that end in a point
+	template<typename V, typename Fn>
+	static void Frustum(List<V>& Vertices, List<uint32_t>& Indices, float BottomRadius, float TopRadius, float Height, uint32_t kSlices, uint32_t kStacks, bool bCapped, Fn&& MakeVertex);
+
+	template<typename V, typename Fn>
+	static void Cylinder(List<V>& Vertices, List<uint32_t>& Indices, float Radius, float Height, uint32_t kSlices, uint32_t kStacks, bool bCapped, Fn&& MakeVertex);
+
+	template<typename V, typename Fn>
+	static void Cone(List<V>& Vertices, List<uint32_t>& Indices, float Radius, float Height, uint32_t kSlices, bool bCapped, Fn&& MakeVertex);
+
+	// Four vertices per face so every face keeps its own normal
+	template<typename V, typename Fn>
+	static void Box(List<V>& Vertices, List<uint32_t>& Indices, const Float3& HalfExtents, Fn&& MakeVertex);
+
+	// Unit sphere the icosphere is built from, midpoints are shared between neighbouring faces so the result is closed
+	static void Icosahedron(List<Float3>& Positions, List<uint32_t>& Indices, uint32_t kSubdivisions) noexcept;
+
+private:
+	static constexpr float Pi = 3.14159265358979f;
+
+	// Two triangles over the quad a-b-c-d given in clockwise order seen from the front
+	static void EmplaceQuad(List<uint32_t>& Indices, uint32_t a, uint32_t b, uint32_t c, uint32_t d) noexcept;
+};
+
+
+inline void Primitives::EmplaceQuad(List<uint32_t>& Indices, uint32_t a, uint32_t b, uint32_t c, uint32_t d) noexcept
+{
+	Indices.insert(Indices.end(), { a, b, c, a, c, d });
+}
+
+template<typename V, typename Fn>
+inline void Primitives::UVSphere(List<V>& Vertices, List<uint32_t>& Indices, float Radius, uint32_t kSlices, uint32_t kStacks, Fn&& MakeVertex)
+{
+	kSlices = std::max(kSlices, 3u);
+	kStacks = std::max(kStacks, 2u);
+
+	const uint32_t kBase    = uint32_t(Vertices.size());
+	const uint32_t kColumns = kSlices + 1u;
+	Vertices.reserve(Vertices.size() + size_t(kColumns) * (kStacks + 1u));
+	Indices.reserve(Indices.size() + size_t(kSlices) * (kStacks - 1u) * 6u);
+
+	for (uint32_t s = 0u; s <= kStacks; s++)
+	{
+		const float Phi = Pi * float(s) / float(kStacks);
+		for (uint32_t k = 0u; k <= kSlices; k++)
+		{
+			const float  Theta  = 2.0f * Pi * float(k % kSlices) / float(kSlices);
+			const Float3 Normal = Float3(sinf(Phi) * cosf(Theta), cosf(Phi), sinf(Phi) * sinf(Theta));
+			Vertices.emplace_back(MakeVertex(Float3(Normal.X * Radius, Normal.Y * Radius, Normal.Z * Radius), Normal));
+		}
+	}
+
+	// The triangle touching a pole with two of its corners is degenerate and left out
+	for (uint32_t s = 0u; s < kStacks; s++)
+	{
+		for (uint32_t k = 0u; k < kSlices; k++)
+		{
+			const uint32_t a = kBase + s * kColumns + k;
+			const uint32_t b = a + 1u;
+			const uint32_t c = b + kColumns;
+			const uint32_t d = a + kColumns;
+			if (s != 0u)
+			{
+				Indices.insert(Indices.end(), { a, b, d });
+			}
+			if (s != kStacks - 1u)
+			{
+				Indices.insert(Indices.end(), { b, c, d });
+			}
+		}
+	}
+}
+
+template<typename V, typename Fn>
+inline void Primitives::IcoSphere(List<V>& Vertices, List<uint32_t>& Indices, float Radius, uint32_t kSubdivisions, Fn&& MakeVertex)
+{
+	List<Float3>   Positions = {};
+	List<uint32_t> Faces     = {};
+	Icosahedron(Positions, Faces, kSubdivisions);
+
+	const uint32_t kBase = uint32_t(Vertices.size());
+	Vertices.reserve(Vertices.size() + Positions.size());
+	for (const Float3& Normal : Positions)
+	{
+		Vertices.emplace_back(MakeVertex(Float3(Normal.X * Radius, Normal.Y * Radius, Normal.Z * Radius), Normal));
+	}
+
+	Indices.reserve(Indices.size() + Faces.size());
+	for (const uint32_t kIndex : Faces)
+	{
+		Indices.emplace_back(kBase + kIndex);
+	}
+}
+
+template<typename V, typename Fn>
+inline void Primitives::Grid(List<V>& Vertices, List<uint32_t>& Indices, float Width, float Depth, uint32_t kColumns, uint32_t kRows, Fn&& MakeVertex)
+{
+	kColumns = std::max(kColumns, 1u);
+	kRows    = std::max(kRows, 1u);
+
+	const uint32_t kBase = uint32_t(Vertices.size());
+	Vertices.reserve(Vertices.size() + size_t(kColumns + 1u) * (kRows + 1u));
+	Indices.reserve(Indices.size() + size_t(kColumns) * kRows * 6u);
+
+	for (uint32_t z = 0u; z <= kRows; z++)
+	{
+		for (uint32_t x = 0u; x <= kColumns; x++)
+		{
+			const Float3 Position = Float3(Width * (float(x) / float(kColumns) - 0.5f), 0.0f, Depth * (float(z) / float(kRows) - 0.5f));
+			Vertices.emplace_back(MakeVertex(Position, Float3(0.0f, 1.0f, 0.0f)));
+		}
+	}
+
+	for (uint32_t z = 0u; z < kRows; z++)
+	{
+		for (uint32_t x = 0u; x < kColumns; x++)
+		{
+			const uint32_t a = kBase + z * (kColumns + 1u) + x;
+			EmplaceQuad(Indices, a, a + kColumns + 1u, a + kColumns + 2u, a + 1u);
+		}
+	}
+}
+
+template<typename V, typename Fn>
+inline void Primitives::Torus(List<V>& Vertices, List<uint32_t>& Indices, float MajorRadius, float MinorRadius, uint32_t kRings, uint32_t kSides, Fn&& MakeVertex)
+{
+	kRings = std::max(kRings, 3u);
+	kSides = std::max(kSides, 3u);
+
+	const uint32_t kBase    = uint32_t(Vertices.size());
+	const uint32_t kColumns = kSides + 1u;
+	Vertices.reserve(Vertices.size() + size_t(kRings + 1u) * kColumns);
+	Indices.reserve(Indices.size() + size_t(kRings) * kSides * 6u);
+
+	for (uint32_t r = 0u; r <= kRings; r++)
+	{
+		const float Theta = 2.0f * Pi * float(r % kRings) / float(kRings);
+		for (uint32_t s = 0u; s <= kSides; s++)
+		{
+			const float  Phi    = 2.0f * Pi * float(s % kSides) / float(kSides);
+			const Float3 Normal = Float3(cosf(Phi) * cosf(Theta), sinf(Phi), cosf(Phi) * sinf(Theta));
+			const float  Ring   = MajorRadius + MinorRadius * cosf(Phi);
+			Vertices.emplace_back(MakeVertex(Float3(Ring * cosf(Theta), MinorRadius * Normal.Y, Ring * sinf(Theta)), Normal));
+		}
+	}
+
+	for (uint32_t r = 0u; r < kRings; r++)
+	{
+		for (uint32_t s = 0u; s < kSides; s++)
+		{
+			const uint32_t a = kBase + r * kColumns + s;
+			EmplaceQuad(Indices, a, a + 1u, a + kColumns + 1u, a + kColumns);
+		}
+	}
+}
+
+template<typename V, typename Fn>
+inline void Primitives::Frustum(List<V>& Vertices, List<uint32_t>& Indices, float BottomRadius, float TopRadius, float Height, uint32_t kSlices, uint32_t kStacks, bool bCapped, Fn&& MakeVertex)
+{
+	kSlices = std::max(kSlices, 3u);
+	kStacks = std::max(kStacks, 1u);
+
+	const uint32_t kBase    = uint32_t(Vertices.size());
+	const uint32_t kColumns = kSlices + 1u;
+	Vertices.reserve(Vertices.size() + size_t(kColumns) * (kStacks + 1u) + (bCapped ? 2u * (kSlices + 1u) : 0u));
+	Indices.reserve(Indices.size() + size_t(kSlices) * kStacks * 6u + (bCapped ? 6u * kSlices : 0u));
+
+	// The side normal leans by the slope, the same for the whole height
+	const float Slope  = BottomRadius - TopRadius;
+	const float Length = sqrtf(Height * Height + Slope * Slope);
+	const float Radial = Length > 0.0f ? Height / Length : 1.0f;
+	const float Rise   = Length > 0.0f ? Slope  / Length : 0.0f;
+
+	for (uint32_t s = 0u; s <= kStacks; s++)
+	{
+		const float t      = float(s) / float(kStacks);
+		const float Radius = BottomRadius + (TopRadius - BottomRadius) * t;
+		const float y      = Height * (t - 0.5f);
+		for (uint32_t k = 0u; k <= kSlices; k++)
+		{
+			const float Theta = 2.0f * Pi * float(k % kSlices) / float(kSlices);
+			const float c     = cosf(Theta);
+			const float d     = sinf(Theta);
+			Vertices.emplace_back(MakeVertex(Float3(Radius * c, y, Radius * d), Float3(Radial * c, Rise, Radial * d)));
+		}
+	}
+
+	// A pointed end collapses the row of triangles with two corners on it
+	for (uint32_t s = 0u; s < kStacks; s++)
+	{
+		for (uint32_t k = 0u; k < kSlices; k++)
+		{
+			const uint32_t a = kBase + s * kColumns + k;
+			const uint32_t b = a + 1u;
+			const uint32_t c = b + kColumns;
+			const uint32_t d = a + kColumns;
+			if (s != 0u || BottomRadius > 0.0f)
+			{
+				Indices.insert(Indices.end(), { a, d, b });
+			}
+			if (s != kStacks - 1u || TopRadius > 0.0f)
+			{
+				Indices.insert(Indices.end(), { b, d, c });
+			}
+		}
+	}
+
+	if (!bCapped)
+	{
+		return;
+	}
+
+	// Fans around a centre vertex, the ring is repeated so the caps stay flat shaded
+	const float Ends[2] = { -0.5f * Height, 0.5f * Height };
+	const float Radii[2] = { BottomRadius, TopRadius };
+	for (uint32_t e = 0u; e < 2u; e++)
+	{
+		if (Radii[e] <= 0.0f)
+		{
+			continue;
+		}
+
+		const Float3   Normal  = Float3(0.0f, e == 0u ? -1.0f : 1.0f, 0.0f);
+		const uint32_t kCentre = uint32_t(Vertices.size());
+		Vertices.emplace_back(MakeVertex(Float3(0.0f, Ends[e], 0.0f), Normal));
+		for (uint32_t k = 0u; k < kSlices; k++)
+		{
+			const float Theta = 2.0f * Pi * float(k) / float(kSlices);
+			Vertices.emplace_back(MakeVertex(Float3(Radii[e] * cosf(Theta), Ends[e], Radii[e] * sinf(Theta)), Normal));
+		}
+		for (uint32_t k = 0u; k < kSlices; k++)
+		{
+			const uint32_t a = kCentre + 1u + k;
+			const uint32_t b = kCentre + 1u + (k + 1u) % kSlices;
+			if (e == 0u)
+			{
+				Indices.insert(Indices.end(), { kCentre, a, b });
+			}
+			else
+			{
+				Indices.insert(Indices.end(), { kCentre, b, a });
+			}
+		}
+	}
+}
+
+template<typename V, typename Fn>
+inline void Primitives::Cylinder(List<V>& Vertices, List<uint32_t>& Indices, float Radius, float Height, uint32_t kSlices, uint32_t kStacks, bool bCapped, Fn&& MakeVertex)
+{
+	Frustum(Vertices, Indices, Radius, Radius, Height, kSlices, kStacks, bCapped, std::forward<Fn>(MakeVertex));
+}
+
+template<typename V, typename Fn>
+inline void Primitives::Cone(List<V>& Vertices, List<uint32_t>& Indices, float Radius, float Height, uint32_t kSlices, bool bCapped, Fn&& MakeVertex)
+{
+	Frustum(Vertices, Indices, Radius, 0.0f, Height, kSlices, 1u, bCapped, std::forward<Fn>(MakeVertex));
+}
+
+template<typename V, typename Fn>
+inline void Primitives::Box(List<V>& Vertices, List<uint32_t>& Indices, const Float3& HalfExtents, Fn&& MakeVertex)
+{
+	// Normal axis, then the two axes spanning the face so that U x W points along the normal
+	static constexpr uint32_t s_Axes[3][3] = { { 0u, 1u, 2u }, { 1u, 2u, 0u }, { 2u, 0u, 1u } };
+
+	const float Extents[3] = { HalfExtents.X, HalfExtents.Y, HalfExtents.Z };
+	Vertices.reserve(Vertices.size() + 24u);
+	Indices.reserve(Indices.size() + 36u);
+
+	for (uint32_t f = 0u; f < 6u; f++)
+	{
+		const uint32_t* pAxes = s_Axes[f >> 1u];
+		const float     Sign  = (f & 1u) ? 1.0f : -1.0f;
+
+		float n[3] = { 0.0f, 0.0f, 0.0f };
+		n[pAxes[0]] = Sign;
+
+		const uint32_t kBase = uint32_t(Vertices.size());
+		for (uint32_t k = 0u; k < 4u; k++)
+		{
+			// Corners go round the face, mirrored on the negative side so both faces wind the same way seen from outside
+			const float u = (k == 1u || k == 2u) ? 1.0f : -1.0f;
+			const float w = (k >= 2u) ? 1.0f : -1.0f;
+
+			float p[3] = {};
+			p[pAxes[0]] = Sign * Extents[pAxes[0]];
+			p[pAxes[1]] = u * Extents[pAxes[1]];
+			p[pAxes[2]] = w * Sign * Extents[pAxes[2]];
+			Vertices.emplace_back(MakeVertex(Float3(p[0], p[1], p[2]), Float3(n[0], n[1], n[2])));
+		}
+		EmplaceQuad(Indices, kBase, kBase + 1u, kBase + 2u, kBase + 3u);
+	}
+}
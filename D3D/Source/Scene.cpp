@@ -0,0 +1,541 @@
+#include "Scene.h"
+#include "File.h"
+#include "MeshOptimizer.h"
+#include "TangentSpace.h"
+#include "Welder.h"
+
+#include <assimp/Importer.hpp>
+#include <assimp/IOStream.hpp>
+#include <assimp/IOSystem.hpp>
+#include <assimp/scene.h>
+#include <assimp/postprocess.h>
+#include <algorithm>
+
+#include <string.h>
+
+#ifdef _MSC_VER
+  #pragma comment (lib, "assimp-vc140-mt.lib")
+#else
+  // error "Please link assimp-vc140-mt.lib"
+#endif
+
+// Assimp stores column vector matrices, transposing gives the row vector form DirectXMath expects
+static Float4x4 ToFloat4x4(const aiMatrix4x4& m) noexcept
+{
+    Float4x4 Result = {};
+    for (uint32_t r = 0u; r < 4u; r++)
+    {
+        for (uint32_t c = 0u; c < 4u; c++)
+        {
+            Result[r][c] = m[c][r];
+        }
+    }
+    return Result;
+}
+
+static SceneMaterial ToSceneMaterial(const aiMaterial* pMaterial) noexcept
+{
+    SceneMaterial Material = {};
+
+    aiString Name = {};
+    if (pMaterial->Get(AI_MATKEY_NAME, Name) == aiReturn_SUCCESS)
+    {
+        Material.Name = Name.C_Str();
+    }
+
+    aiColor3D Color = {};
+    if (pMaterial->Get(AI_MATKEY_COLOR_DIFFUSE, Color) == aiReturn_SUCCESS)
+    {
+        Material.DiffuseColor = Float3(Color.r, Color.g, Color.b);
+    }
+    if (pMaterial->Get(AI_MATKEY_COLOR_SPECULAR, Color) == aiReturn_SUCCESS)
+    {
+        Material.SpecularColor = Float3(Color.r, Color.g, Color.b);
+    }
+    pMaterial->Get(AI_MATKEY_SHININESS, Material.Shininess);
+
+    return Material;
+}
+
+// Vertex as converted from Assimp. Source remembers the aiMesh vertex, so data the optimizer doesn't know about can
+// follow its reordering.
+struct ImportVertex
+{
+    Float3   Position = {};
+    Float3   Normal   = {};
+    uint32_t Source   = 0u;
+
+    ImportVertex() = default;
+    ImportVertex(const Float3& pos, const Float3& n, uint32_t kSource)
+        : Position(pos), Normal(n), Source(kSource)
+    { }
+};
+
+// MorphTargetOffsets[k] is the first scene morph target of aiMesh k, channels name the meshes they animate
+static AnimationClip ToAnimationClip(const aiScene* pScene, const aiAnimation* pAnimation, const Dictionary<String, uint32_t>& NodeIndices, const List<uint32_t>& MorphTargetOffsets) noexcept
+{
+    const double TicksPerSecond = pAnimation->mTicksPerSecond > 0.0 ? pAnimation->mTicksPerSecond : 25.0;
+
+    List<AnimationTrack> Tracks = {};
+    for (uint32_t k = 0u; k < pAnimation->mNumChannels; k++)
+    {
+        const aiNodeAnim* pChannel = pAnimation->mChannels[k];
+        auto it = NodeIndices.find(pChannel->mNodeName.C_Str());
+        if (it == NodeIndices.end())
+        {
+            continue;
+        }
+
+        AnimationTrack& Track = Tracks.emplace_back();
+        Track.Target = it->second;
+        for (uint32_t n = 0u; n < pChannel->mNumPositionKeys; n++)
+        {
+            const aiVectorKey& Key = pChannel->mPositionKeys[n];
+            Track.PositionTimes.emplace_back(float(Key.mTime / TicksPerSecond));
+            Track.Positions.emplace_back(Key.mValue.x, Key.mValue.y, Key.mValue.z);
+        }
+        for (uint32_t n = 0u; n < pChannel->mNumRotationKeys; n++)
+        {
+            const aiQuatKey& Key = pChannel->mRotationKeys[n];
+            Track.RotationTimes.emplace_back(float(Key.mTime / TicksPerSecond));
+            Track.Rotations.emplace_back(Key.mValue.x, Key.mValue.y, Key.mValue.z, Key.mValue.w);
+        }
+        for (uint32_t n = 0u; n < pChannel->mNumScalingKeys; n++)
+        {
+            const aiVectorKey& Key = pChannel->mScalingKeys[n];
+            Track.ScaleTimes.emplace_back(float(Key.mTime / TicksPerSecond));
+            Track.Scales.emplace_back(Key.mValue.x, Key.mValue.y, Key.mValue.z);
+        }
+    }
+
+    List<MorphWeightTrack> MorphTracks = {};
+    for (uint32_t k = 0u; k < pAnimation->mNumMorphMeshChannels; k++)
+    {
+        const aiMeshMorphAnim* pChannel = pAnimation->mMorphMeshChannels[k];
+        for (uint32_t m = 0u; m < pScene->mNumMeshes; m++)
+        {
+            const aiMesh* pMesh = pScene->mMeshes[m];
+            if (pMesh->mName != pChannel->mName || pMesh->mNumAnimMeshes == 0u)
+            {
+                continue;
+            }
+
+            // One track per target, keys only list the targets they weight so the others are zero at that key
+            const size_t kFirstTrack = MorphTracks.size();
+            for (uint32_t t = 0u; t < pMesh->mNumAnimMeshes; t++)
+            {
+                MorphTracks.emplace_back().Target = MorphTargetOffsets[m] + t;
+            }
+            for (uint32_t n = 0u; n < pChannel->mNumKeys; n++)
+            {
+                const aiMeshMorphKey& Key = pChannel->mKeys[n];
+                for (uint32_t t = 0u; t < pMesh->mNumAnimMeshes; t++)
+                {
+                    MorphTracks[kFirstTrack + t].Times.emplace_back(float(Key.mTime / TicksPerSecond));
+                    MorphTracks[kFirstTrack + t].Weights.emplace_back(0.0f);
+                }
+                for (uint32_t v = 0u; v < Key.mNumValuesAndWeights; v++)
+                {
+                    if (Key.mValues[v] < pMesh->mNumAnimMeshes)
+                    {
+                        MorphTracks[kFirstTrack + Key.mValues[v]].Weights.back() = float(Key.mWeights[v]);
+                    }
+                }
+            }
+        }
+    }
+
+    return Animation::Compress(pAnimation->mName.C_Str(), float(pAnimation->mDuration / TicksPerSecond), Tracks, MorphTracks);
+}
+
+// SCENE IO
+// Assimp opens the model and everything it references through these, so all of it comes from the mounted archive
+// when it has them and from a mapped file otherwise
+class MappedIOStream : public Assimp::IOStream
+{
+public:
+    explicit MappedIOStream(MappedFile&& File)
+        : m_File(std::move(File))
+    { }
+
+    virtual size_t Read(void* pBuffer, size_t kSize, size_t kCount) override
+    {
+        const size_t kItems = kSize != 0u ? std::min(kCount, (m_File.GetSize() - m_Position) / kSize) : 0u;
+        if (kItems > 0u)
+        {
+            memcpy(pBuffer, m_File.GetData() + m_Position, kItems * kSize);
+            m_Position += kItems * kSize;
+        }
+        return kItems;
+    }
+
+    virtual size_t Write(const void*, size_t, size_t) override
+    {
+        return 0u;
+    }
+
+    // Offsets from the end are negative, wrapped around like the ones fseek() would be given
+    virtual aiReturn Seek(size_t kOffset, aiOrigin kOrigin) override
+    {
+        const size_t kBase   = kOrigin == aiOrigin_SET ? 0u : kOrigin == aiOrigin_CUR ? m_Position : m_File.GetSize();
+        const size_t kTarget = kBase + kOffset;
+        if (kTarget > m_File.GetSize())
+        {
+            return aiReturn_FAILURE;
+        }
+        m_Position = kTarget;
+        return aiReturn_SUCCESS;
+    }
+
+    virtual size_t Tell() const override
+    {
+        return m_Position;
+    }
+
+    virtual size_t FileSize() const override
+    {
+        return m_File.GetSize();
+    }
+
+    virtual void Flush() override
+    { }
+
+private:
+    MappedFile m_File     = {};
+    size_t     m_Position = 0u;
+};
+
+class MappedIOSystem : public Assimp::IOSystem
+{
+public:
+    virtual bool Exists(const char* lpFilepath) const override
+    {
+        return FileExists(lpFilepath);
+    }
+
+    virtual char getOsSeparator() const override
+    {
+#ifdef _WIN32
+        return '\\';
+#else
+        return '/';
+#endif // _WIN32
+    }
+
+    // Read only, importers never write
+    virtual Assimp::IOStream* Open(const char* lpFilepath, const char* lpMode) override
+    {
+        if (strchr(lpMode, 'w') != nullptr || strchr(lpMode, 'a') != nullptr || strchr(lpMode, '+') != nullptr)
+        {
+            return nullptr;
+        }
+        MappedFile File = MappedFile(lpFilepath);
+        return File.IsOpen() ? new MappedIOStream(std::move(File)) : nullptr;
+    }
+
+    virtual void Close(Assimp::IOStream* pStream) override
+    {
+        delete pStream;
+    }
+};
+
+// SCENE IMPORTER
+bool SceneImporter::LoadFromFile(const char* lpFilepath, Scene& Out, float Scale, size_t* pImporterBytes, const WeldOptions& Welding) noexcept
+{
+    Out = {};
+
+    Assimp::Importer Imp;
+    Imp.SetIOHandler(new MappedIOSystem()); // Owned by the importer
+    // Vertices are welded per part below, with tolerances and on the worker threads
+    const uint32_t kFlags = aiProcess_Triangulate | aiProcess_SortByPType | aiProcess_LimitBoneWeights;
+    const aiScene* pScene = Imp.ReadFile(lpFilepath, kFlags);
+    if (pScene == nullptr || pScene->mRootNode == nullptr)
+    {
+        return false;
+    }
+
+    if (pImporterBytes != nullptr)
+    {
+        aiMemoryInfo Info = {};
+        Imp.GetMemoryRequirements(Info);
+        *pImporterBytes = Info.total;
+    }
+
+    for (uint32_t k = 0u; k < pScene->mNumMaterials; k++)
+    {
+        Out.Materials.emplace_back(ToSceneMaterial(pScene->mMaterials[k]));
+    }
+    if (Out.Materials.empty())
+    {
+        Out.Materials.emplace_back();
+    }
+
+    // Nodes, depth first with an explicit stack so deep hierarchies can't overflow the call stack
+    Dictionary<String, uint32_t> NodeIndices = {};
+    List<std::pair<const aiNode*, int32_t>> Stack = { { pScene->mRootNode, Scene::NoParent } };
+    while (!Stack.empty())
+    {
+        const auto [pNode, kParent] = Stack.back();
+        Stack.pop_back();
+
+        const int32_t kNode = int32_t(Out.Parents.size());
+        NodeIndices.emplace(pNode->mName.C_Str(), uint32_t(kNode));
+        Out.NodeNames.emplace_back(pNode->mName.C_Str());
+        Out.Parents.emplace_back(kParent);
+        Out.LocalTransforms.emplace_back(ToFloat4x4(pNode->mTransformation));
+        Out.NodeMeshOffsets.emplace_back(uint32_t(Out.NodeMeshes.size()));
+        Out.NodeMeshCounts.emplace_back(pNode->mNumMeshes);
+        Out.NodeMeshes.insert(Out.NodeMeshes.end(), pNode->mMeshes, pNode->mMeshes + pNode->mNumMeshes);
+
+        // Reversed so children come out in file order
+        for (uint32_t k = pNode->mNumChildren; k > 0u; k--)
+        {
+            Stack.emplace_back(pNode->mChildren[k - 1u], kNode);
+        }
+    }
+
+    Out.LocalTransforms[0] = Out.LocalTransforms[0] * Float4x4::Scale(Float3(Scale));
+    UpdateWorldTransforms(Out);
+
+    // Skinning data is built for any scene with bones or node animation. Bones become joints with their offset matrix,
+    // rigid parts get a joint on the first node that draws them with an identity inverse bind.
+    bool bAnimated = pScene->mNumAnimations > 0u;
+    for (uint32_t k = 0u; k < pScene->mNumMeshes; k++)
+    {
+        bAnimated |= pScene->mMeshes[k]->HasBones();
+    }
+
+    List<uint32_t> MeshNodes = List<uint32_t>(pScene->mNumMeshes, 0u);
+    for (size_t k = Out.NodeMeshes.size(); k > 0u; k--)
+    {
+        MeshNodes[Out.NodeMeshes[k - 1u]] = uint32_t(std::upper_bound(Out.NodeMeshOffsets.begin(), Out.NodeMeshOffsets.end(), uint32_t(k - 1u)) - Out.NodeMeshOffsets.begin()) - 1u;
+    }
+
+    Dictionary<uint64_t, uint16_t> Joints = {};
+    const auto GetJoint = [&](uint32_t kNode, bool bBone, const Float4x4& InverseBind) -> uint16_t
+    {
+        const uint64_t kKey = uint64_t(kNode) | (bBone ? 0ull : 1ull << 32u);
+        if (auto it = Joints.find(kKey); it != Joints.end())
+        {
+            return it->second;
+        }
+
+        assert(Out.JointNodes.size() <= size_t(UINT16_MAX) && "Too many joints for 16-bit joint indices");
+        const uint16_t kJoint = uint16_t(Out.JointNodes.size());
+        Out.JointNodes.emplace_back(kNode);
+        Out.InverseBindMatrices.emplace_back(InverseBind);
+        Joints.emplace(kKey, kJoint);
+        return kJoint;
+    };
+
+    // Parts, one vertex and one index allocation for all of them
+    size_t kVertexCount = 0u;
+    size_t kIndexCount  = 0u;
+    for (uint32_t k = 0u; k < pScene->mNumMeshes; k++)
+    {
+        kVertexCount += pScene->mMeshes[k]->mNumVertices;
+        kIndexCount  += size_t(pScene->mMeshes[k]->mNumFaces) * 3u;
+    }
+    Out.Vertices.reserve(kVertexCount);
+    Out.Indices.reserve(kIndexCount);
+
+    Out.Influences.reserve(bAnimated ? kVertexCount : 0u);
+    Out.Meshes.reserve(pScene->mNumMeshes);
+
+    List<ImportVertex>  Vertices   = {};
+    List<uint32_t>      Indices    = {};
+    List<SkinInfluence> Influences = {};
+    List<MeshVertex>    MorphBase  = {};
+    List<MeshVertex>    Morphed    = {};
+    List<uint32_t>      MorphIDs   = {};
+    List<uint64_t>      WeldKeys   = {};
+    List<uint32_t>      MorphTargetOffsets = List<uint32_t>(pScene->mNumMeshes, 0u);
+    for (uint32_t k = 0u; k < pScene->mNumMeshes; k++)
+    {
+        const aiMesh* pMesh = pScene->mMeshes[k];
+
+        if (bAnimated)
+        {
+            Influences.assign(pMesh->mNumVertices, SkinInfluence{ { 0u, 0u, 0u, 0u }, { 0.0f, 0.0f, 0.0f, 0.0f } });
+            for (uint32_t b = 0u; b < pMesh->mNumBones; b++)
+            {
+                const aiBone* pBone = pMesh->mBones[b];
+                auto it = NodeIndices.find(pBone->mName.C_Str());
+                if (it == NodeIndices.end())
+                {
+                    continue;
+                }
+
+                const uint16_t kJoint = GetJoint(it->second, true, ToFloat4x4(pBone->mOffsetMatrix));
+                for (uint32_t w = 0u; w < pBone->mNumWeights; w++)
+                {
+                    const aiVertexWeight& Weight = pBone->mWeights[w];
+                    Skinning::AddInfluence(Influences[Weight.mVertexId], kJoint, Weight.mWeight);
+                }
+            }
+
+            // Unweighted vertices follow the part's node
+            const uint16_t kRigidJoint = GetJoint(MeshNodes[k], false, Float4x4(1.0f));
+            for (SkinInfluence& Influence : Influences)
+            {
+                Skinning::NormalizeInfluence(Influence);
+                if (Influence.Weights[0] == 0.0f && Influence.Weights[1] == 0.0f && Influence.Weights[2] == 0.0f && Influence.Weights[3] == 0.0f)
+                {
+                    Influence = SkinInfluence{ { kRigidJoint, 0u, 0u, 0u }, { 1.0f, 0.0f, 0.0f, 0.0f } };
+                }
+            }
+        }
+
+        Vertices.clear();
+        Indices.clear();
+        if (pMesh->mPrimitiveTypes & aiPrimitiveType_TRIANGLE)
+        {
+            for (uint32_t v = 0u; v < pMesh->mNumVertices; v++)
+            {
+                const Float3 Position = *reinterpret_cast<const Float3*>(&pMesh->mVertices[v]);
+                const Float3 Normal   = pMesh->mNormals ? *reinterpret_cast<const Float3*>(&pMesh->mNormals[v]) : Float3();
+                Vertices.emplace_back(Position, Normal, v);
+            }
+            for (uint32_t f = 0u; f < pMesh->mNumFaces; f++)
+            {
+                const aiFace& Face = pMesh->mFaces[f];
+                if (Face.mNumIndices == 3u)
+                {
+                    Indices.insert(Indices.end(), { Face.mIndices[0], Face.mIndices[1], Face.mIndices[2] });
+                }
+            }
+
+            // Skin weights and blend shapes only weld where they agree exactly, hashed per vertex
+            WeldKeys.clear();
+            if (bAnimated || pMesh->mNumAnimMeshes > 0u)
+            {
+                WeldKeys.resize(Vertices.size());
+                for (size_t v = 0u; v < Vertices.size(); v++)
+                {
+                    const uint32_t kSource = Vertices[v].Source;
+
+                    uint64_t kKey = bAnimated ? HashBytes(&Influences[kSource], sizeof(SkinInfluence)) : 0u;
+                    for (uint32_t a = 0u; a < pMesh->mNumAnimMeshes; a++)
+                    {
+                        const aiAnimMesh* pAnimMesh = pMesh->mAnimMeshes[a];
+                        const Float3      Target[2] =
+                        {
+                            pAnimMesh->mVertices ? *reinterpret_cast<const Float3*>(&pAnimMesh->mVertices[kSource]) : Float3(),
+                            pAnimMesh->mNormals  ? *reinterpret_cast<const Float3*>(&pAnimMesh->mNormals[kSource])  : Float3(),
+                        };
+                        kKey = kKey * 0x100000001B3ull ^ HashBytes(Target, sizeof(Target));
+                    }
+                    WeldKeys[v] = kKey;
+                }
+            }
+            VertexWelder::Weld(Vertices, Indices, Welding, WeldKeys.empty() ? nullptr : WeldKeys.data());
+
+            // May split vertices, Source keeps pointing at the aiMesh vertex a copy came from
+            if (!pMesh->HasNormals())
+            {
+                TangentSpace::GenerateNormals(Vertices, Indices);
+            }
+            MeshOptimizer::Optimize(Vertices, Indices);
+        }
+
+        SceneMesh& Part   = Out.Meshes.emplace_back();
+        Part.IndexOffset  = uint32_t(Out.Indices.size());
+        Part.IndexCount   = uint32_t(Indices.size());
+        Part.VertexOffset = uint32_t(Out.Vertices.size());
+        Part.VertexCount  = uint32_t(Vertices.size());
+        Part.MaterialID   = std::min(pMesh->mMaterialIndex, uint32_t(Out.Materials.size()) - 1u);
+
+        for (const ImportVertex& v : Vertices)
+        {
+            Out.Vertices.emplace_back(v.Position, v.Normal);
+            if (bAnimated)
+            {
+                Out.Influences.emplace_back(Influences[v.Source]);
+            }
+        }
+        Out.Indices.insert(Out.Indices.end(), Indices.begin(), Indices.end());
+
+        // Blend shapes, kept sparse as offsets from the optimized vertices
+        MorphTargetOffsets[k] = uint32_t(Out.MorphTargets.size());
+        for (uint32_t a = 0u; a < pMesh->mNumAnimMeshes; a++)
+        {
+            const aiAnimMesh* pAnimMesh = pMesh->mAnimMeshes[a];
+
+            MorphBase.clear();
+            Morphed.clear();
+            MorphIDs.clear();
+            for (size_t v = 0u; v < Vertices.size(); v++)
+            {
+                const ImportVertex& Base     = Vertices[v];
+                const Float3        Position = pAnimMesh->mVertices ? *reinterpret_cast<const Float3*>(&pAnimMesh->mVertices[Base.Source]) : Base.Position;
+                const Float3        Normal   = pAnimMesh->mNormals  ? *reinterpret_cast<const Float3*>(&pAnimMesh->mNormals[Base.Source])  : Base.Normal;
+                MorphBase.emplace_back(Base.Position, Base.Normal);
+                Morphed.emplace_back(Position, Normal);
+                MorphIDs.emplace_back(Part.VertexOffset + uint32_t(v));
+            }
+
+            MorphTarget& Target  = Out.MorphTargets.emplace_back();
+            Target.Name          = String(pMesh->mName.C_Str()) + "/" + std::to_string(a);
+            Target.Mesh          = k;
+            Target.DefaultWeight = pAnimMesh->mWeight;
+            Morphing::AddDeltas(Target, MorphBase.data(), Morphed.data(), MorphIDs.data(), MorphIDs.size());
+        }
+    }
+
+    for (uint32_t k = 0u; k < pScene->mNumAnimations; k++)
+    {
+        Out.Clips.emplace_back(ToAnimationClip(pScene, pScene->mAnimations[k], NodeIndices, MorphTargetOffsets));
+    }
+
+    return true;
+}
+
+void SceneImporter::UpdateWorldTransforms(Scene& s) noexcept
+{
+    s.WorldTransforms.resize(s.LocalTransforms.size());
+    for (size_t k = 0u; k < s.LocalTransforms.size(); k++)
+    {
+        const int32_t kParent = s.Parents[k];
+        s.WorldTransforms[k] = kParent == Scene::NoParent ? s.LocalTransforms[k] : s.LocalTransforms[k] * s.WorldTransforms[kParent];
+    }
+}
+
+size_t SceneImporter::GetByteSize(const Scene& s) noexcept
+{
+    size_t kBytes = 0u;
+    for (const String& Name : s.NodeNames)
+    {
+        kBytes += Name.capacity();
+    }
+    for (const SceneMaterial& Material : s.Materials)
+    {
+        kBytes += Material.Name.capacity();
+    }
+
+    kBytes += s.NodeNames.capacity()       * sizeof(String);
+    kBytes += s.Parents.capacity()         * sizeof(int32_t);
+    kBytes += s.LocalTransforms.capacity() * sizeof(Float4x4);
+    kBytes += s.WorldTransforms.capacity() * sizeof(Float4x4);
+    kBytes += s.NodeMeshOffsets.capacity() * sizeof(uint32_t);
+    kBytes += s.NodeMeshCounts.capacity()  * sizeof(uint32_t);
+    kBytes += s.NodeMeshes.capacity()      * sizeof(uint32_t);
+    kBytes += s.Meshes.capacity()          * sizeof(SceneMesh);
+    kBytes += s.Materials.capacity()       * sizeof(SceneMaterial);
+    kBytes += s.Vertices.capacity()        * sizeof(MeshVertex);
+    kBytes += s.Indices.capacity()         * sizeof(uint32_t);
+
+    kBytes += s.Influences.capacity()          * sizeof(SkinInfluence);
+    kBytes += s.JointNodes.capacity()          * sizeof(uint32_t);
+    kBytes += s.InverseBindMatrices.capacity() * sizeof(Float4x4);
+    kBytes += s.MorphTargets.capacity()        * sizeof(MorphTarget);
+    for (const MorphTarget& Target : s.MorphTargets)
+    {
+        kBytes += Morphing::GetByteSize(Target);
+    }
+    kBytes += s.Clips.capacity()               * sizeof(AnimationClip);
+    for (const AnimationClip& Clip : s.Clips)
+    {
+        kBytes += Animation::GetByteSize(Clip);
+    }
+    return kBytes;
+}
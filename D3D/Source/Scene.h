@@ -0,0 +1,76 @@
+#pragma once
+
+#include "Core.h"
+#include "Animation.h"
+#include "Morph.h"
+#include "Skinning.h"
+#include "Welder.h"
+
+// Indices are relative to VertexOffset, so they stay small enough for 16-bit index buffers per part
+struct SceneMesh
+{
+	uint32_t IndexOffset  = 0u;
+	uint32_t IndexCount   = 0u;
+	uint32_t VertexOffset = 0u;
+	uint32_t VertexCount  = 0u;
+	uint32_t MaterialID   = 0u;
+};
+
+struct SceneMaterial
+{
+	String Name          = {};
+	Float3 DiffuseColor  = Float3(1.0f);
+	Float3 SpecularColor = Float3(0.0f);
+	float  Shininess     = 0.0f;
+};
+
+// A whole imported file flattened into arrays. Nodes are stored depth first, so a node's parent always comes before it
+// and world transforms are one forward pass. Every part shares one vertex and one index allocation.
+struct Scene
+{
+	static constexpr int32_t NoParent = -1;
+
+	// Nodes
+	List<String>   NodeNames       = {};
+	List<int32_t>  Parents         = {};
+	List<Float4x4> LocalTransforms = {}; // Row vector convention, like DirectXMath
+	List<Float4x4> WorldTransforms = {};
+	List<uint32_t> NodeMeshOffsets = {}; // The meshes of node k are NodeMeshes[NodeMeshOffsets[k] .. + NodeMeshCounts[k]]
+	List<uint32_t> NodeMeshCounts  = {};
+	List<uint32_t> NodeMeshes      = {};
+
+	// Parts
+	List<SceneMesh>     Meshes    = {};
+	List<SceneMaterial> Materials = {};
+
+	// Geometry
+	List<MeshVertex> Vertices = {};
+	List<uint32_t>   Indices  = {};
+
+	// Skinning, empty unless the file has bones. Influences run parallel to Vertices, parts without bones are bound to
+	// their node with weight one so a skinned scene is drawn entirely from the palette.
+	List<SkinInfluence> Influences          = {};
+	List<uint32_t>      JointNodes          = {};
+	List<Float4x4>      InverseBindMatrices = {};
+
+	// Blend shapes of every part, the parts' vertices are the base shape
+	List<MorphTarget> MorphTargets = {};
+
+	List<AnimationClip> Clips = {};
+};
+
+class SceneImporter
+{
+public:
+	// Imports every mesh, node, material, bone and animation of a file Assimp understands. Parts are welded within the
+	// Welding tolerances, parts without normals get angle weighted ones, then parts are vertex cache
+	// optimized. Animations are compressed.
+	// The Assimp scene is freed before returning, pImporterBytes receives how much memory it held.
+	static bool   LoadFromFile(const char* lpFilepath, Scene& Out, float Scale = 1.0f, size_t* pImporterBytes = nullptr, const WeldOptions& Welding = {}) noexcept;
+
+	// Recomputes WorldTransforms from LocalTransforms and Parents
+	static void   UpdateWorldTransforms(Scene& s) noexcept;
+
+	// Heap bytes held by the arrays
+	static size_t GetByteSize(const Scene& s) noexcept;
+};
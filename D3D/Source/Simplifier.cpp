@@ -0,0 +1,436 @@
+#include "Simplifier.h"
+#include "MeshOptimizer.h"
+
+#include <algorithm>
+#include <float.h>
+#include <string.h>
+
+// Symmetric 4x4 error quadric, stored as A (3x3), b and c so that Q(p) = p'Ap + 2b'p + c
+struct Quadric
+{
+    double A00 = 0.0, A01 = 0.0, A02 = 0.0, A11 = 0.0, A12 = 0.0, A22 = 0.0;
+    double B0  = 0.0, B1  = 0.0, B2  = 0.0;
+    double C   = 0.0;
+    double Weight = 0.0;
+
+    void Add(const Quadric& q) noexcept
+    {
+        A00 += q.A00; A01 += q.A01; A02 += q.A02;
+        A11 += q.A11; A12 += q.A12; A22 += q.A22;
+        B0  += q.B0;  B1  += q.B1;  B2  += q.B2;
+        C   += q.C;
+        Weight += q.Weight;
+    }
+
+    double Evaluate(const Float3& p) const noexcept
+    {
+        const double x = p.X, y = p.Y, z = p.Z;
+        const double r = A00 * x * x + A11 * y * y + A22 * z * z + 2.0 * (A01 * x * y + A02 * x * z + A12 * y * z) +
+                         2.0 * (B0 * x + B1 * y + B2 * z) + C;
+        return std::max(0.0, r);
+    }
+
+    static Quadric FromPlane(double a, double b, double c, double d, double w) noexcept
+    {
+        Quadric q = {};
+        q.A00 = w * a * a; q.A01 = w * a * b; q.A02 = w * a * c;
+        q.A11 = w * b * b; q.A12 = w * b * c; q.A22 = w * c * c;
+        q.B0  = w * a * d; q.B1  = w * b * d; q.B2  = w * c * d;
+        q.C   = w * d * d;
+        q.Weight = w;
+        return q;
+    }
+};
+
+struct Collapse
+{
+    uint32_t From  = 0u;
+    uint32_t To    = 0u;
+    float    Error = 0.0f;
+};
+
+static inline Float3 Cross(const Float3& u, const Float3& v) noexcept
+{
+    return Float3(u.Y * v.Z - u.Z * v.Y, u.Z * v.X - u.X * v.Z, u.X * v.Y - u.Y * v.X);
+}
+
+static inline float Dot(const Float3& u, const Float3& v) noexcept
+{
+    return u.X * v.X + u.Y * v.Y + u.Z * v.Z;
+}
+
+static inline uint32_t FindRoot(List<uint32_t>& Parents, uint32_t kVertex) noexcept
+{
+    uint32_t kRoot = kVertex;
+    while (Parents[kRoot] != kRoot)
+    {
+        kRoot = Parents[kRoot];
+    }
+    while (Parents[kVertex] != kRoot)
+    {
+        const uint32_t kNext = Parents[kVertex];
+        Parents[kVertex] = kRoot;
+        kVertex = kNext;
+    }
+    return kRoot;
+}
+
+// MESH SIMPLIFIER
+size_t MeshSimplifier::Simplify(
+    uint32_t*       pDestination,
+    const uint32_t* pIndices,
+    size_t          kIndexCount,
+    const Float3*   pPositions,
+    size_t          kPositionStride,
+    size_t          kVertexCount,
+    size_t          kTargetIndexCount,
+    float           TargetError,
+    const Float3*   pNormals,
+    size_t          kNormalStride,
+    float*          pResultError
+) noexcept
+{
+    auto Position = [pPositions, kPositionStride](uint32_t kVertex) -> const Float3&
+    {
+        return *reinterpret_cast<const Float3*>(reinterpret_cast<const uint8_t*>(pPositions) + size_t(kVertex) * kPositionStride);
+    };
+    auto Normal = [pNormals, kNormalStride](uint32_t kVertex) -> const Float3&
+    {
+        return *reinterpret_cast<const Float3*>(reinterpret_cast<const uint8_t*>(pNormals) + size_t(kVertex) * kNormalStride);
+    };
+
+    if (pResultError != nullptr)
+    {
+        *pResultError = 0.0f;
+    }
+
+    // Vertices that only differ in attributes share one position ("wedges"); topology works on the first one
+    List<uint32_t> Canonical = List<uint32_t>(kVertexCount, 0u);
+    List<uint32_t> NextWedge = List<uint32_t>(kVertexCount, 0u);
+    {
+        List<uint32_t> Order = List<uint32_t>(kVertexCount, 0u);
+        for (uint32_t k = 0u; k < uint32_t(kVertexCount); k++)
+        {
+            Order[k] = k;
+        }
+        auto Less = [&Position](uint32_t a, uint32_t b)
+        {
+            const Float3& p = Position(a);
+            const Float3& q = Position(b);
+            if (p.X != q.X) return p.X < q.X;
+            if (p.Y != q.Y) return p.Y < q.Y;
+            if (p.Z != q.Z) return p.Z < q.Z;
+            return a < b;
+        };
+        std::sort(Order.begin(), Order.end(), Less);
+
+        for (size_t k = 0u; k < kVertexCount; )
+        {
+            size_t j = k + 1u;
+            while (j < kVertexCount && memcmp(&Position(Order[j]), &Position(Order[k]), sizeof(Float3)) == 0)
+            {
+                j++;
+            }
+            for (size_t w = k; w < j; w++)
+            {
+                Canonical[Order[w]] = Order[k];
+                NextWedge[Order[w]] = Order[w + 1u < j ? w + 1u : k];
+            }
+            k = j;
+        }
+    }
+
+    List<uint32_t> Triangles = List<uint32_t>(pIndices, pIndices + kIndexCount);
+    List<uint32_t> Parents   = List<uint32_t>(kVertexCount, 0u);
+    List<uint8_t>  Locked    = List<uint8_t>(kVertexCount, 0u);
+    List<Quadric>  Quadrics  = List<Quadric>(kVertexCount);
+    for (uint32_t k = 0u; k < uint32_t(kVertexCount); k++)
+    {
+        Parents[k] = k;
+    }
+
+    // Lock open borders and non-manifold edges
+    {
+        List<uint64_t> Edges = {};
+        Edges.reserve(kIndexCount);
+        for (size_t k = 0u; k + 2u < kIndexCount; k += 3u)
+        {
+            for (size_t e = 0u; e < 3u; e++)
+            {
+                const uint32_t a = Canonical[Triangles[k + e]];
+                const uint32_t b = Canonical[Triangles[k + (e + 1u) % 3u]];
+                if (a != b)
+                {
+                    Edges.emplace_back((uint64_t(std::min(a, b)) << 32u) | uint64_t(std::max(a, b)));
+                }
+            }
+        }
+        std::sort(Edges.begin(), Edges.end());
+        for (size_t k = 0u; k < Edges.size(); )
+        {
+            size_t j = k + 1u;
+            while (j < Edges.size() && Edges[j] == Edges[k])
+            {
+                j++;
+            }
+            if (j - k != 2u)
+            {
+                Locked[uint32_t(Edges[k] >> 32u)] = 1u;
+                Locked[uint32_t(Edges[k])]        = 1u;
+            }
+            k = j;
+        }
+    }
+
+    // Area weighted plane quadrics
+    for (size_t k = 0u; k + 2u < kIndexCount; k += 3u)
+    {
+        const uint32_t a = Canonical[Triangles[k + 0u]];
+        const uint32_t b = Canonical[Triangles[k + 1u]];
+        const uint32_t c = Canonical[Triangles[k + 2u]];
+        const Float3   n = Cross(Position(b) - Position(a), Position(c) - Position(a));
+        const float Length = sqrtf(Dot(n, n));
+        if (Length <= 0.0f)
+        {
+            continue;
+        }
+
+        const Float3  u = n / Float3(Length);
+        const Quadric q = Quadric::FromPlane(u.X, u.Y, u.Z, -Dot(u, Position(a)), 0.5 * double(Length));
+        Quadrics[a].Add(q);
+        Quadrics[b].Add(q);
+        Quadrics[c].Add(q);
+    }
+
+    float ResultError = 0.0f;
+
+    List<uint32_t> Current   = {};
+    List<uint32_t> Offsets   = {};
+    List<uint32_t> Adjacency = {};
+    List<uint64_t> Edges     = {};
+    List<Collapse> Collapses = {};
+    List<uint8_t>  Touched   = List<uint8_t>(kVertexCount, 0u);
+
+    auto Resolve = [&](uint32_t kWedge) -> uint32_t
+    {
+        return FindRoot(Parents, Canonical[kWedge]);
+    };
+
+    while (true)
+    {
+        // Current canonical triangles, degenerate ones dropped
+        Current.clear();
+        size_t kKept = 0u;
+        for (size_t k = 0u; k + 2u < Triangles.size(); k += 3u)
+        {
+            const uint32_t a = Resolve(Triangles[k + 0u]);
+            const uint32_t b = Resolve(Triangles[k + 1u]);
+            const uint32_t c = Resolve(Triangles[k + 2u]);
+            if (a == b || b == c || c == a)
+            {
+                continue;
+            }
+            Triangles[kKept + 0u] = Triangles[k + 0u];
+            Triangles[kKept + 1u] = Triangles[k + 1u];
+            Triangles[kKept + 2u] = Triangles[k + 2u];
+            Current.insert(Current.end(), { a, b, c });
+            kKept += 3u;
+        }
+        Triangles.resize(kKept);
+
+        const size_t kTriangleCount = Current.size() / 3u;
+        if (Current.size() <= kTargetIndexCount)
+        {
+            break;
+        }
+
+        // Vertex -> triangle adjacency
+        Offsets.assign(kVertexCount + 1u, 0u);
+        for (const uint32_t& kVertex : Current)
+        {
+            Offsets[kVertex + 1u]++;
+        }
+        for (size_t k = 0u; k < kVertexCount; k++)
+        {
+            Offsets[k + 1u] += Offsets[k];
+        }
+        Adjacency.resize(Current.size());
+        {
+            List<uint32_t> Cursor = List<uint32_t>(Offsets.begin(), Offsets.end() - 1);
+            for (size_t k = 0u; k < Current.size(); k++)
+            {
+                Adjacency[Cursor[Current[k]]++] = uint32_t(k / 3u);
+            }
+        }
+
+        // Best direction for every unique edge
+        Edges.clear();
+        for (size_t k = 0u; k < Current.size(); k += 3u)
+        {
+            for (size_t e = 0u; e < 3u; e++)
+            {
+                const uint32_t a = Current[k + e];
+                const uint32_t b = Current[k + (e + 1u) % 3u];
+                Edges.emplace_back((uint64_t(std::min(a, b)) << 32u) | uint64_t(std::max(a, b)));
+            }
+        }
+        std::sort(Edges.begin(), Edges.end());
+        Edges.erase(std::unique(Edges.begin(), Edges.end()), Edges.end());
+
+        Collapses.clear();
+        for (const uint64_t& kEdge : Edges)
+        {
+            const uint32_t a = uint32_t(kEdge >> 32u);
+            const uint32_t b = uint32_t(kEdge);
+
+            Quadric q = Quadrics[a];
+            q.Add(Quadrics[b]);
+            const double Weight = std::max(q.Weight, DBL_MIN);
+
+            const float ErrorAB = Locked[a] ? FLT_MAX : float(sqrt(q.Evaluate(Position(b)) / Weight));
+            const float ErrorBA = Locked[b] ? FLT_MAX : float(sqrt(q.Evaluate(Position(a)) / Weight));
+            if (ErrorAB == FLT_MAX && ErrorBA == FLT_MAX)
+            {
+                continue;
+            }
+            Collapses.push_back(ErrorAB <= ErrorBA ? Collapse{ a, b, ErrorAB } : Collapse{ b, a, ErrorBA });
+        }
+        std::sort(Collapses.begin(), Collapses.end(), [](const Collapse& x, const Collapse& y) { return x.Error < y.Error; });
+
+        // Apply as many independent collapses as possible this pass
+        std::fill(Touched.begin(), Touched.end(), uint8_t(0u));
+        const size_t kTargetTriangles = kTargetIndexCount / 3u;
+        size_t kRemoved   = 0u;
+        size_t kCollapsed = 0u;
+        for (const Collapse& c : Collapses)
+        {
+            if (c.Error > TargetError || kTriangleCount - kRemoved <= kTargetTriangles)
+            {
+                break;
+            }
+            if (Touched[c.From] || Touched[c.To])
+            {
+                continue;
+            }
+
+            // Reject collapses that flip or squash a surviving triangle
+            bool   bValid   = true;
+            size_t kShared  = 0u;
+            for (uint32_t j = Offsets[c.From]; j < Offsets[c.From + 1u] && bValid; j++)
+            {
+                const uint32_t* pTriangle = &Current[size_t(Adjacency[j]) * 3u];
+                if (pTriangle[0] == c.To || pTriangle[1] == c.To || pTriangle[2] == c.To)
+                {
+                    kShared++;
+                    continue;
+                }
+
+                const Float3& p0 = Position(pTriangle[0]);
+                const Float3& p1 = Position(pTriangle[1]);
+                const Float3& p2 = Position(pTriangle[2]);
+                const Float3& q0 = Position(pTriangle[0] == c.From ? c.To : pTriangle[0]);
+                const Float3& q1 = Position(pTriangle[1] == c.From ? c.To : pTriangle[1]);
+                const Float3& q2 = Position(pTriangle[2] == c.From ? c.To : pTriangle[2]);
+                const Float3  Before = Cross(p1 - p0, p2 - p0);
+                const Float3  After  = Cross(q1 - q0, q2 - q0);
+                bValid = Dot(Before, After) > 0.25f * sqrtf(Dot(Before, Before) * Dot(After, After));
+            }
+            if (!bValid || kShared == 0u)
+            {
+                continue;
+            }
+
+            Parents[c.From] = c.To;
+            Quadrics[c.To].Add(Quadrics[c.From]);
+            ResultError = std::max(ResultError, c.Error);
+            kRemoved   += kShared;
+            kCollapsed++;
+
+            for (uint32_t j = Offsets[c.From]; j < Offsets[c.From + 1u]; j++)
+            {
+                const uint32_t* pTriangle = &Current[size_t(Adjacency[j]) * 3u];
+                Touched[pTriangle[0]] = Touched[pTriangle[1]] = Touched[pTriangle[2]] = 1u;
+            }
+        }
+
+        if (kCollapsed == 0u)
+        {
+            break;
+        }
+    }
+
+    // Corners whose position moved pick the wedge at the new position with the closest normal
+    size_t kOutputCount = 0u;
+    for (size_t k = 0u; k + 2u < Triangles.size(); k += 3u)
+    {
+        for (size_t j = 0u; j < 3u; j++)
+        {
+            const uint32_t kWedge  = Triangles[k + j];
+            const uint32_t kTarget = Resolve(kWedge);
+            uint32_t       kBest   = kTarget;
+            if (kTarget == Canonical[kWedge])
+            {
+                kBest = kWedge;
+            }
+            else if (pNormals != nullptr)
+            {
+                float BestDot = -FLT_MAX;
+                uint32_t kCandidate = kTarget;
+                do
+                {
+                    const float d = Dot(Normal(kCandidate), Normal(kWedge));
+                    if (d > BestDot)
+                    {
+                        BestDot = d;
+                        kBest   = kCandidate;
+                    }
+                    kCandidate = NextWedge[kCandidate];
+                } while (kCandidate != kTarget);
+            }
+            pDestination[kOutputCount++] = kBest;
+        }
+    }
+
+    if (pResultError != nullptr)
+    {
+        *pResultError = ResultError;
+    }
+    return kOutputCount;
+}
+
+List<MeshLod> MeshSimplifier::GenerateLodChain(List<uint32_t>& Indices, const Float3* pPositions, size_t kPositionStride, size_t kVertexCount, const Float3* pNormals, size_t kNormalStride, uint32_t kMaxLevels, float Reduction) noexcept
+{
+    static constexpr size_t s_MinIndexCount = 3u * 32u;
+
+    List<MeshLod> Lods = { MeshLod{ 0u, uint32_t(Indices.size()), 0.0f } };
+
+    List<uint32_t> Previous = Indices;
+    List<uint32_t> Next     = {};
+    for (uint32_t kLevel = 1u; kLevel <= kMaxLevels; kLevel++)
+    {
+        const size_t kTarget = size_t(float(Previous.size() / 3u) * Reduction) * 3u;
+        if (kTarget < s_MinIndexCount)
+        {
+            break;
+        }
+
+        float Error = 0.0f;
+        Next.resize(Previous.size());
+        const size_t kCount = Simplify(Next.data(), Previous.data(), Previous.size(), pPositions, kPositionStride, kVertexCount,
+                                       kTarget, FLT_MAX, pNormals, kNormalStride, &Error);
+
+        // Not worth a level of its own
+        if (kCount == 0u || float(kCount) > 0.9f * float(Previous.size()))
+        {
+            break;
+        }
+        Next.resize(kCount);
+        MeshOptimizer::OptimizeVertexCache(Next.data(), Next.data(), kCount, kVertexCount);
+
+        Lods.push_back({ uint32_t(Indices.size()), uint32_t(kCount), Lods.back().Error + Error });
+        Indices.insert(Indices.end(), Next.begin(), Next.end());
+        Previous.swap(Next);
+    }
+
+    return Lods;
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include "Core.h"
+
+struct MeshLod
+{
+	uint32_t IndexOffset = 0u;
+	uint32_t IndexCount  = 0u;
+	float    Error       = 0.0f; // Geometric deviation from LOD 0, in mesh units
+};
+
+// Quadric error metric edge-collapse simplifier (Garland & Heckbert 1997). Collapses only move a vertex
+// onto one of its neighbours, so every level indexes the original vertex buffer and an LOD chain is just
+// more indices appended to the same index buffer.
+class MeshSimplifier
+{
+public:
+	// Returns the new index count. Stops at kTargetIndexCount or once the next collapse would exceed
+	// TargetError (mesh units). Vertices on open borders never move. pNormals (optional) picks the closest
+	// matching attribute seam vertex when a corner is moved onto another position.
+	static size_t Simplify(
+		uint32_t*       pDestination,
+		const uint32_t* pIndices,
+		size_t          kIndexCount,
+		const Float3*   pPositions,
+		size_t          kPositionStride,
+		size_t          kVertexCount,
+		size_t          kTargetIndexCount,
+		float           TargetError,
+		const Float3*   pNormals      = nullptr,
+		size_t          kNormalStride = 0u,
+		float*          pResultError  = nullptr
+	) noexcept;
+
+	// Appends up to kMaxLevels coarser levels to Indices (which holds LOD 0 on input), each with about
+	// Reduction times the triangles of the previous one. Returns one entry per level including LOD 0.
+	template<typename V>
+	static List<MeshLod> GenerateLodChain(const List<V>& Vertices, List<uint32_t>& Indices, uint32_t kMaxLevels = 4u, float Reduction = 0.5f);
+
+private:
+	static List<MeshLod> GenerateLodChain(List<uint32_t>& Indices, const Float3* pPositions, size_t kPositionStride, size_t kVertexCount, const Float3* pNormals, size_t kNormalStride, uint32_t kMaxLevels, float Reduction) noexcept;
+};
+
+
+template<typename V>
+inline List<MeshLod> MeshSimplifier::GenerateLodChain(const List<V>& Vertices, List<uint32_t>& Indices, uint32_t kMaxLevels, float Reduction)
+{
+	if (Vertices.empty())
+	{
+		return { MeshLod{ 0u, uint32_t(Indices.size()), 0.0f } };
+	}
+
+	if constexpr (std::is_same<V, MeshVertex>::value)
+	{
+		return GenerateLodChain(Indices, &Vertices[0].Position, sizeof(V), Vertices.size(), &Vertices[0].Normal, sizeof(V), kMaxLevels, Reduction);
+	}
+	else
+	{
+		return GenerateLodChain(Indices, &Vertices[0].Position, sizeof(V), Vertices.size(), nullptr, 0u, kMaxLevels, Reduction);
+	}
+}
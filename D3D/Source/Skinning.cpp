@@ -0,0 +1,125 @@
+#include "Skinning.h"
+#include "Parallel.h"
+
+#include <chrono>
+#include <emmintrin.h>
+
+// Stores the low three lanes without touching the float after them
+static inline void StoreFloat3(float* p, __m128 v) noexcept
+{
+    _mm_storel_pi(reinterpret_cast<__m64*>(p), v);
+    _mm_store_ss(p + 2, _mm_shuffle_ps(v, v, _MM_SHUFFLE(2, 2, 2, 2)));
+}
+
+// SKINNING
+void Skinning::Skin(const SkinningJob& Job, size_t kBegin, size_t kEnd) noexcept
+{
+    const Float4x4* pPalette = Job.pPalette;
+    for (size_t k = kBegin; k < kEnd; k++)
+    {
+        const SkinInfluence& Influence = Job.pInfluences[k];
+        const MeshVertex&    Source    = Job.pSource[k];
+
+        // Blend the four matrices, only the first three columns matter for an affine transform
+        __m128 Rows[4] = { _mm_setzero_ps(), _mm_setzero_ps(), _mm_setzero_ps(), _mm_setzero_ps() };
+        for (size_t j = 0u; j < 4u; j++)
+        {
+            const __m128    Weight = _mm_set1_ps(Influence.Weights[j]);
+            const Float4x4& m      = pPalette[Influence.Joints[j]];
+            Rows[0] = _mm_add_ps(Rows[0], _mm_mul_ps(_mm_loadu_ps(m.Matrix[0]), Weight));
+            Rows[1] = _mm_add_ps(Rows[1], _mm_mul_ps(_mm_loadu_ps(m.Matrix[1]), Weight));
+            Rows[2] = _mm_add_ps(Rows[2], _mm_mul_ps(_mm_loadu_ps(m.Matrix[2]), Weight));
+            Rows[3] = _mm_add_ps(Rows[3], _mm_mul_ps(_mm_loadu_ps(m.Matrix[3]), Weight));
+        }
+
+        __m128 Position = Rows[3];
+        Position = _mm_add_ps(Position, _mm_mul_ps(_mm_set1_ps(Source.Position.X), Rows[0]));
+        Position = _mm_add_ps(Position, _mm_mul_ps(_mm_set1_ps(Source.Position.Y), Rows[1]));
+        Position = _mm_add_ps(Position, _mm_mul_ps(_mm_set1_ps(Source.Position.Z), Rows[2]));
+
+        // Renormalized rather than transformed by the inverse transpose, exact for rotations and uniform scale
+        __m128 Normal = _mm_mul_ps(_mm_set1_ps(Source.Normal.X), Rows[0]);
+        Normal = _mm_add_ps(Normal, _mm_mul_ps(_mm_set1_ps(Source.Normal.Y), Rows[1]));
+        Normal = _mm_add_ps(Normal, _mm_mul_ps(_mm_set1_ps(Source.Normal.Z), Rows[2]));
+
+        const __m128 Square = _mm_mul_ps(Normal, Normal);
+        const __m128 Length = _mm_add_ss(_mm_add_ss(Square, _mm_shuffle_ps(Square, Square, _MM_SHUFFLE(1, 1, 1, 1))), _mm_shuffle_ps(Square, Square, _MM_SHUFFLE(2, 2, 2, 2)));
+        Normal = _mm_div_ps(Normal, _mm_sqrt_ps(_mm_max_ps(_mm_shuffle_ps(Length, Length, _MM_SHUFFLE(0, 0, 0, 0)), _mm_set1_ps(1e-12f))));
+
+        MeshVertex& Destination = Job.pDestination[k];
+        StoreFloat3(&Destination.Position.X, Position);
+        StoreFloat3(&Destination.Normal.X,   Normal);
+    }
+}
+
+SkinningStatistics Skinning::SkinBatch(const SkinningJob* pJobs, size_t kJobCount) noexcept
+{
+    const auto Start = std::chrono::high_resolution_clock::now();
+
+    // Job k owns [Offsets[k], Offsets[k + 1]) of the combined vertex range
+    List<size_t> Offsets = List<size_t>(kJobCount + 1u, 0u);
+    for (size_t k = 0u; k < kJobCount; k++)
+    {
+        Offsets[k + 1u] = Offsets[k] + pJobs[k].kVertexCount;
+    }
+
+    // Runs every frame: a batch too small to give two workers a grain each is skinned here, job by job, without
+    // waking the pool at all
+    if (Offsets.back() < 2u * GrainSize)
+    {
+        for (size_t k = 0u; k < kJobCount; k++)
+        {
+            Skin(pJobs[k], 0u, pJobs[k].kVertexCount);
+        }
+    }
+    else
+    {
+        Parallel::For(Offsets.back(), GrainSize, [&](size_t kBegin, size_t kEnd)
+        {
+            size_t kJob = size_t(std::upper_bound(Offsets.begin(), Offsets.end(), kBegin) - Offsets.begin()) - 1u;
+            for (size_t k = kBegin; k < kEnd; kJob++)
+            {
+                const size_t kLast = std::min(kEnd, Offsets[kJob + 1u]);
+                Skin(pJobs[kJob], k - Offsets[kJob], kLast - Offsets[kJob]);
+                k = kLast;
+            }
+        });
+    }
+
+    SkinningStatistics Statistics = {};
+    Statistics.Jobs         = uint32_t(kJobCount);
+    Statistics.Vertices     = Offsets.back();
+    Statistics.Milliseconds = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - Start).count();
+    return Statistics;
+}
+
+void Skinning::AddInfluence(SkinInfluence& Influence, uint16_t kJoint, float Weight) noexcept
+{
+    // Replace the smallest slot if the new weight beats it, unused slots have weight zero
+    size_t kSmallest = 0u;
+    for (size_t k = 1u; k < 4u; k++)
+    {
+        if (Influence.Weights[k] < Influence.Weights[kSmallest])
+        {
+            kSmallest = k;
+        }
+    }
+    if (Weight > Influence.Weights[kSmallest])
+    {
+        Influence.Joints[kSmallest]  = kJoint;
+        Influence.Weights[kSmallest] = Weight;
+    }
+}
+
+void Skinning::NormalizeInfluence(SkinInfluence& Influence) noexcept
+{
+    const float Total = Influence.Weights[0] + Influence.Weights[1] + Influence.Weights[2] + Influence.Weights[3];
+    if (Total <= 0.0f)
+    {
+        return;
+    }
+    for (float& Weight : Influence.Weights)
+    {
+        Weight /= Total;
+    }
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include "Core.h"
+
+// Up to four joints per vertex, weights sum to one. Unused slots have a weight of zero.
+struct SkinInfluence
+{
+	uint16_t Joints[4]  = { 0u, 0u, 0u, 0u };
+	float    Weights[4] = { 1.0f, 0.0f, 0.0f, 0.0f };
+};
+
+// One mesh instance to skin, pDestination is usually the staging copy of a dynamic vertex buffer
+struct SkinningJob
+{
+	const MeshVertex*    pSource      = nullptr;
+	const SkinInfluence* pInfluences  = nullptr;
+	const Float4x4*      pPalette     = nullptr;
+	MeshVertex*          pDestination = nullptr;
+	size_t               kVertexCount = 0u;
+};
+
+struct SkinningStatistics
+{
+	uint32_t Jobs         = 0u;
+	size_t   Vertices     = 0u;
+	double   Milliseconds = 0.0;
+};
+
+// Linear blend skinning on the CPU with SSE, no Direct3D involved so it can be timed off Windows
+class Skinning
+{
+public:
+	static constexpr size_t GrainSize = 4096u; // Vertices per worker at least
+
+	// Positions and normals of [kBegin, kEnd) of one job
+	static void               Skin(const SkinningJob& Job, size_t kBegin, size_t kEnd) noexcept;
+
+	// Every job, split across the worker pool by vertex count so one large character doesn't serialize the batch.
+	// Batches under two grains are skinned on the calling thread.
+	static SkinningStatistics SkinBatch(const SkinningJob* pJobs, size_t kJobCount) noexcept;
+
+	// Keeps the four largest weights, start from an influence with every weight zero
+	static void               AddInfluence(SkinInfluence& Influence, uint16_t kJoint, float Weight) noexcept;
+	// Makes the weights sum to one, an influence without any weight is left as is
+	static void               NormalizeInfluence(SkinInfluence& Influence) noexcept;
+};
@@ -0,0 +1,796 @@
+#include "Subdivision.h"
+#include "Parallel.h"
+
+#include <algorithm>
+#include <cmath>
+
+static constexpr float s_Pi            = 3.14159265358979f;
+static constexpr float s_QuadFlatness  = 0.94f; // Cosine of the largest angle between two triangles merged into a quad
+
+static inline float Dot(const Float3& u, const Float3& v) noexcept
+{
+    return u.X * v.X + u.Y * v.Y + u.Z * v.Z;
+}
+
+static inline Float3 Cross(const Float3& u, const Float3& v) noexcept
+{
+    return Float3(u.Y * v.Z - u.Z * v.Y, u.Z * v.X - u.X * v.Z, u.X * v.Y - u.Y * v.X);
+}
+
+static inline Float3 Scale(const Float3& u, float s) noexcept
+{
+    return Float3(u.X * s, u.Y * s, u.Z * s);
+}
+
+static inline Float3 Normalize(const Float3& u) noexcept
+{
+    const float Length = sqrtf(Dot(u, u));
+    return Length > 0.0f ? Scale(u, 1.0f / Length) : Float3(0.0f);
+}
+
+static inline const Float3& PositionAt(const Float3* pPositions, size_t kStride, size_t kIndex) noexcept
+{
+    return *reinterpret_cast<const Float3*>(reinterpret_cast<const uint8_t*>(pPositions) + kIndex * kStride);
+}
+
+// Numbers the distinct positions in order of first appearance, open addressing on the position bits
+static void WeldPositions(const Float3* pPositions, size_t kStride, size_t kVertexCount, List<uint32_t>& Groups, List<Float3>& Welded) noexcept
+{
+    size_t kCapacity = 16u;
+    while (kCapacity < kVertexCount * 2u)
+    {
+        kCapacity <<= 1u;
+    }
+
+    List<uint32_t> Slots = List<uint32_t>(kCapacity, UINT32_MAX); // First vertex at the position
+    Groups.resize(kVertexCount);
+    Welded.clear();
+    for (size_t k = 0u; k < kVertexCount; k++)
+    {
+        // Adding zero turns -0 into +0 so both hash alike
+        const Float3& p      = PositionAt(pPositions, kStride, k);
+        const float   Key[3] = { p.X + 0.0f, p.Y + 0.0f, p.Z + 0.0f };
+
+        size_t kSlot = size_t(HashBytes(Key, sizeof(Key))) & (kCapacity - 1u);
+        while (true)
+        {
+            const uint32_t kFirst = Slots[kSlot];
+            if (kFirst == UINT32_MAX)
+            {
+                Slots[kSlot] = uint32_t(k);
+                Groups[k]    = uint32_t(Welded.size());
+                Welded.emplace_back(p);
+                break;
+            }
+
+            const Float3& q = PositionAt(pPositions, kStride, kFirst);
+            if (q.X == p.X && q.Y == p.Y && q.Z == p.Z)
+            {
+                Groups[k] = Groups[kFirst];
+                break;
+            }
+            kSlot = (kSlot + 1u) & (kCapacity - 1u);
+        }
+    }
+}
+
+// Neighbours along open boundaries, returns how many there are and keeps the first two
+static uint32_t GetBoundaryNeighbours(const HalfEdgeMesh& Mesh, uint32_t v, uint32_t Neighbours[2]) noexcept
+{
+    uint32_t kCount = 0u;
+    for (uint32_t j = Mesh.VertexOffsets[v]; j < Mesh.VertexOffsets[v + 1u]; j++)
+    {
+        const uint32_t h = Mesh.VertexEdges[j];
+        if (Mesh.Twins[h] == HalfEdgeMesh::NoTwin)
+        {
+            Neighbours[std::min(kCount, 1u)] = Mesh.Origins[Mesh.Next(h)];
+            kCount++;
+        }
+
+        const uint32_t p = Mesh.Prev(h);
+        if (Mesh.Twins[p] == HalfEdgeMesh::NoTwin)
+        {
+            Neighbours[std::min(kCount, 1u)] = Mesh.Origins[p];
+            kCount++;
+        }
+    }
+    return kCount;
+}
+
+// Boundary and corner rules shared by both schemes. Returns false for interior vertices, which are left to the scheme.
+static bool ApplySharpRule(const HalfEdgeMesh& Mesh, uint32_t v, Float3& Position) noexcept
+{
+    uint32_t       Neighbours[2] = {};
+    const uint32_t kCount        = GetBoundaryNeighbours(Mesh, v, Neighbours);
+    if (kCount == 0u && Mesh.VertexOffsets[v] < Mesh.VertexOffsets[v + 1u])
+    {
+        return false;
+    }
+
+    const Float3& p = Mesh.Positions[v];
+    Position = kCount == 2u ? Scale(p, 0.75f) + Scale(Mesh.Positions[Neighbours[0]] + Mesh.Positions[Neighbours[1]], 0.125f) : p;
+    return true;
+}
+
+// Outgoing half-edges come in a fixed order per vertex and faces per offset, so levels are the same on every run
+static void ComputeFaceNormals(const HalfEdgeMesh& Mesh, List<Float3>& Normals, List<Float3>& Centroids) noexcept
+{
+    const size_t kFaceCount = Mesh.GetFaceCount();
+    Normals.resize(kFaceCount);
+    Centroids.resize(kFaceCount);
+    Parallel::For(kFaceCount, Subdivision::GrainSize, [&](size_t kBegin, size_t kEnd)
+    {
+        for (size_t f = kBegin; f < kEnd; f++)
+        {
+            const uint32_t kFirst = Mesh.FaceOffsets[f];
+            const uint32_t kLast  = Mesh.FaceOffsets[f + 1u];
+            const Float3&  a      = Mesh.Positions[Mesh.Origins[kFirst]];
+
+            Float3 Normal   = Float3(0.0f);
+            Float3 Centroid = a;
+            for (uint32_t h = kFirst + 1u; h < kLast; h++)
+            {
+                Centroid = Centroid + Mesh.Positions[Mesh.Origins[h]];
+                if (h + 1u < kLast)
+                {
+                    Normal = Normal + Cross(Mesh.Positions[Mesh.Origins[h]] - a, Mesh.Positions[Mesh.Origins[h + 1u]] - a);
+                }
+            }
+            Normals[f]   = Normalize(Normal);
+            Centroids[f] = Scale(Centroid, 1.0f / float(kLast - kFirst));
+        }
+    });
+}
+
+static Float3 LoopVertex(const HalfEdgeMesh& Mesh, uint32_t v) noexcept
+{
+    Float3 Position = {};
+    if (ApplySharpRule(Mesh, v, Position))
+    {
+        return Position;
+    }
+
+    Float3 Sum = Float3(0.0f);
+    for (uint32_t j = Mesh.VertexOffsets[v]; j < Mesh.VertexOffsets[v + 1u]; j++)
+    {
+        Sum = Sum + Mesh.Positions[Mesh.Origins[Mesh.Next(Mesh.VertexEdges[j])]];
+    }
+
+    const float n    = float(Mesh.VertexOffsets[v + 1u] - Mesh.VertexOffsets[v]);
+    const float c    = 0.375f + 0.25f * cosf(2.0f * s_Pi / n);
+    const float Beta = (0.625f - c * c) / n;
+    return Scale(Mesh.Positions[v], 1.0f - n * Beta) + Scale(Sum, Beta);
+}
+
+static Float3 LoopEdge(const HalfEdgeMesh& Mesh, uint32_t h) noexcept
+{
+    const Float3& a = Mesh.Positions[Mesh.Origins[h]];
+    const Float3& b = Mesh.Positions[Mesh.Origins[Mesh.Next(h)]];
+    const uint32_t t = Mesh.Twins[h];
+    if (t == HalfEdgeMesh::NoTwin)
+    {
+        return Scale(a + b, 0.5f);
+    }
+
+    const Float3& c = Mesh.Positions[Mesh.Origins[Mesh.Prev(h)]];
+    const Float3& d = Mesh.Positions[Mesh.Origins[Mesh.Prev(t)]];
+    return Scale(a + b, 0.375f) + Scale(c + d, 0.125f);
+}
+
+// HALF-EDGE MESH
+void Subdivision::Link(HalfEdgeMesh& Mesh) noexcept
+{
+    const size_t kFaceCount     = Mesh.GetFaceCount();
+    const size_t kHalfEdgeCount = Mesh.Origins.size();
+    const size_t kVertexCount   = Mesh.Positions.size();
+
+    Mesh.Faces.resize(kHalfEdgeCount);
+    Parallel::For(kFaceCount, GrainSize, [&](size_t kBegin, size_t kEnd)
+    {
+        for (size_t f = kBegin; f < kEnd; f++)
+        {
+            std::fill(Mesh.Faces.begin() + Mesh.FaceOffsets[f], Mesh.Faces.begin() + Mesh.FaceOffsets[f + 1u], uint32_t(f));
+        }
+    });
+
+    Mesh.VertexOffsets.assign(kVertexCount + 1u, 0u);
+    for (size_t h = 0u; h < kHalfEdgeCount; h++)
+    {
+        Mesh.VertexOffsets[Mesh.Origins[h] + 1u]++;
+    }
+    for (size_t v = 0u; v < kVertexCount; v++)
+    {
+        Mesh.VertexOffsets[v + 1u] += Mesh.VertexOffsets[v];
+    }
+    List<uint32_t> Cursor = List<uint32_t>(Mesh.VertexOffsets.begin(), Mesh.VertexOffsets.end() - 1);
+    Mesh.VertexEdges.resize(kHalfEdgeCount);
+    for (size_t h = 0u; h < kHalfEdgeCount; h++)
+    {
+        Mesh.VertexEdges[Cursor[Mesh.Origins[h]]++] = uint32_t(h);
+    }
+
+    // The twin of a -> b leaves b towards a
+    Mesh.Twins.resize(kHalfEdgeCount);
+    Parallel::For(kHalfEdgeCount, GrainSize, [&](size_t kBegin, size_t kEnd)
+    {
+        for (size_t h = kBegin; h < kEnd; h++)
+        {
+            const uint32_t a = Mesh.Origins[h];
+            const uint32_t b = Mesh.Origins[Mesh.Next(uint32_t(h))];
+
+            Mesh.Twins[h] = HalfEdgeMesh::NoTwin;
+            for (uint32_t j = Mesh.VertexOffsets[b]; j < Mesh.VertexOffsets[b + 1u]; j++)
+            {
+                const uint32_t g = Mesh.VertexEdges[j];
+                if (Mesh.Origins[Mesh.Next(g)] == a)
+                {
+                    Mesh.Twins[h] = g;
+                    break;
+                }
+            }
+        }
+    });
+
+    // Non-manifold edges can pair up one-sidedly, those are treated as open
+    Mesh.Edges.resize(kHalfEdgeCount);
+    Mesh.EdgeCount = 0u;
+    for (size_t h = 0u; h < kHalfEdgeCount; h++)
+    {
+        uint32_t& t = Mesh.Twins[h];
+        if (t != HalfEdgeMesh::NoTwin && Mesh.Twins[t] != h)
+        {
+            t = HalfEdgeMesh::NoTwin;
+        }
+        if (t == HalfEdgeMesh::NoTwin || h < t)
+        {
+            Mesh.Edges[h] = Mesh.EdgeCount++;
+        }
+        else
+        {
+            Mesh.Edges[h] = Mesh.Edges[t];
+        }
+    }
+}
+
+size_t Subdivision::BuildFromTriangles(const Float3* pPositions, size_t kPositionStride, size_t kVertexCount, const uint32_t* pIndices, size_t kIndexCount, bool bRecoverQuads, HalfEdgeMesh& Mesh) noexcept
+{
+    List<uint32_t> Groups = {};
+    WeldPositions(pPositions, kPositionStride, kVertexCount, Groups, Mesh.Positions);
+
+    // Welding can collapse triangles, those would make edges without a face on one side
+    Mesh.Origins.clear();
+    Mesh.Origins.reserve(kIndexCount - kIndexCount % 3u);
+    for (size_t k = 0u; k + 2u < kIndexCount; k += 3u)
+    {
+        const uint32_t a = Groups[pIndices[k]];
+        const uint32_t b = Groups[pIndices[k + 1u]];
+        const uint32_t c = Groups[pIndices[k + 2u]];
+        if (a != b && b != c && c != a)
+        {
+            Mesh.Origins.insert(Mesh.Origins.end(), { a, b, c });
+        }
+    }
+
+    const size_t kTriangleCount = Mesh.Origins.size() / 3u;
+    Mesh.FaceOffsets.resize(kTriangleCount + 1u);
+    for (size_t f = 0u; f <= kTriangleCount; f++)
+    {
+        Mesh.FaceOffsets[f] = uint32_t(f * 3u);
+    }
+    Link(Mesh);
+
+    if (!bRecoverQuads)
+    {
+        return 0u;
+    }
+
+    // Longest edge of every triangle, the diagonal if it came from a quad
+    List<uint32_t> Longest = List<uint32_t>(kTriangleCount);
+    List<Float3>   Normals = {};
+    List<Float3>   Centroids = {};
+    ComputeFaceNormals(Mesh, Normals, Centroids);
+    Parallel::For(kTriangleCount, GrainSize, [&](size_t kBegin, size_t kEnd)
+    {
+        for (size_t f = kBegin; f < kEnd; f++)
+        {
+            float Best = -1.0f;
+            for (uint32_t h = uint32_t(f * 3u); h < uint32_t(f * 3u + 3u); h++)
+            {
+                const Float3 e      = Mesh.Positions[Mesh.Origins[Mesh.Next(h)]] - Mesh.Positions[Mesh.Origins[h]];
+                const float  Length = Dot(e, e);
+                if (Length > Best)
+                {
+                    Best       = Length;
+                    Longest[f] = h;
+                }
+            }
+        }
+    });
+
+    // Partner of every triangle that agrees on the diagonal and makes a flat convex quad with it
+    List<uint32_t> Partners = List<uint32_t>(kTriangleCount, UINT32_MAX);
+    Parallel::For(kTriangleCount, GrainSize, [&](size_t kBegin, size_t kEnd)
+    {
+        for (size_t f = kBegin; f < kEnd; f++)
+        {
+            const uint32_t h = Longest[f];
+            const uint32_t t = Mesh.Twins[h];
+            if (t == HalfEdgeMesh::NoTwin || Longest[Mesh.Faces[t]] != t || Dot(Normals[f], Normals[Mesh.Faces[t]]) < s_QuadFlatness)
+            {
+                continue;
+            }
+
+            const Float3 Quad[4] =
+            {
+                Mesh.Positions[Mesh.Origins[Mesh.Prev(h)]],
+                Mesh.Positions[Mesh.Origins[h]],
+                Mesh.Positions[Mesh.Origins[Mesh.Prev(t)]],
+                Mesh.Positions[Mesh.Origins[t]],
+            };
+            const Float3 Normal  = Normals[f] + Normals[Mesh.Faces[t]];
+            bool         bConvex = true;
+            for (uint32_t j = 0u; j < 4u; j++)
+            {
+                bConvex &= Dot(Cross(Quad[(j + 1u) & 3u] - Quad[j], Quad[(j + 2u) & 3u] - Quad[(j + 1u) & 3u]), Normal) > 0.0f;
+            }
+            if (bConvex)
+            {
+                Partners[f] = Mesh.Faces[t];
+            }
+        }
+    });
+
+    // Quads take the place of their first triangle, winding r, p, s, q for shared edge p -> q
+    List<uint32_t> Origins     = {};
+    List<uint32_t> FaceOffsets = { 0u };
+    size_t         kMerged     = 0u;
+    Origins.reserve(Mesh.Origins.size());
+    for (size_t f = 0u; f < kTriangleCount; f++)
+    {
+        const uint32_t u = Partners[f];
+        if (u == UINT32_MAX)
+        {
+            Origins.insert(Origins.end(), Mesh.Origins.begin() + f * 3u, Mesh.Origins.begin() + f * 3u + 3u);
+        }
+        else if (u > f)
+        {
+            const uint32_t h = Longest[f];
+            const uint32_t t = Mesh.Twins[h];
+            Origins.insert(Origins.end(), { Mesh.Origins[Mesh.Prev(h)], Mesh.Origins[h], Mesh.Origins[Mesh.Prev(t)], Mesh.Origins[t] });
+            kMerged += 2u;
+        }
+        else
+        {
+            continue;
+        }
+        FaceOffsets.push_back(uint32_t(Origins.size()));
+    }
+
+    Mesh.Origins.swap(Origins);
+    Mesh.FaceOffsets.swap(FaceOffsets);
+    Link(Mesh);
+    return kMerged;
+}
+
+// UNIFORM
+void Subdivision::Loop(const HalfEdgeMesh& Source, HalfEdgeMesh& Destination) noexcept
+{
+    const size_t kVertexCount   = Source.Positions.size();
+    const size_t kHalfEdgeCount = Source.Origins.size();
+    const size_t kFaceCount     = Source.GetFaceCount();
+    assert(kHalfEdgeCount == kFaceCount * 3u && "Loop subdivision needs triangles");
+
+    // Old vertices keep their index, edge points follow
+    Destination.Positions.resize(kVertexCount + Source.EdgeCount);
+    Parallel::For(kVertexCount, GrainSize, [&](size_t kBegin, size_t kEnd)
+    {
+        for (size_t v = kBegin; v < kEnd; v++)
+        {
+            Destination.Positions[v] = LoopVertex(Source, uint32_t(v));
+        }
+    });
+    Parallel::For(kHalfEdgeCount, GrainSize, [&](size_t kBegin, size_t kEnd)
+    {
+        for (size_t h = kBegin; h < kEnd; h++)
+        {
+            if (Source.Twins[h] == HalfEdgeMesh::NoTwin || h < Source.Twins[h])
+            {
+                Destination.Positions[kVertexCount + Source.Edges[h]] = LoopEdge(Source, uint32_t(h));
+            }
+        }
+    });
+
+    // Triangle a b c with edge points ab bc ca: a ab ca, ab b bc, ca bc c, ab bc ca
+    Destination.Origins.resize(kFaceCount * 12u);
+    Destination.FaceOffsets.resize(kFaceCount * 4u + 1u);
+    Parallel::For(kFaceCount, GrainSize, [&](size_t kBegin, size_t kEnd)
+    {
+        for (size_t f = kBegin; f < kEnd; f++)
+        {
+            const uint32_t h  = uint32_t(f * 3u);
+            const uint32_t a  = Source.Origins[h];
+            const uint32_t b  = Source.Origins[h + 1u];
+            const uint32_t c  = Source.Origins[h + 2u];
+            const uint32_t ab = uint32_t(kVertexCount) + Source.Edges[h];
+            const uint32_t bc = uint32_t(kVertexCount) + Source.Edges[h + 1u];
+            const uint32_t ca = uint32_t(kVertexCount) + Source.Edges[h + 2u];
+
+            const uint32_t Children[12] = { a, ab, ca, ab, b, bc, ca, bc, c, ab, bc, ca };
+            std::copy(Children, Children + 12u, Destination.Origins.begin() + f * 12u);
+            for (uint32_t j = 0u; j < 4u; j++)
+            {
+                Destination.FaceOffsets[f * 4u + j] = uint32_t(f * 12u + j * 3u);
+            }
+        }
+    });
+    Destination.FaceOffsets.back() = uint32_t(kFaceCount * 12u);
+    Link(Destination);
+}
+
+void Subdivision::CatmullClark(const HalfEdgeMesh& Source, HalfEdgeMesh& Destination) noexcept
+{
+    const size_t   kVertexCount   = Source.Positions.size();
+    const size_t   kHalfEdgeCount = Source.Origins.size();
+    const size_t   kFaceCount     = Source.GetFaceCount();
+    const uint32_t kEdgeBase      = uint32_t(kVertexCount);
+    const uint32_t kFaceBase      = uint32_t(kVertexCount + Source.EdgeCount);
+
+    // Old vertices keep their index, then edge points, then face points
+    List<Float3>& Positions = Destination.Positions;
+    Positions.resize(kFaceBase + kFaceCount);
+    Parallel::For(kFaceCount, GrainSize, [&](size_t kBegin, size_t kEnd)
+    {
+        for (size_t f = kBegin; f < kEnd; f++)
+        {
+            Float3 Sum = Float3(0.0f);
+            for (uint32_t h = Source.FaceOffsets[f]; h < Source.FaceOffsets[f + 1u]; h++)
+            {
+                Sum = Sum + Source.Positions[Source.Origins[h]];
+            }
+            Positions[kFaceBase + f] = Scale(Sum, 1.0f / float(Source.FaceOffsets[f + 1u] - Source.FaceOffsets[f]));
+        }
+    });
+    Parallel::For(kHalfEdgeCount, GrainSize, [&](size_t kBegin, size_t kEnd)
+    {
+        for (size_t h = kBegin; h < kEnd; h++)
+        {
+            const uint32_t t = Source.Twins[h];
+            if (t != HalfEdgeMesh::NoTwin && t < h)
+            {
+                continue;
+            }
+
+            const Float3 Sum = Source.Positions[Source.Origins[h]] + Source.Positions[Source.Origins[Source.Next(uint32_t(h))]];
+            Positions[kEdgeBase + Source.Edges[h]] = t == HalfEdgeMesh::NoTwin ? Scale(Sum, 0.5f) :
+                Scale(Sum + Positions[kFaceBase + Source.Faces[h]] + Positions[kFaceBase + Source.Faces[t]], 0.25f);
+        }
+    });
+    Parallel::For(kVertexCount, GrainSize, [&](size_t kBegin, size_t kEnd)
+    {
+        for (size_t v = kBegin; v < kEnd; v++)
+        {
+            if (ApplySharpRule(Source, uint32_t(v), Positions[v]))
+            {
+                continue;
+            }
+
+            // (F + 2R + (n - 3)P) / n with F the average face point and R the average edge midpoint
+            const Float3& p     = Source.Positions[v];
+            Float3        Faces = Float3(0.0f);
+            Float3        Edges = Float3(0.0f);
+            for (uint32_t j = Source.VertexOffsets[v]; j < Source.VertexOffsets[v + 1u]; j++)
+            {
+                const uint32_t h = Source.VertexEdges[j];
+                Faces = Faces + Positions[kFaceBase + Source.Faces[h]];
+                Edges = Edges + Source.Positions[Source.Origins[Source.Next(h)]];
+            }
+
+            const float n = float(Source.VertexOffsets[v + 1u] - Source.VertexOffsets[v]);
+            Positions[v] = Scale(Faces, 1.0f / (n * n)) + Scale(p + Scale(Edges, 1.0f / n), 1.0f / n) + Scale(p, (n - 3.0f) / n);
+        }
+    });
+
+    // A quad per corner: the corner, its outgoing edge point, the face point and its incoming edge point
+    Destination.Origins.resize(kHalfEdgeCount * 4u);
+    Destination.FaceOffsets.resize(kHalfEdgeCount + 1u);
+    Parallel::For(kHalfEdgeCount, GrainSize, [&](size_t kBegin, size_t kEnd)
+    {
+        for (size_t h = kBegin; h < kEnd; h++)
+        {
+            uint32_t* pQuad = Destination.Origins.data() + h * 4u;
+            pQuad[0] = Source.Origins[h];
+            pQuad[1] = kEdgeBase + Source.Edges[h];
+            pQuad[2] = kFaceBase + Source.Faces[h];
+            pQuad[3] = kEdgeBase + Source.Edges[Source.Prev(uint32_t(h))];
+            Destination.FaceOffsets[h] = uint32_t(h * 4u);
+        }
+    });
+    Destination.FaceOffsets.back() = uint32_t(kHalfEdgeCount * 4u);
+    Link(Destination);
+}
+
+// ADAPTIVE
+bool Subdivision::LoopAdaptive(const HalfEdgeMesh& Source, const SubdivisionOptions& Options, HalfEdgeMesh& Destination) noexcept
+{
+    const size_t kVertexCount   = Source.Positions.size();
+    const size_t kHalfEdgeCount = Source.Origins.size();
+    const size_t kFaceCount     = Source.GetFaceCount();
+    assert(kHalfEdgeCount == kFaceCount * 3u && "Loop subdivision needs triangles");
+
+    // A split triangle adds three, and each of its edges adds at most one to the neighbour across it
+    if (Options.MaxTriangles <= kFaceCount)
+    {
+        return false;
+    }
+    const size_t kBudget = (Options.MaxTriangles - kFaceCount) / 6u;
+    if (kBudget == 0u)
+    {
+        return false;
+    }
+
+    List<Float3> Normals   = {};
+    List<Float3> Centroids = {};
+    ComputeFaceNormals(Source, Normals, Centroids);
+
+    // Largest bend against a neighbour, silhouettes rank above any bend
+    List<float> Scores = List<float>(kFaceCount);
+    Parallel::For(kFaceCount, GrainSize, [&](size_t kBegin, size_t kEnd)
+    {
+        for (size_t f = kBegin; f < kEnd; f++)
+        {
+            const bool bFront = Dot(Normals[f], Options.ViewPosition - Centroids[f]) > 0.0f;
+
+            float Score = 0.0f;
+            for (uint32_t h = uint32_t(f * 3u); h < uint32_t(f * 3u + 3u); h++)
+            {
+                const uint32_t t = Source.Twins[h];
+                if (t == HalfEdgeMesh::NoTwin)
+                {
+                    continue;
+                }
+
+                const uint32_t g      = Source.Faces[t];
+                const float    Cosine = std::clamp(Dot(Normals[f], Normals[g]), -1.0f, 1.0f);
+                Score = std::max(Score, acosf(Cosine));
+                if (Options.bSilhouettes && bFront != (Dot(Normals[g], Options.ViewPosition - Centroids[g]) > 0.0f))
+                {
+                    Score = std::max(Score, s_Pi + acosf(Cosine));
+                }
+            }
+            Scores[f] = Score;
+        }
+    });
+
+    List<uint32_t> Candidates = {};
+    for (size_t f = 0u; f < kFaceCount; f++)
+    {
+        if (Scores[f] > Options.CurvatureAngle)
+        {
+            Candidates.push_back(uint32_t(f));
+        }
+    }
+    if (Candidates.empty())
+    {
+        return false;
+    }
+    if (Candidates.size() > kBudget)
+    {
+        std::nth_element(Candidates.begin(), Candidates.begin() + kBudget, Candidates.end(), [&Scores](uint32_t i, uint32_t j)
+        {
+            return Scores[i] != Scores[j] ? Scores[i] > Scores[j] : i < j;
+        });
+        Candidates.resize(kBudget);
+    }
+
+    // Split triangles split all their edges. Neighbours left with three split edges are split too, which marks no new edges.
+    List<uint8_t>  Split      = List<uint8_t>(kFaceCount, 0u);
+    List<uint32_t> EdgePoints = List<uint32_t>(Source.EdgeCount, UINT32_MAX);
+    for (const uint32_t& f : Candidates)
+    {
+        Split[f] = 1u;
+        for (uint32_t h = f * 3u; h < f * 3u + 3u; h++)
+        {
+            EdgePoints[Source.Edges[h]] = 0u;
+        }
+    }
+
+    uint32_t kPointCount = uint32_t(kVertexCount);
+    for (uint32_t& kPoint : EdgePoints)
+    {
+        kPoint = kPoint == 0u ? kPointCount++ : kPoint;
+    }
+
+    List<uint32_t> ChildOffsets = List<uint32_t>(kFaceCount + 1u, 0u);
+    for (size_t f = 0u; f < kFaceCount; f++)
+    {
+        uint32_t kSplitEdges = 0u;
+        for (size_t h = f * 3u; h < f * 3u + 3u; h++)
+        {
+            kSplitEdges += EdgePoints[Source.Edges[h]] != UINT32_MAX ? 1u : 0u;
+        }
+        Split[f] = kSplitEdges == 3u ? 1u : 0u;
+        ChildOffsets[f + 1u] = ChildOffsets[f] + (kSplitEdges == 3u ? 4u : kSplitEdges + 1u);
+    }
+
+    // Only vertices of split triangles move, the others have no refined ring to smooth over
+    List<uint8_t> Moves = List<uint8_t>(kVertexCount, 0u);
+    for (size_t f = 0u; f < kFaceCount; f++)
+    {
+        if (Split[f])
+        {
+            Moves[Source.Origins[f * 3u]] = Moves[Source.Origins[f * 3u + 1u]] = Moves[Source.Origins[f * 3u + 2u]] = 1u;
+        }
+    }
+
+    Destination.Positions.resize(kPointCount);
+    Parallel::For(kVertexCount, GrainSize, [&](size_t kBegin, size_t kEnd)
+    {
+        for (size_t v = kBegin; v < kEnd; v++)
+        {
+            Destination.Positions[v] = Moves[v] ? LoopVertex(Source, uint32_t(v)) : Source.Positions[v];
+        }
+    });
+    Parallel::For(kHalfEdgeCount, GrainSize, [&](size_t kBegin, size_t kEnd)
+    {
+        for (size_t h = kBegin; h < kEnd; h++)
+        {
+            const uint32_t kPoint = EdgePoints[Source.Edges[h]];
+            if (kPoint != UINT32_MAX && (Source.Twins[h] == HalfEdgeMesh::NoTwin || h < Source.Twins[h]))
+            {
+                Destination.Positions[kPoint] = LoopEdge(Source, uint32_t(h));
+            }
+        }
+    });
+
+    const size_t kChildCount = ChildOffsets.back();
+    Destination.Origins.resize(kChildCount * 3u);
+    Destination.FaceOffsets.resize(kChildCount + 1u);
+    Parallel::For(kFaceCount, GrainSize, [&](size_t kBegin, size_t kEnd)
+    {
+        for (size_t f = kBegin; f < kEnd; f++)
+        {
+            uint32_t* pChildren = Destination.Origins.data() + size_t(ChildOffsets[f]) * 3u;
+            for (uint32_t j = ChildOffsets[f]; j < ChildOffsets[f + 1u]; j++)
+            {
+                Destination.FaceOffsets[j] = j * 3u;
+            }
+
+            const uint32_t h       = uint32_t(f * 3u);
+            const uint32_t c[3]    = { Source.Origins[h], Source.Origins[h + 1u], Source.Origins[h + 2u] };
+            const uint32_t m[3]    = { EdgePoints[Source.Edges[h]], EdgePoints[Source.Edges[h + 1u]], EdgePoints[Source.Edges[h + 2u]] };
+            const uint32_t kSplits = ChildOffsets[f + 1u] - ChildOffsets[f];
+            if (kSplits == 4u)
+            {
+                const uint32_t Children[12] = { c[0], m[0], m[2], m[0], c[1], m[1], m[2], m[1], c[2], m[0], m[1], m[2] };
+                std::copy(Children, Children + 12u, pChildren);
+            }
+            else if (kSplits == 1u)
+            {
+                std::copy(c, c + 3u, pChildren);
+            }
+            else if (kSplits == 2u)
+            {
+                // Bisected from the opposite corner
+                const uint32_t i = m[0] != UINT32_MAX ? 0u : (m[1] != UINT32_MAX ? 1u : 2u);
+                const uint32_t Children[6] = { c[i], m[i], c[(i + 2u) % 3u], m[i], c[(i + 1u) % 3u], c[(i + 2u) % 3u] };
+                std::copy(Children, Children + 6u, pChildren);
+            }
+            else
+            {
+                // Edge k is whole, o is the corner across it. A corner triangle at o and the rest of the quad cut
+                // along its shorter diagonal.
+                const uint32_t k  = m[0] == UINT32_MAX ? 0u : (m[1] == UINT32_MAX ? 1u : 2u);
+                const uint32_t a  = c[k];
+                const uint32_t b  = c[(k + 1u) % 3u];
+                const uint32_t o  = c[(k + 2u) % 3u];
+                const uint32_t m1 = m[(k + 1u) % 3u];
+                const uint32_t m2 = m[(k + 2u) % 3u];
+
+                const List<Float3>& p = Destination.Positions;
+                const Float3 d1 = p[m1] - p[a];
+                const Float3 d2 = p[m2] - p[b];
+                if (Dot(d1, d1) <= Dot(d2, d2))
+                {
+                    const uint32_t Children[9] = { m1, o, m2, a, b, m1, a, m1, m2 };
+                    std::copy(Children, Children + 9u, pChildren);
+                }
+                else
+                {
+                    const uint32_t Children[9] = { m1, o, m2, a, b, m2, b, m1, m2 };
+                    std::copy(Children, Children + 9u, pChildren);
+                }
+            }
+        }
+    });
+    Destination.FaceOffsets.back() = uint32_t(kChildCount * 3u);
+    Link(Destination);
+    return true;
+}
+
+// OUTPUT
+void Subdivision::Triangulate(const HalfEdgeMesh& Mesh, List<uint32_t>& Indices) noexcept
+{
+    const size_t   kFaceCount = Mesh.GetFaceCount();
+    List<uint32_t> Offsets    = List<uint32_t>(kFaceCount + 1u, 0u);
+    for (size_t f = 0u; f < kFaceCount; f++)
+    {
+        Offsets[f + 1u] = Offsets[f] + (Mesh.FaceOffsets[f + 1u] - Mesh.FaceOffsets[f] - 2u) * 3u;
+    }
+
+    Indices.resize(Offsets.back());
+    Parallel::For(kFaceCount, GrainSize, [&](size_t kBegin, size_t kEnd)
+    {
+        for (size_t f = kBegin; f < kEnd; f++)
+        {
+            const uint32_t* pCorners = Mesh.Origins.data() + Mesh.FaceOffsets[f];
+            const uint32_t  kCorners = Mesh.FaceOffsets[f + 1u] - Mesh.FaceOffsets[f];
+            uint32_t*       pOutput  = Indices.data() + Offsets[f];
+
+            // Quads along their shorter diagonal, anything else as a fan
+            uint32_t kFirst = 0u;
+            if (kCorners == 4u)
+            {
+                const Float3 d0 = Mesh.Positions[pCorners[2]] - Mesh.Positions[pCorners[0]];
+                const Float3 d1 = Mesh.Positions[pCorners[3]] - Mesh.Positions[pCorners[1]];
+                kFirst = Dot(d0, d0) <= Dot(d1, d1) ? 0u : 1u;
+            }
+            for (uint32_t j = 1u; j + 1u < kCorners; j++)
+            {
+                *pOutput++ = pCorners[kFirst];
+                *pOutput++ = pCorners[(kFirst + j) % kCorners];
+                *pOutput++ = pCorners[(kFirst + j + 1u) % kCorners];
+            }
+        }
+    });
+}
+
+void Subdivision::Subdivide(const Float3* pPositions, size_t kPositionStride, size_t kVertexCount, const uint32_t* pIndices, size_t kIndexCount, const SubdivisionOptions& Options, List<Float3>& Positions, List<uint32_t>& Indices) noexcept
+{
+    SubdivisionScheme Scheme = Options.bAdaptive ? SubdivisionScheme::Loop : Options.Scheme;
+
+    HalfEdgeMesh Mesh    = {};
+    const size_t kMerged = BuildFromTriangles(pPositions, kPositionStride, kVertexCount, pIndices, kIndexCount, Scheme != SubdivisionScheme::Loop, Mesh);
+    if (Scheme == SubdivisionScheme::Auto)
+    {
+        // Mostly quads: at least two thirds of the triangles merged
+        Scheme = kMerged * 3u >= (kIndexCount / 3u) * 2u ? SubdivisionScheme::CatmullClark : SubdivisionScheme::Loop;
+        if (Scheme == SubdivisionScheme::Loop && kMerged > 0u)
+        {
+            BuildFromTriangles(pPositions, kPositionStride, kVertexCount, pIndices, kIndexCount, false, Mesh);
+        }
+    }
+
+    HalfEdgeMesh Next = {};
+    for (uint32_t kLevel = 0u; kLevel < Options.Levels; kLevel++)
+    {
+        if (Options.bAdaptive)
+        {
+            if (!LoopAdaptive(Mesh, Options, Next))
+            {
+                break;
+            }
+        }
+        else
+        {
+            // Loop makes four triangles of one, Catmull-Clark a quad of every corner
+            const size_t kTriangles = Scheme == SubdivisionScheme::Loop ? Mesh.GetFaceCount() * 4u : Mesh.Origins.size() * 2u;
+            if (kTriangles > Options.MaxTriangles)
+            {
+                break;
+            }
+
+            if (Scheme == SubdivisionScheme::Loop)
+            {
+                Loop(Mesh, Next);
+            }
+            else
+            {
+                CatmullClark(Mesh, Next);
+            }
+        }
+        std::swap(Mesh, Next);
+    }
+
+    Triangulate(Mesh, Indices);
+    Positions.swap(Mesh.Positions);
+}
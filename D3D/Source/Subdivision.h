@@ -0,0 +1,105 @@
+#pragma once
+
+#include "Core.h"
+#include "TangentSpace.h"
+
+#include <cfloat>
+
+enum class SubdivisionScheme
+{
+	Auto,         // Catmull-Clark when most triangles pair up into quads, Loop otherwise
+	Loop,
+	CatmullClark,
+};
+
+struct SubdivisionOptions
+{
+	uint32_t          Levels         = 0u;
+	SubdivisionScheme Scheme         = SubdivisionScheme::Auto;
+	size_t            MaxTriangles   = SIZE_MAX;   // Levels that would go over are not done, adaptive levels stop short of it
+	// Feature adaptive refinement, always with Loop. Only triangles bending away from a neighbour by more than
+	// CurvatureAngle, or on the silhouette seen from ViewPosition, are split, the most bent first.
+	bool              bAdaptive      = false;
+	float             CurvatureAngle = 0.35f;      // Radians
+	bool              bSilhouettes   = false;
+	Float3            ViewPosition   = {};         // Model space
+};
+
+// Polygon mesh as half-edges. A face owns a run of consecutive half-edges, so next and previous come from the face
+// and twins are the only stored links. Half-edge h leaves Origins[h] towards the origin of the next one.
+struct HalfEdgeMesh
+{
+	static constexpr uint32_t NoTwin = UINT32_MAX;
+
+	List<Float3>   Positions     = {};
+	List<uint32_t> FaceOffsets   = {}; // Face count + 1, the half-edges of face f are [FaceOffsets[f], FaceOffsets[f + 1])
+	List<uint32_t> Origins       = {};
+	List<uint32_t> Twins         = {}; // NoTwin on open boundaries
+	List<uint32_t> Faces         = {};
+	List<uint32_t> Edges         = {}; // Undirected edge of every half-edge, twins share one
+	List<uint32_t> VertexOffsets = {}; // Outgoing half-edges of vertex v are VertexEdges[VertexOffsets[v] .. VertexOffsets[v + 1])
+	List<uint32_t> VertexEdges   = {};
+	uint32_t       EdgeCount     = 0u;
+
+	size_t   GetFaceCount() const noexcept   { return FaceOffsets.empty() ? 0u : FaceOffsets.size() - 1u; }
+	uint32_t Next(uint32_t h) const noexcept { return h + 1u == FaceOffsets[Faces[h] + 1u] ? FaceOffsets[Faces[h]] : h + 1u; }
+	uint32_t Prev(uint32_t h) const noexcept { return h == FaceOffsets[Faces[h]] ? FaceOffsets[Faces[h] + 1u] - 1u : h - 1u; }
+};
+
+// Loop (1987) and Catmull-Clark (1978) subdivision. Every step of a level runs on the worker threads. Open
+// boundaries are kept sharp with the usual crease rules, vertices where more than two meet stay where they are.
+// Faces keep their winding.
+class Subdivision
+{
+public:
+	static constexpr size_t GrainSize = 4096u;
+
+	// Links the twins, numbers the edges and gathers the outgoing half-edges of every vertex. Positions, FaceOffsets
+	// and Origins must be set.
+	static void Link(HalfEdgeMesh& Mesh) noexcept;
+
+	// Welds the triangle list on exact positions. With bRecoverQuads, pairs of triangles that split a flat enough
+	// quad along its longest edge, which is how triangulating quads comes out, are merged back into quads.
+	// Returns the number of triangles that were merged.
+	static size_t BuildFromTriangles(const Float3* pPositions, size_t kPositionStride, size_t kVertexCount, const uint32_t* pIndices, size_t kIndexCount, bool bRecoverQuads, HalfEdgeMesh& Mesh) noexcept;
+
+	// One uniform level. Loop needs triangles, Catmull-Clark takes any polygons and makes quads.
+	static void Loop(const HalfEdgeMesh& Source, HalfEdgeMesh& Destination) noexcept;
+	static void CatmullClark(const HalfEdgeMesh& Source, HalfEdgeMesh& Destination) noexcept;
+
+	// One adaptive Loop level on triangles. Neighbours of split triangles are bisected along the split edges so the
+	// surface stays crack free. Returns false when nothing qualified or the budget allowed nothing.
+	static bool LoopAdaptive(const HalfEdgeMesh& Source, const SubdivisionOptions& Options, HalfEdgeMesh& Destination) noexcept;
+
+	// Fans every face into triangles
+	static void Triangulate(const HalfEdgeMesh& Mesh, List<uint32_t>& Indices) noexcept;
+
+	// The whole pipeline on a triangle list. Vertices come out welded with smooth normals.
+	static void Subdivide(const Float3* pPositions, size_t kPositionStride, size_t kVertexCount, const uint32_t* pIndices, size_t kIndexCount, const SubdivisionOptions& Options, List<Float3>& Positions, List<uint32_t>& Indices) noexcept;
+
+	// As above in place on a vertex type with Float3 Position and Normal members, other members are value initialized
+	template<typename V>
+	static void Subdivide(List<V>& Vertices, List<uint32_t>& Indices, const SubdivisionOptions& Options);
+};
+
+
+template<typename V>
+inline void Subdivision::Subdivide(List<V>& Vertices, List<uint32_t>& Indices, const SubdivisionOptions& Options)
+{
+	if (Vertices.empty() || Indices.empty() || Options.Levels == 0u)
+	{
+		return;
+	}
+
+	List<Float3>   Positions  = {};
+	List<uint32_t> Subdivided = {};
+	Subdivide(&Vertices[0].Position, sizeof(V), Vertices.size(), Indices.data(), Indices.size(), Options, Positions, Subdivided);
+
+	Vertices.assign(Positions.size(), V{});
+	for (size_t k = 0u; k < Positions.size(); k++)
+	{
+		Vertices[k].Position = Positions[k];
+	}
+	Indices.swap(Subdivided);
+	TangentSpace::ComputeSmoothNormals(&Vertices[0].Position, sizeof(V), Vertices.size(), Indices.data(), Indices.size(), &Vertices[0].Normal, sizeof(V));
+}
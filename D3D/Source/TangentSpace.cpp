@@ -0,0 +1,361 @@
+#include "TangentSpace.h"
+#include "Parallel.h"
+
+#include <string.h>
+
+static inline float Dot(const Float3& u, const Float3& v) noexcept
+{
+    return u.X * v.X + u.Y * v.Y + u.Z * v.Z;
+}
+
+static inline Float3 Cross(const Float3& u, const Float3& v) noexcept
+{
+    return Float3(u.Y * v.Z - u.Z * v.Y, u.Z * v.X - u.X * v.Z, u.X * v.Y - u.Y * v.X);
+}
+
+static inline Float3 Scale(const Float3& u, float s) noexcept
+{
+    return Float3(u.X * s, u.Y * s, u.Z * s);
+}
+
+// Zero vectors stay zero
+static inline Float3 Normalize(const Float3& u) noexcept
+{
+    const float Length = sqrtf(Dot(u, u));
+    return Length > 0.0f ? Scale(u, 1.0f / Length) : Float3(0.0f);
+}
+
+static inline const Float3& PositionAt(const Float3* pPositions, size_t kStride, size_t kIndex) noexcept
+{
+    return *reinterpret_cast<const Float3*>(reinterpret_cast<const uint8_t*>(pPositions) + kIndex * kStride);
+}
+
+// Angle between two edges leaving a corner
+static inline float CornerAngle(const Float3& u, const Float3& v) noexcept
+{
+    const float Cosine = Dot(Normalize(u), Normalize(v));
+    return acosf(Cosine < -1.0f ? -1.0f : (Cosine > 1.0f ? 1.0f : Cosine));
+}
+
+// The corners touching each group, in corner order so sums over them come out the same on every run.
+// The corners of group g are Corners[Offsets[g] .. Offsets[g + 1]).
+struct CornerAdjacency
+{
+    List<uint32_t> Offsets = {};
+    List<uint32_t> Corners = {};
+};
+
+static void BuildAdjacency(const uint32_t* pGroups, size_t kGroupCount, const uint32_t* pIndices, size_t kIndexCount, CornerAdjacency& Adjacency) noexcept
+{
+    Adjacency.Offsets.assign(kGroupCount + 1u, 0u);
+    for (size_t k = 0u; k < kIndexCount; k++)
+    {
+        Adjacency.Offsets[pGroups[pIndices[k]] + 1u]++;
+    }
+    for (size_t g = 0u; g < kGroupCount; g++)
+    {
+        Adjacency.Offsets[g + 1u] += Adjacency.Offsets[g];
+    }
+
+    List<uint32_t> Cursor = List<uint32_t>(Adjacency.Offsets.begin(), Adjacency.Offsets.end() - 1);
+    Adjacency.Corners.resize(kIndexCount);
+    for (size_t k = 0u; k < kIndexCount; k++)
+    {
+        Adjacency.Corners[Cursor[pGroups[pIndices[k]]]++] = uint32_t(k);
+    }
+}
+
+// Numbers the distinct positions in order of first appearance, open addressing on the position bits
+static size_t GroupPositions(const Float3* pPositions, size_t kStride, size_t kVertexCount, List<uint32_t>& Groups) noexcept
+{
+    size_t kCapacity = 16u;
+    while (kCapacity < kVertexCount * 2u)
+    {
+        kCapacity <<= 1u;
+    }
+
+    List<uint32_t> Slots  = List<uint32_t>(kCapacity, UINT32_MAX); // First vertex at the position
+    List<uint32_t> Firsts = {};
+    Groups.resize(kVertexCount);
+    for (size_t k = 0u; k < kVertexCount; k++)
+    {
+        // Adding zero turns -0 into +0 so both hash alike
+        const Float3& p      = PositionAt(pPositions, kStride, k);
+        const float   Key[3] = { p.X + 0.0f, p.Y + 0.0f, p.Z + 0.0f };
+
+        size_t kSlot = size_t(HashBytes(Key, sizeof(Key))) & (kCapacity - 1u);
+        while (true)
+        {
+            const uint32_t kFirst = Slots[kSlot];
+            if (kFirst == UINT32_MAX)
+            {
+                Slots[kSlot] = uint32_t(k);
+                Groups[k]    = uint32_t(Firsts.size());
+                Firsts.emplace_back(uint32_t(k));
+                break;
+            }
+
+            const Float3& q = PositionAt(pPositions, kStride, kFirst);
+            if (q.X == p.X && q.Y == p.Y && q.Z == p.Z)
+            {
+                Groups[k] = Groups[kFirst];
+                break;
+            }
+            kSlot = (kSlot + 1u) & (kCapacity - 1u);
+        }
+    }
+    return Firsts.size();
+}
+
+// Unit normal of every face and the angle of every corner, degenerate faces get a zero normal
+static void ComputeFaceNormals(const Float3* pPositions, size_t kStride, const uint32_t* pIndices, size_t kIndexCount, List<Float3>& FaceNormals, List<float>& CornerAngles) noexcept
+{
+    FaceNormals.resize(kIndexCount / 3u);
+    CornerAngles.resize(kIndexCount);
+    Parallel::For(kIndexCount / 3u, TangentSpace::GrainSize / 3u, [&](size_t kBegin, size_t kEnd)
+    {
+        for (size_t f = kBegin; f < kEnd; f++)
+        {
+            const Float3& a = PositionAt(pPositions, kStride, pIndices[f * 3u + 0u]);
+            const Float3& b = PositionAt(pPositions, kStride, pIndices[f * 3u + 1u]);
+            const Float3& c = PositionAt(pPositions, kStride, pIndices[f * 3u + 2u]);
+
+            FaceNormals[f] = Normalize(Cross(b - a, c - a));
+            CornerAngles[f * 3u + 0u] = CornerAngle(b - a, c - a);
+            CornerAngles[f * 3u + 1u] = CornerAngle(c - b, a - b);
+            CornerAngles[f * 3u + 2u] = CornerAngle(a - c, b - c);
+        }
+    });
+}
+
+// TANGENT SPACE
+void TangentSpace::ComputeCornerNormals(const Float3* pPositions, size_t kPositionStride, size_t kVertexCount, const uint32_t* pIndices, size_t kIndexCount, float CreaseAngle, Float3* pCornerNormals) noexcept
+{
+    kIndexCount -= kIndexCount % 3u;
+
+    List<Float3> FaceNormals  = {};
+    List<float>  CornerAngles = {};
+    ComputeFaceNormals(pPositions, kPositionStride, pIndices, kIndexCount, FaceNormals, CornerAngles);
+
+    // Faceted needs no neighbours at all
+    if (CreaseAngle <= 0.0f)
+    {
+        Parallel::For(kIndexCount, GrainSize, [&](size_t kBegin, size_t kEnd)
+        {
+            for (size_t k = kBegin; k < kEnd; k++)
+            {
+                pCornerNormals[k] = FaceNormals[k / 3u];
+            }
+        });
+        return;
+    }
+
+    List<uint32_t>  Groups    = {};
+    CornerAdjacency Adjacency = {};
+    const size_t    kGroupCount = GroupPositions(pPositions, kPositionStride, kVertexCount, Groups);
+    BuildAdjacency(Groups.data(), kGroupCount, pIndices, kIndexCount, Adjacency);
+
+    // Every corner sums the faces around its position that are close enough to its own, each corner is independent
+    const bool  bSmooth   = CreaseAngle >= SmoothAngle;
+    const float Threshold = cosf(CreaseAngle);
+    Parallel::For(kIndexCount, GrainSize, [&](size_t kBegin, size_t kEnd)
+    {
+        for (size_t k = kBegin; k < kEnd; k++)
+        {
+            const Float3&  Face   = FaceNormals[k / 3u];
+            const uint32_t kGroup = Groups[pIndices[k]];
+
+            Float3 Sum = Float3(0.0f);
+            for (uint32_t a = Adjacency.Offsets[kGroup]; a < Adjacency.Offsets[kGroup + 1u]; a++)
+            {
+                const uint32_t kCorner = Adjacency.Corners[a];
+                const Float3&  Other   = FaceNormals[kCorner / 3u];
+                if (bSmooth || Dot(Face, Other) >= Threshold)
+                {
+                    Sum = Sum + Scale(Other, CornerAngles[kCorner]);
+                }
+            }
+
+            const Float3 Normal = Normalize(Sum);
+            pCornerNormals[k] = Dot(Normal, Normal) > 0.0f ? Normal : Face;
+        }
+    });
+}
+
+void TangentSpace::ComputeSmoothNormals(const Float3* pPositions, size_t kPositionStride, size_t kVertexCount, const uint32_t* pIndices, size_t kIndexCount, Float3* pNormals, size_t kNormalStride) noexcept
+{
+    kIndexCount -= kIndexCount % 3u;
+
+    List<Float3> FaceNormals  = {};
+    List<float>  CornerAngles = {};
+    ComputeFaceNormals(pPositions, kPositionStride, pIndices, kIndexCount, FaceNormals, CornerAngles);
+
+    List<uint32_t>  Groups    = {};
+    CornerAdjacency Adjacency = {};
+    const size_t    kGroupCount = GroupPositions(pPositions, kPositionStride, kVertexCount, Groups);
+    BuildAdjacency(Groups.data(), kGroupCount, pIndices, kIndexCount, Adjacency);
+
+    List<Float3> GroupNormals = List<Float3>(kGroupCount);
+    Parallel::For(kGroupCount, GrainSize, [&](size_t kBegin, size_t kEnd)
+    {
+        for (size_t g = kBegin; g < kEnd; g++)
+        {
+            Float3 Sum = Float3(0.0f);
+            for (uint32_t a = Adjacency.Offsets[g]; a < Adjacency.Offsets[g + 1u]; a++)
+            {
+                const uint32_t kCorner = Adjacency.Corners[a];
+                Sum = Sum + Scale(FaceNormals[kCorner / 3u], CornerAngles[kCorner]);
+            }
+            GroupNormals[g] = Normalize(Sum);
+        }
+    });
+
+    Parallel::For(kVertexCount, GrainSize, [&](size_t kBegin, size_t kEnd)
+    {
+        for (size_t k = kBegin; k < kEnd; k++)
+        {
+            *reinterpret_cast<Float3*>(reinterpret_cast<uint8_t*>(pNormals) + k * kNormalStride) = GroupNormals[Groups[k]];
+        }
+    });
+}
+
+void TangentSpace::ComputeCornerTangents(const Float3* pPositions, size_t kPositionStride, const Float3* pNormals, size_t kNormalStride, const Float2* pTexCoords, size_t kTexCoordStride, size_t kVertexCount, const uint32_t* pIndices, size_t kIndexCount, Float4* pCornerTangents) noexcept
+{
+    kIndexCount -= kIndexCount % 3u;
+
+    const auto NormalAt = [&](size_t kIndex) -> const Float3&
+    {
+        return *reinterpret_cast<const Float3*>(reinterpret_cast<const uint8_t*>(pNormals) + kIndex * kNormalStride);
+    };
+    const auto TexCoordAt = [&](size_t kIndex) -> const Float2&
+    {
+        return *reinterpret_cast<const Float2*>(reinterpret_cast<const uint8_t*>(pTexCoords) + kIndex * kTexCoordStride);
+    };
+
+    // Unit direction of increasing U on every face, flipped where the UVs are mirrored so it stays comparable with its
+    // neighbours (MikkTSpace's vOs). Faces without UV area get no tangent and a handedness of zero.
+    const size_t kFaceCount = kIndexCount / 3u;
+    List<Float3> FaceTangents = List<Float3>(kFaceCount);
+    List<float>  Handedness   = List<float>(kFaceCount);
+    Parallel::For(kFaceCount, GrainSize / 3u, [&](size_t kBegin, size_t kEnd)
+    {
+        for (size_t f = kBegin; f < kEnd; f++)
+        {
+            const uint32_t* pFace = pIndices + f * 3u;
+            const Float3    d1    = PositionAt(pPositions, kPositionStride, pFace[1]) - PositionAt(pPositions, kPositionStride, pFace[0]);
+            const Float3    d2    = PositionAt(pPositions, kPositionStride, pFace[2]) - PositionAt(pPositions, kPositionStride, pFace[0]);
+            const Float2    t21   = TexCoordAt(pFace[1]) - TexCoordAt(pFace[0]);
+            const Float2    t31   = TexCoordAt(pFace[2]) - TexCoordAt(pFace[0]);
+
+            const float Area = t21.X * t31.Y - t21.Y * t31.X;
+            const float Sign = Area > 0.0f ? 1.0f : (Area < 0.0f ? -1.0f : 0.0f);
+            FaceTangents[f] = Scale(Normalize(Scale(d1, t31.Y) - Scale(d2, t21.Y)), Sign);
+            Handedness[f]   = Sign;
+        }
+    });
+
+    // Grouped by vertex index rather than position, UV seams must keep their own tangents
+    List<uint32_t> Groups = List<uint32_t>(kVertexCount);
+    for (size_t k = 0u; k < kVertexCount; k++)
+    {
+        Groups[k] = uint32_t(k);
+    }
+    CornerAdjacency Adjacency = {};
+    BuildAdjacency(Groups.data(), kVertexCount, pIndices, kIndexCount, Adjacency);
+
+    // What every corner adds to the corners of its vertex: the face tangent projected onto the plane of the vertex
+    // normal, weighted by the corner's angle measured in that plane
+    List<Float3> Contributions = List<Float3>(kIndexCount);
+    Parallel::For(kIndexCount, GrainSize, [&](size_t kBegin, size_t kEnd)
+    {
+        for (size_t k = kBegin; k < kEnd; k++)
+        {
+            const size_t kFace = k / 3u;
+            if (Handedness[kFace] == 0.0f)
+            {
+                Contributions[k] = Float3(0.0f);
+                continue;
+            }
+
+            const uint32_t* pFace = pIndices + kFace * 3u;
+            const size_t    j     = k - kFace * 3u;
+            const Float3&   p     = PositionAt(pPositions, kPositionStride, pFace[j]);
+            const Float3&   n     = NormalAt(pFace[j]);
+
+            Float3 u = PositionAt(pPositions, kPositionStride, pFace[(j + 1u) % 3u]) - p;
+            Float3 v = PositionAt(pPositions, kPositionStride, pFace[(j + 2u) % 3u]) - p;
+            u = u - Scale(n, Dot(n, u));
+            v = v - Scale(n, Dot(n, v));
+
+            const Float3& t = FaceTangents[kFace];
+            Contributions[k] = Scale(Normalize(t - Scale(n, Dot(n, t))), CornerAngle(u, v));
+        }
+    });
+
+    Parallel::For(kIndexCount, GrainSize, [&](size_t kBegin, size_t kEnd)
+    {
+        for (size_t k = kBegin; k < kEnd; k++)
+        {
+            const uint32_t kVertex = pIndices[k];
+            const float    Sign    = Handedness[k / 3u];
+
+            Float3 Sum = Float3(0.0f);
+            for (uint32_t a = Adjacency.Offsets[kVertex]; a < Adjacency.Offsets[kVertex + 1u]; a++)
+            {
+                const uint32_t kCorner = Adjacency.Corners[a];
+                if (Handedness[kCorner / 3u] == Sign)
+                {
+                    Sum = Sum + Contributions[kCorner];
+                }
+            }
+
+            Float3 Tangent = Normalize(Sum);
+            if (Dot(Tangent, Tangent) == 0.0f)
+            {
+                // No usable UVs around this corner, any direction in the tangent plane will do
+                const Float3& n    = NormalAt(kVertex);
+                const Float3  Axis = fabsf(n.X) < 0.9f ? Float3(1.0f, 0.0f, 0.0f) : Float3(0.0f, 1.0f, 0.0f);
+                Tangent = Normalize(Axis - Scale(n, Dot(n, Axis)));
+            }
+            pCornerTangents[k] = Float4(Tangent, Sign < 0.0f ? -1.0f : 1.0f);
+        }
+    });
+}
+
+void TangentSpace::SplitVertices(uint32_t* pIndices, size_t kIndexCount, size_t kVertexCount, const void* pCornerValues, size_t kValueSize, List<uint32_t>& VertexRemap) noexcept
+{
+    const uint8_t* pValues = reinterpret_cast<const uint8_t*>(pCornerValues);
+
+    // Each vertex keeps the value of its first corner, copies are chained through Next
+    List<uint32_t> Next    = List<uint32_t>(kVertexCount, UINT32_MAX);
+    List<uint32_t> Corners = List<uint32_t>(kVertexCount, UINT32_MAX); // Corner whose value the vertex holds
+    VertexRemap.resize(kVertexCount);
+    for (size_t k = 0u; k < kVertexCount; k++)
+    {
+        VertexRemap[k] = uint32_t(k);
+    }
+
+    for (size_t k = 0u; k < kIndexCount; k++)
+    {
+        const uint8_t* pValue  = pValues + k * kValueSize;
+        uint32_t       kVertex = pIndices[k];
+        if (Corners[kVertex] == UINT32_MAX)
+        {
+            Corners[kVertex] = uint32_t(k);
+            continue;
+        }
+
+        while (memcmp(pValues + size_t(Corners[kVertex]) * kValueSize, pValue, kValueSize) != 0)
+        {
+            if (Next[kVertex] == UINT32_MAX)
+            {
+                Next[kVertex] = uint32_t(VertexRemap.size());
+                VertexRemap.emplace_back(VertexRemap[kVertex]);
+                Next.emplace_back(UINT32_MAX);
+                Corners.emplace_back(uint32_t(k));
+            }
+            kVertex = Next[kVertex];
+        }
+        pIndices[k] = kVertex;
+    }
+}
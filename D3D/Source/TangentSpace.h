@@ -0,0 +1,89 @@
+#pragma once
+
+#include "Core.h"
+
+// Normal and tangent generation for imported meshes. The work is spread over the worker threads, but every value is
+// summed in a fixed order, so the output is bit for bit the same whatever the thread count.
+// Faces are expected to wind clockwise seen from the front, like everything else the renderer draws.
+class TangentSpace
+{
+public:
+	static constexpr float  SmoothAngle        = 3.14159265358979f; // Every face around a vertex is smoothed together
+	static constexpr float  DefaultCreaseAngle = 1.04719755f;       // 60 degrees
+	static constexpr size_t GrainSize          = 16384u;            // Corners per worker at least
+
+	// Angle weighted normal of every corner (index). Faces meeting at a vertex more than CreaseAngle apart keep their
+	// own normal there, so 0 gives faceted normals. Vertices at the same position are smoothed together even when
+	// their index differs, which is how a mesh split at UV seams comes out.
+	static void ComputeCornerNormals(const Float3* pPositions, size_t kPositionStride, size_t kVertexCount, const uint32_t* pIndices, size_t kIndexCount, float CreaseAngle, Float3* pCornerNormals) noexcept;
+
+	// Angle weighted smooth normal of every vertex, no vertex needs splitting
+	static void ComputeSmoothNormals(const Float3* pPositions, size_t kPositionStride, size_t kVertexCount, const uint32_t* pIndices, size_t kIndexCount, Float3* pNormals, size_t kNormalStride) noexcept;
+
+	// MikkTSpace style tangent of every corner. The face tangent follows the texture U direction, it is projected onto
+	// the plane of the vertex normal and angle weighted over the faces around the vertex with the same UV handedness.
+	// W is the bitangent sign, Bitangent = W * cross(Normal, Tangent). Vertices are expected to be welded, as with
+	// MikkTSpace's own welding this matches its output except where it splits a vertex's faces into several groups
+	// of the same handedness.
+	static void ComputeCornerTangents(const Float3* pPositions, size_t kPositionStride, const Float3* pNormals, size_t kNormalStride, const Float2* pTexCoords, size_t kTexCoordStride, size_t kVertexCount, const uint32_t* pIndices, size_t kIndexCount, Float4* pCornerTangents) noexcept;
+
+	// Gives the corners of a vertex that ended up with different values their own copies of it. Indices are rewritten,
+	// VertexRemap receives the source vertex of every vertex, the first kVertexCount are the originals.
+	static void SplitVertices(uint32_t* pIndices, size_t kIndexCount, size_t kVertexCount, const void* pCornerValues, size_t kValueSize, List<uint32_t>& VertexRemap) noexcept;
+
+	// The above on a vertex type with Float3 Position and Normal members, splitting vertices at creases
+	template<typename V>
+	static void GenerateNormals(List<V>& Vertices, List<uint32_t>& Indices, float CreaseAngle = DefaultCreaseAngle);
+
+	// Same for a vertex type that also has Float2 TexCoord and Float4 Tangent members, normals must already be set
+	template<typename V>
+	static void GenerateTangents(List<V>& Vertices, List<uint32_t>& Indices);
+
+private:
+	template<typename V, typename Tp>
+	static void ApplyCornerValues(List<V>& Vertices, List<uint32_t>& Indices, const List<Tp>& Values, Tp V::* pMember);
+};
+
+
+template<typename V, typename Tp>
+inline void TangentSpace::ApplyCornerValues(List<V>& Vertices, List<uint32_t>& Indices, const List<Tp>& Values, Tp V::* pMember)
+{
+	List<uint32_t> VertexRemap = {};
+	SplitVertices(Indices.data(), Indices.size(), Vertices.size(), Values.data(), sizeof(Tp), VertexRemap);
+
+	Vertices.reserve(VertexRemap.size());
+	for (size_t k = Vertices.size(); k < VertexRemap.size(); k++)
+	{
+		Vertices.emplace_back(Vertices[VertexRemap[k]]);
+	}
+	for (size_t k = 0u; k < Indices.size(); k++)
+	{
+		Vertices[Indices[k]].*pMember = Values[k];
+	}
+}
+
+template<typename V>
+inline void TangentSpace::GenerateNormals(List<V>& Vertices, List<uint32_t>& Indices, float CreaseAngle)
+{
+	if (Vertices.empty() || Indices.empty())
+	{
+		return;
+	}
+
+	List<Float3> Normals = List<Float3>(Indices.size());
+	ComputeCornerNormals(&Vertices[0].Position, sizeof(V), Vertices.size(), Indices.data(), Indices.size(), CreaseAngle, Normals.data());
+	ApplyCornerValues(Vertices, Indices, Normals, &V::Normal);
+}
+
+template<typename V>
+inline void TangentSpace::GenerateTangents(List<V>& Vertices, List<uint32_t>& Indices)
+{
+	if (Vertices.empty() || Indices.empty())
+	{
+		return;
+	}
+
+	List<Float4> Tangents = List<Float4>(Indices.size());
+	ComputeCornerTangents(&Vertices[0].Position, sizeof(V), &Vertices[0].Normal, sizeof(V), &Vertices[0].TexCoord, sizeof(V), Vertices.size(), Indices.data(), Indices.size(), Tangents.data());
+	ApplyCornerValues(Vertices, Indices, Tangents, &V::Tangent);
+}
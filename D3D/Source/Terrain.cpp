@@ -0,0 +1,529 @@
+#include "Terrain.h"
+
+#include <cfloat>
+#include <cmath>
+#include <string.h>
+
+static inline float Dot(const Float3& u, const Float3& v) noexcept
+{
+    return u.X * v.X + u.Y * v.Y + u.Z * v.Z;
+}
+
+static inline Float3 Scale(const Float3& u, float s) noexcept
+{
+    return Float3(u.X * s, u.Y * s, u.Z * s);
+}
+
+static inline Float3 Normalize(const Float3& u) noexcept
+{
+    const float Length = sqrtf(Dot(u, u));
+    return Length > 0.0f ? Scale(u, 1.0f / Length) : Float3(0.0f);
+}
+
+// First and last level 0 sample of a node along one axis, the last clamped to the map
+static inline uint32_t NodeFirstSample(uint32_t kPatchSize, uint32_t kLevel, uint32_t kNode) noexcept
+{
+    return (kNode * kPatchSize) << kLevel;
+}
+
+static inline uint32_t NodeLastSample(uint32_t kPatchSize, uint32_t kLevel, uint32_t kNode, uint32_t kSamples) noexcept
+{
+    return std::min(((kNode + 1u) * kPatchSize) << kLevel, kSamples - 1u);
+}
+
+static void GetNodeBox(const IHeightSource& Source, const TerrainSettings& Settings, const TerrainPatch& Node, Float3& Minimum, Float3& Maximum) noexcept
+{
+    const uint32_t        kPatchSize = Source.GetPatchSize();
+    const TerrainNodeInfo Info       = Source.GetNodeInfo(Node.Level, Node.X, Node.Y);
+
+    Minimum = Settings.Origin + Float3(
+        float(NodeFirstSample(kPatchSize, Node.Level, Node.X)) * Settings.SampleSpacing,
+        Info.MinHeight,
+        float(NodeFirstSample(kPatchSize, Node.Level, Node.Y)) * Settings.SampleSpacing);
+    Maximum = Settings.Origin + Float3(
+        float(NodeLastSample(kPatchSize, Node.Level, Node.X, Source.GetWidth())) * Settings.SampleSpacing,
+        Info.MaxHeight,
+        float(NodeLastSample(kPatchSize, Node.Level, Node.Y, Source.GetHeight())) * Settings.SampleSpacing);
+}
+
+// HEIGHT SOURCE
+uint32_t IHeightSource::GetLevelCount() const noexcept
+{
+    // Enough levels for a handful of roots to cover the map
+    const uint32_t kQuads  = std::max(std::max(GetWidth(), GetHeight()), 2u) - 1u;
+    uint32_t       kLevels = 1u;
+    while ((GetPatchSize() << (kLevels - 1u)) < kQuads)
+    {
+        kLevels++;
+    }
+    return kLevels;
+}
+
+uint32_t IHeightSource::GetNodeCountX(uint32_t kLevel) const noexcept
+{
+    const uint32_t kNodeQuads = GetPatchSize() << kLevel;
+    return std::max((std::max(GetWidth(), 2u) - 1u + kNodeQuads - 1u) / kNodeQuads, 1u);
+}
+
+uint32_t IHeightSource::GetNodeCountY(uint32_t kLevel) const noexcept
+{
+    const uint32_t kNodeQuads = GetPatchSize() << kLevel;
+    return std::max((std::max(GetHeight(), 2u) - 1u + kNodeQuads - 1u) / kNodeQuads, 1u);
+}
+
+GridHeightSource::GridHeightSource(uint32_t kWidth, uint32_t kHeight, uint32_t kPatchSize)
+    : m_Width(kWidth), m_Height(kHeight), m_PatchSize(kPatchSize)
+{
+    assert(kPatchSize >= 2u && (kPatchSize & (kPatchSize - 1u)) == 0u && "Patch size must be a power of two");
+}
+
+void GridHeightSource::BuildNodes() noexcept
+{
+    // Level 0 bounds straight from the samples, every level above from its children plus its own deviation from them
+    m_Nodes.resize(GetLevelCount());
+    for (uint32_t kLevel = 0u; kLevel < m_Nodes.size(); kLevel++)
+    {
+        const uint32_t kCountX = GetNodeCountX(kLevel);
+        const uint32_t kCountY = GetNodeCountY(kLevel);
+        const int64_t  kStride = int64_t(1) << kLevel;
+        m_Nodes[kLevel].resize(size_t(kCountX) * kCountY);
+
+        for (uint32_t y = 0u; y < kCountY; y++)
+        {
+            for (uint32_t x = 0u; x < kCountX; x++)
+            {
+                TerrainNodeInfo& Info = m_Nodes[kLevel][size_t(y) * kCountX + x];
+                if (kLevel == 0u)
+                {
+                    Info.MinHeight = FLT_MAX;
+                    Info.MaxHeight = -FLT_MAX;
+                    for (uint32_t sy = NodeFirstSample(m_PatchSize, 0u, y); sy <= NodeLastSample(m_PatchSize, 0u, y, m_Height); sy++)
+                    {
+                        for (uint32_t sx = NodeFirstSample(m_PatchSize, 0u, x); sx <= NodeLastSample(m_PatchSize, 0u, x, m_Width); sx++)
+                        {
+                            Info.MinHeight = std::min(Info.MinHeight, GetClampedSample(sx, sy));
+                            Info.MaxHeight = std::max(Info.MaxHeight, GetClampedSample(sx, sy));
+                        }
+                    }
+                    continue;
+                }
+
+                Info.MinHeight = FLT_MAX;
+                Info.MaxHeight = -FLT_MAX;
+                for (uint32_t k = 0u; k < 4u; k++)
+                {
+                    const uint32_t cx = 2u * x + (k & 1u);
+                    const uint32_t cy = 2u * y + (k >> 1u);
+                    if (cx < GetNodeCountX(kLevel - 1u) && cy < GetNodeCountY(kLevel - 1u))
+                    {
+                        const TerrainNodeInfo Child = GetNodeInfo(kLevel - 1u, cx, cy);
+                        Info.MinHeight = std::min(Info.MinHeight, Child.MinHeight);
+                        Info.MaxHeight = std::max(Info.MaxHeight, Child.MaxHeight);
+                        Info.Error     = std::max(Info.Error, Child.Error);
+                    }
+                }
+
+                // The finer level's extra samples against this level's triangles, split along (0, 0)-(1, 1)
+                float Deviation = 0.0f;
+                const int64_t kBaseX = int64_t(x) * m_PatchSize * kStride;
+                const int64_t kBaseY = int64_t(y) * m_PatchSize * kStride;
+                for (uint32_t j = 0u; j < m_PatchSize; j++)
+                {
+                    for (uint32_t i = 0u; i < m_PatchSize; i++)
+                    {
+                        const int64_t sx  = kBaseX + int64_t(i) * kStride;
+                        const int64_t sy  = kBaseY + int64_t(j) * kStride;
+                        const int64_t kHalf = kStride / 2;
+                        const float   h00 = GetClampedSample(sx, sy);
+                        const float   h10 = GetClampedSample(sx + kStride, sy);
+                        const float   h01 = GetClampedSample(sx, sy + kStride);
+                        const float   h11 = GetClampedSample(sx + kStride, sy + kStride);
+
+                        Deviation = std::max(Deviation, fabsf(GetClampedSample(sx + kHalf, sy) - 0.5f * (h00 + h10)));
+                        Deviation = std::max(Deviation, fabsf(GetClampedSample(sx, sy + kHalf) - 0.5f * (h00 + h01)));
+                        Deviation = std::max(Deviation, fabsf(GetClampedSample(sx + kHalf, sy + kHalf) - 0.5f * (h00 + h11)));
+                        Deviation = std::max(Deviation, fabsf(GetClampedSample(sx + kStride, sy + kHalf) - 0.5f * (h10 + h11)));
+                        Deviation = std::max(Deviation, fabsf(GetClampedSample(sx + kHalf, sy + kStride) - 0.5f * (h01 + h11)));
+                    }
+                }
+                Info.Error += Deviation;
+            }
+        }
+    }
+}
+
+TerrainNodeInfo GridHeightSource::GetNodeInfo(uint32_t kLevel, uint32_t x, uint32_t y) const noexcept
+{
+    return m_Nodes[kLevel][size_t(y) * GetNodeCountX(kLevel) + x];
+}
+
+void GridHeightSource::ReadTile(uint32_t kLevel, uint32_t x, uint32_t y, float* pHeights) const noexcept
+{
+    const int64_t kStride = int64_t(1) << kLevel;
+    const int64_t kBaseX  = int64_t(NodeFirstSample(m_PatchSize, kLevel, x)) - kStride;
+    const int64_t kBaseY  = int64_t(NodeFirstSample(m_PatchSize, kLevel, y)) - kStride;
+    const int64_t kSide   = int64_t(m_PatchSize) + 3;
+    for (int64_t j = 0; j < kSide; j++)
+    {
+        for (int64_t i = 0; i < kSide; i++)
+        {
+            *pHeights++ = GetClampedSample(kBaseX + i * kStride, kBaseY + j * kStride);
+        }
+    }
+}
+
+float GridHeightSource::GetClampedSample(int64_t x, int64_t y) const noexcept
+{
+    return GetSample(uint32_t(std::clamp<int64_t>(x, 0, int64_t(m_Width) - 1)), uint32_t(std::clamp<int64_t>(y, 0, int64_t(m_Height) - 1)));
+}
+
+ImageHeightSource::ImageHeightSource(const Image& Heightmap, float HeightScale, uint32_t kPatchSize)
+    : GridHeightSource(Heightmap.GetWidth(), Heightmap.GetHeight(), kPatchSize), m_Scale(HeightScale / 255.0f)
+{
+    const Pixel* pPixels = Heightmap.GetBufferPointer();
+    m_Samples.resize(size_t(GetWidth()) * GetHeight());
+    for (size_t k = 0u; k < m_Samples.size(); k++)
+    {
+        m_Samples[k] = pPixels[k].Red;
+    }
+    BuildNodes();
+}
+
+float ImageHeightSource::GetSample(uint32_t x, uint32_t y) const noexcept
+{
+    return float(m_Samples[size_t(y) * GetWidth() + x]) * m_Scale;
+}
+
+RawHeightSource::RawHeightSource(const char* lpFilepath, uint32_t kWidth, uint32_t kHeight, float HeightScale, uint32_t kPatchSize)
+    : GridHeightSource(kWidth, kHeight, kPatchSize), m_File(lpFilepath), m_Scale(HeightScale / 65535.0f)
+{
+    if (m_File.GetSize() != size_t(kWidth) * kHeight * sizeof(uint16_t))
+    {
+        m_File.Close();
+    }
+    BuildNodes();
+}
+
+bool RawHeightSource::IsOpen() const noexcept
+{
+    return m_File.IsOpen();
+}
+
+float RawHeightSource::GetSample(uint32_t x, uint32_t y) const noexcept
+{
+    if (!m_File.IsOpen())
+    {
+        return 0.0f;
+    }
+
+    // Little endian, like every platform we build for
+    uint16_t kSample = 0u;
+    memcpy(&kSample, m_File.GetData() + (size_t(y) * GetWidth() + x) * sizeof(uint16_t), sizeof(kSample));
+    return float(kSample) * m_Scale;
+}
+
+// SELECTION
+void TerrainLod::Balance(const IHeightSource& Source, List<TerrainPatch>& Patches) noexcept
+{
+    static constexpr int32_t s_Directions[4][2] = { { -1, 0 }, { 1, 0 }, { 0, -1 }, { 0, 1 } }; // Stitch bit order
+
+    const uint32_t kRootLevel = Source.GetLevelCount() - 1u;
+    const auto     Neighbour  = [&](const TerrainPatch& Patch, uint32_t kDirection, uint32_t& nx, uint32_t& ny)
+    {
+        const int64_t x = int64_t(Patch.X) + s_Directions[kDirection][0];
+        const int64_t y = int64_t(Patch.Y) + s_Directions[kDirection][1];
+        nx = uint32_t(x);
+        ny = uint32_t(y);
+        return x >= 0 && y >= 0 && nx < Source.GetNodeCountX(Patch.Level) && ny < Source.GetNodeCountY(Patch.Level);
+    };
+
+    Dictionary<uint64_t, size_t> Leaves = {};
+    List<size_t>                 Work   = {};
+    for (size_t k = 0u; k < Patches.size(); k++)
+    {
+        Leaves.emplace(Patches[k].GetKey(), k);
+        Work.push_back(k);
+    }
+
+    // A leaf two or more levels coarser than a neighbour is split, its children are checked in turn. Finer
+    // neighbours are left to the finer side, so each seam is looked at once.
+    while (!Work.empty())
+    {
+        const size_t       kPatch = Work.back();
+        const TerrainPatch Patch  = Patches[kPatch];
+        Work.pop_back();
+        if (Leaves.count(Patch.GetKey()) == 0u)
+        {
+            continue;
+        }
+
+        for (uint32_t kDirection = 0u; kDirection < 4u; kDirection++)
+        {
+            uint32_t nx = 0u;
+            uint32_t ny = 0u;
+            if (!Neighbour(Patch, kDirection, nx, ny))
+            {
+                continue;
+            }
+
+            auto itCoarse = Leaves.end();
+            for (uint32_t kLevel = Patch.Level + 2u; kLevel <= kRootLevel && itCoarse == Leaves.end(); kLevel++)
+            {
+                const uint32_t kShift = kLevel - Patch.Level;
+                itCoarse = Leaves.find(TerrainPatch{ kLevel, nx >> kShift, ny >> kShift, 0u }.GetKey());
+            }
+            if (itCoarse == Leaves.end())
+            {
+                continue;
+            }
+
+            const TerrainPatch Coarse = Patches[itCoarse->second];
+            Leaves.erase(itCoarse);
+            for (uint32_t k = 0u; k < 4u; k++)
+            {
+                const TerrainPatch Child = { Coarse.Level - 1u, 2u * Coarse.X + (k & 1u), 2u * Coarse.Y + (k >> 1u), 0u };
+                if (Child.X < Source.GetNodeCountX(Child.Level) && Child.Y < Source.GetNodeCountY(Child.Level))
+                {
+                    Leaves.emplace(Child.GetKey(), Patches.size());
+                    Work.push_back(Patches.size());
+                    Patches.push_back(Child);
+                }
+            }
+
+            // The split may still leave that neighbour too coarse
+            Work.push_back(kPatch);
+            break;
+        }
+    }
+
+    size_t kKept = 0u;
+    for (size_t k = 0u; k < Patches.size(); k++)
+    {
+        const auto it = Leaves.find(Patches[k].GetKey());
+        if (it != Leaves.end() && it->second == k)
+        {
+            Patches[kKept++] = Patches[k];
+        }
+    }
+    Patches.resize(kKept);
+
+    for (TerrainPatch& Patch : Patches)
+    {
+        Patch.Stitch = 0u;
+        for (uint32_t kDirection = 0u; kDirection < 4u; kDirection++)
+        {
+            uint32_t nx = 0u;
+            uint32_t ny = 0u;
+            if (Patch.Level < kRootLevel && Neighbour(Patch, kDirection, nx, ny) &&
+                Leaves.count(TerrainPatch{ Patch.Level + 1u, nx >> 1u, ny >> 1u, 0u }.GetKey()) != 0u)
+            {
+                Patch.Stitch |= uint8_t(1u << kDirection);
+            }
+        }
+    }
+}
+
+BoundingSphere TerrainLod::GetBounds(const IHeightSource& Source, const TerrainSettings& Settings, const TerrainPatch& Node) noexcept
+{
+    Float3 Minimum = {};
+    Float3 Maximum = {};
+    GetNodeBox(Source, Settings, Node, Minimum, Maximum);
+
+    const Float3 Half = (Maximum - Minimum) * Float3(0.5f);
+    return BoundingSphere{ Minimum + Half, sqrtf(Dot(Half, Half)) };
+}
+
+float TerrainLod::ProjectedError(const IHeightSource& Source, const TerrainSettings& Settings, const TerrainView& View, const TerrainPatch& Node) noexcept
+{
+    Float3 Minimum = {};
+    Float3 Maximum = {};
+    GetNodeBox(Source, Settings, Node, Minimum, Maximum);
+
+    const Float3 Closest = Float3(
+        std::clamp(View.CameraPosition.X, Minimum.X, Maximum.X),
+        std::clamp(View.CameraPosition.Y, Minimum.Y, Maximum.Y),
+        std::clamp(View.CameraPosition.Z, Minimum.Z, Maximum.Z));
+    const Float3 Offset   = View.CameraPosition - Closest;
+    const float  Distance = sqrtf(Dot(Offset, Offset));
+
+    const float Error = Source.GetNodeInfo(Node.Level, Node.X, Node.Y).Error;
+    return Distance > 0.0f ? Error * View.PixelsPerUnit / Distance : (Error > 0.0f ? FLT_MAX : 0.0f);
+}
+
+bool TerrainLod::IsVisible(const IHeightSource& Source, const TerrainSettings& Settings, const TerrainView& View, const TerrainPatch& Node) noexcept
+{
+    Float3 Minimum = {};
+    Float3 Maximum = {};
+    GetNodeBox(Source, Settings, Node, Minimum, Maximum);
+
+    // Outside once the box corner furthest along a plane's normal is behind it
+    for (const Float4& Plane : View.Planes)
+    {
+        const Float3 Corner = Float3(
+            Plane.X >= 0.0f ? Maximum.X : Minimum.X,
+            Plane.Y >= 0.0f ? Maximum.Y : Minimum.Y,
+            Plane.Z >= 0.0f ? Maximum.Z : Minimum.Z);
+        if (Dot(Float3(Plane.X, Plane.Y, Plane.Z), Corner) + Plane.W < 0.0f)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+// PATCHES
+void TerrainLod::BuildPatternIndices(uint32_t kPatchSize, uint8_t kStitch, List<uint16_t>& Indices) noexcept
+{
+    assert((kPatchSize + 1u) * (kPatchSize + 1u) <= 65536u && "Patch vertices must fit 16 bit indices");
+
+    // Odd vertices of a stitched edge fold onto the even vertex before them, which leaves exactly the coarser
+    // neighbour's edge. The triangles that collapse are dropped.
+    const auto Index = [&](uint32_t i, uint32_t j)
+    {
+        if ((kStitch & TerrainPatch::StitchWest) && i == 0u && (j & 1u))               j--;
+        if ((kStitch & TerrainPatch::StitchEast) && i == kPatchSize && (j & 1u))       j--;
+        if ((kStitch & TerrainPatch::StitchSouth) && j == 0u && (i & 1u))              i--;
+        if ((kStitch & TerrainPatch::StitchNorth) && j == kPatchSize && (i & 1u))      i--;
+        return uint16_t(j * (kPatchSize + 1u) + i);
+    };
+    const auto Emit = [&](uint16_t a, uint16_t b, uint16_t c)
+    {
+        if (a != b && b != c && c != a)
+        {
+            Indices.push_back(a);
+            Indices.push_back(b);
+            Indices.push_back(c);
+        }
+    };
+
+    Indices.clear();
+    Indices.reserve(size_t(kPatchSize) * kPatchSize * 6u);
+    for (uint32_t j = 0u; j < kPatchSize; j++)
+    {
+        for (uint32_t i = 0u; i < kPatchSize; i++)
+        {
+            // Facing up, split along the same diagonal the node errors were measured against
+            Emit(Index(i, j), Index(i + 1u, j + 1u), Index(i + 1u, j));
+            Emit(Index(i, j), Index(i, j + 1u), Index(i + 1u, j + 1u));
+        }
+    }
+}
+
+void TerrainLod::BuildTile(const IHeightSource& Source, const TerrainSettings& Settings, const TerrainPatch& Node, TerrainTile& Tile) noexcept
+{
+    const uint32_t kPatchSize = Source.GetPatchSize();
+    const uint32_t kSide      = kPatchSize + 3u;
+    const uint32_t kStride    = 1u << Node.Level;
+
+    List<float> Heights = List<float>(size_t(kSide) * kSide);
+    Source.ReadTile(Node.Level, Node.X, Node.Y, Heights.data());
+    const auto Height = [&](uint32_t i, uint32_t j) { return Heights[size_t(j + 1u) * kSide + (i + 1u)]; };
+
+    Tile.Positions.resize(size_t(kPatchSize + 1u) * (kPatchSize + 1u));
+    Tile.Normals.resize(Tile.Positions.size());
+
+    // Vertices past the map's edge sit on it, like their clamped heights
+    const uint32_t kFirstX    = NodeFirstSample(kPatchSize, Node.Level, Node.X);
+    const uint32_t kFirstY    = NodeFirstSample(kPatchSize, Node.Level, Node.Y);
+    const float    InvSpacing = 0.5f / (float(kStride) * Settings.SampleSpacing);
+    for (uint32_t j = 0u; j <= kPatchSize; j++)
+    {
+        for (uint32_t i = 0u; i <= kPatchSize; i++)
+        {
+            const uint32_t sx = std::min(kFirstX + i * kStride, Source.GetWidth() - 1u);
+            const uint32_t sy = std::min(kFirstY + j * kStride, Source.GetHeight() - 1u);
+            const size_t   k  = size_t(j) * (kPatchSize + 1u) + i;
+
+            Tile.Positions[k] = Settings.Origin + Float3(float(sx) * Settings.SampleSpacing, Height(i, j), float(sy) * Settings.SampleSpacing);
+
+            const float dx = (Height(i + 1u, j) - Height(i - 1u, j)) * InvSpacing;
+            const float dz = (Height(i, j + 1u) - Height(i, j - 1u)) * InvSpacing;
+            Tile.Normals[k] = Normalize(Float3(-dx, 1.0f, -dz));
+        }
+    }
+}
+
+// STREAMING
+TerrainStream::TerrainStream(const std::shared_ptr<IHeightSource>& Source, const TerrainSettings& Settings)
+    : m_Source(Source), m_Settings(Settings)
+{
+    m_Loader = std::thread(&TerrainStream::LoaderMain, this);
+}
+
+TerrainStream::~TerrainStream() noexcept
+{
+    {
+        std::lock_guard<std::mutex> Lock = std::lock_guard<std::mutex>(m_Mutex);
+        m_bStopping = true;
+    }
+    m_Wake.notify_all();
+    m_Loader.join();
+}
+
+const IHeightSource& TerrainStream::GetSource() const noexcept
+{
+    return *m_Source;
+}
+
+void TerrainStream::Request(const List<TerrainPatch>& Nodes) noexcept
+{
+    {
+        std::lock_guard<std::mutex> Lock = std::lock_guard<std::mutex>(m_Mutex);
+        m_Queue.clear();
+        for (auto it = Nodes.rbegin(); it != Nodes.rend(); ++it)
+        {
+            const uint64_t kNode   = it->GetKey();
+            const bool     bLoaded = std::any_of(m_Loaded.begin(), m_Loaded.end(), [&](const LoadedTile& Loaded) { return Loaded.Node.GetKey() == kNode; });
+            if (kNode != m_InFlight && !bLoaded)
+            {
+                m_Queue.push_back(*it);
+            }
+        }
+    }
+    m_Wake.notify_one();
+}
+
+void TerrainStream::TakeLoaded(List<LoadedTile>& Loaded) noexcept
+{
+    std::lock_guard<std::mutex> Lock = std::lock_guard<std::mutex>(m_Mutex);
+    for (LoadedTile& Tile : m_Loaded)
+    {
+        Loaded.emplace_back(std::move(Tile));
+    }
+    m_Loaded.clear();
+}
+
+void TerrainStream::Flush() noexcept
+{
+    std::unique_lock<std::mutex> Lock = std::unique_lock<std::mutex>(m_Mutex);
+    m_Idle.wait(Lock, [this]() { return m_Queue.empty() && m_InFlight == UINT64_MAX; });
+}
+
+void TerrainStream::LoaderMain() noexcept
+{
+    std::unique_lock<std::mutex> Lock = std::unique_lock<std::mutex>(m_Mutex);
+    while (true)
+    {
+        m_Wake.wait(Lock, [this]() { return m_bStopping || !m_Queue.empty(); });
+        if (m_bStopping)
+        {
+            break;
+        }
+
+        LoadedTile Loaded = {};
+        Loaded.Node = m_Queue.back();
+        m_InFlight  = Loaded.Node.GetKey();
+        m_Queue.pop_back();
+        Lock.unlock();
+
+        TerrainLod::BuildTile(*m_Source, m_Settings, Loaded.Node, Loaded.Tile);
+
+        Lock.lock();
+        m_Loaded.emplace_back(std::move(Loaded));
+        m_InFlight = UINT64_MAX;
+        if (m_Queue.empty())
+        {
+            m_Idle.notify_all();
+        }
+    }
+}
@@ -0,0 +1,279 @@
+#pragma once
+
+#include "Core.h"
+#include "File.h"
+#include "Image.h"
+#include "MeshOptimizer.h"
+
+#include <algorithm>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+// Terrain nodes form a quadtree over the height samples. A node at level l has PatchSize quads along each side spaced
+// 2^l samples apart, so level 0 is full resolution and every node, at any level, is the same grid of vertices.
+struct TerrainNodeInfo
+{
+	float MinHeight = 0.0f;
+	float MaxHeight = 0.0f;
+	float Error     = 0.0f; // Largest height difference to the full resolution surface
+};
+
+// Heights at every level, point sampled so a coarse node's vertices are exactly the fine nodes' even vertices.
+// Implementations can read tiles from anywhere, terrain only ever asks for the nodes it is about to draw. Tiles are
+// read on the terrain's loader thread while node info is asked for on the main thread.
+class IHeightSource
+{
+public:
+	virtual ~IHeightSource() = default;
+
+	virtual uint32_t        GetWidth() const noexcept = 0;     // Samples
+	virtual uint32_t        GetHeight() const noexcept = 0;
+	virtual uint32_t        GetPatchSize() const noexcept = 0; // Quads along a node's side, a power of two
+	virtual TerrainNodeInfo GetNodeInfo(uint32_t kLevel, uint32_t x, uint32_t y) const noexcept = 0;
+
+	// (PatchSize + 3)^2 heights, row by row, from one sample before the node to one after it, clamped to the edges
+	virtual void ReadTile(uint32_t kLevel, uint32_t x, uint32_t y, float* pHeights) const noexcept = 0;
+
+	uint32_t GetLevelCount() const noexcept;
+	uint32_t GetNodeCountX(uint32_t kLevel) const noexcept;
+	uint32_t GetNodeCountY(uint32_t kLevel) const noexcept;
+};
+
+// Heights on a grid of samples, clamped to its edges. Node bounds and errors are computed up front for every level,
+// tiles are read from the samples when asked for.
+class GridHeightSource : public IHeightSource
+{
+public:
+	virtual uint32_t        GetWidth() const noexcept override     { return m_Width; }
+	virtual uint32_t        GetHeight() const noexcept override    { return m_Height; }
+	virtual uint32_t        GetPatchSize() const noexcept override { return m_PatchSize; }
+	virtual TerrainNodeInfo GetNodeInfo(uint32_t kLevel, uint32_t x, uint32_t y) const noexcept override;
+	virtual void            ReadTile(uint32_t kLevel, uint32_t x, uint32_t y, float* pHeights) const noexcept override;
+
+protected:
+	GridHeightSource(uint32_t kWidth, uint32_t kHeight, uint32_t kPatchSize);
+
+	// Called by the derived constructor once its samples can be read
+	void          BuildNodes() noexcept;
+	virtual float GetSample(uint32_t x, uint32_t y) const noexcept = 0;
+
+private:
+	float GetClampedSample(int64_t x, int64_t y) const noexcept;
+
+private:
+	List<List<TerrainNodeInfo>> m_Nodes     = {}; // Per level, row by row
+	uint32_t                    m_Width     = 0u;
+	uint32_t                    m_Height    = 0u;
+	uint32_t                    m_PatchSize = 32u;
+};
+
+// The red channel of an image, kept as the 8 bit values it came as rather than decoded to floats
+class ImageHeightSource : public GridHeightSource
+{
+public:
+	ImageHeightSource(const Image& Heightmap, float HeightScale, uint32_t kPatchSize = 32u);
+
+protected:
+	virtual float GetSample(uint32_t x, uint32_t y) const noexcept override;
+
+private:
+	List<uint8_t> m_Samples = {};
+	float         m_Scale   = 1.0f;
+};
+
+// Raw 16 bit heights, row by row, the way terrain tools export them. The file is mapped rather than read, so only the
+// pages under the tiles being built need to be in memory and they are faulted in on the terrain's loader thread.
+// A file of the wrong size is left closed and reads as flat.
+class RawHeightSource : public GridHeightSource
+{
+public:
+	RawHeightSource(const char* lpFilepath, uint32_t kWidth, uint32_t kHeight, float HeightScale, uint32_t kPatchSize = 32u);
+
+	bool IsOpen() const noexcept;
+
+protected:
+	virtual float GetSample(uint32_t x, uint32_t y) const noexcept override;
+
+private:
+	MappedFile m_File  = {};
+	float      m_Scale = 1.0f;
+};
+
+struct TerrainSettings
+{
+	Float3 Origin        = {};   // World position of sample (0, 0), X and Z follow the sample columns and rows
+	float  SampleSpacing = 1.0f; // World units between level 0 samples
+};
+
+struct TerrainView
+{
+	Float4   Planes[6]      = {};   // (n, d) with dot(n, p) + d >= 0 inside, in world space
+	Float3   CameraPosition = {};
+	float    PixelsPerUnit  = 1.0f; // Pixels a unit covers at a distance of one
+	float    MaxError       = 2.0f; // Pixels
+	uint32_t MaxPatches     = 512u; // Refinement stops here, balancing can add a few more
+};
+
+struct TerrainPatch
+{
+	static constexpr uint8_t StitchWest  = 1u; // Edge next to a coarser patch, drawn without its odd vertices
+	static constexpr uint8_t StitchEast  = 2u;
+	static constexpr uint8_t StitchSouth = 4u;
+	static constexpr uint8_t StitchNorth = 8u;
+	static constexpr uint32_t PatternCount = 16u;
+
+	uint32_t Level  = 0u;
+	uint32_t X      = 0u;
+	uint32_t Y      = 0u;
+	uint8_t  Stitch = 0u;
+
+	uint64_t GetKey() const noexcept { return uint64_t(Level) << 56u | uint64_t(X) << 28u | uint64_t(Y); }
+};
+
+// Node vertices in world space, (PatchSize + 1)^2 of them row by row
+struct TerrainTile
+{
+	List<Float3> Positions = {};
+	List<Float3> Normals   = {};
+};
+
+// Geomipmapping (de Boer 2000) on a restricted quadtree. Nodes are refined while their error projects to more than
+// MaxError pixels, then split further until neighbouring patches are at most one level apart, so every seam is
+// closed by dropping the odd vertices on the finer side. One index pattern per combination of stitched edges serves
+// every patch.
+class TerrainLod
+{
+public:
+	// Patches to draw and nodes to load, most wanted first. A node is only refined once IsResident(Key) holds for
+	// all its children, otherwise its children are requested. Roots and the children the balancing splits into are
+	// selected whether resident or not, the caller has to load them before it can draw the selection.
+	template<typename Fn>
+	static void Select(const IHeightSource& Source, const TerrainSettings& Settings, const TerrainView& View, Fn&& IsResident, List<TerrainPatch>& Patches, List<TerrainPatch>& Requests);
+
+	// Splits patches until no two neighbours are more than a level apart and sets the stitched edges
+	static void Balance(const IHeightSource& Source, List<TerrainPatch>& Patches) noexcept;
+
+	static void BuildPatternIndices(uint32_t kPatchSize, uint8_t kStitch, List<uint16_t>& Indices) noexcept;
+	static void BuildTile(const IHeightSource& Source, const TerrainSettings& Settings, const TerrainPatch& Node, TerrainTile& Tile) noexcept;
+
+	static BoundingSphere GetBounds(const IHeightSource& Source, const TerrainSettings& Settings, const TerrainPatch& Node) noexcept;
+	// Error in pixels at the closest point of the node's bounds, infinite inside them
+	static float          ProjectedError(const IHeightSource& Source, const TerrainSettings& Settings, const TerrainView& View, const TerrainPatch& Node) noexcept;
+	static bool           IsVisible(const IHeightSource& Source, const TerrainSettings& Settings, const TerrainView& View, const TerrainPatch& Node) noexcept;
+};
+
+// Tiles built on a background thread, the way PointCloudStream reads nodes, so the main thread only uploads them
+class TerrainStream
+{
+public:
+	struct LoadedTile
+	{
+		TerrainPatch Node = {};
+		TerrainTile  Tile = {};
+	};
+
+public:
+	TerrainStream(const std::shared_ptr<IHeightSource>& Source, const TerrainSettings& Settings);
+	~TerrainStream() noexcept;
+
+	const IHeightSource& GetSource() const noexcept;
+
+	// Replaces the queued requests, tiles are built in the given order. Tiles already being built are not built again.
+	void Request(const List<TerrainPatch>& Nodes) noexcept;
+	// Moves the tiles built since the last call to the end of Loaded
+	void TakeLoaded(List<LoadedTile>& Loaded) noexcept;
+	// Blocks until the queue is empty and nothing is being built
+	void Flush() noexcept;
+
+private:
+	TerrainStream(const TerrainStream&) = delete;
+	TerrainStream& operator=(const TerrainStream&) = delete;
+
+	void LoaderMain() noexcept;
+
+private:
+	std::shared_ptr<IHeightSource> m_Source   = nullptr;
+	TerrainSettings                m_Settings = {};
+
+	std::thread             m_Loader    = {};
+	std::mutex              m_Mutex     = {};
+	std::condition_variable m_Wake      = {};
+	std::condition_variable m_Idle      = {};
+	List<TerrainPatch>      m_Queue     = {}; // Reversed, the next node is at the back
+	List<LoadedTile>        m_Loaded    = {};
+	uint64_t                m_InFlight  = UINT64_MAX; // Key of the node being built
+	bool                    m_bStopping = false;
+};
+
+
+template<typename Fn>
+inline void TerrainLod::Select(const IHeightSource& Source, const TerrainSettings& Settings, const TerrainView& View, Fn&& IsResident, List<TerrainPatch>& Patches, List<TerrainPatch>& Requests)
+{
+	Patches.clear();
+	Requests.clear();
+
+	// Largest projected error on top, so the patch budget goes where it shows the most
+	List<std::pair<float, TerrainPatch>> Heap = {};
+	const auto Push = [&](const TerrainPatch& Node)
+	{
+		if (IsVisible(Source, Settings, View, Node))
+		{
+			Heap.emplace_back(ProjectedError(Source, Settings, View, Node), Node);
+			std::push_heap(Heap.begin(), Heap.end(), [](const auto& a, const auto& b) { return a.first < b.first; });
+		}
+	};
+
+	// Roots are selected whether resident or not
+	const uint32_t kRootLevel = Source.GetLevelCount() - 1u;
+	for (uint32_t y = 0u; y < Source.GetNodeCountY(kRootLevel); y++)
+	{
+		for (uint32_t x = 0u; x < Source.GetNodeCountX(kRootLevel); x++)
+		{
+			Push({ kRootLevel, x, y, 0u });
+		}
+	}
+
+	while (!Heap.empty())
+	{
+		std::pop_heap(Heap.begin(), Heap.end(), [](const auto& a, const auto& b) { return a.first < b.first; });
+		const auto[Error, Node] = Heap.back();
+		Heap.pop_back();
+
+		if (Node.Level == 0u || Error <= View.MaxError || Patches.size() + Heap.size() + 4u > View.MaxPatches)
+		{
+			Patches.push_back(Node);
+			continue;
+		}
+
+		TerrainPatch Children[4] = {};
+		uint32_t     kChildren   = 0u;
+		bool         bResident   = true;
+		for (uint32_t k = 0u; k < 4u; k++)
+		{
+			const TerrainPatch Child = { Node.Level - 1u, 2u * Node.X + (k & 1u), 2u * Node.Y + (k >> 1u), 0u };
+			if (Child.X < Source.GetNodeCountX(Child.Level) && Child.Y < Source.GetNodeCountY(Child.Level))
+			{
+				Children[kChildren++] = Child;
+				if (!IsResident(Child.GetKey()))
+				{
+					bResident = false;
+					Requests.push_back(Child);
+				}
+			}
+		}
+
+		if (!bResident)
+		{
+			Patches.push_back(Node);
+			continue;
+		}
+		for (uint32_t k = 0u; k < kChildren; k++)
+		{
+			Push(Children[k]);
+		}
+	}
+
+	Balance(Source, Patches);
+}
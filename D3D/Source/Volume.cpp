@@ -0,0 +1,432 @@
+#include "Volume.h"
+
+#include <cmath>
+
+// Dirty keys are collapsed once this many have piled up between re-meshes
+static constexpr size_t s_DirtyCompactThreshold = 4096u;
+
+static inline float Dot(const Float3& u, const Float3& v) noexcept
+{
+    return u.X * v.X + u.Y * v.Y + u.Z * v.Z;
+}
+
+static inline Float3 Scale(const Float3& u, float s) noexcept
+{
+    return Float3(u.X * s, u.Y * s, u.Z * s);
+}
+
+static inline Float3 Normalize(const Float3& u) noexcept
+{
+    const float Length = sqrtf(Dot(u, u));
+    return Length > 0.0f ? Scale(u, 1.0f / Length) : Float3(0.0f);
+}
+
+static inline size_t SampleIndex(int32_t x, int32_t y, int32_t z) noexcept
+{
+    return (size_t(z) * Volume::ChunkSize + size_t(y)) * Volume::ChunkSize + size_t(x);
+}
+
+static void SortUnique(List<uint64_t>& Keys) noexcept
+{
+    std::sort(Keys.begin(), Keys.end());
+    Keys.erase(std::unique(Keys.begin(), Keys.end()), Keys.end());
+}
+
+// VOLUME
+Volume::Volume(float VoxelSize, const Float3& Origin, float Background) noexcept
+    : m_VoxelSize(VoxelSize), m_Origin(Origin), m_Background(Background)
+{
+}
+
+float Volume::Get(int32_t x, int32_t y, int32_t z) const noexcept
+{
+    const int32_t cx = FloorDiv(x);
+    const int32_t cy = FloorDiv(y);
+    const int32_t cz = FloorDiv(z);
+
+    const float* pChunk = GetChunk(PackChunk(cx, cy, cz));
+    return pChunk ? pChunk[SampleIndex(x - cx * ChunkSize, y - cy * ChunkSize, z - cz * ChunkSize)] : m_Background;
+}
+
+void Volume::Set(int32_t x, int32_t y, int32_t z, float Value) noexcept
+{
+    const int32_t  cx     = FloorDiv(x);
+    const int32_t  cy     = FloorDiv(y);
+    const int32_t  cz     = FloorDiv(z);
+    const uint64_t kChunk = PackChunk(cx, cy, cz);
+
+    // Background written outside of any chunk changes nothing
+    if (Value == m_Background && GetChunk(kChunk) == nullptr)
+    {
+        return;
+    }
+
+    float& Sample = GetOrCreateChunk(kChunk)[SampleIndex(x - cx * ChunkSize, y - cy * ChunkSize, z - cz * ChunkSize)];
+    if (Sample != Value)
+    {
+        Sample = Value;
+        MarkDirty({ x, y, z }, { x, y, z });
+    }
+}
+
+void Volume::SetDense(const VoxelCoord& Corner, uint32_t kSizeX, uint32_t kSizeY, uint32_t kSizeZ, const float* pSamples) noexcept
+{
+    if (kSizeX == 0u || kSizeY == 0u || kSizeZ == 0u)
+    {
+        return;
+    }
+
+    for (uint32_t z = 0u; z < kSizeZ; z++)
+    {
+        for (uint32_t y = 0u; y < kSizeY; y++)
+        {
+            const float* pRow = pSamples + (size_t(z) * kSizeY + y) * kSizeX;
+            for (uint32_t x = 0u; x < kSizeX;)
+            {
+                const int32_t gx = Corner.X + int32_t(x);
+                const int32_t gy = Corner.Y + int32_t(y);
+                const int32_t gz = Corner.Z + int32_t(z);
+                const int32_t cx = FloorDiv(gx);
+                const int32_t cy = FloorDiv(gy);
+                const int32_t cz = FloorDiv(gz);
+
+                float* const   pChunk = GetOrCreateChunk(PackChunk(cx, cy, cz));
+                const int32_t  lx     = gx - cx * ChunkSize;
+                const uint32_t kRun   = std::min(kSizeX - x, uint32_t(ChunkSize - lx));
+                std::copy(pRow + x, pRow + x + kRun, pChunk + SampleIndex(lx, gy - cy * ChunkSize, gz - cz * ChunkSize));
+                x += kRun;
+            }
+        }
+    }
+
+    MarkDirty(Corner, { Corner.X + int32_t(kSizeX) - 1, Corner.Y + int32_t(kSizeY) - 1, Corner.Z + int32_t(kSizeZ) - 1 });
+}
+
+List<uint64_t> Volume::TakeDirtyChunks() noexcept
+{
+    List<uint64_t> Dirty = {};
+    Dirty.swap(m_DirtyChunks);
+    SortUnique(Dirty);
+    return Dirty;
+}
+
+bool Volume::HasDirtyChunks() const noexcept
+{
+    return !m_DirtyChunks.empty();
+}
+
+const float* Volume::GetChunk(uint64_t kChunk) const noexcept
+{
+    const auto it = m_Chunks.find(kChunk);
+    return it == m_Chunks.end() ? nullptr : it->second.data();
+}
+
+size_t Volume::GetChunkCount() const noexcept
+{
+    return m_Chunks.size();
+}
+
+Float3 Volume::GetPosition(int32_t x, int32_t y, int32_t z) const noexcept
+{
+    return m_Origin + Scale(Float3(float(x), float(y), float(z)), m_VoxelSize);
+}
+
+uint64_t Volume::PackChunk(int32_t x, int32_t y, int32_t z) noexcept
+{
+    return  uint64_t(uint32_t(x) & 0x1FFFFFu) |
+           (uint64_t(uint32_t(y) & 0x1FFFFFu) << 21u) |
+           (uint64_t(uint32_t(z) & 0x1FFFFFu) << 42u);
+}
+
+VoxelCoord Volume::UnpackChunk(uint64_t kChunk) noexcept
+{
+    // Shifting the 21 bits to the top and back sign extends them
+    return
+    {
+        int32_t(uint32_t(kChunk)          << 11u) >> 11,
+        int32_t(uint32_t(kChunk >> 21u)   << 11u) >> 11,
+        int32_t(uint32_t(kChunk >> 42u)   << 11u) >> 11,
+    };
+}
+
+float* Volume::GetOrCreateChunk(uint64_t kChunk) noexcept
+{
+    List<float>& Samples = m_Chunks[kChunk];
+    if (Samples.empty())
+    {
+        Samples.assign(ChunkVolume, m_Background);
+    }
+    return Samples.data();
+}
+
+void Volume::MarkDirty(const VoxelCoord& Minimum, const VoxelCoord& Maximum) noexcept
+{
+    // A sample is a corner of the cells one below it, whose vertices the quads of the edges one below those use, and
+    // chunks reach one cell into the chunk below
+    for (int32_t cz = FloorDiv(Minimum.Z - 1); cz <= FloorDiv(Maximum.Z + 1); cz++)
+    {
+        for (int32_t cy = FloorDiv(Minimum.Y - 1); cy <= FloorDiv(Maximum.Y + 1); cy++)
+        {
+            for (int32_t cx = FloorDiv(Minimum.X - 1); cx <= FloorDiv(Maximum.X + 1); cx++)
+            {
+                const uint64_t kChunk = PackChunk(cx, cy, cz);
+                if (m_DirtyChunks.empty() || m_DirtyChunks.back() != kChunk)
+                {
+                    m_DirtyChunks.emplace_back(kChunk);
+                }
+            }
+        }
+    }
+
+    if (m_DirtyChunks.size() > s_DirtyCompactThreshold)
+    {
+        SortUnique(m_DirtyChunks);
+    }
+}
+
+// MESHING
+// Samples of a chunk and one more on every side, [-1, ChunkSize] along each axis
+static constexpr int32_t s_ApronSize = Volume::ChunkSize + 2;
+// Cells with a vertex, [-1, ChunkSize) along each axis
+static constexpr int32_t s_CellSpan  = Volume::ChunkSize + 1;
+
+static constexpr int32_t s_CornerOffsets[8][3] =
+{
+    { 0, 0, 0 }, { 1, 0, 0 }, { 0, 1, 0 }, { 1, 1, 0 },
+    { 0, 0, 1 }, { 1, 0, 1 }, { 0, 1, 1 }, { 1, 1, 1 },
+};
+
+static constexpr uint8_t s_CellEdges[12][2] =
+{
+    { 0, 1 }, { 2, 3 }, { 4, 5 }, { 6, 7 }, // Along X
+    { 0, 2 }, { 1, 3 }, { 4, 6 }, { 5, 7 }, // Along Y
+    { 0, 4 }, { 1, 5 }, { 2, 6 }, { 3, 7 }, // Along Z
+};
+
+static void GatherSamples(const Volume& Field, const VoxelCoord& Chunk, float* pSamples) noexcept
+{
+    constexpr int32_t N = Volume::ChunkSize;
+
+    // Each neighbour contributes a slab, edge or corner, the chunk itself the middle
+    for (int32_t dz = -1; dz <= 1; dz++)
+    {
+        for (int32_t dy = -1; dy <= 1; dy++)
+        {
+            for (int32_t dx = -1; dx <= 1; dx++)
+            {
+                const float*  pChunk = Field.GetChunk(Volume::PackChunk(Chunk.X + dx, Chunk.Y + dy, Chunk.Z + dz));
+                const int32_t d[3]   = { dx, dy, dz };
+
+                // Apron range and where it starts in the neighbour
+                int32_t kBegin[3]  = {};
+                int32_t kEnd[3]    = {};
+                int32_t kSource[3] = {};
+                for (int32_t a = 0; a < 3; a++)
+                {
+                    kBegin[a]  = d[a] < 0 ? 0 : d[a] == 0 ? 1 : N + 1;
+                    kEnd[a]    = d[a] < 0 ? 1 : d[a] == 0 ? N + 1 : N + 2;
+                    kSource[a] = d[a] < 0 ? N - 1 : 0;
+                }
+
+                for (int32_t z = kBegin[2]; z < kEnd[2]; z++)
+                {
+                    for (int32_t y = kBegin[1]; y < kEnd[1]; y++)
+                    {
+                        float* pRow = pSamples + (size_t(z) * s_ApronSize + size_t(y)) * s_ApronSize;
+                        if (pChunk == nullptr)
+                        {
+                            std::fill(pRow + kBegin[0], pRow + kEnd[0], Field.GetBackground());
+                            continue;
+                        }
+
+                        const float* pSource = pChunk + SampleIndex(kSource[0], kSource[1] + y - kBegin[1], kSource[2] + z - kBegin[2]);
+                        std::copy(pSource, pSource + (kEnd[0] - kBegin[0]), pRow + kBegin[0]);
+                    }
+                }
+            }
+        }
+    }
+}
+
+void VolumeMesher::MeshChunk(const Volume& Field, uint64_t kChunk, float IsoValue, ChunkSurface& Surface) noexcept
+{
+    constexpr int32_t N = Volume::ChunkSize;
+
+    Surface.Positions.clear();
+    Surface.Normals.clear();
+    Surface.Indices.clear();
+
+    const VoxelCoord Chunk = Volume::UnpackChunk(kChunk);
+
+    List<float> Samples = List<float>(size_t(s_ApronSize) * s_ApronSize * s_ApronSize);
+    GatherSamples(Field, Chunk, Samples.data());
+
+    // Nothing to do when every sample is on one side, the common case away from the surface
+    bool bAnyInside  = false;
+    bool bAnyOutside = false;
+    for (const float& Value : Samples)
+    {
+        bAnyInside  |= Value < IsoValue;
+        bAnyOutside |= Value >= IsoValue;
+    }
+    if (!bAnyInside || !bAnyOutside)
+    {
+        return;
+    }
+
+    // Apron coordinates, sample (x, y, z) of the chunk is at (x + 1, y + 1, z + 1)
+    const auto SampleAt = [&](int32_t x, int32_t y, int32_t z) -> float
+    {
+        return Samples[(size_t(z) * s_ApronSize + size_t(y)) * s_ApronSize + size_t(x)];
+    };
+
+    // Cell vertices are made the first time a quad needs them, apron cells the neighbour owns all the edges of never are
+    List<uint32_t>   CellVertices = List<uint32_t>(size_t(s_CellSpan) * s_CellSpan * s_CellSpan, UINT32_MAX);
+    const VoxelCoord Base         = { Chunk.X * N - 1, Chunk.Y * N - 1, Chunk.Z * N - 1 };
+
+    const auto GetVertex = [&](int32_t x, int32_t y, int32_t z) -> uint32_t
+    {
+        uint32_t& kVertex = CellVertices[(size_t(z) * s_CellSpan + size_t(y)) * s_CellSpan + size_t(x)];
+        if (kVertex != UINT32_MAX)
+        {
+            return kVertex;
+        }
+
+        float Corners[8] = {};
+        for (uint32_t k = 0u; k < 8u; k++)
+        {
+            Corners[k] = SampleAt(x + s_CornerOffsets[k][0], y + s_CornerOffsets[k][1], z + s_CornerOffsets[k][2]);
+        }
+
+        // The vertex sits at the mean of the crossings on the cell's edges
+        Float3   Sum        = Float3(0.0f);
+        uint32_t kCrossings = 0u;
+        for (uint32_t e = 0u; e < 12u; e++)
+        {
+            const uint8_t a  = s_CellEdges[e][0];
+            const uint8_t b  = s_CellEdges[e][1];
+            const float   va = Corners[a];
+            const float   vb = Corners[b];
+            if ((va < IsoValue) == (vb < IsoValue))
+            {
+                continue;
+            }
+
+            const float t = (IsoValue - va) / (vb - va);
+            Sum = Sum + Float3(
+                float(s_CornerOffsets[a][0]) + t * float(s_CornerOffsets[b][0] - s_CornerOffsets[a][0]),
+                float(s_CornerOffsets[a][1]) + t * float(s_CornerOffsets[b][1] - s_CornerOffsets[a][1]),
+                float(s_CornerOffsets[a][2]) + t * float(s_CornerOffsets[b][2] - s_CornerOffsets[a][2]));
+            kCrossings++;
+        }
+        const Float3 p = Scale(Sum, 1.0f / float(std::max(kCrossings, 1u)));
+
+        // Gradient of the trilinear interpolant at the vertex, pointing towards positive values
+        const float gx = (1.0f - p.Y) * (1.0f - p.Z) * (Corners[1] - Corners[0]) + p.Y * (1.0f - p.Z) * (Corners[3] - Corners[2]) +
+                         (1.0f - p.Y) * p.Z * (Corners[5] - Corners[4]) + p.Y * p.Z * (Corners[7] - Corners[6]);
+        const float gy = (1.0f - p.X) * (1.0f - p.Z) * (Corners[2] - Corners[0]) + p.X * (1.0f - p.Z) * (Corners[3] - Corners[1]) +
+                         (1.0f - p.X) * p.Z * (Corners[6] - Corners[4]) + p.X * p.Z * (Corners[7] - Corners[5]);
+        const float gz = (1.0f - p.X) * (1.0f - p.Y) * (Corners[4] - Corners[0]) + p.X * (1.0f - p.Y) * (Corners[5] - Corners[1]) +
+                         (1.0f - p.X) * p.Y * (Corners[6] - Corners[2]) + p.X * p.Y * (Corners[7] - Corners[3]);
+
+        kVertex = uint32_t(Surface.Positions.size());
+        // From the global cell so both chunks sharing a cell place its vertex identically
+        Surface.Positions.emplace_back(Field.GetOrigin() + Scale(Float3(float(Base.X + x) + p.X, float(Base.Y + y) + p.Y, float(Base.Z + z) + p.Z), Field.GetVoxelSize()));
+        Surface.Normals.emplace_back(Normalize(Float3(gx, gy, gz)));
+        return kVertex;
+    };
+
+    // Every edge leaving a sample of the chunk in a positive direction is the chunk's, its quad joins the four cells
+    // around it. Going around them counterclockwise about the edge faces the quad along it.
+    for (int32_t z = 1; z <= N; z++)
+    {
+        for (int32_t y = 1; y <= N; y++)
+        {
+            for (int32_t x = 1; x <= N; x++)
+            {
+                const bool bInside = SampleAt(x, y, z) < IsoValue;
+                for (int32_t a = 0; a < 3; a++)
+                {
+                    const int32_t p[3] = { x, y, z };
+                    int32_t       q[3] = { x, y, z };
+                    q[a]++;
+                    if (bInside == (SampleAt(q[0], q[1], q[2]) < IsoValue))
+                    {
+                        continue;
+                    }
+
+                    // Cells are indexed by their lowest sample, cell (0, 0, 0) is the one below the chunk's first sample
+                    const int32_t b = (a + 1) % 3;
+                    const int32_t c = (a + 2) % 3;
+                    int32_t Cells[4][3] = {};
+                    for (uint32_t k = 0u; k < 4u; k++)
+                    {
+                        Cells[k][0] = p[0] - 1;
+                        Cells[k][1] = p[1] - 1;
+                        Cells[k][2] = p[2] - 1;
+                    }
+                    Cells[0][b]--; Cells[0][c]--;
+                    Cells[1][c]--;
+                    Cells[3][b]--;
+
+                    uint32_t kQuad[4] = {};
+                    for (uint32_t k = 0u; k < 4u; k++)
+                    {
+                        kQuad[k] = GetVertex(Cells[k][0] + 1, Cells[k][1] + 1, Cells[k][2] + 1);
+                    }
+                    // Faces +a as listed, which is outwards when the lower sample is the inside one
+                    if (!bInside)
+                    {
+                        std::swap(kQuad[1], kQuad[3]);
+                    }
+
+                    // Split along the shorter diagonal
+                    const Float3 d02 = Surface.Positions[kQuad[2]] - Surface.Positions[kQuad[0]];
+                    const Float3 d13 = Surface.Positions[kQuad[3]] - Surface.Positions[kQuad[1]];
+                    if (Dot(d02, d02) <= Dot(d13, d13))
+                    {
+                        Surface.Indices.insert(Surface.Indices.end(), { kQuad[0], kQuad[1], kQuad[2], kQuad[0], kQuad[2], kQuad[3] });
+                    }
+                    else
+                    {
+                        Surface.Indices.insert(Surface.Indices.end(), { kQuad[0], kQuad[1], kQuad[3], kQuad[1], kQuad[2], kQuad[3] });
+                    }
+                }
+            }
+        }
+    }
+}
+
+size_t VolumeMesher::Update(Volume& Field, float IsoValue, Dictionary<uint64_t, ChunkSurface>& Surfaces, List<uint64_t>* pChanged) noexcept
+{
+    const List<uint64_t> Dirty = Field.TakeDirtyChunks();
+
+    List<ChunkSurface> Meshed = List<ChunkSurface>(Dirty.size());
+    Parallel::For(Dirty.size(), GrainSize, [&](size_t kBegin, size_t kEnd)
+    {
+        for (size_t k = kBegin; k < kEnd; k++)
+        {
+            MeshChunk(Field, Dirty[k], IsoValue, Meshed[k]);
+        }
+    });
+
+    size_t kTriangles = 0u;
+    for (size_t k = 0u; k < Dirty.size(); k++)
+    {
+        kTriangles += Meshed[k].Indices.size() / 3u;
+        if (Meshed[k].Indices.empty())
+        {
+            Surfaces.erase(Dirty[k]);
+        }
+        else
+        {
+            Surfaces[Dirty[k]] = std::move(Meshed[k]);
+        }
+    }
+
+    if (pChanged)
+    {
+        *pChanged = Dirty;
+    }
+    return kTriangles;
+}
@@ -0,0 +1,143 @@
+#pragma once
+
+#include "Core.h"
+#include "Parallel.h"
+
+#include <algorithm>
+
+struct VoxelCoord
+{
+	int32_t X = 0;
+	int32_t Y = 0;
+	int32_t Z = 0;
+};
+
+// Scalar field on an integer lattice, negative inside. Samples are stored in cubic chunks allocated on first write,
+// the rest of the lattice reads as the background value. Writes record which chunks' surfaces they may have changed.
+class Volume
+{
+public:
+	static constexpr int32_t ChunkSize   = 32; // Samples along each side, also the cells a chunk's surface covers
+	static constexpr size_t  ChunkVolume = size_t(ChunkSize) * ChunkSize * ChunkSize;
+
+	explicit Volume(float VoxelSize = 1.0f, const Float3& Origin = {}, float Background = 1.0f) noexcept;
+
+	float Get(int32_t x, int32_t y, int32_t z) const noexcept;
+	void  Set(int32_t x, int32_t y, int32_t z, float Value) noexcept;
+
+	// Copies a dense grid, X fastest then Y, whose first sample lands on Corner
+	void SetDense(const VoxelCoord& Corner, uint32_t kSizeX, uint32_t kSizeY, uint32_t kSizeZ, const float* pSamples) noexcept;
+
+	// Replaces every sample in [Minimum, Maximum] with Func(Position, Value), one chunk per task on the worker
+	// threads. Position is in the volume's space, which makes signed distance brushes simple.
+	template<typename Fn>
+	void Apply(const VoxelCoord& Minimum, const VoxelCoord& Maximum, Fn&& Func);
+
+	// Chunks whose surface may have changed since the last call, sorted and without repeats
+	List<uint64_t> TakeDirtyChunks() noexcept;
+	bool           HasDirtyChunks() const noexcept;
+
+	// Sample storage of a chunk, nullptr when it was never written
+	const float* GetChunk(uint64_t kChunk) const noexcept;
+	size_t       GetChunkCount() const noexcept;
+
+	float         GetVoxelSize() const noexcept  { return m_VoxelSize; }
+	const Float3& GetOrigin() const noexcept     { return m_Origin; }
+	float         GetBackground() const noexcept { return m_Background; }
+
+	Float3 GetPosition(int32_t x, int32_t y, int32_t z) const noexcept;
+
+	// 21 bits a coordinate, which with 32 sample chunks is a lattice 64 million samples across
+	static uint64_t   PackChunk(int32_t x, int32_t y, int32_t z) noexcept;
+	static VoxelCoord UnpackChunk(uint64_t kChunk) noexcept;
+	static int32_t    FloorDiv(int32_t a) noexcept { return a >= 0 ? a / ChunkSize : -((-a + ChunkSize - 1) / ChunkSize); }
+
+private:
+	float* GetOrCreateChunk(uint64_t kChunk) noexcept;
+	// Every chunk whose cells touch a sample in [Minimum, Maximum]
+	void   MarkDirty(const VoxelCoord& Minimum, const VoxelCoord& Maximum) noexcept;
+
+private:
+	Dictionary<uint64_t, List<float>> m_Chunks      = {};
+	List<uint64_t>                    m_DirtyChunks = {};
+	float                             m_VoxelSize   = 1.0f;
+	Float3                            m_Origin      = {};
+	float                             m_Background  = 1.0f;
+};
+
+// Triangles of one chunk in the volume's space. Every cell the surface passes through has one vertex, shared by the
+// quads of all its sign changing edges.
+struct ChunkSurface
+{
+	List<Float3>   Positions = {};
+	List<Float3>   Normals   = {};
+	List<uint32_t> Indices   = {};
+};
+
+// Naive Surface Nets (Gibson 1998), the dual of marching cubes. A chunk owns the lattice edges leaving its own samples
+// and puts vertices in the cells around them, one sample into its neighbours, so chunks mesh independently and still
+// join without cracks. Quads face from negative to positive values.
+class VolumeMesher
+{
+public:
+	static constexpr size_t GrainSize = 1u; // Chunks, each is plenty of work on its own
+
+	static void MeshChunk(const Volume& Field, uint64_t kChunk, float IsoValue, ChunkSurface& Surface) noexcept;
+
+	// Re-meshes every dirty chunk on the worker threads. Surfaces keeps an entry for every chunk with triangles,
+	// chunks left without any are erased. Changed receives every chunk that was re-meshed. Returns the triangles made.
+	static size_t Update(Volume& Field, float IsoValue, Dictionary<uint64_t, ChunkSurface>& Surfaces, List<uint64_t>* pChanged = nullptr) noexcept;
+};
+
+
+template<typename Fn>
+inline void Volume::Apply(const VoxelCoord& Minimum, const VoxelCoord& Maximum, Fn&& Func)
+{
+	if (Minimum.X > Maximum.X || Minimum.Y > Maximum.Y || Minimum.Z > Maximum.Z)
+	{
+		return;
+	}
+
+	// Chunks are created up front, the workers then only write into their own
+	const VoxelCoord First = { FloorDiv(Minimum.X), FloorDiv(Minimum.Y), FloorDiv(Minimum.Z) };
+	const VoxelCoord Last  = { FloorDiv(Maximum.X), FloorDiv(Maximum.Y), FloorDiv(Maximum.Z) };
+
+	List<std::pair<VoxelCoord, float*>> Chunks = {};
+	for (int32_t cz = First.Z; cz <= Last.Z; cz++)
+	{
+		for (int32_t cy = First.Y; cy <= Last.Y; cy++)
+		{
+			for (int32_t cx = First.X; cx <= Last.X; cx++)
+			{
+				Chunks.emplace_back(VoxelCoord{ cx, cy, cz }, GetOrCreateChunk(PackChunk(cx, cy, cz)));
+			}
+		}
+	}
+
+	Parallel::For(Chunks.size(), 1u, [&](size_t kBegin, size_t kEnd)
+	{
+		for (size_t k = kBegin; k < kEnd; k++)
+		{
+			const VoxelCoord& Chunk   = Chunks[k].first;
+			float* const      pChunk  = Chunks[k].second;
+			const VoxelCoord  Base    = { Chunk.X * ChunkSize, Chunk.Y * ChunkSize, Chunk.Z * ChunkSize };
+			const VoxelCoord  Lower   = { std::max(Minimum.X, Base.X), std::max(Minimum.Y, Base.Y), std::max(Minimum.Z, Base.Z) };
+			const VoxelCoord  Upper   = { std::min(Maximum.X, Base.X + ChunkSize - 1), std::min(Maximum.Y, Base.Y + ChunkSize - 1), std::min(Maximum.Z, Base.Z + ChunkSize - 1) };
+
+			for (int32_t z = Lower.Z; z <= Upper.Z; z++)
+			{
+				for (int32_t y = Lower.Y; y <= Upper.Y; y++)
+				{
+					float* pRow = pChunk + (size_t(z - Base.Z) * ChunkSize + size_t(y - Base.Y)) * ChunkSize;
+					for (int32_t x = Lower.X; x <= Upper.X; x++)
+					{
+						float& Value = pRow[x - Base.X];
+						Value = Func(GetPosition(x, y, z), Value);
+					}
+				}
+			}
+		}
+	});
+
+	MarkDirty(Minimum, Maximum);
+}
@@ -0,0 +1,324 @@
+#include "Welder.h"
+#include "Parallel.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+// Sine squared of the largest corner angle below which a triangle counts as having no area
+static constexpr float s_DegenerateSine = 1e-12f;
+
+struct WeldCell
+{
+    int64_t X = 0;
+    int64_t Y = 0;
+    int64_t Z = 0;
+};
+
+static inline bool operator==(const WeldCell& a, const WeldCell& b) noexcept
+{
+    return a.X == b.X && a.Y == b.Y && a.Z == b.Z;
+}
+
+// Multiplicative mixing, cells are hashed millions of times a weld and are already well spread integers
+static inline size_t HashCell(const WeldCell& Cell) noexcept
+{
+    const uint64_t h = uint64_t(Cell.X) * 0x9E3779B97F4A7C15ull ^ uint64_t(Cell.Y) * 0xC2B2AE3D27D4EB4Full ^ uint64_t(Cell.Z) * 0x165667B19E3779F9ull;
+    return size_t(h ^ (h >> 31u));
+}
+
+static inline float Dot(const Float3& u, const Float3& v) noexcept
+{
+    return u.X * v.X + u.Y * v.Y + u.Z * v.Z;
+}
+
+static inline Float3 Cross(const Float3& u, const Float3& v) noexcept
+{
+    return Float3(u.Y * v.Z - u.Z * v.Y, u.Z * v.X - u.X * v.Z, u.X * v.Y - u.Y * v.X);
+}
+
+template<typename Tp>
+static inline const Tp& ElementAt(const Tp* pElements, size_t kStride, size_t kIndex) noexcept
+{
+    return *reinterpret_cast<const Tp*>(reinterpret_cast<const uint8_t*>(pElements) + kIndex * kStride);
+}
+
+// Grid cells and the vertices in each, vertices in ascending order within a cell
+struct WeldGrid
+{
+    List<WeldCell> Cells        = {};
+    List<uint32_t> Slots        = {}; // Open addressing table of cell indices
+    List<uint32_t> CellOffsets  = {};
+    List<uint32_t> CellVertices = {};
+
+    uint32_t Find(const WeldCell& Cell) const noexcept
+    {
+        size_t kSlot = HashCell(Cell) & (Slots.size() - 1u);
+        while (Slots[kSlot] != UINT32_MAX)
+        {
+            if (Cells[Slots[kSlot]] == Cell)
+            {
+                return Slots[kSlot];
+            }
+            kSlot = (kSlot + 1u) & (Slots.size() - 1u);
+        }
+        return UINT32_MAX;
+    }
+};
+
+static void BuildGrid(const List<WeldCell>& VertexCells, List<uint32_t>& CellOfVertex, WeldGrid& Grid) noexcept
+{
+    const size_t kVertexCount = VertexCells.size();
+
+    size_t kCapacity = 16u;
+    while (kCapacity < kVertexCount * 2u)
+    {
+        kCapacity <<= 1u;
+    }
+    Grid.Slots.assign(kCapacity, UINT32_MAX);
+    Grid.Cells.clear();
+
+    CellOfVertex.resize(kVertexCount);
+    for (size_t k = 0u; k < kVertexCount; k++)
+    {
+        const WeldCell& Cell = VertexCells[k];
+
+        size_t kSlot = HashCell(Cell) & (kCapacity - 1u);
+        while (Grid.Slots[kSlot] != UINT32_MAX && !(Grid.Cells[Grid.Slots[kSlot]] == Cell))
+        {
+            kSlot = (kSlot + 1u) & (kCapacity - 1u);
+        }
+        if (Grid.Slots[kSlot] == UINT32_MAX)
+        {
+            Grid.Slots[kSlot] = uint32_t(Grid.Cells.size());
+            Grid.Cells.emplace_back(Cell);
+        }
+        CellOfVertex[k] = Grid.Slots[kSlot];
+    }
+
+    Grid.CellOffsets.assign(Grid.Cells.size() + 1u, 0u);
+    for (size_t k = 0u; k < kVertexCount; k++)
+    {
+        Grid.CellOffsets[CellOfVertex[k] + 1u]++;
+    }
+    for (size_t c = 0u; c < Grid.Cells.size(); c++)
+    {
+        Grid.CellOffsets[c + 1u] += Grid.CellOffsets[c];
+    }
+
+    List<uint32_t> Cursor = List<uint32_t>(Grid.CellOffsets.begin(), Grid.CellOffsets.end() - 1);
+    Grid.CellVertices.resize(kVertexCount);
+    for (size_t k = 0u; k < kVertexCount; k++)
+    {
+        Grid.CellVertices[Cursor[CellOfVertex[k]]++] = uint32_t(k);
+    }
+}
+
+// WELDING
+size_t VertexWelder::Weld(const Float3* pPositions, size_t kPositionStride, const Float3* pNormals, size_t kNormalStride, const Float2* pTexCoords, size_t kTexCoordStride, const uint64_t* pKeys, size_t kVertexCount, const WeldOptions& Options, uint32_t* pRemap) noexcept
+{
+    if (kVertexCount == 0u)
+    {
+        return 0u;
+    }
+
+    Float3 Minimum = ElementAt(pPositions, kPositionStride, 0u);
+    Float3 Maximum = Minimum;
+    for (size_t k = 1u; k < kVertexCount; k++)
+    {
+        const Float3& p = ElementAt(pPositions, kPositionStride, k);
+        Minimum = Float3(std::min(Minimum.X, p.X), std::min(Minimum.Y, p.Y), std::min(Minimum.Z, p.Z));
+        Maximum = Float3(std::max(Maximum.X, p.X), std::max(Maximum.Y, p.Y), std::max(Maximum.Z, p.Z));
+    }
+
+    const Float3  Extent         = Maximum - Minimum;
+    const float   Epsilon        = Options.PositionEpsilon * sqrtf(Dot(Extent, Extent));
+    const float   EpsilonSquared = Epsilon * Epsilon;
+    const float   NormalCosine   = cosf(Options.NormalAngle);
+    const bool    bExact         = !(Epsilon > 0.0f) || !std::isfinite(1.0f / Epsilon);
+    const double  CellSize       = double(Epsilon) * 4.0;
+    const double  Reach          = double(Epsilon) * 1.01; // Slack for rounding in the offsets
+
+    // Exact welding hashes the position bits. Otherwise cells are four tolerances wide, so most vertices are far enough
+    // from every face of their cell to only look in that one.
+    List<WeldCell> VertexCells = List<WeldCell>(kVertexCount);
+    Parallel::For(kVertexCount, GrainSize, [&](size_t kBegin, size_t kEnd)
+    {
+        for (size_t k = kBegin; k < kEnd; k++)
+        {
+            const Float3& p = ElementAt(pPositions, kPositionStride, k);
+            if (bExact)
+            {
+                // Adding zero turns -0 into +0 so both land in one cell
+                const float Key[3]  = { p.X + 0.0f, p.Y + 0.0f, p.Z + 0.0f };
+                uint32_t    Bits[3] = {};
+                memcpy(Bits, Key, sizeof(Bits));
+                VertexCells[k] = { int64_t(Bits[0]), int64_t(Bits[1]), int64_t(Bits[2]) };
+            }
+            else
+            {
+                VertexCells[k] = { int64_t(floor(double(p.X - Minimum.X) / CellSize)), int64_t(floor(double(p.Y - Minimum.Y) / CellSize)), int64_t(floor(double(p.Z - Minimum.Z) / CellSize)) };
+            }
+        }
+    });
+
+    List<uint32_t> CellOfVertex = {};
+    WeldGrid       Grid         = {};
+    BuildGrid(VertexCells, CellOfVertex, Grid);
+
+    const auto Matches = [&](size_t a, size_t b) noexcept -> bool
+    {
+        if (pKeys != nullptr && pKeys[a] != pKeys[b])
+        {
+            return false;
+        }
+
+        const Float3& pa = ElementAt(pPositions, kPositionStride, a);
+        const Float3& pb = ElementAt(pPositions, kPositionStride, b);
+        const Float3  dp = pa - pb;
+        if (bExact ? !(pa.X == pb.X && pa.Y == pb.Y && pa.Z == pb.Z) : Dot(dp, dp) > EpsilonSquared)
+        {
+            return false;
+        }
+
+        if (pNormals != nullptr)
+        {
+            const Float3& na = ElementAt(pNormals, kNormalStride, a);
+            const Float3& nb = ElementAt(pNormals, kNormalStride, b);
+            const bool bEqual = na.X == nb.X && na.Y == nb.Y && na.Z == nb.Z;
+            if (!bEqual && !(Options.NormalAngle > 0.0f && Dot(na, nb) >= NormalCosine * sqrtf(Dot(na, na) * Dot(nb, nb))))
+            {
+                return false;
+            }
+        }
+
+        if (pTexCoords != nullptr)
+        {
+            const Float2& ta = ElementAt(pTexCoords, kTexCoordStride, a);
+            const Float2& tb = ElementAt(pTexCoords, kTexCoordStride, b);
+            if (!(fabsf(ta.X - tb.X) <= Options.TexCoordEpsilon && fabsf(ta.Y - tb.Y) <= Options.TexCoordEpsilon))
+            {
+                return false;
+            }
+        }
+        return true;
+    };
+
+    // Smallest earlier vertex that matches, v itself if none does. With pLeaders only vertices leading their own group count.
+    const auto FindMatch = [&](size_t v, const uint32_t* pLeaders) noexcept -> uint32_t
+    {
+        const WeldCell& Center = VertexCells[v];
+
+        // Per axis, the neighbour cell on the side the vertex is within a tolerance of, if any
+        int64_t Low[3]  = {};
+        int64_t High[3] = {};
+        if (!bExact)
+        {
+            const Float3& p          = ElementAt(pPositions, kPositionStride, v);
+            const double  Offsets[3] = { double(p.X - Minimum.X), double(p.Y - Minimum.Y), double(p.Z - Minimum.Z) };
+            const int64_t Cells[3]   = { Center.X, Center.Y, Center.Z };
+            for (uint32_t a = 0u; a < 3u; a++)
+            {
+                const double Inside = Offsets[a] - double(Cells[a]) * CellSize;
+                Low[a]  = Inside <= Reach ? -1 : 0;
+                High[a] = Inside >= CellSize - Reach ? 1 : 0;
+            }
+        }
+
+        uint32_t kBest = uint32_t(v);
+        for (int64_t z = Low[2]; z <= High[2]; z++)
+        {
+            for (int64_t y = Low[1]; y <= High[1]; y++)
+            {
+                for (int64_t x = Low[0]; x <= High[0]; x++)
+                {
+                    const uint32_t kCell = Grid.Find({ Center.X + x, Center.Y + y, Center.Z + z });
+                    if (kCell == UINT32_MAX)
+                    {
+                        continue;
+                    }
+
+                    for (uint32_t j = Grid.CellOffsets[kCell]; j < Grid.CellOffsets[kCell + 1u]; j++)
+                    {
+                        const uint32_t u = Grid.CellVertices[j];
+                        if (u >= kBest)
+                        {
+                            break;
+                        }
+                        if ((pLeaders == nullptr || pLeaders[u] == u) && Matches(u, v))
+                        {
+                            kBest = u;
+                            break;
+                        }
+                    }
+                }
+            }
+        }
+        return kBest;
+    };
+
+    List<uint32_t> Leaders = List<uint32_t>(kVertexCount);
+    Parallel::For(kVertexCount, GrainSize / 8u, [&](size_t kBegin, size_t kEnd)
+    {
+        for (size_t v = kBegin; v < kEnd; v++)
+        {
+            Leaders[v] = FindMatch(v, nullptr);
+        }
+    });
+
+    // A first match that was itself welded away is not a leader, those vertices look again among leaders only. In
+    // order, so every earlier leader is settled by then.
+    for (size_t v = 0u; v < kVertexCount; v++)
+    {
+        const uint32_t u = Leaders[v];
+        if (u != v && Leaders[u] != u)
+        {
+            Leaders[v] = FindMatch(v, Leaders.data());
+        }
+    }
+
+    size_t kCount = 0u;
+    for (size_t v = 0u; v < kVertexCount; v++)
+    {
+        pRemap[v] = Leaders[v] == v ? uint32_t(kCount++) : pRemap[Leaders[v]];
+    }
+    return kCount;
+}
+
+size_t VertexWelder::RemapIndices(uint32_t* pIndices, size_t kIndexCount, const uint32_t* pRemap, const Float3* pPositions, size_t kPositionStride, bool bRemoveDegenerates) noexcept
+{
+    const size_t  kTriangleCount = kIndexCount / 3u;
+    List<uint8_t> Keep           = List<uint8_t>(kTriangleCount, 1u);
+    Parallel::For(kTriangleCount, GrainSize / 3u, [&](size_t kBegin, size_t kEnd)
+    {
+        for (size_t f = kBegin; f < kEnd; f++)
+        {
+            uint32_t* pCorners = pIndices + f * 3u;
+            pCorners[0] = pRemap[pCorners[0]];
+            pCorners[1] = pRemap[pCorners[1]];
+            pCorners[2] = pRemap[pCorners[2]];
+            if (!bRemoveDegenerates)
+            {
+                continue;
+            }
+
+            const Float3& a = ElementAt(pPositions, kPositionStride, pCorners[0]);
+            const Float3  u = ElementAt(pPositions, kPositionStride, pCorners[1]) - a;
+            const Float3  v = ElementAt(pPositions, kPositionStride, pCorners[2]) - a;
+            const Float3  n = Cross(u, v);
+            const bool bCollapsed = pCorners[0] == pCorners[1] || pCorners[1] == pCorners[2] || pCorners[2] == pCorners[0];
+            Keep[f] = !bCollapsed && Dot(n, n) > s_DegenerateSine * Dot(u, u) * Dot(v, v) ? 1u : 0u;
+        }
+    });
+
+    size_t kCount = 0u;
+    for (size_t f = 0u; f < kTriangleCount; f++)
+    {
+        if (Keep[f])
+        {
+            std::copy(pIndices + f * 3u, pIndices + f * 3u + 3u, pIndices + kCount);
+            kCount += 3u;
+        }
+    }
+    return kCount;
+}
@@ -0,0 +1,89 @@
+#pragma once
+
+#include "Core.h"
+
+#include <type_traits>
+
+// Tolerances are inclusive, all zero welds exactly equal vertices only
+struct WeldOptions
+{
+	float PositionEpsilon    = 1e-6f;   // Fraction of the bounding box diagonal
+	float NormalAngle        = 0.0175f; // Radians, about one degree
+	float TexCoordEpsilon    = 1e-5f;   // Per component
+	bool  bRemoveDegenerates = true;    // Triangles that collapse, or had no area to begin with
+};
+
+struct WeldReport
+{
+	size_t VerticesBefore   = 0u;
+	size_t VerticesAfter    = 0u;
+	size_t TrianglesRemoved = 0u;
+};
+
+// Spatial hash vertex welding. Vertices are bucketed in a grid with cells four position tolerances wide, so a match is
+// in the vertex's own cell or a neighbour it is within a tolerance of, usually the former. A vertex welds onto the first earlier vertex within every
+// tolerance that was not itself welded, as a sequential pass would, but the searches run on the worker threads and
+// only the few vertices whose first match was welded away are settled afterwards in order.
+class VertexWelder
+{
+public:
+	static constexpr size_t GrainSize = 16384u;
+
+	// Remap receives the welded vertex of every vertex, numbered in order of first appearance. Normals and texture
+	// coordinates can be null to leave them out of the comparison. With pKeys, only vertices with equal keys weld,
+	// for data the welder can't compare such as skin weights. Returns the welded vertex count.
+	static size_t Weld(const Float3* pPositions, size_t kPositionStride, const Float3* pNormals, size_t kNormalStride, const Float2* pTexCoords, size_t kTexCoordStride, const uint64_t* pKeys, size_t kVertexCount, const WeldOptions& Options, uint32_t* pRemap) noexcept;
+
+	// Rewrites a triangle list through Remap in place and drops degenerate triangles when asked to. Positions are
+	// those of the welded vertices. Returns the new index count.
+	static size_t RemapIndices(uint32_t* pIndices, size_t kIndexCount, const uint32_t* pRemap, const Float3* pPositions, size_t kPositionStride, bool bRemoveDegenerates) noexcept;
+
+	// The above in place on a vertex type with Float3 Position and Normal members, and Float2 TexCoord if it has one.
+	// The first vertex of every welded group is the one kept.
+	template<typename V>
+	static WeldReport Weld(List<V>& Vertices, List<uint32_t>& Indices, const WeldOptions& Options = {}, const uint64_t* pKeys = nullptr);
+};
+
+
+template<typename V, typename = void>
+struct HasTexCoord : std::false_type { };
+
+template<typename V>
+struct HasTexCoord<V, std::void_t<decltype(V::TexCoord)>> : std::true_type { };
+
+template<typename V>
+inline WeldReport VertexWelder::Weld(List<V>& Vertices, List<uint32_t>& Indices, const WeldOptions& Options, const uint64_t* pKeys)
+{
+	WeldReport Report = {};
+	Report.VerticesBefore = Vertices.size();
+	Report.VerticesAfter  = Vertices.size();
+	if (Vertices.empty())
+	{
+		return Report;
+	}
+
+	const Float2* pTexCoords = nullptr;
+	if constexpr (HasTexCoord<V>::value)
+	{
+		pTexCoords = &Vertices[0].TexCoord;
+	}
+
+	List<uint32_t> Remap  = List<uint32_t>(Vertices.size());
+	const size_t   kCount = Weld(&Vertices[0].Position, sizeof(V), &Vertices[0].Normal, sizeof(V), pTexCoords, sizeof(V), pKeys, Vertices.size(), Options, Remap.data());
+
+	// Remap is in first appearance order, so every kept vertex moves down or stays
+	for (size_t k = 0u, kNext = 0u; k < Vertices.size(); k++)
+	{
+		if (Remap[k] == kNext)
+		{
+			Vertices[kNext++] = Vertices[k];
+		}
+	}
+	Vertices.resize(kCount);
+
+	const size_t kIndexCount = RemapIndices(Indices.data(), Indices.size(), Remap.data(), &Vertices[0].Position, sizeof(V), Options.bRemoveDegenerates);
+	Report.TrianglesRemoved = (Indices.size() - kIndexCount) / 3u;
+	Report.VerticesAfter    = kCount;
+	Indices.resize(kIndexCount);
+	return Report;
+}